@@ -49,6 +49,10 @@ namespace aslam {
       /** @}
         */
 
+      /// Assemble the Hessian in parallel. The result does not depend on the
+      /// number of threads, but every error term keeps a copy of its Hessian
+      /// blocks.
+      bool parallelAssembly;
     };
 
   }
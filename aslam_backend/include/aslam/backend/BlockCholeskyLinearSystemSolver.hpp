@@ -39,6 +39,12 @@ namespace aslam {
 
       std::string name() const override { return "block_" + _solverType; }
 
+      /// \brief return the timing statistics of the last evaluation of the error term contributions
+      ///        in the parallel assembly. Null if the Hessian is assembled serially.
+      const util::ThreadedJobStatistics* getJacobianEvaluationStatistics() const override {
+        return _options.parallelAssembly ? &_contributionLoadBalancer.getStatistics() : NULL;
+      }
+
       /// \brief compute only the covariance blocks associated with the block indices passed as an argument
       void computeCovarianceBlocks(const std::vector<std::pair<int, int> >& blockIndices, SparseBlockMatrix& outP);
 
@@ -54,22 +60,66 @@ namespace aslam {
       /// Helper Function for DogLeg implementation; returns parts required for the steepest descent solution
       double rhsJtJrhs() override;
         
-    private:
-
-      void initSolver();
-      
+    protected:
       /// \brief initialized the matrix structure for the problem with these error terms and errors.
       void initMatrixStructureImplementation(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors, bool useDiagonalConditioner) override;
 
-
       /// \brief The full Hessian matrix.
       SparseBlockMatrixWrapper _H;
 
+      /// Options
+      BlockCholeskyLinearSolverOptions _options;
+
+    private:
+
+      /// \brief The Hessian and right-hand-side contributions of one error term
+      struct ErrorTermContribution {
+        /// \brief The sorted block indices of the active design variables of the error term
+        std::vector<int> blocks;
+        /// \brief The Hessian blocks (blocks[i], blocks[j]) for i <= j, stored at j * (j + 1) / 2 + i
+        std::vector<Eigen::MatrixXd> hessianBlocks;
+        /// \brief The right-hand-side segments of the blocks
+        std::vector<Eigen::VectorXd> rhsSegments;
+      };
+
+      void initSolver();
+
+      /// \brief set up the bookkeeping of the parallel assembly.
+      void initParallelAssembly();
+
+      /// \brief build the Hessian by adding up the error terms one by one.
+      void buildSystemSerial(bool useMEstimator);
+
+      /// \brief build the Hessian in two parallel passes. First, each error term is evaluated into its own
+      ///        contribution. Second, each block column is accumulated by a single thread, adding the contributions
+      ///        in error term order. The result is therefore independent of the number of threads.
+      ///        Error terms must only write to the Hessian blocks of their own active design variables.
+      void buildSystemParallel(size_t nThreads, bool useMEstimator);
+
+      /// \brief evaluate the contributions of the error terms (startIdx .. endIdx - 1)
+      void evaluateContributions(size_t threadId, size_t startIdx, size_t endIdx, bool useMEstimator);
+
+      /// \brief add the contributions to the block columns (startIdx .. endIdx - 1) of the Hessian
+      void accumulateContributions(size_t threadId, size_t startIdx, size_t endIdx);
+
       /// \brief the linear solver
       boost::shared_ptr<LinearSolver> _solver;
 
-      /// Options
-      BlockCholeskyLinearSolverOptions _options;
+      /// \brief The contribution of each error term to the Hessian for the parallel assembly
+      std::vector<ErrorTermContribution> _contributions;
+
+      /// \brief For each block column, the (error term, local block) pairs contributing to it in error term order
+      std::vector< std::vector< std::pair<size_t, size_t> > > _columnContributions;
+
+      /// \brief A Hessian and right-hand-side per thread the error terms are built into before they are copied out
+      std::vector< boost::shared_ptr<SparseBlockMatrix> > _threadHessians;
+      std::vector<Eigen::VectorXd> _threadRhs;
+
+      /// \brief Balances the evaluation of the contributions between the threads
+      util::LoadBalancer _contributionLoadBalancer;
+
+      /// \brief Balances the accumulation of the block columns between the threads
+      util::LoadBalancer _accumulationLoadBalancer;
 
       std::string _solverType;
     };
@@ -41,6 +41,30 @@ namespace aslam {
        */
       cholmod_factor* analyze(cholmod_sparse* J);
 
+      /**
+       * \brief Wraps the cholmod_analyze_p function to use a given fill-reducing ordering
+       *
+       * @param J the sparse matrix to analyze
+       * @param permutation the ordering of the rows of J
+       *
+       * @return a cholmod factor for the matrix. This must be freed using Cholmod::free()
+       */
+      cholmod_factor* analyze(cholmod_sparse* J, index_t* permutation);
+
+      /// \brief Wraps cholmod_amd: orders A, or A*A^T if A is unsymmetric. Returns true for success.
+      bool amd(cholmod_sparse* A, index_t* outPermutation);
+
+      /// \brief Wraps cholmod_colamd: orders A*A^T. Returns true for success.
+      bool colamd(cholmod_sparse* A, index_t* outPermutation);
+
+      /// \brief Wraps cholmod_ccolamd: orders A*A^T such that the rows come in ascending order of their constraint and
+      ///        are ordered by COLAMD within their constraint. Returns false if CHOLMOD has been built without CCOLAMD.
+      bool constrainedColamd(cholmod_sparse* A, index_t* constraints, index_t* outPermutation);
+
+      /// \brief Wraps cholmod_metis: nested dissection of A, or A*A^T if A is unsymmetric.
+      ///        Returns false if CHOLMOD has been built without METIS.
+      bool nestedDissection(cholmod_sparse* A, index_t* outPermutation);
+
       /// \brief wraps the spqr analyze functions
 #ifndef QRSOLVER_DISABLED
       spqr_factor* analyzeQR(cholmod_sparse* J);
@@ -54,6 +78,13 @@ namespace aslam {
         double tol = SPQR_DEFAULT_TOL, bool transpose = false);
 #endif
 
+      /// \brief Copy the numeric factor L to a simplicial LL' factor with packed columns, which start with
+      ///        the diagonal entry. The copy must be freed with free().
+      cholmod_factor* copyToSimplicialLL(cholmod_factor* L);
+
+      /// \brief Wraps the cholmod_copy_factor function, e.g. to factorize another matrix of the same pattern with the symbolic analysis of L.
+      cholmod_factor* copy(cholmod_factor* L);
+
       /// \brief free a cholmod_factor
       void free(cholmod_factor* factor);
 
@@ -99,11 +130,26 @@ namespace aslam {
 #ifndef QRSOLVER_DISABLED
       /// Get the R matrix from the QR decomposition
       void getR(cholmod_sparse* A, cholmod_sparse** R);
+
+      /// Get the R matrix and Q^T b from the QR decomposition of A^T with the
+      /// fixed column ordering. Q is applied to b while factorizing and never
+      /// formed. Returns the rank estimated with the tolerance tol. If given,
+      /// the rows of A are permuted by permutation before, i.e. column k of
+      /// R belongs to row permutation[k] of A.
+      SuiteSparse_long getR(cholmod_sparse* A, cholmod_dense* b,
+        cholmod_sparse** R, cholmod_dense** QTb, double tol = SPQR_DEFAULT_TOL,
+        SuiteSparse_long* permutation = NULL);
 #endif
 
       /// Returns the current memory usage in bytes
       size_t getMemoryUsage() const;
 
+      /// Returns the peak memory usage in bytes
+      size_t getPeakMemoryUsage() const;
+
+      /// Returns the number of non-zeros in the factor of the last symbolic factorization
+      double getFactorNonZeros() const;
+
     private:
 
       cholmod_common _cholmod;
@@ -0,0 +1,108 @@
+#ifndef ASLAM_BACKEND_COMPRESSED_COLUMN_HESSIAN_BUILDER_HPP
+#define ASLAM_BACKEND_COMPRESSED_COLUMN_HESSIAN_BUILDER_HPP
+
+#include <vector>
+
+#include <cholmod.h>
+#include <Eigen/Core>
+
+#include "util/PerThreadErrorVectors.hpp"
+#include "util/PerThreadJacobianContainers.hpp"
+#include "util/ThreadedRangeProcessor.hpp"
+
+namespace aslam {
+  namespace backend {
+
+    class DesignVariable;
+    class ErrorTerm;
+
+    /**
+     * \class CompressedColumnHessianBuilder
+     *
+     * Multithreaded code for building the upper triangle of \f$ \mathbf J^T \mathbf J \f$ and the right-hand side
+     * \f$ -\mathbf J^T \mathbf e \f$ directly from the error terms, without forming the Jacobian.
+     *
+     * The scalar compressed column pattern is computed once from the coupling of the design variables. Within a
+     * column, the rows of the coupled design variables are stored in block order, so the diagonal entry is the last one.
+     * The error terms are split into one contiguous chunk per thread. Each chunk is added up in a buffer of the size of
+     * the Hessian, which are then summed in parallel. The result therefore depends only on the number of threads.
+     */
+    class CompressedColumnHessianBuilder {
+    public:
+      CompressedColumnHessianBuilder();
+      ~CompressedColumnHessianBuilder();
+
+      /// \brief initialize the pattern of the Hessian for these design variables and error terms.
+      ///
+      /// The design variables must be sorted by block index such that dvs[i]->blockIndex() == i.
+      /// Returns true if the pattern is the same as the one of the previous call.
+      bool initMatrixStructure(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors);
+
+      /// \brief build the Hessian and the right-hand side from the weighted Jacobians and errors of the error terms.
+      ///        The errors must have been evaluated.
+      void buildSystem(size_t nThreads, bool useMEstimator, Eigen::VectorXd& outRhs, const util::ThreadedJobOptions& options = util::ThreadedJobOptions());
+
+      /// \brief outY = H x with the full symmetric Hessian
+      void multiply(const Eigen::VectorXd& x, Eigen::VectorXd& outY) const;
+
+      /// \brief Get a view of the upper triangle of the Hessian as a symmetric cholmod sparse matrix with the values \p values.
+      void getView(cholmod_sparse* outView, double* values) const;
+
+      /// \brief get the block pattern of the upper triangle in compressed column form, one row and column per design variable
+      void getBlockStructure(std::vector<int>& outColPtr, std::vector<int>& outRowInd) const;
+
+      /// \brief the minimal dimensions of the design variables, in block order
+      const std::vector<int>& designVariableDimensions() const { return _blockDimension; }
+
+      size_t cols() const { return _colPtr.empty() ? 0 : _colPtr.size() - 1; }
+      size_t nnz() const { return _values.size(); }
+      const std::vector<int>& col_ptr() const { return _colPtr; }
+      const std::vector<int>& row_ind() const { return _rowInd; }
+      /// \brief the values of the upper triangle, the diagonal entry of column c is at col_ptr()[c + 1] - 1
+      const std::vector<double>& values() const { return _values; }
+
+      /// \brief the number of bytes allocated for the pattern, the values and the per thread buffers
+      size_t getMemoryUsage() const;
+
+    private:
+      /// \brief add the error terms of the chunks (startIdx .. endIdx - 1) to their buffers
+      void buildChunks(size_t threadId, size_t startIdx, size_t endIdx, bool useMEstimator);
+      /// \brief sum the buffers of the chunks into the values (startIdx .. endIdx - 1)
+      void sumChunks(size_t threadId, size_t startIdx, size_t endIdx);
+
+      /// \brief the index of the value of block row \p blockRow in the first column of block \p blockCol
+      int blockOffset(int blockRow, int blockCol) const;
+
+      /// \brief The dimension and first column of each design variable block
+      std::vector<int> _blockDimension;
+      std::vector<int> _blockColumnBase;
+
+      /// \brief The block pattern of the upper triangle and, parallel to _blockRowInd, the offset of each block row within the columns of its block column
+      std::vector<int> _blockColPtr;
+      std::vector<int> _blockRowInd;
+      std::vector<int> _blockRowOffset;
+
+      /// \brief The scalar pattern and the values of the upper triangle
+      std::vector<int> _colPtr;
+      std::vector<int> _rowInd;
+      std::vector<double> _values;
+
+      std::vector<ErrorTerm*> _errorTerms;
+
+      /// \brief The chunks of error terms [_chunkBoundaries[k], _chunkBoundaries[k + 1]) and their Hessian and right-hand-side buffers.
+      ///        The first chunk is added up in _values and the right-hand side directly.
+      std::vector<size_t> _chunkBoundaries;
+      std::vector< std::vector<double> > _chunkValues;
+      std::vector<Eigen::VectorXd> _chunkRhs;
+      Eigen::VectorXd* _rhs;
+
+      /// \brief The Jacobian containers, error vectors and a scratch matrix for the Hessian blocks reused by the threads
+      util::PerThreadJacobianContainers<> _jacobianContainers;
+      util::PerThreadErrorVectors _errorVectors;
+      std::vector<Eigen::MatrixXd> _threadBlocks;
+    };
+
+  } // namespace backend
+} // namespace aslam
+
+#endif /* ASLAM_BACKEND_COMPRESSED_COLUMN_HESSIAN_BUILDER_HPP */
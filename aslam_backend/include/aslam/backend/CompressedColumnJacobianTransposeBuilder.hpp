@@ -3,6 +3,9 @@
 
 #include "JacobianBuilder.hpp"
 #include "CompressedColumnMatrix.hpp"
+#include "util/PerThreadErrorVectors.hpp"
+#include "util/PerThreadJacobianContainers.hpp"
+#include "util/ThreadedRangeProcessor.hpp"
 
 namespace aslam {
   namespace backend {
@@ -29,8 +32,45 @@ namespace aslam {
       ///
       virtual void initMatrixStructure(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors);
 
+      /// \brief How updateMatrixStructure() changed the structure of the matrix
+      enum class StructureUpdate {
+        Unchanged, ///< Same sparsity pattern as before, only the values have to be refilled
+        Extended, ///< Error terms were appended, they only couple design variables that were coupled before
+        ExtendedWithNewCoupling, ///< Error terms were appended, some of them couple design variables that were not coupled before
+        Rebuilt ///< The structure was initialized from scratch
+      };
+
+      /// \brief update the internal structure of the matrix, reusing as much of the previous structure as possible.
+      ///
+      /// The sparsity pattern of the design variables and error terms is compared with the one of
+      /// the previous call. If it is unchanged, or error terms were only appended at the end,
+      /// the structure is kept and only the new error terms are added. Otherwise the structure is
+      /// initialized from scratch. The same assumptions as for initMatrixStructure() apply.
+      StructureUpdate updateMatrixStructure(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors);
+
+      /// \brief get the block structure of J^T in compressed column form: one row per design variable and one column per error term.
+      void getBlockStructure(std::vector<index_t>& outColPtr, std::vector<index_t>& outRowInd) const;
+
+      /// \brief the minimal dimensions of the design variables, in block order
+      const std::vector<int>& designVariableDimensions() const { return _designVariableDimensions; }
+
       /// \brief build the large, sparse internal Jacobian matrix from the error terms.
-      virtual void buildSystem(size_t nThreads, bool useMEstimator);
+      ///        Jacobians from evaluateErrorsAndJacobians() with the same \p useMEstimator are used without evaluating them again.
+      virtual void buildSystem(size_t nThreads, bool useMEstimator, const util::ThreadedJobOptions& options = util::ThreadedJobOptions());
+
+      /// \brief evaluate the errors and the weighted Jacobians of the error terms in one pass.
+      ///
+      /// The negative weighted errors are written to \p outE at the row bases of the error terms and
+      /// their squared errors to \p outSquaredErrors, like LinearSystemSolver::evaluateError() does.
+      /// The Jacobians are kept aside, so J^T is unchanged until the next buildSystem() call picks them up.
+      /// Call discardEvaluatedJacobians() if the design variables change before that.
+      void evaluateErrorsAndJacobians(size_t nThreads, bool useMEstimator, Eigen::VectorXd& outE, std::vector<double>& outSquaredErrors, const util::ThreadedJobOptions& options = util::ThreadedJobOptions());
+
+      /// \brief discard the Jacobians of the last evaluateErrorsAndJacobians() call
+      void discardEvaluatedJacobians() { _hasEvaluatedJacobians = false; }
+
+      /// \brief will the next buildSystem() call use the Jacobians of evaluateErrorsAndJacobians()?
+      bool hasEvaluatedJacobians() const { return _hasEvaluatedJacobians; }
 
       /// \brief Get a view of the transpose of the Jacobian as a cholmod sparse matrix.
       virtual cholmod_sparse getJacobianTransposeView();
@@ -41,10 +81,25 @@ namespace aslam {
       /// \brief Get a const version of the compressed column matrix.
         const CompressedColumnMatrix<index_t> & J_transpose() const;
 
+      /// \brief Get the load balancer of the Jacobian evaluation.
+      const util::LoadBalancer & loadBalancer() const;
+
     private:
       /// \brief a function to be run by a single thread.
       void evaluateJacobians(int threadId, int startIdx, int endIdx, bool useMEstimator);
 
+      /// \brief evaluate the errors and Jacobians of the error terms (startIdx .. endIdx - 1)
+      void evaluateErrorsAndJacobians(int threadId, int startIdx, int endIdx, bool useMEstimator, Eigen::VectorXd* outE, std::vector<double>* outSquaredErrors);
+
+      /// \brief reset the load balancer and the Jacobian containers for the error terms
+      void initErrorTermEvaluation(const std::vector<ErrorTerm*>& errors);
+
+      /// \brief append the sparsity pattern of \p e to \p pattern: dimension, number of active design variables and their sorted block indices.
+      static void appendSparsityPattern(const ErrorTerm& e, std::vector<int>& pattern);
+
+      /// \brief do the error terms starting at \p begin in \p pattern only couple design variables that are coupled before \p begin?
+      static bool isCouplingUnchanged(const std::vector<int>& pattern, size_t begin);
+
       /// \brief The transpose of the Jacobian matrix has better cache coherency.
       CompressedColumnMatrix<index_t> _J_transpose;
 
@@ -71,8 +126,26 @@ namespace aslam {
       /// \brief have we built the Jacobian from the transpose?
       bool _isJacobianBuiltFromJacobianTranspose;
 
-      template<typename MEMBER_FUNCTION_PTR>
-      void setupThreadedJob(MEMBER_FUNCTION_PTR ptr, size_t nThreads, bool useMEstimator);
+      /// \brief Balances the Jacobian evaluation between the threads
+      util::LoadBalancer _loadBalancer;
+
+      /// \brief The Jacobian containers and error vectors reused by the threads
+      util::PerThreadJacobianContainers<> _jacobianContainers;
+      util::PerThreadErrorVectors _errorVectors;
+
+      /// \brief The minimal dimensions of the design variables the structure was built for
+      std::vector<int> _designVariableDimensions;
+
+      /// \brief The sparsity pattern of the error terms the structure was built for, see appendSparsityPattern()
+      std::vector<int> _sparsityPattern;
+
+      /// \brief Scratch space for the sparsity pattern of the error terms passed to updateMatrixStructure()
+      std::vector<int> _newSparsityPattern;
+
+      /// \brief The values of J^T evaluated by evaluateErrorsAndJacobians() and whether they are used by the next buildSystem() call
+      std::vector<double> _evaluatedJacobians;
+      bool _hasEvaluatedJacobians;
+      bool _evaluatedJacobiansUseMEstimator;
 
     };
   } // namespace backend
@@ -17,6 +17,7 @@
 #include "ErrorTerm.hpp"
 #include <iostream>
 #include "Matrix.hpp"
+#include "util/ThreadedRangeProcessor.hpp"
 
 namespace aslam {
   namespace backend {
@@ -78,6 +79,9 @@ namespace aslam {
       /// \brief Get the underlying values
       const std::vector<double>& values() const;
 
+      /// \brief Swap the underlying values with \p values, which must have the same size. No diagonal may be appended.
+      void swapValues(std::vector<double>& values);
+
       /// \brief Get the underlying row indices
       const std::vector<index_t>& row_ind() const;
 
@@ -131,6 +135,20 @@ namespace aslam {
       /// \brief left multiply the vector y = A^T x
       void leftMultiply(const Eigen::VectorXd& x, Eigen::VectorXd& outY) const override;
 
+      /// \brief right multiply the vector y = A x with up to \p nThreads threads.
+      ///        The columns are cut into one chunk per thread of about the same number of non-zeros,
+      ///        each chunk scatters into its own buffer and the buffers are summed up in row tiles.
+      ///        The result only depends on the number of threads, not on the scheduling.
+      ///        The buffers are reused between calls, so the threaded products must not be called concurrently on the same matrix.
+      void rightMultiply(const Eigen::VectorXd& x, Eigen::VectorXd& outY, size_t nThreads, const util::ThreadedJobOptions& options = util::ThreadedJobOptions()) const;
+
+      /// \brief left multiply the vector y = A^T x with up to \p nThreads threads
+      void leftMultiply(const Eigen::VectorXd& x, Eigen::VectorXd& outY, size_t nThreads, const util::ThreadedJobOptions& options = util::ThreadedJobOptions()) const;
+
+      /// \brief y = A A^T x with up to \p nThreads threads, i.e. J^T J x for A = J^T.
+      ///        Each column is read once: its dot product with x is scattered back right away.
+      void rightMultiplyNormal(const Eigen::VectorXd& x, Eigen::VectorXd& outY, size_t nThreads, const util::ThreadedJobOptions& options = util::ThreadedJobOptions()) const;
+
 
       /// \brief Initialize the matrix from a dense matrix
       void fromDense(const Eigen::MatrixXd& M) override;
@@ -159,6 +177,22 @@ namespace aslam {
     private:
       void checkMatrixDbg();
 
+      /// \brief the number of columns without the appended diagonal
+      size_t numJacobianColumns() const { return _hasDiagonalAppended ? _cols - _rows : _cols; }
+
+      /// \brief cut the columns (0 .. cols - 1) into \p numChunks ranges with about the same number of non-zeros
+      void computeColumnChunks(size_t cols, size_t numChunks, std::vector<size_t>& outBoundaries) const;
+
+      /// \brief run \p scatterColumns on the column chunks and sum up the per chunk buffers into outY
+      template<typename SCATTER_COLUMNS>
+      void scatterThreaded(SCATTER_COLUMNS scatterColumns, Eigen::VectorXd& outY, size_t nThreads, const util::ThreadedJobOptions& options) const;
+
+      /// \brief the dot product of the column entries (values, rowInd) of length n with x
+      static double sparseDot(const double* values, const index_t* rowInd, index_t n, const double* x);
+
+      /// \brief y += a * column for the column entries (values, rowInd) of length n
+      static void sparseAxpy(double a, const double* values, const index_t* rowInd, index_t n, double* y);
+
       size_t _rows;
       size_t _cols;
       std::vector<double> _values;
@@ -167,6 +201,10 @@ namespace aslam {
 
       bool _hasDiagonalAppended;
 
+      /// \brief The column chunks and the per chunk buffers of scatterThreaded(), reused between calls
+      mutable std::vector<size_t> _scatterBoundaries;
+      mutable std::vector<Eigen::VectorXd> _scatterBuffers;
+
       /// \brief If enabled the system builder must not complain about constant error terms (:= not depending on any active design variable)
       bool _acceptConstantErrorTerms = false;
 
@@ -48,6 +48,27 @@ namespace aslam {
       /** @}
         */
 
+      /// Decompositions of the dense system
+      enum Decomposition {
+        /// Rank-revealing column pivoting Householder QR of J
+        COL_PIV_HOUSEHOLDER_QR,
+        /// Blocked Householder QR of J without pivoting, requires J to have
+        /// full column rank
+        HOUSEHOLDER_QR,
+        /// Cholesky decomposition LLT of the normal equations J^T J, which are
+        /// formed in parallel once per system. Falls back to
+        /// COL_PIV_HOUSEHOLDER_QR if J^T J is not positive definite or its
+        /// reciprocal condition number is below normalEquationsMinRcond.
+        NORMAL_EQUATIONS_LLT,
+        /// Same as NORMAL_EQUATIONS_LLT with the LDLT decomposition
+        NORMAL_EQUATIONS_LDLT
+      };
+
+      /// The decomposition used to solve the system
+      Decomposition decomposition;
+      /// The minimal estimate of the reciprocal condition number of the
+      /// damped J^T J for which the normal equations are used
+      double normalEquationsMinRcond;
     };
 
   }
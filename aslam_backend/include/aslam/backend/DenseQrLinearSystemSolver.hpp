@@ -1,8 +1,15 @@
 #ifndef ASLAM_DENSE_QR_LINEAR_SYSTEM_SOLVER_HPP
 #define ASLAM_DENSE_QR_LINEAR_SYSTEM_SOLVER_HPP
 
+#include <memory>
+#include <vector>
+
+#include <Eigen/Cholesky>
+#include <Eigen/QR>
+
 #include "LinearSystemSolver.hpp"
 #include "DenseMatrix.hpp"
+#include "JacobianContainerRows.hpp"
 
 #include "aslam/backend/DenseQRLinearSolverOptions.h"
 
@@ -26,6 +33,10 @@ namespace aslam {
       /// \brief solve the system storing the solution in outDx and returning true on success.
       bool solveSystem(Eigen::VectorXd& outDx) override;
 
+      /// \brief solve the system for several constant conditioners in parallel, each thread decomposes its own copy of the augmented Jacobian
+      ///        or of the damped normal equations.
+      void solveSystems(const std::vector<double>& conditioners, size_t nThreads, std::vector<Eigen::VectorXd>& outDx) override;
+
       /// \brief return the Jacobian matrix if available. Null if not available.
       const Matrix* Jacobian() const override;
       const Eigen::MatrixXd& getJacobian() const;
@@ -43,8 +54,36 @@ namespace aslam {
 
       /// Helper Function for DogLeg implementation; returns parts required for the steepest descent solution
       double rhsJtJrhs() override;
+
+      /// \brief The number of solves of the normal equations that fell back to the QR decomposition
+      size_t getNumNormalEquationsFallbacks() const { return _numNormalEquationsFallbacks; }
     
     private:
+      /// \brief The matrices and decompositions of a solve, which keep their memory for the next solve of the same size
+      struct Workspace {
+        Eigen::MatrixXd augmentedJ;
+        Eigen::MatrixXd dampedHessian;
+        Eigen::ColPivHouseholderQR<Eigen::MatrixXd> colPivQr;
+        Eigen::HouseholderQR<Eigen::MatrixXd> qr;
+        Eigen::LLT<Eigen::MatrixXd> llt;
+        Eigen::LDLT<Eigen::MatrixXd> ldlt;
+      };
+
+      /// \brief solve the system with the diagonal conditioner \p conditioner, or without one if it is NULL.
+      ///        outFellBack is set if the normal equations were rejected for the QR decomposition.
+      bool solve(const Eigen::VectorXd* conditioner, Workspace& workspace, Eigen::VectorXd& outDx, bool& outFellBack) const;
+      /// \brief solve the damped normal equations, returns false if they are not positive definite or ill conditioned
+      bool solveNormalEquations(const Eigen::VectorXd* conditioner, Workspace& workspace, Eigen::VectorXd& outDx) const;
+      /// \brief solve the least squares problem of the Jacobian with the conditioner rows appended
+      void solveQr(const Eigen::VectorXd* conditioner, bool pivoting, Workspace& workspace, Eigen::VectorXd& outDx) const;
+      /// \brief whether the options select the normal equations
+      bool useNormalEquations() const;
+
+      /// \brief form the lower triangle of J^T J from one chunk of rows per thread
+      void computeHessian();
+      /// \brief a method for a thread to add up the Hessian of the chunks of rows (startIdx .. endIdx - 1)
+      void computeChunkHessians(size_t threadId, size_t startIdx, size_t endIdx);
+
       /// \brief a method for a thread to evaluate Jacobians
       void evaluateJacobians(size_t threadId, size_t startIdx, size_t endIdx, bool useMEstimator);
 
@@ -56,6 +95,28 @@ namespace aslam {
 
       Eigen::VectorXd _truncated_e;
 
+      /// \brief The errors the system was built at followed by zeros for the conditioner rows,
+      ///        _e is overwritten by the error evaluations of rejected steps
+      Eigen::VectorXd _systemE;
+
+      /// \brief The lower triangle of J^T J of the normal equations, formed at the first solve after buildSystem()
+      Eigen::MatrixXd _hessian;
+      bool _hessianValid = false;
+      /// \brief The chunks of rows [_chunkBoundaries[k], _chunkBoundaries[k + 1]) of J and the Hessians of all but the first one
+      std::vector<size_t> _chunkBoundaries;
+      std::vector<Eigen::MatrixXd> _chunkHessians;
+
+      /// \brief The workspace of solveSystem() and the ones of the threads of solveSystems()
+      Workspace _workspace;
+      std::vector<Workspace> _threadWorkspaces;
+
+      /// \brief The number of threads of the last buildSystem call
+      size_t _nThreads = 1;
+      size_t _numNormalEquationsFallbacks = 0;
+
+      /// \brief The Jacobian containers of the threads, which write into the rows of _J
+      std::vector<std::unique_ptr<JacobianContainerRows> > _jacobianContainers;
+
       /// Options
       DenseQRLinearSolverOptions _options;
 
@@ -55,6 +55,18 @@ namespace aslam {
       /// \brief evaluate the Jacobians.
       void evaluateJacobians(JacobianContainer & outJacobians);
 
+      /// \brief evaluate the error term and its Jacobians in one pass and return the effective squared error.
+      ///        This is equivalent to evaluateError() followed by evaluateJacobians(), but the error term can
+      ///        reuse intermediate results of the error for the Jacobians, see evaluateErrorAndJacobiansImplementation().
+      double evaluateErrorAndJacobians(JacobianContainer & outJacobians) {
+        _squaredError = evaluateErrorAndJacobiansImplementation(outJacobians);
+        return getSquaredError();
+      }
+
+      /// \brief evaluate the error term, its weighted error and its weighted Jacobians in one pass and return the effective squared error.
+      ///        This is equivalent to evaluateError() followed by getWeightedError() and getWeightedJacobians().
+      virtual double evaluateWeightedErrorAndJacobians(Eigen::VectorXd& outE, JacobianContainer& outJc, bool useMEstimator);
+
       /// \brief evaluate the Jacobians using finite differences.
       void evaluateJacobiansFiniteDifference(JacobianContainer & outJacobians);
       
@@ -137,6 +149,11 @@ namespace aslam {
       /// \brief Get the design variables
       const std::vector<DesignVariable*> & designVariables() const;
 
+      /// \brief Get a relative estimate of the cost to evaluate this error term and its Jacobians.
+      ///        It is used to balance the error terms between threads until measured timings are available.
+      ///        The default assumes the cost to scale with the size of the Jacobian. Override it for expensive error terms.
+      virtual double getEvaluationCostHint() const;
+
       /// \brief Get the column base of this error term in the Jacobian matrix.
       size_t rowBase() const { return _rowBase; }
 
@@ -154,6 +171,10 @@ namespace aslam {
       /// \brief evaluate the Jacobians
       virtual void evaluateJacobiansImplementation(JacobianContainer & outJacobians) = 0;
 
+      /// \brief evaluate the error term and the Jacobians and return the squared error like evaluateErrorImplementation().
+      ///        The default calls evaluateErrorImplementation() and evaluateJacobiansImplementation().
+      virtual double evaluateErrorAndJacobiansImplementation(JacobianContainer & outJacobians);
+
       /// \brief get the number of dimensions of this error term.
       virtual size_t getDimensionImplementation() const = 0;
 
@@ -204,6 +225,9 @@ namespace aslam {
     };
 
 
+    template<int DIMENSION, int... DESIGN_VARIABLE_DIMENSIONS>
+    class ErrorTermFs;
+
     /**
      * \class ErrorTermFs
      * \brief An implementation of a vector-valued error term.
@@ -211,9 +235,11 @@ namespace aslam {
      * This class fills in some of the functionality needed for "normal", vector-valued error terms.
      * In most cases, one will want to derive from this class when implementing an error term.
      *
+     * If the minimal dimensions of the design variables are known at compile time as well,
+     * derive from ErrorTermFs<DIMENSION, DESIGN_VARIABLE_DIMENSIONS...> instead.
      */
     template<int DIMENSION>
-    class ErrorTermFs : public ErrorTerm {
+    class ErrorTermFs<DIMENSION> : public ErrorTerm {
     public:
       EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
@@ -245,6 +271,10 @@ namespace aslam {
       void getWeightedJacobians(JacobianContainer& outJc, bool useMEstimator) override;
       void getWeightedError(Eigen::VectorXd& e, bool useMEstimator) const override;
 
+      /// \brief evaluate the error and the Jacobians with evaluateErrorAndJacobians() if the M-estimator weight
+      ///        does not depend on the error, i.e. the weighting of the Jacobians is known beforehand.
+      double evaluateWeightedErrorAndJacobians(Eigen::VectorXd& outE, JacobianContainer& outJc, bool useMEstimator) override;
+
       /// Check if Jacobians are finite
       void checkJacobiansFinite() const;
       /// Check if analytical and numerical Jacobians match
@@ -298,6 +328,97 @@ namespace aslam {
       Timer _buildHessianTimer;
     };
 
+    namespace detail {
+      /// \brief The sum of the design variable dimensions
+      template<int... DIMENSIONS>
+      struct SumOfDimensions { enum { value = 0 }; };
+      template<int D, int... DIMENSIONS>
+      struct SumOfDimensions<D, DIMENSIONS...> { enum { value = D + SumOfDimensions<DIMENSIONS...>::value }; };
+
+      /// \brief The dimension of design variable \p I
+      template<int I, int... DIMENSIONS>
+      struct DesignVariableDimension;
+      template<int D, int... DIMENSIONS>
+      struct DesignVariableDimension<0, D, DIMENSIONS...> { enum { value = D }; };
+      template<int I, int D, int... DIMENSIONS>
+      struct DesignVariableDimension<I, D, DIMENSIONS...> { enum { value = DesignVariableDimension<I - 1, DIMENSIONS...>::value }; };
+
+      /// \brief The first column of the Jacobian of design variable \p I in the stacked Jacobian
+      template<int I, int... DIMENSIONS>
+      struct DesignVariableColumnOffset;
+      template<int D, int... DIMENSIONS>
+      struct DesignVariableColumnOffset<0, D, DIMENSIONS...> { enum { value = 0 }; };
+      template<int I, int D, int... DIMENSIONS>
+      struct DesignVariableColumnOffset<I, D, DIMENSIONS...> { enum { value = D + DesignVariableColumnOffset<I - 1, DIMENSIONS...>::value }; };
+    } // namespace detail
+
+    /**
+     * \class ErrorTermFs
+     * \brief A vector-valued error term with fixed-size design variables, e.g. ErrorTermFs<2, 6, 3> for a
+     *        reprojection error depending on a pose and a landmark.
+     *
+     * The design variables have to be set in the order of \p DESIGN_VARIABLE_DIMENSIONS. Child classes
+     * implement evaluateFixedSizeJacobiansImplementation() instead of evaluateJacobiansImplementation().
+     * The Jacobians, their weighting with the square root information matrix and the Hessian blocks are then
+     * computed with fixed-size matrices, i.e. without heap allocations and with vectorized kernels.
+     */
+    template<int DIMENSION, int... DESIGN_VARIABLE_DIMENSIONS>
+    class ErrorTermFs : public ErrorTermFs<DIMENSION> {
+    public:
+      EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+      typedef ErrorTermFs<DIMENSION> parent_t;
+      enum {
+        NumDesignVariables = sizeof...(DESIGN_VARIABLE_DIMENSIONS),
+        JacobianCols = detail::SumOfDimensions<DESIGN_VARIABLE_DIMENSIONS...>::value
+      };
+      static_assert(NumDesignVariables > 0, "There has to be at least one design variable");
+
+      /// \brief The Jacobians of all design variables, stacked horizontally in the order of the design variables
+      typedef Eigen::Matrix<double, DIMENSION, JacobianCols> jacobian_t;
+
+      /// \brief The minimal dimension of design variable \p I
+      template<int I>
+      struct DesignVariableDimension {
+        enum { value = detail::DesignVariableDimension<I, DESIGN_VARIABLE_DIMENSIONS...>::value };
+      };
+
+      /// \brief The first column of design variable \p I in jacobian_t
+      template<int I>
+      struct DesignVariableColumnOffset {
+        enum { value = detail::DesignVariableColumnOffset<I, DESIGN_VARIABLE_DIMENSIONS...>::value };
+      };
+
+      /// \brief The Jacobian of design variable \p I, a view on \p J
+      template<int I, typename DERIVED>
+      static Eigen::Block<DERIVED, DIMENSION, DesignVariableDimension<I>::value> jacobianBlock(Eigen::MatrixBase<DERIVED>& J)
+      {
+        return J.template block<DIMENSION, DesignVariableDimension<I>::value>(0, DesignVariableColumnOffset<I>::value);
+      }
+
+      void getWeightedJacobians(JacobianContainer& outJc, bool useMEstimator) override;
+
+      /// \brief evaluate the error and the fixed-size weighted Jacobians
+      double evaluateWeightedErrorAndJacobians(Eigen::VectorXd& outE, JacobianContainer& outJc, bool useMEstimator) override;
+
+    protected:
+      /// \brief evaluate the Jacobians with respect to all design variables, even inactive ones
+      virtual void evaluateFixedSizeJacobiansImplementation(jacobian_t& outJacobian) = 0;
+
+      /// \brief evaluate the Jacobians by adding the fixed-size ones to \p outJacobians
+      void evaluateJacobiansImplementation(JacobianContainer& outJacobians) override;
+
+      /// \brief build the Hessian with fixed-size products
+      void buildHessianImplementation(SparseBlockMatrix& outHessian, Eigen::VectorXd& outRhs, bool useMEstimator) override;
+
+    private:
+      /// \brief Evaluate the Jacobian and check the design variables in debug mode
+      void evaluateFixedSizeJacobians(jacobian_t& outJacobian);
+
+      /// \brief The square root of the M-estimator weight
+      double sqrtMEstimatorWeight(bool useMEstimator) const;
+    };
+
   } // namespace backend
 } // namespace aslam
 
@@ -120,6 +120,13 @@ namespace aslam {
       }
 
     protected:
+      /// \brief Set the number of rows. The chain rule stack has to be empty.
+      void setRows(int rows)
+      {
+        this->setNumRows(rows);
+        _rows = rows;
+      }
+
       /// \brief The number of rows for this set of Jacobians
       int _rows;
 
@@ -0,0 +1,87 @@
+#ifndef ASLAM_JACOBIAN_CONTAINER_ROWS_HPP
+#define ASLAM_JACOBIAN_CONTAINER_ROWS_HPP
+
+#include <vector>
+
+#include <aslam/Exceptions.hpp>
+#include "DesignVariable.hpp"
+#include "JacobianContainer.hpp"
+#include "implementation/JacobianContainerImpl.hpp"
+
+namespace aslam {
+  namespace backend {
+
+    /**
+     * \class JacobianContainerRows
+     * \brief Writes the Jacobians of an error term straight into its rows of a preallocated dense matrix.
+     *
+     * The container is moved to the rows of each error term with reset(), which zeroes only the blocks of the
+     * active design variables of that term. Error terms with disjoint rows can thus be evaluated into the same
+     * matrix by one container per thread.
+     */
+    class JacobianContainerRows : public JacobianContainer {
+    public:
+      SM_DEFINE_EXCEPTION(Exception, aslam::Exception);
+      static constexpr const int RowsAtCompileTime = Eigen::Dynamic;
+
+      /// \brief Constructs the container writing into \p jacobian, which has to outlive it
+      explicit JacobianContainerRows(Eigen::MatrixXd& jacobian) : JacobianContainer(1), _jacobian(jacobian), _rowBase(0) { }
+
+      /// \brief Destructor
+      ~JacobianContainerRows() override { }
+
+      /// \brief Target the rows [rowBase, rowBase + rows) and zero the blocks of the active design variables \p dvs in them.
+      ///        The chain rule stack has to be empty.
+      void reset(int rowBase, int rows, const std::vector<DesignVariable*>& dvs)
+      {
+        SM_ASSERT_GE_LE_DBG(Exception, rowBase, 0, _jacobian.rows() - rows, "The rows must be within the matrix");
+        setRows(rows);
+        _rowBase = rowBase;
+        for (const DesignVariable* dv : dvs) {
+          if (dv->isActive())
+            _jacobian.block(_rowBase, dv->columnBase(), rows, dv->minimalDimensions()).setZero();
+        }
+      }
+
+      /// \brief Add a jacobian to the list. If the design variable is not active,
+      /// discard the value.
+      void add(DesignVariable* designVariable, const Eigen::Ref<const Eigen::MatrixXd>& Jacobian) override
+      {
+        internal::JacobianContainerImplHelper::addImpl(*this, designVariable, Jacobian);
+      }
+      void add(DesignVariable* designVariable) override
+      {
+        internal::JacobianContainerImplHelper::addImpl(*this, designVariable);
+      }
+
+      /// Check whether the entries corresponding to design variable \p dv are finite
+      bool isFinite(const DesignVariable& dv) const override
+      {
+        return _jacobian.block(_rowBase, dv.columnBase(), rows(), dv.minimalDimensions()).allFinite();
+      }
+
+      /// \brief Gets the rows of the current error term
+      Eigen::MatrixXd asDenseMatrix() const override { return _jacobian.middleRows(_rowBase, rows()); }
+
+    private:
+
+      template <typename MATRIX>
+      EIGEN_ALWAYS_INLINE void addJacobian(DesignVariable* dv, const MATRIX& Jacobian)
+      {
+        SM_ASSERT_EQ_DBG(Exception, rows(), Jacobian.rows(), "");
+        SM_ASSERT_GE_LE_DBG(Exception, dv->columnBase(), 0, _jacobian.cols() - Jacobian.cols(), "Check that column base of design variable is set correctly");
+        // Several contributions of the same design variable are summed up
+        _jacobian.block(_rowBase, dv->columnBase(), Jacobian.rows(), Jacobian.cols()).noalias() += Jacobian;
+      }
+
+      friend class internal::JacobianContainerImplHelper;
+
+      /// \brief The matrix written to and the first row of the current error term
+      Eigen::MatrixXd& _jacobian;
+      int _rowBase;
+    };
+
+  } // namespace backend
+} // namespace aslam
+
+#endif /* ASLAM_JACOBIAN_CONTAINER_ROWS_HPP */
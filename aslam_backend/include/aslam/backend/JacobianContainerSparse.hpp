@@ -3,8 +3,10 @@
 
 #include <sparse_block_matrix/sparse_block_matrix.h>
 #include <aslam/Exceptions.hpp>
-#include <map>
+#include <iterator>
 #include <set>
+#include <type_traits>
+#include <vector>
 #include "DesignVariable.hpp"
 #include "JacobianContainer.hpp"
 #include "backend.hpp"
@@ -19,11 +21,56 @@ namespace aslam {
       SM_DEFINE_EXCEPTION(Exception, aslam::Exception);
       static constexpr const int RowsAtCompileTime = Rows;
 
-      /// \brief The map type for storing Jacobians. Sorting the list by block index
-      ///        simplifies computing the upper-diagonal of the Hessian matrix.
-      typedef std::map<DesignVariable*, Eigen::MatrixXd, DesignVariable::BlockIndexOrdering> map_t;
       typedef DesignVariable::set_t set_t;
 
+      /// \brief Views on the Jacobians stored in the container
+      typedef Eigen::Map<Eigen::MatrixXd> JacobianMap;
+      typedef Eigen::Map<const Eigen::MatrixXd> ConstJacobianMap;
+
+      /// \brief A (design variable, Jacobian) pair as returned by the iterators.
+      ///        It mimics a std::pair, the Jacobian is a view on the storage of the container.
+      template<typename MAP>
+      struct EntryReference {
+        EntryReference(DesignVariable* dv, const MAP& jacobian) : first(dv), second(jacobian) { }
+        /// \brief Allows the iterators to return the pair by value from operator->
+        EntryReference* operator->() { return this; }
+
+        DesignVariable* first; /// \brief The design variable
+        MAP second; /// \brief The Jacobian with respect to the design variable
+      };
+
+      /// \brief Iterator over the Jacobians in ascending block index order
+      template<bool IsConst>
+      class Iterator {
+       public:
+        typedef typename std::conditional<IsConst, const JacobianContainerSparse, JacobianContainerSparse>::type container_t;
+        typedef EntryReference<typename std::conditional<IsConst, ConstJacobianMap, JacobianMap>::type> value_type;
+        typedef value_type reference;
+        typedef value_type pointer;
+        typedef std::ptrdiff_t difference_type;
+        typedef std::forward_iterator_tag iterator_category;
+
+        Iterator() : _container(nullptr), _index(0) { }
+        Iterator(container_t* container, std::size_t index) : _container(container), _index(index) { }
+        /// \brief Conversion from a mutable iterator
+        Iterator(const Iterator<false>& other) : _container(other.container()), _index(other.index()) { }
+
+        reference operator*() const { return _container->entryReference(_index); }
+        pointer operator->() const { return _container->entryReference(_index); }
+        Iterator& operator++() { ++_index; return *this; }
+        Iterator operator++(int) { Iterator it(*this); ++_index; return it; }
+        bool operator==(const Iterator& rhs) const { return _index == rhs._index && _container == rhs._container; }
+        bool operator!=(const Iterator& rhs) const { return !(*this == rhs); }
+
+        container_t* container() const { return _container; }
+        std::size_t index() const { return _index; }
+       private:
+        container_t* _container;
+        std::size_t _index;
+      };
+      typedef Iterator<false> iterator;
+      typedef Iterator<true> const_iterator;
+
       JacobianContainerSparse(int rows, const std::size_t maxNumMatrices = 100)
           : aslam::backend::JacobianContainer(rows, maxNumMatrices)
       {
@@ -70,32 +117,35 @@ namespace aslam {
       /// \brief Get design variable i.
       const DesignVariable* designVariable(size_t i) const;
 
-      map_t::const_iterator begin() const;
-      map_t::const_iterator end() const;
+      const_iterator begin() const;
+      const_iterator end() const;
 
-      map_t::iterator begin();
-      map_t::iterator end();
+      iterator begin();
+      iterator end();
 
 
       /// Check whether the entries corresponding to design variable \p dv are finite
       bool isFinite(const DesignVariable& dv) const override;
 
       /// Get the Jacobian associated with a particular design variable \p dv
-      const Eigen::MatrixXd& Jacobian(const DesignVariable* dv) const;
+      ConstJacobianMap Jacobian(const DesignVariable* dv) const;
 
       /// \brief Apply the chain rule to the set of Jacobians.
       /// This may change the number of rows of this set of Jacobians
       /// by multiplying through by df_dx on the left.
       void applyChainRule(const Eigen::MatrixXd& df_dx);
 
-      /// \brief Clear the contents of this container
+      /// \brief Clear the contents of this container. The memory is kept for reuse.
       void clear();
 
       /// \brief Set all entries to zero
       inline void setZero();
 
-      /// \brief Clean and set the number of rows
+      /// \brief Clean and set the number of rows. The memory is kept for reuse.
       void reset(int rows);
+
+      /// \brief Reserve memory for \p numDesignVariables Jacobians with \p numValues values in total
+      void reserve(std::size_t numDesignVariables, std::size_t numValues);
       
       /// \brief Gets a sparse matrix with the Jacobians. The matrix is, in fact, dense
       ///        and the Jacobian ordering matches the sort order.
@@ -115,25 +165,41 @@ namespace aslam {
       /// The number of columns in the compressed Jacobian. Warning: this is expensive.
       int cols() const;
     private:
+      /// \brief The location of the Jacobian of one design variable in the buffer
+      struct Entry {
+        DesignVariable* designVariable;
+        int cols; /// \brief The number of columns of the Jacobian
+        std::size_t offset; /// \brief The offset of the (column major) Jacobian in the buffer
+      };
+      typedef std::vector<Entry> entry_vector_t;
 
-      void buildCorrelatedHessianBlock(const Eigen::VectorXd& e,
-                                       const Eigen::MatrixXd& J1, int j1_block,
-                                       SparseBlockMatrix& outHessian,
-                                       map_t::const_iterator it, map_t::const_iterator it_end) const;
+      /// \brief Find the entry of the design variable \p dv or the position to insert it
+      typename entry_vector_t::iterator findEntry(const DesignVariable* dv);
+      typename entry_vector_t::const_iterator findEntry(const DesignVariable* dv) const;
 
-      void buildHessianBlock(const Eigen::VectorXd& e,
-                             SparseBlockMatrix& outHessian,
-                             Eigen::VectorXd& outRhs,
-                             map_t::const_iterator it, map_t::const_iterator it_end) const;
+      JacobianMap jacobianMap(const Entry& entry) { return JacobianMap(_buffer.data() + entry.offset, _rows, entry.cols); }
+      ConstJacobianMap jacobianMap(const Entry& entry) const { return ConstJacobianMap(_buffer.data() + entry.offset, _rows, entry.cols); }
 
+      typename iterator::value_type entryReference(std::size_t i) { return typename iterator::value_type(_entries[i].designVariable, jacobianMap(_entries[i])); }
+      typename const_iterator::value_type entryReference(std::size_t i) const { return typename const_iterator::value_type(_entries[i].designVariable, jacobianMap(_entries[i])); }
 
       template <typename MATRIX>
       void addJacobian(DesignVariable * dv, const MATRIX & jacobian);
 
       friend class internal::JacobianContainerImplHelper;
 
-      /// \brief The list of design variables.
-      map_t _jacobianMap;
+      /// \brief The Jacobians sorted by the block index of their design variable. Sorting the list
+      ///        by block index simplifies computing the upper-diagonal of the Hessian matrix.
+      entry_vector_t _entries;
+
+      /// \brief The values of all Jacobians
+      std::vector<double> _buffer;
+
+      /// \brief Scratch space for applying the chain rule
+      std::vector<double> _chainRuleBuffer;
+
+      /// \brief Scratch space for the scaled Jacobians and error of evaluateHessian()
+      mutable std::vector<double> _scaledBuffer;
     };
 
   } // namespace backend
@@ -33,13 +33,23 @@ namespace aslam {
           std::ostream & printState(std::ostream & out) const override;
           bool requiresAugmentedDiagonal() const override;
           std::string name() const override { return "levenberg_marquardt"; }
+
+          /// \brief Set the number of damping values tried after a rejected step, 1 to try only the next one.
+          ///        The systems are solved together. Their steps are evaluated from the least damped one on, as many at
+          ///        once as the trial cost function allows, and the first one that decreases the cost is taken. The
+          ///        remaining batches are skipped. Requires a trial cost function, set by Optimizer2.
+          void setNumTrialLambdas(int numTrialLambdas);
+          int getNumTrialLambdas() const { return _numTrialLambdas; }
         private:
           double getLmRho(const Eigen::VectorXd & dx);
+          /// \brief solve for the next _numTrialLambdas damping values and keep the least damped one that decreases the cost
+          bool solveTrialLambdas(double J, int nThreads, Eigen::VectorXd& outDx);
           double _lambdaInit;
           double _gammaInit;
           double _betaInit;
           int _pInit;
           double _muInit;
+          int _numTrialLambdas;
           
           double _lambda;
           double _gamma;
@@ -43,6 +43,8 @@ THE POSSIBILITY OF SUCH DAMAGE.
 
 */
 
+#include <vector>
+
 #include <boost/shared_ptr.hpp>
 #include <boost/optional.hpp>
 #include <boost/function.hpp>
@@ -188,6 +190,7 @@ namespace aslam {
       std::size_t nMaxIterWolfe1 = 30; /// \brief Maximum number of iterations for method wolfe1
       std::size_t nMaxIterWolfe2 = 10; /// \brief Maximum number of iterations for method wolfe2
       std::size_t nMaxIterZoom = 10;   /// \brief Maximum number of iterations for the internal zoom method
+      std::size_t numParallelEvaluations = 1; /// \brief Number of step lengths evaluated concurrently if the cost function supports it, 1 disables speculative evaluation
 
       template<class Archive>
       inline void serialize(Archive & ar, const unsigned int version);
@@ -260,6 +263,10 @@ namespace aslam {
        * Search for a step length that satisfies strong Wolfe conditions.
        * Uses the line search algorithm to enforce strong Wolfe conditions. See Wright and Nocedal, 'Numerical Optimization', 1999, pg. 59-60.
        * Adapted from scipy https://github.com/scipy/scipy/blob/master/scipy/optimize/linesearch.py#L296
+       *
+       * If speculative evaluation is enabled (see isSpeculative()), the doubling step lengths of the bracketing phase are
+       * evaluated in batches of LineSearchOptions::numParallelEvaluations in parallel. They are checked in the same order
+       * as sequentially, so the accepted step length does not change. The zoom phase stays sequential.
        * @return Successful or not
        */
       bool lineSearchWolfe2();
@@ -267,6 +274,7 @@ namespace aslam {
       /**
        * Search for a step length that satisfies strong Wolfe conditions
        * Same as lineSearchWolfe1, but fall back to lineSearchWolfe2 if suitable step length is not found.
+       * If speculative evaluation is enabled, lineSearchWolfe2 is tried first, since its bracketing phase runs in parallel.
        * @return Successful or not
        */
       bool lineSearchWolfe12();
@@ -322,6 +330,12 @@ namespace aslam {
        */
       inline double getCurrentStepLength() const;
 
+      /**
+       * Whether step lengths are evaluated speculatively in parallel, i.e. LineSearchOptions::numParallelEvaluations > 1
+       * and the cost function supports concurrent evaluations
+       */
+      bool isSpeculative() const;
+
     private: // private methods
 
       /**
@@ -329,6 +343,17 @@ namespace aslam {
        */
       bool zoom(double minStepLength, double maxStepLength, double error_lo, double error_hi, double derror_lo, double error0, double derror0);
 
+      /**
+       * Evaluates the error and gradient at the \p n step lengths \p stepLength * 2^j, j = 0 .. n - 1, in parallel without
+       * changing the state. The results replace the previous speculative evaluations.
+       */
+      void evaluateSpeculatively(double stepLength, std::size_t n);
+
+      /**
+       * Same as applyStateUpdate(), but the error and gradient are taken from the speculative evaluations if \p s is among them
+       */
+      void applySpeculativeStateUpdate(const double s);
+
     private: // private members
 
       /// \brief Cost function
@@ -358,6 +383,11 @@ namespace aslam {
       /// \brief Whether an update of the gradient-related information is neccesary
       bool _derrorOutdated = true;
 
+      /// \brief Step lengths evaluated speculatively with the corresponding errors and gradients
+      std::vector<double> _speculativeStepLengths;
+      std::vector<double> _speculativeErrors;
+      std::vector<RowVectorType> _speculativeGradients;
+
       /// \brief Callback  that is called when the objective function is evaluated
       boost::function<void(void)> _evalErrorCallback;
 
@@ -5,6 +5,8 @@
 #include <Eigen/Core>
 #include <boost/function.hpp>
 #include <sm/assert_macros.hpp>
+#include <aslam/backend/util/PerThreadErrorVectors.hpp>
+#include <aslam/backend/util/ThreadedRangeProcessor.hpp>
 
 namespace aslam {
   namespace backend {
@@ -17,6 +19,16 @@ namespace aslam {
       class Manager;
     }
 
+    /// \brief The outcome of the last solve of an iterative linear system solver
+    struct IterativeSolverStatistics {
+      /// \brief The number of iterations
+      std::size_t iterations = 0;
+      /// \brief The norm of the final residual relative to the norm of the right-hand side
+      double relativeResidual = 0.0;
+      /// \brief Did the solver reach its tolerance?
+      bool converged = false;
+    };
+
     class LinearSystemSolver {
     public:
       SM_DEFINE_EXCEPTION(Exception, std::runtime_error);
@@ -28,6 +40,14 @@ namespace aslam {
       /// \brief Evaluate the error using nThreads.
       double evaluateError(size_t nThreads, bool useMEstimator, callback::Manager * callback = nullptr);
 
+      /// \brief Evaluate the error like evaluateError() and, if the solver supports it, the Jacobians for the next
+      ///        buildSystem() call in the same pass over the error terms.
+      ///        Call discardEvaluatedJacobians() if the design variables change before buildSystem() is called.
+      double evaluateErrorAndJacobians(size_t nThreads, bool useMEstimator, callback::Manager * callback = nullptr);
+
+      /// \brief Discard the Jacobians of the last evaluateErrorAndJacobians() call, buildSystem() evaluates them again.
+      virtual void discardEvaluatedJacobians() { }
+
       /// \brief initialized the matrix structure for the problem with these error terms and errors.
       void initMatrixStructure(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors, bool useDiagonalConditioner);
 
@@ -42,9 +62,20 @@ namespace aslam {
       ///        NOTE: The square of this value will be added to the diagonal of the Hessian matrix
       virtual void setConstantConditioner(double diag);
 
+      /// \brief Get the diagonal matrix conditioner.
+      const Eigen::VectorXd& getConditioner() const {
+        return _diagonalConditioner;
+      }
+
       /// \brief solve the system storing the solution in outDx and returning true on success.
       virtual bool solveSystem(Eigen::VectorXd& outDx) = 0;
 
+      /// \brief solve the system for several constant diagonal conditioners, e.g. the damping values of Levenberg-Marquardt.
+      ///        outDx[i] is the solution for conditioners[i], empty if it failed. The default solves one after the other,
+      ///        solvers that can factorize the conditioned systems independently use up to nThreads threads.
+      ///        Afterwards, the constant conditioner is the last one.
+      virtual void solveSystems(const std::vector<double>& conditioners, size_t nThreads, std::vector<Eigen::VectorXd>& outDx);
+
       virtual std::string name() const = 0;
 
       /// \brief return the right-hand side of the equation system.
@@ -72,11 +103,41 @@ namespace aslam {
       // helper function for dog leg implementation / steepest descent solution
       virtual double rhsJtJrhs() = 0;
 
+      /// \brief Whether the matrix structure has been initialized with a diagonal conditioner
+      bool usesDiagonalConditioner() const {
+        return _useDiagonalConditioner;
+      }
+
       /// \brief If enabled the system builder must not throw on constant error terms (:= not depending on any active design variable)
       bool isAcceptConstantErrorTerms() const {
         return _acceptConstantErrorTerms;
       }
       void setAcceptConstantErrorTerms(bool acceptConstantErrorTerms);
+
+      /// \brief The scheduling options for the multi-threaded jobs
+      const util::ThreadedJobOptions& getThreadedJobOptions() const {
+        return _threadedJobOptions;
+      }
+      void setThreadedJobOptions(const util::ThreadedJobOptions& options);
+
+      /// \brief return the timing statistics of the last error evaluation
+      const util::ThreadedJobStatistics& getErrorEvaluationStatistics() const {
+        return _errorLoadBalancer.getStatistics();
+      }
+
+      /// \brief return the timing statistics of the last Jacobian evaluation if available. Null if not available.
+      virtual const util::ThreadedJobStatistics* getJacobianEvaluationStatistics() const {
+        return NULL;
+      }
+
+      /// \brief Set the tolerance of the residual norm relative to the norm of the right-hand side for the next solve,
+      ///        i.e. the forcing term of an inexact Newton method. Only iterative solvers use it, 0 resets their own tolerance.
+      virtual void setForcingTolerance(double /* tolerance */) { }
+
+      /// \brief return the statistics of the last solve if the solver is iterative. Null if not available.
+      virtual const IterativeSolverStatistics* getIterativeSolverStatistics() const {
+        return NULL;
+      }
     protected:
       /// \brief initialized the matrix structure for the problem with these error terms and errors.
       virtual void initMatrixStructureImplementation(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors, bool useDiagonalConditioner) = 0;
@@ -88,8 +149,19 @@ namespace aslam {
       /// \brief a function for one thread to evaluate a set of error terms.
       void evaluateErrors(size_t threadId, size_t startIdx, size_t endIdx, bool useMEstimator);
 
+      /// \brief Evaluate the errors into _e and _squaredErrors together with the Jacobians for the next buildSystem() call.
+      ///        Returns false if the solver cannot fuse the evaluations, the default.
+      virtual bool evaluateErrorsAndJacobiansImplementation(size_t /* nThreads */, bool /* useMEstimator */) { return false; }
+
+      /// \brief Issue the RESIDUALS_UPDATED callback and sum the squared errors
+      double sumSquaredErrors(callback::Manager * callback) const;
+
       /// \brief a function to split a multi-threaded job across all error term indices.
-      void setupThreadedJob(boost::function<void(size_t, size_t, size_t, bool)> job, size_t nThreads, bool useMEstimator);
+      ///        If \p loadBalancer is given, the error terms are split by their estimated cost.
+      void setupThreadedJob(boost::function<void(size_t, size_t, size_t, bool)> job, size_t nThreads, bool useMEstimator, util::LoadBalancer* loadBalancer = NULL);
+
+      /// \brief collect the evaluation cost hints of the error terms.
+      static std::vector<double> getEvaluationCostHints(const std::vector<ErrorTerm*>& errors);
 
       /// \brief Event hook to handle new value for the acceptConstantErrorTerms property
       virtual void handleNewAcceptConstantErrorTerms();
@@ -97,8 +169,17 @@ namespace aslam {
       /// \brief the vector of error terms.
       std::vector<ErrorTerm*> _errorTerms;
 
-      /// \brief The squared error values calculated locally for a single thread.
-      std::vector<double> _threadLocalErrors;
+      /// \brief The squared error values of the error terms.
+      std::vector<double> _squaredErrors;
+
+      /// \brief The scheduling options for the multi-threaded jobs
+      util::ThreadedJobOptions _threadedJobOptions;
+
+      /// \brief Balances the error evaluation between the threads
+      util::LoadBalancer _errorLoadBalancer;
+
+      /// \brief The weighted errors of the error terms, reused by the threads
+      util::PerThreadErrorVectors _errorVectors;
 
       /// \brief the error vector;
       Eigen::VectorXd _e;
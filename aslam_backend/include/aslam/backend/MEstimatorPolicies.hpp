@@ -13,6 +13,8 @@ namespace aslam {
       virtual ~MEstimator();
       virtual double getWeight(double squaredError) const = 0;
       virtual std::string name() const = 0;
+      /// \brief does the weight depend on the squared error? The default is true.
+      virtual bool isErrorDependent() const;
     };
 
     class NoMEstimator : public MEstimator {
@@ -20,6 +22,7 @@ namespace aslam {
       ~NoMEstimator() override;
       double getWeight(double squaredError) const override;
       std::string name() const override;
+      bool isErrorDependent() const override;
     };
 
     class  GemanMcClureMEstimator : public MEstimator {
@@ -52,6 +55,7 @@ namespace aslam {
       double getWeight(double error) const override;
       virtual void setWeight(double weight);
       std::string name() const override;
+      bool isErrorDependent() const override;
 
       double _weight;
     };
@@ -11,6 +11,7 @@
 #include <aslam/backend/DesignVariable.hpp>
 #include <aslam/backend/MarginalizationPriorErrorTerm.hpp>
 #include <aslam/backend/ErrorTerm.hpp>
+#include <aslam/backend/MarginalizerOptions.h>
 #include <boost/shared_ptr.hpp>
 
 namespace aslam {
@@ -38,6 +39,22 @@ void marginalize(
 			size_t numTopRowsInRtop = 0,
 			size_t numThreads = 1
 		);
+
+/// \brief Marginalizes out the given design variables with the method and the number of threads of \p options
+///
+/// See the overload above for the parameters. With MarginalizerOptions::SPARSE_QR, the design variables to remove
+/// stay in front, Q is never formed and the rank is taken from the factorization.
+void marginalize(
+			std::vector<aslam::backend::DesignVariable*>& inDesignVariables,
+			std::vector<aslam::backend::ErrorTerm*>& inErrorTerms,
+			int numberOfInputDesignVariablesToRemove,
+			bool useMEstimator,
+			boost::shared_ptr<aslam::backend::MarginalizationPriorErrorTerm>& outPriorErrorTermPtr,
+			Eigen::MatrixXd& outRtop,
+			std::vector<aslam::backend::DesignVariable*>& designVariablesInvolvedInRtop,
+			size_t numTopRowsInRtop,
+			const MarginalizerOptions& options
+		);
 } /* namespace backend */
 } /* namespace aslam */
 #endif /* MARGINALIZER_H_ */
@@ -0,0 +1,59 @@
+/** \file MarginalizerOptions.h
+    \brief This file defines the MarginalizerOptions class which contains the
+           options of the marginalization.
+  */
+
+#ifndef ASLAM_BACKEND_MARGINALIZER_OPTIONS_H
+#define ASLAM_BACKEND_MARGINALIZER_OPTIONS_H
+
+#include <cstddef>
+
+namespace aslam {
+  namespace backend {
+
+    /** The class MarginalizerOptions contains the options of
+        aslam::backend::marginalize().
+        \brief Marginalizer options
+      */
+    class MarginalizerOptions {
+    public:
+      /** \name Constructors/destructor
+        @{
+        */
+      /// Default constructor
+      MarginalizerOptions();
+      /// Copy constructor
+      MarginalizerOptions(const MarginalizerOptions& other);
+      /// Assignment operator
+      MarginalizerOptions& operator = (const MarginalizerOptions& other);
+      /// Destructor
+      virtual ~MarginalizerOptions();
+      /** @}
+        */
+
+      /// Methods computing the square root information form of the prior
+      enum Method {
+        /// Dense Householder QR of the Jacobian
+        DENSE_QR,
+        /// Sparse QR of the Jacobian with SuiteSparseQR. Falls back to
+        /// DENSE_QR if the Jacobian is rank deficient or SuiteSparseQR is not
+        /// available.
+        SPARSE_QR,
+        /// Block Cholesky elimination of the removed design variables from the
+        /// Hessian J^T J, which is assembled in parallel into a sparse block
+        /// matrix. The Schur complement is formed with parallel block products
+        /// and factorized with a dense Cholesky decomposition. Falls back to
+        /// DENSE_QR if the Hessian is not positive definite.
+        SCHUR_COMPLEMENT
+      };
+
+      /// The method used to marginalize
+      Method method;
+      /// The number of threads used to build and eliminate the system
+      size_t numThreads;
+    };
+
+  }
+}
+
+#endif // ASLAM_BACKEND_MARGINALIZER_OPTIONS_H
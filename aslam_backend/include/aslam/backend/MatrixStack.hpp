@@ -119,6 +119,13 @@ namespace backend {
     /// \brief Number of matrix elements stored
     std::size_t numElements() const { return _dataSize; }
 
+    /// \brief Set the number of rows of the first matrix. The stack has to be empty.
+    void setNumRows(const uint16_t numRows)
+    {
+      SM_ASSERT_TRUE(Exception, this->empty(), "The number of rows can only be changed on an empty stack");
+      _numRows = numRows;
+    }
+
     /// \brief Push a matrix \p mat to the top of the stack
     template <typename DERIVED>
     EIGEN_ALWAYS_INLINE void push(const Eigen::MatrixBase<DERIVED>& mat)
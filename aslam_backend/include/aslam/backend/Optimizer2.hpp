@@ -104,6 +104,12 @@ namespace aslam {
       void computeDiagonalCovariances(SparseBlockMatrix& outP, double lambda);
 
       /// \brief compute only the covariance blocks associated with the block indices passed as an argument
+      ///
+      /// The blocks of \f$ (\mathbf H + \lambda^2 \mathbf I)^{-1} \f$ are recovered from the sparse Cholesky factor. If the
+      /// optimizer runs a SparseCholeskyLinearSystemSolver, the system and the factorization of its last iteration are reused;
+      /// the factorization is only redone if \p lambda differs from the last conditioner. Otherwise the system is built at the
+      /// current estimate, with the M-estimator. The blocks are computed with numThreadsJacobian threads. The conditioner of the
+      /// optimizer's solver and the status of the optimization are left unchanged.
       void computeCovarianceBlocks(const std::vector<std::pair<int, int> >& blockIndices, SparseBlockMatrix& outP, double lambda);
 
       void computeHessian(SparseBlockMatrix& outH, double lambda);
@@ -154,8 +160,20 @@ namespace aslam {
       /// \brief Revert the last state update.
       void revertLastStateUpdate();
 
+      /// \brief Evaluate the error at the current state with the M-estimator and, if fuseErrorAndJacobianEvaluation is set,
+      ///        the Jacobians for the next system in the same pass.
+      double evaluateStepError();
+
       /// \brief Apply a state update.
-      double applyStateUpdate();
+      double applyStateUpdate(const Eigen::VectorXd& dx);
+
+      /// \brief The cost after the state update dx. Used by the trust region policy to compare trial steps. With replicas of
+      ///        the problem, see addProblemReplica(), the step is evaluated on a replica and the calls may run concurrently.
+      ///        Otherwise the update is applied to the design variables and reverted again.
+      double evaluateTrialStep(const Eigen::VectorXd& dx);
+
+      /// \brief The number of trial steps that evaluateTrialStep() can evaluate concurrently
+      size_t numConcurrentTrialSteps();
 
       /// \brief issue callback for given event
       template<typename Event>
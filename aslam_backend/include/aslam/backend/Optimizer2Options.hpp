@@ -15,14 +15,16 @@ namespace aslam {
       Optimizer2Options() :
         doSchurComplement(false),
         verbose(false),
-        linearSolverMaximumFails(0)
+        linearSolverMaximumFails(0),
+        fuseErrorAndJacobianEvaluation(false)
       {
         convergenceDeltaError = 1e-3;
         convergenceDeltaX = 1e-3;
         maxIterations = 20;
       }
 
-      /// \brief should we use the Schur complement trick? Currently not supported.
+      /// \brief should we use the Schur complement trick? If no linear system solver is set, the SchurComplementLinearSystemSolver
+      ///        eliminates the marginalized design variables (DesignVariable::isMarginalized()).
       bool doSchurComplement;
 
       /// \brief should we print out some information each iteration?
@@ -31,6 +33,11 @@ namespace aslam {
       /// \brief The number of times the linear solver may fail before the optimization is aborted. (>0 only if a fall back is available!)
       int linearSolverMaximumFails;
 
+      /// \brief should the error evaluation after each state update also evaluate the Jacobians, in the same pass over the
+      ///        error terms? They are used for the next system if the step is accepted and discarded otherwise. Only the
+      ///        solvers building J^T (sparse_cholesky, sparse_qr and pcg) support it, at the cost of a second copy of its values.
+      bool fuseErrorAndJacobianEvaluation;
+
       boost::shared_ptr<LinearSystemSolver> linearSystemSolver;
       boost::shared_ptr<TrustRegionPolicy> trustRegionPolicy;
     };
@@ -41,6 +48,7 @@ namespace aslam {
       out << "\tdoSchurComplement: " << options.doSchurComplement << std::endl;
       out << "\tverbose: " << options.verbose << std::endl;
       out << "\tlinearSolverMaximumFails: " << options.linearSolverMaximumFails << std::endl;
+      out << "\tfuseErrorAndJacobianEvaluation: " << options.fuseErrorAndJacobianEvaluation << std::endl;
       return out;
     }
   } // namespace backend
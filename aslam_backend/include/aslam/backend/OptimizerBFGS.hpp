@@ -23,6 +23,8 @@ namespace aslam {
       LineSearchOptions linesearch; /// \brief Linesearch options
       bool useDenseJacobianContainer = true; /// \brief Whether or not to use a dense Jacobian container
       boost::shared_ptr<ScalarNonSquaredErrorTerm> regularizer = NULL; /// \brief Regularizer
+      int historySize = 0; /// \brief Number of correction pairs stored by the limited-memory variant (L-BFGS). With 0, the dense inverse Hessian is updated.
+      bool useDesignVariableScaling = false; /// \brief Whether the initial inverse Hessian is the diagonal of the squared design variable scalings instead of the identity
 
       void check() const override;
 
@@ -38,6 +40,11 @@ namespace aslam {
      * \class OptimizerBFGS
      *
      * Broyden-Fletcher-Goldfarb-Shannon algorithm implementation for the ASLAM framework.
+     *
+     * By default, a dense approximation of the inverse Hessian is stored and updated, which takes O(n^2) memory and time
+     * per iteration. With a positive OptimizerOptionsBFGS::historySize m, the limited-memory variant (L-BFGS) is run instead.
+     * It keeps the last m step and gradient differences and computes the search direction with the two-loop recursion
+     * in O(mn).
      */
     class OptimizerBFGS : public OptimizerProblemManagerBase
     {
@@ -83,6 +90,15 @@ namespace aslam {
       /// \brief Update the status
       void updateStatus(bool lineSearchSuccess);
 
+      /// \brief Reset the inverse Hessian approximation to the initial diagonal, or clear the L-BFGS history
+      void resetInverseHessian();
+
+      /// \brief Compute the search direction -H_k * \p gradient
+      void computeSearchDirection(const RowVectorType& gradient, RowVectorType& outDirection);
+
+      /// \brief Update the inverse Hessian approximation with the step \p sk and the gradient difference \p yk
+      void updateInverseHessian(const RowVectorType& sk, const RowVectorType& yk);
+
     private:
 
       /// \brief Problem manager
@@ -94,6 +110,19 @@ namespace aslam {
       /// \brief The current estimate of the inverse Hessian
       Eigen::MatrixXd _Bk;
 
+      /// \brief The diagonal of the initial inverse Hessian
+      RowVectorType _H0;
+
+      /// \brief The L-BFGS history as ring buffer, column i holds the step s_i and gradient difference y_i, rho_i = 1/(y_i^T s_i)
+      Eigen::MatrixXd _S;
+      Eigen::MatrixXd _Y;
+      Eigen::VectorXd _rho;
+      /// \brief Scratch space for the two-loop recursion
+      Eigen::VectorXd _alpha;
+      /// \brief The column of the newest pair and the number of stored pairs
+      int _newest = -1;
+      int _numPairs = 0;
+
       /// \brief Line-search class
       LineSearch _linesearch;
 
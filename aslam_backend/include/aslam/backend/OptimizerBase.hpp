@@ -14,6 +14,7 @@
 
 // self
 #include <aslam/backend/util/CommonDefinitions.hpp> // RowVectorType
+#include <aslam/backend/util/ThreadedRangeProcessor.hpp> // ThreadedJobOptions
 #include <aslam/backend/OptimizationProblemBase.hpp>
 #include <aslam/backend/OptimizerCallbackManager.hpp>
 
@@ -62,10 +63,16 @@ struct OptimizerOptionsBase
   int maxIterations = 100; /// \brief Stop if we reach this number of iterations without hitting any of the above stopping criteria. -1 for unlimited.
   std::size_t numThreadsJacobian = 4; /// \brief The number of threads to use for gradient/Jacobian computation
   std::size_t numThreadsError = 1; /// \brief The number of threads to use for error computation
+  bool useThreadPool = true; /// \brief Run multi-threaded computations on the shared persistent thread pool instead of spawning threads on every call
+  std::size_t threadPoolChunkSize = 0; /// \brief The number of error terms a pool thread claims at once. 0 chooses a chunk size automatically.
+  bool balanceThreadLoad = true; /// \brief Split the error terms between the threads by their measured evaluation cost instead of their number
 
   /// \brief Checks options for sanity. Throws if any options is not valid.
   virtual void check() const;
 
+  /// \brief The scheduling options for multi-threaded computations
+  util::ThreadedJobOptions getThreadedJobOptions() const;
+
   template<class Archive>
   inline void serialize(Archive & ar, const unsigned int version);
 };
@@ -60,6 +60,18 @@ struct LINEAR_SYSTEM_SOLVED : Event {
   using Event::Event;
 };
 
+/// \brief Right after LINEAR_SYSTEM_SOLVED if the linear system solver is iterative
+struct ITERATIVE_LINEAR_SYSTEM_SOLVED : Event {
+  ITERATIVE_LINEAR_SYSTEM_SOLVED(double currentCost_, double previousLowestCost_, std::size_t iterations_, double relativeResidual_)
+      : Event(currentCost_, previousLowestCost_), iterations(iterations_), relativeResidual(relativeResidual_)
+  {
+  }
+  /// \brief the number of iterations of the last solve
+  std::size_t iterations;
+  /// \brief the norm of the final residual of the last solve relative to the norm of the right-hand side
+  double relativeResidual;
+};
+
 /// \brief Right after the design variables (X) have been updated.
 struct DESIGN_VARIABLES_UPDATED : Event {
   using Event::Event;
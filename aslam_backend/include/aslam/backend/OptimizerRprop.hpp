@@ -96,6 +96,11 @@ namespace aslam {
         return (0.0 < val) - (val < 0.0);
       }
 
+      /// \brief Adapt the step-lengths, compute the update and store the gradient for the next iteration in one pass
+      ///        over all parameters. Returns the maximum absolute update coefficient.
+      template <OptimizerOptionsRprop::Method METHOD>
+      double computeStep(bool errorIncreased);
+
     private:
 
       /// \brief The dense update vector.
@@ -104,6 +109,9 @@ namespace aslam {
       /// \brief current step-length to be performed into the negative direction of the gradient
       ColumnVectorType _delta;
 
+      /// \brief gradient in the current iteration, reused between iterations
+      RowVectorType _gradient;
+
       /// \brief gradient in the previous iteration
       RowVectorType _prev_gradient;
 
@@ -0,0 +1,68 @@
+/** \file PcgLinearSolverOptions.h
+    \brief This file defines the PcgLinearSolverOptions class which contains
+           specific options for the preconditioned conjugate gradient linear
+           solver.
+  */
+
+#ifndef ASLAM_BACKEND_PCG_LINEAR_SOLVER_OPTIONS_H
+#define ASLAM_BACKEND_PCG_LINEAR_SOLVER_OPTIONS_H
+
+#include <cstddef>
+
+namespace aslam {
+  namespace backend {
+
+    /** The class PcgLinearSolverOptions contains specific options for the
+        preconditioned conjugate gradient linear solver.
+        \brief PCG linear solver options
+      */
+    class PcgLinearSolverOptions {
+    public:
+      /** \name Constructors/destructor
+        @{
+        */
+      /// Default constructor
+      PcgLinearSolverOptions();
+      /// Copy constructor
+      PcgLinearSolverOptions(const PcgLinearSolverOptions& other);
+      /// Assignment operator
+      PcgLinearSolverOptions& operator =
+        (const PcgLinearSolverOptions& other);
+      /// Destructor
+      virtual ~PcgLinearSolverOptions();
+      /** @}
+        */
+
+      /// Preconditioners of the normal equations
+      enum Preconditioner {
+        /// No preconditioning
+        NONE,
+        /// The inverses of the diagonal blocks of the design variables
+        BLOCK_JACOBI,
+        /// Eliminates the marginalized design variables like the Schur
+        /// complement, approximating the Schur complement of the remaining
+        /// design variables by its diagonal blocks. Marginalized design
+        /// variables must not share an error term with each other. Without
+        /// marginalized design variables this is BLOCK_JACOBI.
+        SCHUR_JACOBI
+      };
+
+      /** \name Members
+        @{
+        */
+      /// The preconditioner
+      Preconditioner preconditioner;
+      /// The tolerance of the residual norm relative to the norm of the
+      /// right-hand side, used unless a trust region policy sets a forcing
+      /// tolerance
+      double tolerance;
+      /// The maximum number of iterations, 0 for the dimension of the system
+      std::size_t maxIterations;
+      /** @}
+        */
+    };
+
+  }
+}
+
+#endif // ASLAM_BACKEND_PCG_LINEAR_SOLVER_OPTIONS_H
@@ -0,0 +1,196 @@
+#ifndef ASLAM_BACKEND_PCG_LINEAR_SYSTEM_SOLVER_HPP
+#define ASLAM_BACKEND_PCG_LINEAR_SYSTEM_SOLVER_HPP
+
+#include <utility>
+#include <vector>
+
+#include "LinearSystemSolver.hpp"
+#include "CompressedColumnJacobianTransposeBuilder.hpp"
+
+#include "aslam/backend/PcgLinearSolverOptions.h"
+
+namespace sm {
+
+  class PropertyTree;
+
+}
+namespace aslam {
+  namespace backend {
+
+    /**
+     * \class PcgLinearSystemSolver
+     *
+     * Solves the normal equations with the preconditioned conjugate gradient method without forming the Hessian.
+     * The Hessian-vector products (J^T J + D^2) x are computed from the compressed column J^T in two parallel passes,
+     * one over the error terms for J x and one over the design variables for J^T (J x). The preconditioner is built
+     * from the Jacobian as well, see PcgLinearSolverOptions::Preconditioner.
+     *
+     * The solution is inexact: the iteration stops as soon as the residual norm relative to the norm of the
+     * right-hand side drops below the forcing tolerance set by the trust region policy, or the tolerance of the options.
+     */
+    class PcgLinearSystemSolver : public LinearSystemSolver {
+    public:
+      PcgLinearSystemSolver(const PcgLinearSolverOptions& options = PcgLinearSolverOptions());
+      PcgLinearSystemSolver(const sm::PropertyTree& config);
+      ~PcgLinearSystemSolver() override;
+
+      void buildSystem(size_t nThreads, bool useMEstimator) override;
+
+      /// \brief solve the system storing the solution in outDx. The solution fails only if the first iteration fails.
+      bool solveSystem(Eigen::VectorXd& outDx) override;
+
+      std::string name() const override { return "pcg"; }
+
+      /// \brief return the timing statistics of the last Jacobian evaluation
+      const util::ThreadedJobStatistics* getJacobianEvaluationStatistics() const override {
+        return &_jacobianBuilder.loadBalancer().getStatistics();
+      }
+
+      /// \brief discard the Jacobians of the last evaluateErrorAndJacobians() call
+      void discardEvaluatedJacobians() override { _jacobianBuilder.discardEvaluatedJacobians(); }
+
+      void setForcingTolerance(double tolerance) override { _forcingTolerance = tolerance; }
+
+      const IterativeSolverStatistics* getIterativeSolverStatistics() const override { return &_statistics; }
+
+      /// Helper Function for DogLeg implementation; returns parts required for the steepest descent solution
+      double rhsJtJrhs() override;
+
+      /// \brief outY = (J^T J + D^2) x, where D is the diagonal conditioner if it is used
+      void multiplyHessian(const Eigen::VectorXd& x, Eigen::VectorXd& outY);
+
+      /// Returns the current Jacobian transpose
+      const CompressedColumnMatrix<int>& getJacobianTranspose() const { return _jacobianBuilder.J_transpose(); }
+
+      /// Returns the options
+      const PcgLinearSolverOptions& getOptions() const;
+      /// Returns the options
+      PcgLinearSolverOptions& getOptions();
+      /// Sets the options. The preconditioner takes effect with the next matrix structure initialization.
+      void setOptions(const PcgLinearSolverOptions& options);
+
+    private:
+      typedef Eigen::Map<const Eigen::MatrixXd, Eigen::Unaligned, Eigen::OuterStride<> > ConstJacobianMap;
+
+      /// \brief The rows of one design variable in the columns of a column group of J^T
+      struct Segment {
+        /// \brief the block index of the design variable
+        int block;
+        /// \brief the offset of its values within a column
+        int offset;
+      };
+
+      /// \brief Consecutive columns of J^T with the same rows, e.g. the rows of one error term
+      struct ColumnGroup {
+        int firstColumn;
+        int numColumns;
+        /// \brief the index of the first value in J^T and the number of values per column
+        int valuePtr;
+        int stride;
+        /// \brief the segments of the group are [segmentBegin, segmentEnd)
+        int segmentBegin;
+        int segmentEnd;
+      };
+
+      /// \brief The data of the SCHUR_JACOBI preconditioner for a marginalized design variable
+      struct MarginalizedBlock {
+        int block;
+        /// \brief The sorted block indices of the other design variables sharing an error term with it
+        std::vector<int> coupledBlocks;
+        /// \brief The Hessian blocks (coupledBlocks[p], block)
+        std::vector<Eigen::MatrixXd> couplings;
+      };
+
+      void initMatrixStructureImplementation(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors, bool useDiagonalConditioner) override;
+      void handleNewAcceptConstantErrorTerms() override;
+      bool evaluateErrorsAndJacobiansImplementation(size_t nThreads, bool useMEstimator) override;
+
+      /// \brief group the columns of J^T and index the segments of each design variable
+      void initColumnGroups();
+
+      /// \brief set up the structure of the SCHUR_JACOBI preconditioner
+      void initSchurJacobiStructure();
+
+      /// \brief the Jacobian block of a segment, rows of the design variable by columns of the group
+      ConstJacobianMap jacobianBlock(const ColumnGroup& group, const Segment& segment) const;
+
+      /// \brief the rows of block \p block in a vector of the size of the system
+      Eigen::VectorXd::SegmentReturnType blockSegment(Eigen::VectorXd& v, int block) const {
+        return v.segment(_blockColumnBase[block], _blockDimension[block]);
+      }
+      Eigen::VectorXd::ConstSegmentReturnType blockSegment(const Eigen::VectorXd& v, int block) const {
+        return v.segment(_blockColumnBase[block], _blockDimension[block]);
+      }
+
+      /// \brief outY = J x, in parallel over the column groups
+      void multiplyJacobian(const Eigen::VectorXd& x, Eigen::VectorXd& outY);
+      /// \brief outY = J^T x, in parallel over the design variables
+      void multiplyJacobianTranspose(const Eigen::VectorXd& x, Eigen::VectorXd& outY);
+      void multiplyJacobianRange(size_t threadId, size_t startIdx, size_t endIdx, const Eigen::VectorXd* x, Eigen::VectorXd* outY) const;
+      void multiplyJacobianTransposeRange(size_t threadId, size_t startIdx, size_t endIdx, const Eigen::VectorXd* x, Eigen::VectorXd* outY) const;
+
+      /// \brief compute the preconditioner for the current Jacobian and conditioner
+      void computePreconditioner();
+      /// \brief compute the diagonal blocks (startIdx .. endIdx - 1) of J^T J + D^2
+      void computeDiagonalBlocks(size_t threadId, size_t startIdx, size_t endIdx);
+      /// \brief compute the couplings of the marginalized blocks (startIdx .. endIdx - 1)
+      void computeCouplings(size_t threadId, size_t startIdx, size_t endIdx);
+      /// \brief invert the diagonal blocks of the approximate Schur complement of the kept blocks (startIdx .. endIdx - 1)
+      void computeSchurBlocks(size_t threadId, size_t startIdx, size_t endIdx);
+
+      /// \brief outZ = M^-1 r
+      void applyPreconditioner(const Eigen::VectorXd& r, Eigen::VectorXd& outZ);
+      void applyBlockInverses(size_t threadId, size_t startIdx, size_t endIdx, const std::vector<int>* blocks, const Eigen::VectorXd* r, Eigen::VectorXd* outZ) const;
+      void eliminateCouplings(size_t threadId, size_t startIdx, size_t endIdx, const Eigen::VectorXd* r, Eigen::VectorXd* outZ) const;
+      void backSubstituteCouplings(size_t threadId, size_t startIdx, size_t endIdx, Eigen::VectorXd* outZ) const;
+
+      /// \brief the inverse of a symmetric block, eigenvalues that are not clearly positive are raised
+      static void invertBlock(const Eigen::MatrixXd& block, Eigen::MatrixXd& outInverse);
+
+      CompressedColumnJacobianTransposeBuilder<int> _jacobianBuilder;
+
+      /// \brief The dimension and first column of each design variable block
+      std::vector<int> _blockDimension;
+      std::vector<int> _blockColumnBase;
+
+      /// \brief The column groups of J^T and their segments
+      std::vector<ColumnGroup> _columnGroups;
+      std::vector<Segment> _segments;
+
+      /// \brief For each block, the (column group, segment) pairs of its Jacobian blocks
+      std::vector< std::vector< std::pair<int, int> > > _blockSegments;
+
+      /// \brief Balance the products over the column groups and over the blocks between the threads
+      util::LoadBalancer _columnGroupLoadBalancer;
+      util::LoadBalancer _blockLoadBalancer;
+
+      /// \brief The preconditioner: per block the diagonal block of J^T J + D^2 and the inverse used by the preconditioner
+      std::vector<Eigen::MatrixXd> _diagonalBlocks;
+      std::vector<Eigen::MatrixXd> _inverseBlocks;
+
+      /// \brief The SCHUR_JACOBI preconditioner: the marginalized and the kept blocks and, for each block,
+      ///        the (marginalized block, position in its coupledBlocks) pairs coupled to it
+      std::vector<MarginalizedBlock> _marginalized;
+      std::vector<int> _marginalizedBlocks;
+      std::vector<int> _keptBlocks;
+      std::vector< std::vector< std::pair<size_t, size_t> > > _blockCouplings;
+      bool _useSchurJacobi;
+
+      /// \brief Scratch vectors of the iteration
+      Eigen::VectorXd _x, _r, _z, _p, _q, _Jx;
+
+      /// \brief The number of threads of the last buildSystem call
+      size_t _nThreads;
+
+      /// \brief The tolerance set by the trust region policy, 0 if not set
+      double _forcingTolerance;
+
+      IterativeSolverStatistics _statistics;
+
+      /// Options
+      PcgLinearSolverOptions _options;
+    };
+
+  } // namespace backend
+} // namespace aslam
+#endif /* ASLAM_BACKEND_PCG_LINEAR_SYSTEM_SOLVER_HPP */
@@ -47,7 +47,6 @@ namespace aslam {
 
       /// \brief evaluate the Jacobians. Equivalent to evaluateWeightedJacobians.
       inline void evaluateJacobians(JacobianContainer & outJacobians) {
-        Timer t("ScalarNonSquaredErrorTerm: evaluateJacobians", false);
         evaluateWeightedJacobians(outJacobians);
       }
 
@@ -156,6 +155,10 @@ namespace aslam {
       std::vector<DesignVariable*> _designVariables;
 
       sm::timing::NsecTime _timestamp;
+
+      /// \brief The timers of the Jacobian evaluation, constructed once so evaluating does not allocate
+      Timer _evalRawJacobianTimer;
+      Timer _evalWeightedJacobianTimer;
     };
 
 
@@ -0,0 +1,128 @@
+#ifndef ASLAM_BACKEND_SCHUR_COMPLEMENT_LINEAR_SYSTEM_SOLVER_HPP
+#define ASLAM_BACKEND_SCHUR_COMPLEMENT_LINEAR_SYSTEM_SOLVER_HPP
+
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+#include <boost/shared_ptr.hpp>
+
+#include "BlockCholeskyLinearSystemSolver.hpp"
+
+namespace sm {
+
+  class PropertyTree;
+
+}
+namespace aslam {
+  namespace backend {
+
+    /**
+     * \class SchurComplementLinearSystemSolver
+     *
+     * Solves the normal equations by eliminating the marginalized design variables (DesignVariable::isMarginalized())
+     * with the Schur complement, e.g. the landmarks of a bundle adjustment problem.
+     *
+     * The Hessian is assembled like in the BlockCholeskyLinearSystemSolver. To solve, the diagonal blocks of the
+     * marginalized design variables are inverted and the reduced system of the remaining design variables is
+     * formed, both in parallel. The reduced system is solved with the \p reducedSolver ("cholesky" or "dense") and
+     * the marginalized design variables are recovered by back-substitution.
+     *
+     * Marginalized design variables must not share an error term with another marginalized design variable,
+     * i.e. their part of the Hessian has to be block diagonal.
+     */
+    class SchurComplementLinearSystemSolver : public BlockCholeskyLinearSystemSolver {
+    public:
+      SchurComplementLinearSystemSolver(const std::string & reducedSolver = "cholesky", const BlockCholeskyLinearSolverOptions& options = BlockCholeskyLinearSolverOptions());
+      SchurComplementLinearSystemSolver(const sm::PropertyTree& config);
+      ~SchurComplementLinearSystemSolver() override;
+
+      /// \brief build the system of equations.
+      void buildSystem(size_t nThreads, bool useMEstimator) override;
+
+      /// \brief solve the system storing the solution in outDx and returning true on success.
+      bool solveSystem(Eigen::VectorXd& outDx) override;
+
+      std::string name() const override { return "schur_complement"; }
+
+      /// Helper Function for DogLeg implementation; returns parts required for the steepest descent solution
+      double rhsJtJrhs() override;
+
+      /// \brief the number of marginalized design variable blocks
+      size_t numMarginalizedBlocks() const { return _marginalized.size(); }
+
+      /// \brief the dimension of the reduced system
+      int reducedDimension() const { return _S.rows(); }
+
+    protected:
+      /// \brief initialized the matrix structure for the problem with these error terms and errors.
+      void initMatrixStructureImplementation(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors, bool useDiagonalConditioner) override;
+
+    private:
+
+      /// \brief The elimination data of one marginalized block
+      struct MarginalizedBlock {
+        /// \brief The block index in the full Hessian
+        int block;
+        /// \brief The sorted block indices of the kept blocks coupled to this block
+        std::vector<int> coupledBlocks;
+        /// \brief The (conditioned) inverse of the diagonal block
+        Eigen::MatrixXd inverse;
+        /// \brief The off-diagonal Hessian blocks (coupledBlocks[p], block)
+        std::vector<Eigen::MatrixXd> couplings;
+        /// \brief couplings[p] * inverse
+        std::vector<Eigen::MatrixXd> scaledCouplings;
+        /// \brief Did the inversion of the diagonal block succeed?
+        bool success;
+      };
+
+      void initReducedSolver();
+
+      /// \brief the conditioner added to the diagonal of the full block \p block
+      Eigen::VectorXd diagonalAugmentation(int block) const;
+
+      /// \brief invert the diagonal blocks of the marginalized blocks (startIdx .. endIdx - 1)
+      void eliminateBlocks(size_t threadId, size_t startIdx, size_t endIdx);
+
+      /// \brief form the block columns (startIdx .. endIdx - 1) of the reduced system
+      void buildReducedColumns(size_t threadId, size_t startIdx, size_t endIdx);
+
+      /// \brief recover the marginalized blocks (startIdx .. endIdx - 1) from the solution of the reduced system
+      void backSubstitute(size_t threadId, size_t startIdx, size_t endIdx, Eigen::VectorXd* outDx);
+
+      /// \brief The marginalized blocks
+      std::vector<MarginalizedBlock> _marginalized;
+
+      /// \brief The block index in the full Hessian of each block of the reduced system
+      std::vector<int> _keptBlocks;
+
+      /// \brief The block index in the reduced system of each block of the full Hessian, -1 if it is marginalized
+      std::vector<int> _reducedIndex;
+
+      /// \brief For each reduced block column, the (marginalized block, position in its coupledBlocks) pairs
+      std::vector< std::vector< std::pair<size_t, size_t> > > _reducedColumnCouplings;
+
+      /// \brief The reduced system and its right-hand side
+      SparseBlockMatrix _S;
+      Eigen::VectorXd _reducedRhs;
+
+      /// \brief The solution of the reduced system
+      Eigen::VectorXd _reducedDx;
+
+      /// \brief the linear solver for the reduced system
+      boost::shared_ptr<LinearSolver> _reducedSolver;
+
+      /// \brief Balances the elimination and back-substitution of the marginalized blocks between the threads
+      util::LoadBalancer _eliminationLoadBalancer;
+
+      /// \brief Balances the forming of the reduced block columns between the threads
+      util::LoadBalancer _reductionLoadBalancer;
+
+      /// \brief The number of threads of the last buildSystem call
+      size_t _nThreads;
+
+      std::string _reducedSolverType;
+    };
+
+  } // namespace backend
+} // namespace aslam
+#endif /* ASLAM_BACKEND_SCHUR_COMPLEMENT_LINEAR_SYSTEM_SOLVER_HPP */
@@ -49,6 +49,35 @@ namespace aslam {
       /** @}
         */
 
+      /// Fill-reducing orderings of the factorization
+      enum Ordering {
+        /// AMD on the scalar matrix
+        SCALAR_AMD,
+        /// AMD on the graph of the design variables, expanded to their columns
+        BLOCK_AMD,
+        /// COLAMD on the block structure of the Jacobian, expanded to the
+        /// columns of the design variables
+        BLOCK_COLAMD,
+        /// METIS nested dissection on the graph of the design variables,
+        /// expanded to their columns. Falls back to BLOCK_AMD if CHOLMOD has
+        /// been built without METIS.
+        BLOCK_NESTED_DISSECTION
+      };
+
+      /// The fill-reducing ordering. A block ordering is kept as long as the
+      /// design variables and their coupling by the error terms do not change.
+      Ordering ordering;
+      /// Form J^T J once per system and factor damped copies of it, instead of
+      /// factoring J^T with the conditioner appended for every solve. Solving
+      /// again for a new conditioner, e.g. after a rejected Levenberg-Marquardt
+      /// step, then costs only the numeric factorization.
+      bool cacheHessian;
+      /// Assemble the upper triangle of J^T J directly from the error terms
+      /// into a fixed pattern, in parallel, and factor it instead of J^T. The
+      /// Jacobian is never stored, which saves memory and time for problems
+      /// with many more residuals than parameters. Takes precedence over
+      /// cacheHessian and takes effect at the next initMatrixStructure().
+      bool assembleHessian;
     };
 
   }
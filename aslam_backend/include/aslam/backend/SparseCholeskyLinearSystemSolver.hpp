@@ -3,6 +3,8 @@
 
 #include "LinearSystemSolver.hpp"
 #include "CompressedColumnJacobianTransposeBuilder.hpp"
+#include "CompressedColumnHessianBuilder.hpp"
+#include <sparse_block_matrix/sparse_block_matrix.h>
 
 #include "aslam/backend/SparseCholeskyLinearSolverOptions.h"
 
@@ -16,6 +18,8 @@ namespace aslam {
 
     class SparseCholeskyLinearSystemSolver : public LinearSystemSolver {
     public:
+      typedef sparse_block_matrix::SparseBlockMatrix<Eigen::MatrixXd> SparseBlockMatrix;
+
       SparseCholeskyLinearSystemSolver(const SparseCholeskyLinearSolverOptions& options = SparseCholeskyLinearSolverOptions());
       SparseCholeskyLinearSystemSolver(const sm::PropertyTree& config);
       ~SparseCholeskyLinearSystemSolver() override;
@@ -24,6 +28,24 @@ namespace aslam {
       void buildSystem(size_t nThreads, bool useMEstimator) override;
       bool solveSystem(Eigen::VectorXd& outDx) override;
 
+      /// \brief solve the system for several constant conditioners. The last one is solved by solveSystem(), the others in parallel,
+      ///        each thread repeats the numeric factorization of its damped copy of the values with the symbolic factorization of the last one.
+      void solveSystems(const std::vector<double>& conditioners, size_t nThreads, std::vector<Eigen::VectorXd>& outDx) override;
+
+      void setConditioner(const Eigen::VectorXd& diag) override;
+      void setConstantConditioner(double diag) override;
+
+      /// \brief Compute the blocks \p blockIndices of the inverse of the conditioned J^T J of the last buildSystem() call.
+      ///
+      /// The entries are computed by the sparse inverse recursion on the Cholesky factor, so only the entries of the
+      /// inverse on the way to the requested ones are formed. The numeric factorization of the last solveSystem() call is
+      /// reused if it has been done for the current system and conditioner. The block indices are split into
+      /// \p nThreads contiguous chunks, which are computed in parallel.
+      void computeCovarianceBlocks(const std::vector<std::pair<int, int> >& blockIndices, SparseBlockMatrix& outP, size_t nThreads = 1);
+
+      /// \brief Whether buildSystem() has been called since the matrix structure was initialized
+      bool isSystemBuilt() const { return _isSystemBuilt; }
+
       /// Returns the options
       const SparseCholeskyLinearSolverOptions& getOptions() const;
       /// Returns the options
@@ -32,21 +54,85 @@ namespace aslam {
       void setOptions(const SparseCholeskyLinearSolverOptions& options);
 
       std::string name() const override {  return "sparse_cholesky"; };        
+      /// \brief return the timing statistics of the last Jacobian evaluation
+      const util::ThreadedJobStatistics* getJacobianEvaluationStatistics() const override {
+        return &_jacobianBuilder.loadBalancer().getStatistics();
+      }
+
+      /// \brief discard the Jacobians of the last evaluateErrorAndJacobians() call
+      void discardEvaluatedJacobians() override { _jacobianBuilder.discardEvaluatedJacobians(); }
       /// Helper Function for DogLeg implementation; returns parts required for the steepest descent solution
       double rhsJtJrhs() override;
+
+      /// \brief The number of matrix structure initializations that kept the symbolic factorization
+      size_t getNumSymbolicFactorizationReuses() const { return _numSymbolicFactorizationReuses; }
+      /// \brief The number of matrix structure initializations that required a new symbolic factorization
+      size_t getNumSymbolicFactorizationMisses() const { return _numSymbolicFactorizationMisses; }
+      /// \brief The number of non-zeros in the Cholesky factor of the last symbolic factorization
+      double getFactorNonZeros() const { return _cholmod.getFactorNonZeros(); }
+      /// \brief The number of bytes of the system matrices stored by the solver plus the peak memory usage of CHOLMOD
+      size_t getMemoryUsage() const;
    
     
     private:
+      /// \brief The matrix that is factored
+      enum class System {
+        /// J^T with the conditioner appended
+        JacobianTranspose,
+        /// J^T J formed from J^T by the cacheHessian option
+        CachedHessian,
+        /// J^T J assembled from the error terms by the assembleHessian option
+        AssembledHessian
+      };
+      /// \brief The matrix factored by solveSystem() for the current options and matrix structure
+      System system() const;
+
       void initMatrixStructureImplementation(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors, bool useDiagonalConditioner) override;
       void handleNewAcceptConstantErrorTerms() override;
+      bool evaluateErrorsAndJacobiansImplementation(size_t nThreads, bool useMEstimator) override;
+      /// \brief Compute the fill-reducing ordering of the design variables and expand it to their columns
+      void computeOrdering();
+      /// \brief Form the undamped J^T J of the cacheHessian option and find its diagonal
+      void computeHessian();
+      void freeHessian();
 
       CompressedColumnJacobianTransposeBuilder<int> _jacobianBuilder;
+      CompressedColumnHessianBuilder _hessianBuilder;
+      /// \brief Whether the matrix structure has been initialized for the assembleHessian option
+      bool _assembleHessian = false;
+      /// \brief The damped values of the assembled Hessian viewed by _cholmodLhs
+      std::vector<double> _dampedHessianValues;
 
       Cholmod<> _cholmod;
       cholmod_sparse _cholmodLhs;
       cholmod_dense  _cholmodRhs;
       cholmod_factor* _factor;
 
+      /// \brief The ordering of the columns for the block orderings, empty if it has to be computed
+      std::vector<int> _ordering;
+      /// \brief The ordering option used for the current symbolic factorization
+      SparseCholeskyLinearSolverOptions::Ordering _factorOrdering;
+      /// \brief The matrix of the current symbolic factorization
+      System _factorSystem = System::JacobianTranspose;
+
+      /// \brief The upper triangle of J^T J for the cacheHessian option, NULL until the first solve after buildSystem().
+      ///        Its values are overwritten by the damped Hessian, _hessianValues keeps the undamped ones.
+      cholmod_sparse* _hessian = nullptr;
+      std::vector<double> _hessianValues;
+      /// \brief The index of the diagonal entry of each column in the values of _hessian
+      std::vector<int> _hessianDiagonal;
+
+      /// \brief Statistics of the symbolic factorization cache
+      size_t _numSymbolicFactorizationReuses = 0;
+      size_t _numSymbolicFactorizationMisses = 0;
+
+      /// \brief Whether a system has been built and whether _factor holds its numeric factorization for the current conditioner
+      bool _isSystemBuilt = false;
+      bool _isFactorCurrent = false;
+
+      /// \brief The number of threads of the last buildSystem call, used for the products with J^T
+      size_t _nThreads = 1;
+
       /// Options
       SparseCholeskyLinearSolverOptions _options;
 
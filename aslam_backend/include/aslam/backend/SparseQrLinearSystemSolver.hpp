@@ -30,6 +30,14 @@ namespace aslam {
 
       std::string name() const override { return "sparse_qr"; }
 
+      /// \brief return the timing statistics of the last Jacobian evaluation
+      const util::ThreadedJobStatistics* getJacobianEvaluationStatistics() const override {
+        return &_jacobianBuilder.loadBalancer().getStatistics();
+      }
+
+      /// \brief discard the Jacobians of the last evaluateErrorAndJacobians() call
+      void discardEvaluatedJacobians() override { _jacobianBuilder.discardEvaluatedJacobians(); }
+
       /// Returns the current Jacobian transpose
       const CompressedColumnMatrix<index_t>& getJacobianTranspose() const;
       /// Returns the current estimated numerical rank
@@ -60,12 +68,15 @@ namespace aslam {
     private:
       void initMatrixStructureImplementation(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors, bool useDiagonalConditioner) override;
       void handleNewAcceptConstantErrorTerms() override;
+      bool evaluateErrorsAndJacobiansImplementation(size_t nThreads, bool useMEstimator) override;
 
       CompressedColumnJacobianTransposeBuilder<index_t> _jacobianBuilder;
 
       Cholmod<index_t> _cholmod;
       cholmod_sparse _cholmodLhs;
       cholmod_dense  _cholmodRhs;
+      /// \brief The number of threads of the last buildSystem call, used for the products with J^T
+      size_t _nThreads = 1;
 #ifndef QRSOLVER_DISABLED
       SuiteSparseQR_factorization<double>* _factor;
       CompressedColumnMatrix<index_t> _R;
@@ -3,6 +3,7 @@
 
 #include <aslam/backend/LinearSystemSolver.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
 #include "Optimizer2Options.hpp"
 #include <sm/eigen/assert_macros.hpp>
 #include <aslam/Exceptions.hpp>
@@ -13,6 +14,9 @@ namespace aslam {
         class TrustRegionPolicy
         {
         public:
+            /// \brief Evaluates the cost after the state update dx without keeping the update
+            typedef boost::function<double(const Eigen::VectorXd& dx)> TrialCostFunction;
+
             TrustRegionPolicy();
             virtual ~TrustRegionPolicy();
             
@@ -31,6 +35,19 @@ namespace aslam {
             /// \brief should the optimizer revert on failure? You should probably return true (the default implementation does this)
             virtual bool revertOnFailure();
 
+            /// \brief Enable the forcing sequence of an inexact Newton method for iterative linear system solvers.
+            ///        Before each solve, the relative tolerance of the solver is set to eta = 0.9 * J / J_previous,
+            ///        Eisenstat and Walker's second choice with the norm of the residuals, safeguarded against
+            ///        decreasing too fast and clamped to [minTolerance, maxTolerance]. maxTolerance <= 0 disables it.
+            void setForcingSequence(double minTolerance, double maxTolerance);
+
+            /// \brief the forcing tolerance passed to the linear system solver for the last solve, 0 if disabled
+            double getForcingTolerance() const { return _forcingTolerance; }
+
+            /// \brief set by the optimizer for policies that compare several trial steps per iteration, empty to unset.
+            ///        Up to \p numConcurrentTrials calls of \p trialCost may run concurrently in different threads.
+            void setTrialCostFunction(const TrialCostFunction& trialCost, size_t numConcurrentTrials = 1);
+
             /// \brief print the current state to a stream (no newlines).
             virtual std::ostream & printState(std::ostream & out) const = 0;
             virtual std::string name() const = 0;
@@ -45,13 +62,26 @@ namespace aslam {
             /// \brief Returns true if the solution was successful
             virtual bool solveSystemImplementation(double J, bool previousIterationFailed, int nThreads, Eigen::VectorXd& outDx) = 0;
 
+            /// \brief the forcing tolerance for the next solve, see setForcingSequence()
+            virtual double computeForcingTolerance(bool previousIterationFailed) const;
+
             boost::shared_ptr<LinearSystemSolver> _solver;
+
+            /// \brief the cost of a trial step, may be empty
+            TrialCostFunction _trialCost;
+            /// \brief the number of calls of _trialCost that may run concurrently
+            size_t _numConcurrentTrials;
             
         private:
             /// \brief the linear system solver.
             double _J;
             double _p_J;
             bool _isFirstIteration;
+            /// \brief the bounds of the forcing sequence
+            double _minForcingTolerance;
+            double _maxForcingTolerance;
+            /// \brief the forcing tolerance of the last solve
+            double _forcingTolerance;
         };
 
     } // namespace backend
@@ -51,6 +51,23 @@ namespace aslam {
       static cholmod_factor* analyze(cholmod_sparse* A, cholmod_common* c) {
         return cholmod_analyze(A, c);
       }
+      static cholmod_factor* analyze_p(cholmod_sparse* A, int* perm, cholmod_common* c) {
+        return cholmod_analyze_p(A, perm, NULL, 0, c);
+      }
+      static int amd(cholmod_sparse* A, int* perm, cholmod_common* c) {
+        return cholmod_amd(A, NULL, 0, perm, c);
+      }
+      static int colamd(cholmod_sparse* A, int* perm, cholmod_common* c) {
+        return cholmod_colamd(A, NULL, 0, 1, perm, c);
+      }
+#ifndef NPARTITION
+      static int metis(cholmod_sparse* A, int* perm, cholmod_common* c) {
+        return cholmod_metis(A, NULL, 0, 1, perm, c);
+      }
+      static int ccolamd(cholmod_sparse* A, int* constraints, int* perm, cholmod_common* c) {
+        return cholmod_ccolamd(A, NULL, 0, constraints, perm, c);
+      }
+#endif
       static int free_sparse(cholmod_sparse** A, cholmod_common* c) {
         return cholmod_free_sparse(A, c);
       }
@@ -66,6 +83,12 @@ namespace aslam {
       static int factorize(cholmod_sparse* A, cholmod_factor* L, cholmod_common* c) {
         return cholmod_factorize(A, L, c);
       }
+      static cholmod_factor* copy_factor(cholmod_factor* L, cholmod_common* c) {
+        return cholmod_copy_factor(L, c);
+      }
+      static int change_factor(int to_xtype, int to_ll, int to_super, int to_packed, int to_monotonic, cholmod_factor* L, cholmod_common* c) {
+        return cholmod_change_factor(to_xtype, to_ll, to_super, to_packed, to_monotonic, L, c);
+      }
       static cholmod_dense* solve(int sys, cholmod_factor* L, cholmod_dense* B, cholmod_common* c) {
         return cholmod_solve(sys, L, B, c);
       }
@@ -98,6 +121,23 @@ namespace aslam {
       static cholmod_factor* analyze(cholmod_sparse* A, cholmod_common* c) {
         return cholmod_l_analyze(A, c);
       }
+      static cholmod_factor* analyze_p(cholmod_sparse* A, SuiteSparse_long* perm, cholmod_common* c) {
+        return cholmod_l_analyze_p(A, perm, NULL, 0, c);
+      }
+      static int amd(cholmod_sparse* A, SuiteSparse_long* perm, cholmod_common* c) {
+        return cholmod_l_amd(A, NULL, 0, perm, c);
+      }
+      static int colamd(cholmod_sparse* A, SuiteSparse_long* perm, cholmod_common* c) {
+        return cholmod_l_colamd(A, NULL, 0, 1, perm, c);
+      }
+#ifndef NPARTITION
+      static int metis(cholmod_sparse* A, SuiteSparse_long* perm, cholmod_common* c) {
+        return cholmod_l_metis(A, NULL, 0, 1, perm, c);
+      }
+      static int ccolamd(cholmod_sparse* A, SuiteSparse_long* constraints, SuiteSparse_long* perm, cholmod_common* c) {
+        return cholmod_l_ccolamd(A, NULL, 0, constraints, perm, c);
+      }
+#endif
       static int free_sparse(cholmod_sparse** A, cholmod_common* c) {
         return cholmod_l_free_sparse(A, c);
       }
@@ -113,6 +153,12 @@ namespace aslam {
       static int factorize(cholmod_sparse* A, cholmod_factor* L, cholmod_common* c) {
         return cholmod_l_factorize(A, L, c);
       }
+      static cholmod_factor* copy_factor(cholmod_factor* L, cholmod_common* c) {
+        return cholmod_l_copy_factor(L, c);
+      }
+      static int change_factor(int to_xtype, int to_ll, int to_super, int to_packed, int to_monotonic, cholmod_factor* L, cholmod_common* c) {
+        return cholmod_l_change_factor(to_xtype, to_ll, to_super, to_packed, to_monotonic, L, c);
+      }
       static cholmod_dense* solve(int sys, cholmod_factor* L, cholmod_dense* B, cholmod_common* c) {
         return cholmod_l_solve(sys, L, B, c);
       }
@@ -218,6 +264,58 @@ namespace aslam {
       return factor;
     }
 
+    template<typename I>
+    cholmod_factor* Cholmod<I>::analyze(cholmod_sparse* J, index_t* permutation)
+    {
+      SM_ASSERT_TRUE(Exception, permutation != NULL, "Null input");
+      // Use the given ordering only
+      _cholmod.nmethods = 1;
+      _cholmod.method[0].ordering = CHOLMOD_GIVEN;
+      _cholmod.supernodal = CHOLMOD_AUTO;
+      cholmod_factor* factor = CholmodIndexTraits<index_t>::analyze_p(J, permutation, &_cholmod);
+      SM_ASSERT_EQ(Exception, _cholmod.status, CHOLMOD_OK, "The symbolic Cholesky factorization failed.");
+      SM_ASSERT_FALSE(Exception, factor == NULL, "cholmod_analyze_p returned a null factor");
+      return factor;
+    }
+
+    template<typename I>
+    bool Cholmod<I>::amd(cholmod_sparse* A, index_t* outPermutation)
+    {
+      return CholmodIndexTraits<index_t>::amd(A, outPermutation, &_cholmod) && _cholmod.status == CHOLMOD_OK;
+    }
+
+    template<typename I>
+    bool Cholmod<I>::colamd(cholmod_sparse* A, index_t* outPermutation)
+    {
+      return CholmodIndexTraits<index_t>::colamd(A, outPermutation, &_cholmod) && _cholmod.status == CHOLMOD_OK;
+    }
+
+    template<typename I>
+    bool Cholmod<I>::constrainedColamd(cholmod_sparse* A, index_t* constraints, index_t* outPermutation)
+    {
+#ifndef NPARTITION
+      return CholmodIndexTraits<index_t>::ccolamd(A, constraints, outPermutation, &_cholmod) && _cholmod.status == CHOLMOD_OK;
+#else
+      (void)A;
+      (void)constraints;
+      (void)outPermutation;
+      return false;
+#endif
+    }
+
+    template<typename I>
+    bool Cholmod<I>::nestedDissection(cholmod_sparse* A, index_t* outPermutation)
+    {
+#ifndef NPARTITION
+      // Fails with CHOLMOD_NOT_INSTALLED if CHOLMOD has been built without METIS
+      return CholmodIndexTraits<index_t>::metis(A, outPermutation, &_cholmod) && _cholmod.status == CHOLMOD_OK;
+#else
+      (void)A;
+      (void)outPermutation;
+      return false;
+#endif
+    }
+
 #ifndef QRSOLVER_DISABLED
     template<typename I>
     spqr_factor* Cholmod<I>::analyzeQR(cholmod_sparse* J)
@@ -383,6 +481,26 @@ namespace aslam {
 #endif
 
 
+    template<typename I>
+    cholmod_factor* Cholmod<I>::copyToSimplicialLL(cholmod_factor* L)
+    {
+      cholmod_factor* copy = CholmodIndexTraits<index_t>::copy_factor(L, &_cholmod);
+      SM_ASSERT_FALSE(Exception, copy == NULL, "Copying the factor failed");
+      if (!CholmodIndexTraits<index_t>::change_factor(CHOLMOD_REAL, 1, 0, 1, 1, copy, &_cholmod)) {
+        CholmodIndexTraits<index_t>::free_factor(&copy, &_cholmod);
+        SM_THROW(Exception, "Converting the factor to a simplicial LL' factor failed");
+      }
+      return copy;
+    }
+
+    template<typename I>
+    cholmod_factor* Cholmod<I>::copy(cholmod_factor* L)
+    {
+      cholmod_factor* copy = CholmodIndexTraits<index_t>::copy_factor(L, &_cholmod);
+      SM_ASSERT_FALSE(Exception, copy == NULL, "Copying the factor failed");
+      return copy;
+    }
+
     template<typename I>
     cholmod_dense* Cholmod<I>::solve(cholmod_sparse* A,
                                      cholmod_factor* L,
@@ -451,6 +569,19 @@ namespace aslam {
         "QR factorization failed");
       CholmodIndexTraits<index_t>::free_sparse(&qrJ, &_cholmod);
     }
+
+    template<typename I>
+    SuiteSparse_long Cholmod<I>::getR(cholmod_sparse* A, cholmod_dense* b,
+        cholmod_sparse** R, cholmod_dense** QTb, double tol, SuiteSparse_long* permutation) {
+      cholmod_sparse* qrJ = cholmod_l_ptranspose(A, 1, permutation, NULL, 0, &_cholmod);
+      const SuiteSparse_long rank = SuiteSparseQR<double>(SPQR_ORDERING_FIXED,
+        tol, qrJ->ncol, 0, qrJ, NULL, b, NULL, QTb, R, NULL, NULL, NULL, NULL,
+        &_cholmod);
+      CholmodIndexTraits<index_t>::free_sparse(&qrJ, &_cholmod);
+      SM_ASSERT_EQ(Exception, _cholmod.status, CHOLMOD_OK,
+        "QR factorization failed");
+      return rank;
+    }
 #endif
 
     template<typename I>
@@ -509,5 +640,15 @@ namespace aslam {
       return _cholmod.memory_inuse;
     }
 
+    template<typename I>
+    size_t Cholmod<I>::getPeakMemoryUsage() const {
+      return _cholmod.memory_usage;
+    }
+
+    template<typename I>
+    double Cholmod<I>::getFactorNonZeros() const {
+      return _cholmod.lnz;
+    }
+
   } // namespace backend
 } // namespace aslam
@@ -1,11 +1,14 @@
 #include <aslam/backend/CompressedColumnJacobianTransposeBuilder.hpp>
-#include <boost/thread.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_set>
 
 namespace aslam {
   namespace backend {
 
     template<typename I>
-    CompressedColumnJacobianTransposeBuilder<I>::CompressedColumnJacobianTransposeBuilder() : _isInitialized(false)
+    CompressedColumnJacobianTransposeBuilder<I>::CompressedColumnJacobianTransposeBuilder() : _isInitialized(false), _hasEvaluatedJacobians(false), _evaluatedJacobiansUseMEstimator(false)
     {
     }
 
@@ -40,6 +43,7 @@ namespace aslam {
       // std::cout << "Matrix storage: " << ((double)nnz * 64.0 * 1e-9) << " GB\n";
       // Initialize the matrix to be the right size.
       _J_transpose.init(dvs.back()->columnBase() + dvs.back()->minimalDimensions(), 0, nnz, num_cols);
+      initErrorTermEvaluation(errors);
       std::vector<ErrorTerm*>::const_iterator it = errors.begin();
       int i = 0;
       size_t eRow = 0;
@@ -49,58 +53,196 @@ namespace aslam {
         eRow += (*it)->dimension();
       }
       //_e.resize(eRow);
+      _designVariableDimensions.clear();
+      for (const DesignVariable* dv : dvs)
+        _designVariableDimensions.push_back(dv->minimalDimensions());
+      _sparsityPattern.clear();
+      for (const ErrorTerm* e : errors)
+        appendSparsityPattern(*e, _sparsityPattern);
       _isInitialized = true;
     }
 
 
-
     template<typename I>
-    template<typename MEMBER_FUNCTION_PTR>
-    void CompressedColumnJacobianTransposeBuilder<I>::setupThreadedJob(MEMBER_FUNCTION_PTR ptr, size_t nThreads, bool useMEstimator)
+    typename CompressedColumnJacobianTransposeBuilder<I>::StructureUpdate
+    CompressedColumnJacobianTransposeBuilder<I>::updateMatrixStructure(const std::vector<DesignVariable*> & dvs, const std::vector<ErrorTerm*> & errors)
     {
-      if (nThreads <= 1) {
-        (this->*ptr)(0, 0, _jacobianPointers.size(), useMEstimator);
-      } else {
-        nThreads = std::min(nThreads, _jacobianPointers.size());
-        // Give some error terms to each thread.
-        std::vector<int> indices(nThreads + 1, 0);
-        int nJPerThread = std::max(1, (int)(_jacobianPointers.size() / nThreads));
-        for (unsigned i = 0; i < nThreads; ++i)
-          indices[i + 1] = indices[i] + nJPerThread;
-        // deal with the remainder.
-        indices.back() = _jacobianPointers.size();
-        // Build a thread pool and evaluate the jacobians.
-        boost::thread_group threads;
-        for (unsigned i = 0; i < nThreads; ++i) {
-          threads.create_thread(boost::bind(ptr, this, i, indices[i], indices[i + 1], useMEstimator));
+      bool sameDesignVariables = _isInitialized && dvs.size() == _designVariableDimensions.size();
+      for (size_t i = 0; sameDesignVariables && i < dvs.size(); ++i)
+        sameDesignVariables = dvs[i]->minimalDimensions() == _designVariableDimensions[i];
+      if (!sameDesignVariables) {
+        initMatrixStructure(dvs, errors);
+        return StructureUpdate::Rebuilt;
+      }
+
+      // The records of the pattern are self-delimiting, so a matching prefix means the old error terms are unchanged
+      _newSparsityPattern.clear();
+      for (const ErrorTerm* e : errors)
+        appendSparsityPattern(*e, _newSparsityPattern);
+      const size_t numOldErrors = _jacobianPointers.size();
+      if (errors.size() < numOldErrors || _newSparsityPattern.size() < _sparsityPattern.size() ||
+          !std::equal(_sparsityPattern.begin(), _sparsityPattern.end(), _newSparsityPattern.begin())) {
+        initMatrixStructure(dvs, errors);
+        return StructureUpdate::Rebuilt;
+      }
+
+      // The error term objects might have been replaced by ones with the same structure
+      for (size_t i = 0; i < numOldErrors; ++i)
+        _jacobianPointers[i].errorTerm = errors[i];
+
+      StructureUpdate update = StructureUpdate::Unchanged;
+      if (errors.size() > numOldErrors) {
+        update = isCouplingUnchanged(_newSparsityPattern, _sparsityPattern.size()) ? StructureUpdate::Extended : StructureUpdate::ExtendedWithNewCoupling;
+        size_t eRow = numOldErrors ? _jacobianPointers.back().eRow + _jacobianPointers.back().errorTerm->dimension() : 0;
+        _jacobianPointers.resize(errors.size());
+        for (size_t i = numOldErrors; i < errors.size(); ++i) {
+          _jacobianPointers[i].set(_J_transpose.appendErrorJacobiansSymbolic(*errors[i]), errors[i], eRow);
+          eRow += errors[i]->dimension();
         }
-        threads.join_all();
+      }
+      _sparsityPattern.swap(_newSparsityPattern);
+      initErrorTermEvaluation(errors);
+      return update;
+    }
+
+
+    template<typename I>
+    void CompressedColumnJacobianTransposeBuilder<I>::getBlockStructure(std::vector<index_t>& outColPtr, std::vector<index_t>& outRowInd) const
+    {
+      outColPtr.assign(1, 0);
+      outColPtr.reserve(_jacobianPointers.size() + 1);
+      outRowInd.clear();
+      for (size_t r = 0; r < _sparsityPattern.size(); r += _sparsityPattern[r + 1] + 2) {
+        const size_t begin = outRowInd.size();
+        outRowInd.insert(outRowInd.end(), _sparsityPattern.begin() + r + 2, _sparsityPattern.begin() + r + 2 + _sparsityPattern[r + 1]);
+        // An error term might depend on a design variable more than once
+        outRowInd.erase(std::unique(outRowInd.begin() + begin, outRowInd.end()), outRowInd.end());
+        outColPtr.push_back(outRowInd.size());
       }
     }
 
 
+    template<typename I>
+    void CompressedColumnJacobianTransposeBuilder<I>::initErrorTermEvaluation(const std::vector<ErrorTerm*>& errors)
+    {
+      std::vector<double> costHints(errors.size());
+      for (size_t j = 0; j < errors.size(); ++j)
+        costHints[j] = errors[j]->getEvaluationCostHint();
+      _loadBalancer.init(costHints);
+      _jacobianContainers.reserve(errors);
+      _errorVectors.reserve(errors);
+      _hasEvaluatedJacobians = false;
+    }
+
+
+    template<typename I>
+    void CompressedColumnJacobianTransposeBuilder<I>::appendSparsityPattern(const ErrorTerm& e, std::vector<int>& pattern)
+    {
+      pattern.push_back(e.dimension());
+      const size_t numIndex = pattern.size();
+      pattern.push_back(0);
+      for (const DesignVariable* dv : e.designVariables()) {
+        if (dv->isActive())
+          pattern.push_back(dv->blockIndex());
+      }
+      pattern[numIndex] = pattern.size() - numIndex - 1;
+      std::sort(pattern.begin() + numIndex + 1, pattern.end());
+    }
+
+
+    template<typename I>
+    bool CompressedColumnJacobianTransposeBuilder<I>::isCouplingUnchanged(const std::vector<int>& pattern, size_t begin)
+    {
+      // The pattern of J^T J only depends on which pairs of design variables share an error term
+      auto pairKey = [](int a, int b) { return (static_cast<std::uint64_t>(a) << 32) | static_cast<std::uint32_t>(b); };
+      std::unordered_set<std::uint64_t> coupled;
+      for (size_t r = 0; r < begin; r += pattern[r + 1] + 2) {
+        for (int j = 0; j < pattern[r + 1]; ++j)
+          for (int k = j; k < pattern[r + 1]; ++k)
+            coupled.insert(pairKey(pattern[r + 2 + j], pattern[r + 2 + k]));
+      }
+      for (size_t r = begin; r < pattern.size(); r += pattern[r + 1] + 2) {
+        for (int j = 0; j < pattern[r + 1]; ++j)
+          for (int k = j; k < pattern[r + 1]; ++k)
+            if (!coupled.count(pairKey(pattern[r + 2 + j], pattern[r + 2 + k])))
+              return false;
+      }
+      return true;
+    }
+
+
+
     /// \brief build the large, sparse internal Jacobian matrix from the error terms.
     template<typename I>
-    void CompressedColumnJacobianTransposeBuilder<I>::buildSystem(size_t nThreads, bool useMEstimator)
+    void CompressedColumnJacobianTransposeBuilder<I>::buildSystem(size_t nThreads, bool useMEstimator, const util::ThreadedJobOptions& options)
     {
       _isJacobianBuiltFromJacobianTranspose = false;
-      setupThreadedJob(&CompressedColumnJacobianTransposeBuilder::evaluateJacobians, nThreads, useMEstimator);
+      if (_hasEvaluatedJacobians && _evaluatedJacobiansUseMEstimator == useMEstimator) {
+        _J_transpose.swapValues(_evaluatedJacobians);
+        _hasEvaluatedJacobians = false;
+        return;
+      }
+      _hasEvaluatedJacobians = false;
+      nThreads = std::max<size_t>(1, nThreads);
+      _jacobianContainers.resize(nThreads);
+      // The lambda is small enough to be stored in the boost::function without allocating
+      util::runThreadedJob([this, useMEstimator](size_t threadId, size_t startIdx, size_t endIdx) {
+        evaluateJacobians(threadId, startIdx, endIdx, useMEstimator);
+      }, _loadBalancer, nThreads, options);
+    }
+
+
+    template<typename I>
+    void CompressedColumnJacobianTransposeBuilder<I>::evaluateErrorsAndJacobians(size_t nThreads, bool useMEstimator, Eigen::VectorXd& outE, std::vector<double>& outSquaredErrors, const util::ThreadedJobOptions& options)
+    {
+      SM_ASSERT_EQ(Exception, outSquaredErrors.size(), _jacobianPointers.size(), "There has to be one squared error per error term");
+      nThreads = std::max<size_t>(1, nThreads);
+      _jacobianContainers.resize(nThreads);
+      _errorVectors.resize(nThreads);
+      // Write the new Jacobians into the spare values and keep the current ones in J^T
+      _hasEvaluatedJacobians = false;
+      _evaluatedJacobians.resize(_J_transpose.values().size());
+      _J_transpose.swapValues(_evaluatedJacobians);
+      try {
+        util::runThreadedJob([this, useMEstimator, &outE, &outSquaredErrors](size_t threadId, size_t startIdx, size_t endIdx) {
+          evaluateErrorsAndJacobians(threadId, startIdx, endIdx, useMEstimator, &outE, &outSquaredErrors);
+        }, _loadBalancer, nThreads, options);
+      } catch (...) {
+        _J_transpose.swapValues(_evaluatedJacobians);
+        throw;
+      }
+      _J_transpose.swapValues(_evaluatedJacobians);
+      _hasEvaluatedJacobians = true;
+      _evaluatedJacobiansUseMEstimator = useMEstimator;
     }
 
 
     /// \brief a function to be run by a single thread.
     template<typename I>
-    void CompressedColumnJacobianTransposeBuilder<I>::evaluateJacobians(int /* threadId */, int startIdx, int endIdx, bool useMEstimator)
+    void CompressedColumnJacobianTransposeBuilder<I>::evaluateJacobians(int threadId, int startIdx, int endIdx, bool useMEstimator)
     {
-      Eigen::VectorXd ee;
       for (int i = startIdx; i < endIdx; ++i) {
-        JacobianContainerSparse<Eigen::Dynamic> jc(_jacobianPointers[i].errorTerm->dimension());
+        JacobianContainerSparse<Eigen::Dynamic>& jc = _jacobianContainers.get(threadId, _jacobianPointers[i].errorTerm->dimension());
         _jacobianPointers[i].errorTerm->getWeightedJacobians(jc, useMEstimator);
         _J_transpose.writeJacobians(jc, _jacobianPointers[i].jcp);
       }
     }
 
 
+    template<typename I>
+    void CompressedColumnJacobianTransposeBuilder<I>::evaluateErrorsAndJacobians(int threadId, int startIdx, int endIdx, bool useMEstimator, Eigen::VectorXd* outE, std::vector<double>* outSquaredErrors)
+    {
+      for (int i = startIdx; i < endIdx; ++i) {
+        ErrorTerm* errorTerm = _jacobianPointers[i].errorTerm;
+        JacobianContainerSparse<Eigen::Dynamic>& jc = _jacobianContainers.get(threadId, errorTerm->dimension());
+        Eigen::VectorXd& e = _errorVectors.get(threadId, errorTerm->dimension());
+        (*outSquaredErrors)[i] = errorTerm->evaluateWeightedErrorAndJacobians(e, jc, useMEstimator);
+        outE->segment(errorTerm->rowBase(), errorTerm->dimension()) = -e;
+        _J_transpose.writeJacobians(jc, _jacobianPointers[i].jcp);
+      }
+    }
+
+
     // /// \brief Get a view of the Jacobian as a cholmod sparse matrix.
     // cholmod_sparse CompressedColumnJacobianTransposeBuilder::getJacobianView()
     // {
@@ -147,6 +289,12 @@ namespace aslam {
       return _J_transpose;
     }
 
+    template<typename I>
+    const util::LoadBalancer & CompressedColumnJacobianTransposeBuilder<I>::loadBalancer() const
+    {
+      return _loadBalancer;
+    }
+
 
     // const Eigen::VectorXd & CompressedColumnJacobianTransposeBuilder::e() const
     // {
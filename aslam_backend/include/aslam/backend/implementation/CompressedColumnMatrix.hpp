@@ -199,6 +199,14 @@ namespace aslam {
       return _values;
     }
 
+    template<typename I>
+    void CompressedColumnMatrix<I>::swapValues(std::vector<double>& values)
+    {
+      SM_ASSERT_FALSE(Exception, _hasDiagonalAppended, "The values cannot be swapped while a diagonal is appended");
+      SM_ASSERT_EQ(Exception, values.size(), _values.size(), "The values must have the same size");
+      _values.swap(values);
+    }
+
     /// \brief Get the underlying row indices
     template<typename I>
     const std::vector<I>& CompressedColumnMatrix<I>::row_ind() const
@@ -406,6 +414,131 @@ namespace aslam {
     }
 
 
+    template<typename I>
+    double CompressedColumnMatrix<I>::sparseDot(const double* values, const I* rowInd, I n, const double* x)
+    {
+      // Independent partial sums break the dependency chain of the additions
+      double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+      I i = 0;
+      for (; i + 4 <= n; i += 4) {
+        s0 += values[i] * x[rowInd[i]];
+        s1 += values[i + 1] * x[rowInd[i + 1]];
+        s2 += values[i + 2] * x[rowInd[i + 2]];
+        s3 += values[i + 3] * x[rowInd[i + 3]];
+      }
+      for (; i < n; ++i)
+        s0 += values[i] * x[rowInd[i]];
+      return (s0 + s1) + (s2 + s3);
+    }
+
+    template<typename I>
+    void CompressedColumnMatrix<I>::sparseAxpy(double a, const double* values, const I* rowInd, I n, double* y)
+    {
+      for (I i = 0; i < n; ++i)
+        y[rowInd[i]] += a * values[i];
+    }
+
+    template<typename I>
+    void CompressedColumnMatrix<I>::computeColumnChunks(size_t cols, size_t numChunks, std::vector<size_t>& outBoundaries) const
+    {
+      outBoundaries.resize(numChunks + 1);
+      outBoundaries[0] = 0;
+      const double nnzPerChunk = static_cast<double>(_col_ptr[cols]) / numChunks;
+      for (size_t k = 1; k < numChunks; ++k) {
+        const I target = static_cast<I>(k * nnzPerChunk);
+        const size_t c = std::lower_bound(_col_ptr.begin(), _col_ptr.begin() + cols, target) - _col_ptr.begin();
+        outBoundaries[k] = std::max(outBoundaries[k - 1], c);
+      }
+      outBoundaries[numChunks] = cols;
+    }
+
+    template<typename I>
+    template<typename SCATTER_COLUMNS>
+    void CompressedColumnMatrix<I>::scatterThreaded(SCATTER_COLUMNS scatterColumns, Eigen::VectorXd& outY, size_t nThreads, const util::ThreadedJobOptions& options) const
+    {
+      const size_t cols = numJacobianColumns();
+      outY.setZero(_rows);
+      const size_t numChunks = std::max<size_t>(1, std::min(nThreads, cols));
+      if (numChunks == 1) {
+        scatterColumns(0, cols, outY.data());
+        return;
+      }
+      std::vector<size_t>& boundaries = _scatterBoundaries;
+      computeColumnChunks(cols, numChunks, boundaries);
+
+      // The first chunk scatters into outY directly, the others into private buffers, which are kept between calls
+      std::vector<Eigen::VectorXd>& buffers = _scatterBuffers;
+      if (buffers.size() < numChunks - 1)
+        buffers.resize(numChunks - 1);
+      util::ThreadedJobOptions chunkOptions(options);
+      chunkOptions.chunkSize = 1;
+      util::runThreadedJob([&](size_t /* threadId */, size_t startIdx, size_t endIdx) {
+        for (size_t k = startIdx; k < endIdx; ++k) {
+          double* y = outY.data();
+          if (k > 0) {
+            buffers[k - 1].setZero(_rows);
+            y = buffers[k - 1].data();
+          }
+          scatterColumns(boundaries[k], boundaries[k + 1], y);
+        }
+      }, numChunks, numChunks, chunkOptions);
+
+      // Sum up the buffers in tiles of rows small enough to stay in the cache
+      const size_t tileRows = 4096;
+      util::runThreadedJob([&](size_t /* threadId */, size_t startIdx, size_t endIdx) {
+        for (size_t t = startIdx; t < endIdx; ++t) {
+          const size_t begin = t * tileRows;
+          const size_t n = std::min(tileRows, _rows - begin);
+          Eigen::VectorXd::SegmentReturnType y = outY.segment(begin, n);
+          for (size_t k = 0; k + 1 < numChunks; ++k)
+            y += buffers[k].segment(begin, n);
+        }
+      }, (_rows + tileRows - 1) / tileRows, numChunks, options);
+    }
+
+    template<typename I>
+    void CompressedColumnMatrix<I>::rightMultiply(const Eigen::VectorXd& x, Eigen::VectorXd& outY, size_t nThreads, const util::ThreadedJobOptions& options) const
+    {
+      SM_ASSERT_EQ(Exception, (size_t)x.size(), numJacobianColumns(), "The input array is the wrong size");
+      scatterThreaded([&](size_t startCol, size_t endCol, double* y) {
+        for (size_t c = startCol; c < endCol; ++c)
+          sparseAxpy(x[c], _values.data() + _col_ptr[c], _row_ind.data() + _col_ptr[c], _col_ptr[c + 1] - _col_ptr[c], y);
+      }, outY, nThreads, options);
+    }
+
+    template<typename I>
+    void CompressedColumnMatrix<I>::leftMultiply(const Eigen::VectorXd& x, Eigen::VectorXd& outY, size_t nThreads, const util::ThreadedJobOptions& options) const
+    {
+      const size_t cols = numJacobianColumns();
+      SM_ASSERT_EQ(Exception, (size_t)x.size(), _rows, "The input array is the wrong size");
+      outY.resize(cols);
+      // Every entry of outY is a dot product of its own, the columns can be processed in any order
+      auto multiplyColumns = [&](size_t /* threadId */, size_t startIdx, size_t endIdx) {
+        for (size_t c = startIdx; c < endIdx; ++c)
+          outY[c] = sparseDot(_values.data() + _col_ptr[c], _row_ind.data() + _col_ptr[c], _col_ptr[c + 1] - _col_ptr[c], x.data());
+      };
+      if (nThreads <= 1)
+        multiplyColumns(0, 0, cols);
+      else
+        util::runThreadedJob(multiplyColumns, cols, nThreads, options);
+    }
+
+    template<typename I>
+    void CompressedColumnMatrix<I>::rightMultiplyNormal(const Eigen::VectorXd& x, Eigen::VectorXd& outY, size_t nThreads, const util::ThreadedJobOptions& options) const
+    {
+      SM_ASSERT_EQ(Exception, (size_t)x.size(), _rows, "The input array is the wrong size");
+      SM_ASSERT_TRUE(Exception, &x != &outY, "The input and the output must not be the same vector");
+      scatterThreaded([&](size_t startCol, size_t endCol, double* y) {
+        for (size_t c = startCol; c < endCol; ++c) {
+          const double* values = _values.data() + _col_ptr[c];
+          const I* rowInd = _row_ind.data() + _col_ptr[c];
+          const I n = _col_ptr[c + 1] - _col_ptr[c];
+          sparseAxpy(sparseDot(values, rowInd, n, x.data()), values, rowInd, n, y);
+        }
+      }, outY, nThreads, options);
+    }
+
+
 
     template<typename I>
     void CompressedColumnMatrix<I>:: fromDense(const Eigen::MatrixXd& M)
@@ -189,6 +189,18 @@ namespace aslam {
       e = _sqrtInvR.transpose() * _error * sqrtWeight;
     }
 
+    template<int C>
+    double ErrorTermFs<C>::evaluateWeightedErrorAndJacobians(Eigen::VectorXd& outE, JacobianContainer& outJc, bool useMEstimator)
+    {
+      if (useMEstimator && _mEstimatorPolicy->isErrorDependent())
+        return ErrorTerm::evaluateWeightedErrorAndJacobians(outE, outJc, useMEstimator);
+
+      const double sqrtWeight = useMEstimator ? sqrt(_mEstimatorPolicy->getWeight(0.0)) : 1.0;
+      const double squaredError = evaluateErrorAndJacobians(outJc.apply(sqrtWeight*_sqrtInvR.transpose()));
+      outE = _sqrtInvR.transpose() * _error * sqrtWeight;
+      return squaredError;
+    }
+
     template<int C>
     void ErrorTermFs<C>::checkJacobiansFinite() const {
       JacobianContainerSparse<Dimension> J(C);
@@ -229,5 +241,170 @@ namespace aslam {
       }
     }
 
+    namespace detail {
+      /// \brief Calls \p f.apply<I>() for I in [BEGIN, END)
+      template<int BEGIN, int END>
+      struct StaticFor {
+        template<typename FUNCTOR>
+        static void run(FUNCTOR& f)
+        {
+          f.template apply<BEGIN>();
+          StaticFor<BEGIN + 1, END>::run(f);
+        }
+      };
+      template<int END>
+      struct StaticFor<END, END> {
+        template<typename FUNCTOR>
+        static void run(FUNCTOR& /* f */) { }
+      };
+
+      /// \brief Checks the design variables of a fixed-size error term
+      template<typename ERROR_TERM>
+      struct CheckDesignVariableDimensions {
+        const ERROR_TERM& _et;
+        template<int I>
+        void apply()
+        {
+          SM_ASSERT_EQ(aslam::Exception, _et.designVariable(I)->minimalDimensions(), (int)ERROR_TERM::template DesignVariableDimension<I>::value,
+                       "Design variable " << I << " does not have the minimal dimension of the error term type");
+        }
+      };
+
+      /// \brief Adds the Jacobian blocks of a fixed-size error term to a Jacobian container
+      template<typename ERROR_TERM>
+      struct AddFixedSizeJacobians {
+        ERROR_TERM& _et;
+        const typename ERROR_TERM::jacobian_t& _J;
+        JacobianContainer& _jc;
+        template<int I>
+        void apply()
+        {
+          _jc.add(_et.designVariable(I),
+                  _J.template block<ERROR_TERM::Dimension, ERROR_TERM::template DesignVariableDimension<I>::value>(0, ERROR_TERM::template DesignVariableColumnOffset<I>::value));
+        }
+      };
+
+      /// \brief Adds the Hessian blocks (I, J) for all J >= I of a fixed-size error term with weighted Jacobian \p _WJ
+      template<typename ERROR_TERM, int I>
+      struct AddFixedSizeHessianBlocks {
+        enum { DimI = ERROR_TERM::template DesignVariableDimension<I>::value };
+        ERROR_TERM& _et;
+        const typename ERROR_TERM::jacobian_t& _WJ;
+        SparseBlockMatrix& _H;
+
+        template<int J>
+        void apply()
+        {
+          enum { DimJ = ERROR_TERM::template DesignVariableDimension<J>::value };
+          const DesignVariable* dvI = _et.designVariable(I);
+          const DesignVariable* dvJ = _et.designVariable(J);
+          if (!dvJ->isActive())
+            return;
+          const auto JI = _WJ.template block<ERROR_TERM::Dimension, DimI>(0, ERROR_TERM::template DesignVariableColumnOffset<I>::value);
+          const auto JJ = _WJ.template block<ERROR_TERM::Dimension, DimJ>(0, ERROR_TERM::template DesignVariableColumnOffset<J>::value);
+          const double scaling = dvI->scaling() * dvJ->scaling();
+          // Only the upper triangular part of the Hessian is populated
+          const bool allocateIfMissing = true;
+          if (dvI->blockIndex() <= dvJ->blockIndex()) {
+            Eigen::MatrixXd* HIJ = _H.block(dvI->blockIndex(), dvJ->blockIndex(), allocateIfMissing);
+            SM_ASSERT_TRUE_DBG(aslam::Exception, HIJ != NULL, "The Hessian block is NULL");
+            HIJ->noalias() += scaling * JI.transpose() * JJ;
+            // The same design variable appearing twice contributes both cross terms
+            if (I != J && dvI == dvJ)
+              HIJ->noalias() += scaling * JJ.transpose() * JI;
+          } else {
+            Eigen::MatrixXd* HJI = _H.block(dvJ->blockIndex(), dvI->blockIndex(), allocateIfMissing);
+            SM_ASSERT_TRUE_DBG(aslam::Exception, HJI != NULL, "The Hessian block is NULL");
+            HJI->noalias() += scaling * JJ.transpose() * JI;
+          }
+        }
+      };
+
+      /// \brief Adds the Hessian blocks and the right hand side of a fixed-size error term with weighted Jacobian \p _WJ and weighted error \p _we
+      template<typename ERROR_TERM>
+      struct AddFixedSizeHessian {
+        ERROR_TERM& _et;
+        const typename ERROR_TERM::jacobian_t& _WJ;
+        const typename ERROR_TERM::error_t& _we;
+        SparseBlockMatrix& _H;
+        Eigen::VectorXd& _rhs;
+
+        template<int I>
+        void apply()
+        {
+          enum { DimI = ERROR_TERM::template DesignVariableDimension<I>::value };
+          const DesignVariable* dv = _et.designVariable(I);
+          if (!dv->isActive())
+            return;
+          SM_ASSERT_NE_DBG(aslam::Exception, dv->blockIndex(), -1, "Negative blocks shouldn't make it in here");
+          const auto JI = _WJ.template block<ERROR_TERM::Dimension, DimI>(0, ERROR_TERM::template DesignVariableColumnOffset<I>::value);
+          _rhs.template segment<DimI>(_H.rowBaseOfBlock(dv->blockIndex())).noalias() -= dv->scaling() * JI.transpose() * _we;
+          AddFixedSizeHessianBlocks<ERROR_TERM, I> blocks = { _et, _WJ, _H };
+          StaticFor<I, ERROR_TERM::NumDesignVariables>::run(blocks);
+        }
+      };
+    } // namespace detail
+
+#define ERROR_TERM_FS_FIXED_TEMPLATE template<int C, int... DVD>
+#define ERROR_TERM_FS_FIXED_CLASS ErrorTermFs<C, DVD...>
+
+    ERROR_TERM_FS_FIXED_TEMPLATE
+    void ERROR_TERM_FS_FIXED_CLASS::evaluateFixedSizeJacobians(jacobian_t& outJacobian)
+    {
+      SM_ASSERT_EQ_DBG(aslam::Exception, this->numDesignVariables(), (size_t)NumDesignVariables, "The number of design variables does not match the error term type");
+#ifndef NDEBUG
+      detail::CheckDesignVariableDimensions<ERROR_TERM_FS_FIXED_CLASS> check = { *this };
+      detail::StaticFor<0, NumDesignVariables>::run(check);
+#endif
+      evaluateFixedSizeJacobiansImplementation(outJacobian);
+    }
+
+    ERROR_TERM_FS_FIXED_TEMPLATE
+    double ERROR_TERM_FS_FIXED_CLASS::sqrtMEstimatorWeight(bool useMEstimator) const
+    {
+      return useMEstimator ? sqrt(this->_mEstimatorPolicy->getWeight(this->getRawSquaredError())) : 1.0;
+    }
+
+    ERROR_TERM_FS_FIXED_TEMPLATE
+    void ERROR_TERM_FS_FIXED_CLASS::evaluateJacobiansImplementation(JacobianContainer& outJacobians)
+    {
+      jacobian_t J;
+      evaluateFixedSizeJacobians(J);
+      detail::AddFixedSizeJacobians<ERROR_TERM_FS_FIXED_CLASS> add = { *this, J, outJacobians };
+      detail::StaticFor<0, NumDesignVariables>::run(add);
+    }
+
+    ERROR_TERM_FS_FIXED_TEMPLATE
+    void ERROR_TERM_FS_FIXED_CLASS::getWeightedJacobians(JacobianContainer& outJc, bool useMEstimator)
+    {
+      jacobian_t J;
+      evaluateFixedSizeJacobians(J);
+      const jacobian_t WJ = sqrtMEstimatorWeight(useMEstimator) * this->sqrtInvR().transpose() * J;
+      detail::AddFixedSizeJacobians<ERROR_TERM_FS_FIXED_CLASS> add = { *this, WJ, outJc };
+      detail::StaticFor<0, NumDesignVariables>::run(add);
+    }
+
+    ERROR_TERM_FS_FIXED_TEMPLATE
+    double ERROR_TERM_FS_FIXED_CLASS::evaluateWeightedErrorAndJacobians(Eigen::VectorXd& outE, JacobianContainer& outJc, bool useMEstimator)
+    {
+      // The fixed-size weighting is cheaper than evaluating into a prescaled container
+      return ErrorTerm::evaluateWeightedErrorAndJacobians(outE, outJc, useMEstimator);
+    }
+
+    ERROR_TERM_FS_FIXED_TEMPLATE
+    void ERROR_TERM_FS_FIXED_CLASS::buildHessianImplementation(SparseBlockMatrix& outHessian, Eigen::VectorXd& outRhs, bool useMEstimator)
+    {
+      jacobian_t J;
+      evaluateFixedSizeJacobians(J);
+      const typename parent_t::inverse_covariance_t W = sqrtMEstimatorWeight(useMEstimator) * this->sqrtInvR().transpose();
+      const jacobian_t WJ = W * J;
+      const typename parent_t::error_t we = W * this->error();
+      detail::AddFixedSizeHessian<ERROR_TERM_FS_FIXED_CLASS> hessian = { *this, WJ, we, outHessian, outRhs };
+      detail::StaticFor<0, NumDesignVariables>::run(hessian);
+    }
+
+#undef ERROR_TERM_FS_FIXED_TEMPLATE
+#undef ERROR_TERM_FS_FIXED_CLASS
+
   } // namespace backend
 } // namespace aslam
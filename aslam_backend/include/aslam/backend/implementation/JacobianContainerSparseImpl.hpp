@@ -1,6 +1,8 @@
 #ifndef ASLAM_JACOBIAN_CONTAINER_SPARSE_IMPL_HPP
 #define ASLAM_JACOBIAN_CONTAINER_SPARSE_IMPL_HPP
 
+#include <algorithm>
+
 #include <sm/assert_macros.hpp>
 
 #include "JacobianContainerImpl.hpp"
@@ -20,97 +22,64 @@ namespace aslam {
     JACOBIAN_CONTAINER_SPARSE_TEMPLATE
     size_t JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::numDesignVariables() const
     {
-      return _jacobianMap.size();
+      return _entries.size();
     }
 
     JACOBIAN_CONTAINER_SPARSE_TEMPLATE
-    JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::map_t::const_iterator JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::begin() const
+    typename JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::const_iterator JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::begin() const
     {
-      return _jacobianMap.begin();
+      return const_iterator(this, 0);
     }
 
     JACOBIAN_CONTAINER_SPARSE_TEMPLATE
-    JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::map_t::const_iterator JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::end() const
+    typename JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::const_iterator JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::end() const
     {
-      return _jacobianMap.end();
+      return const_iterator(this, _entries.size());
     }
 
     JACOBIAN_CONTAINER_SPARSE_TEMPLATE
-    JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::map_t::iterator JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::begin()
+    typename JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::iterator JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::begin()
     {
-      return _jacobianMap.begin();
+      return iterator(this, 0);
     }
 
     JACOBIAN_CONTAINER_SPARSE_TEMPLATE
-    JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::map_t::iterator JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::end()
+    typename JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::iterator JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::end()
     {
-      return _jacobianMap.end();
+      return iterator(this, _entries.size());
     }
 
-
-    /// \brief Apply the chain rule to the set of Jacobians.
-    /// This may change the number of rows of this set of Jacobians
-    /// by multiplying through by df_dx on the left.
     JACOBIAN_CONTAINER_SPARSE_TEMPLATE
-    void JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::applyChainRule(const Eigen::MatrixXd& df_dx)
+    typename JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::entry_vector_t::iterator JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::findEntry(const DesignVariable* dv)
     {
-      SM_ASSERT_EQ(Exception, df_dx.cols(), _rows, "Invalid matrix multiplication");
-      map_t::iterator it = _jacobianMap.begin(),
-                      it_end = _jacobianMap.end();
-      for (; it != it_end; ++it)
-        it->second = df_dx * it->second;
-      _rows = df_dx.rows();
+      return std::lower_bound(_entries.begin(), _entries.end(), dv->blockIndex(),
+                              [](const Entry& entry, int blockIndex) { return entry.designVariable->blockIndex() < blockIndex; });
     }
 
-
-
     JACOBIAN_CONTAINER_SPARSE_TEMPLATE
-    void JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::buildCorrelatedHessianBlock(const Eigen::VectorXd& e,
-                                                        const Eigen::MatrixXd& J1, int j1_block,
-                                                        SparseBlockMatrix& outHessian,
-                                                        map_t::const_iterator it, map_t::const_iterator it_end) const
+    typename JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::entry_vector_t::const_iterator JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::findEntry(const DesignVariable* dv) const
     {
-      // Recursion base case.
-      if (it == it_end)
-        return;
-      int j2_block = it->first->blockIndex();
-      SM_ASSERT_LE_DBG(Exception, j1_block, j2_block, "The recursion should proceed in ordered blocks in order to only populate the upper diagonal of the Hessian. This violates the ordering.");
-      const bool allocateIfMissing = true;
-      Eigen::MatrixXd* J1t_invR_J2 = outHessian.block(j1_block, j2_block, allocateIfMissing);
-      SM_ASSERT_TRUE_DBG(Exception, J1t_invR_J2 != NULL, "The Hessian block is NULL");
-      SM_ASSERT_EQ_DBG(Exception, J1t_invR_J2->rows(), J1.cols(),
-                       "The Hessian block has an unexpected number of rows. Block J1^T invR J2: (" <<
-                       j1_block << ", " << j2_block << "). J1 is: " <<
-                       J1.cols() << "x" << J1.rows() <<  ", J2 is: " <<
-                       it->second.rows() << "x" << it->second.cols());
-      SM_ASSERT_EQ_DBG(Exception, J1t_invR_J2->cols(), it->second.cols(),
-                       "The Hessian block has an unexpected number of rows. Block J1^T invR J2: (" <<
-                       j1_block << ", " << j2_block << "). J1 is: " <<
-                       J1.cols() << "x" << J1.rows() <<  ", J2 is: " <<
-                       it->second.rows() << "x" << it->second.cols());
-      *J1t_invR_J2 += J1.transpose() * it->second;
-      // Tail recursion
-      buildCorrelatedHessianBlock(e, J1, j1_block, outHessian, ++it, it_end);
+      return std::lower_bound(_entries.begin(), _entries.end(), dv->blockIndex(),
+                              [](const Entry& entry, int blockIndex) { return entry.designVariable->blockIndex() < blockIndex; });
     }
 
+    /// \brief Apply the chain rule to the set of Jacobians.
+    /// This may change the number of rows of this set of Jacobians
+    /// by multiplying through by df_dx on the left.
     JACOBIAN_CONTAINER_SPARSE_TEMPLATE
-    void JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::buildHessianBlock(const Eigen::VectorXd& e,
-                                              SparseBlockMatrix& outHessian,
-                                              Eigen::VectorXd& outRhs,
-                                              map_t::const_iterator it, map_t::const_iterator it_end) const
+    void JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::applyChainRule(const Eigen::MatrixXd& df_dx)
     {
-      // Recursion base case.
-      if (it == it_end)
-        return;
-      const int j1_block = it->first->blockIndex();
-      // \todo Make this a debug assert.
-      SM_ASSERT_NE_DBG(Exception, j1_block, -1, "Negative blocks shouldn't make it in here");
-      // templated version: outRhs.segment< J1::ColsAtCompileTime >.(j1_block);
-      outRhs.segment(outHessian.rowBaseOfBlock(j1_block), it->second.cols()) -= it->second.transpose() * e;
-      // Recurse in to the list to build correlated blocks
-      buildCorrelatedHessianBlock(e, it->second, j1_block, outHessian, it, it_end);
-      // Tail recursion to traverse the list
-      buildHessianBlock(e, outHessian, outRhs, ++it, it_end);
+      SM_ASSERT_EQ(Exception, df_dx.cols(), _rows, "Invalid matrix multiplication");
+      const int rows = df_dx.rows();
+      _chainRuleBuffer.resize(_buffer.size() / std::max(_rows, 1) * rows);
+      std::size_t offset = 0;
+      for (Entry& entry : _entries) {
+        JacobianMap(_chainRuleBuffer.data() + offset, rows, entry.cols).noalias() = df_dx * jacobianMap(entry);
+        entry.offset = offset;
+        offset += rows * entry.cols;
+      }
+      _buffer.swap(_chainRuleBuffer);
+      _rows = rows;
     }
 
     JACOBIAN_CONTAINER_SPARSE_TEMPLATE
@@ -118,34 +87,56 @@ namespace aslam {
     {
       SM_ASSERT_EQ_DBG(Exception, e.size(), _rows, "The error and this Jacobian container should have the same size");
       SM_ASSERT_EQ_DBG(Exception, e.size(), sqrtInvR.rows(), "The error and the covariance matrix don't have compatible sizes");
-      //SparseMatrixBlock * block = outHessian.block(int r, int c, allocIfMissing);
-      // This sucks but I'll have to take a copy of the map to keep this function const.
-      map_t mapCopy = _jacobianMap;
-      // Scale each Jacobian.
-      map_t::iterator itt = mapCopy.begin();
-      for (; itt != mapCopy.end(); ++itt) {
-        itt->second = (itt->first->scaling() * sqrtInvR.transpose() * itt->second).eval();
+      // Scale each Jacobian into the scratch buffer, using the same layout as the buffer of the Jacobians.
+      const int scaledRows = sqrtInvR.cols();
+      const std::size_t rows = std::max(_rows, 1);
+      _scaledBuffer.resize(_buffer.size() / rows * scaledRows + scaledRows);
+      auto scaledJacobian = [&](const Entry& entry) {
+        return Eigen::Map<Eigen::MatrixXd>(_scaledBuffer.data() + entry.offset / rows * scaledRows, scaledRows, entry.cols);
+      };
+      for (const Entry& entry : _entries)
+        scaledJacobian(entry).noalias() = entry.designVariable->scaling() * sqrtInvR.transpose() * jacobianMap(entry);
+      Eigen::Map<Eigen::VectorXd> scaledError(_scaledBuffer.data() + _scaledBuffer.size() - scaledRows, scaledRows);
+      scaledError.noalias() = sqrtInvR.transpose() * e;
+      // Only populate the upper diagonal of the Hessian. The entries are ordered by block index.
+      for (size_t i = 0; i < _entries.size(); ++i) {
+        const int j1_block = _entries[i].designVariable->blockIndex();
+        SM_ASSERT_NE_DBG(Exception, j1_block, -1, "Negative blocks shouldn't make it in here");
+        const Eigen::Map<Eigen::MatrixXd> J1 = scaledJacobian(_entries[i]);
+        outRhs.segment(outHessian.rowBaseOfBlock(j1_block), J1.cols()).noalias() -= J1.transpose() * scaledError;
+        for (size_t j = i; j < _entries.size(); ++j) {
+          const int j2_block = _entries[j].designVariable->blockIndex();
+          const Eigen::Map<Eigen::MatrixXd> J2 = scaledJacobian(_entries[j]);
+          const bool allocateIfMissing = true;
+          Eigen::MatrixXd* J1t_invR_J2 = outHessian.block(j1_block, j2_block, allocateIfMissing);
+          SM_ASSERT_TRUE_DBG(Exception, J1t_invR_J2 != NULL, "The Hessian block is NULL");
+          SM_ASSERT_EQ_DBG(Exception, J1t_invR_J2->rows(), J1.cols(),
+                           "The Hessian block has an unexpected number of rows. Block J1^T invR J2: (" <<
+                           j1_block << ", " << j2_block << "). J1 is: " <<
+                           J1.cols() << "x" << J1.rows() <<  ", J2 is: " <<
+                           J2.rows() << "x" << J2.cols());
+          SM_ASSERT_EQ_DBG(Exception, J1t_invR_J2->cols(), J2.cols(),
+                           "The Hessian block has an unexpected number of rows. Block J1^T invR J2: (" <<
+                           j1_block << ", " << j2_block << "). J1 is: " <<
+                           J1.cols() << "x" << J1.rows() <<  ", J2 is: " <<
+                           J2.rows() << "x" << J2.cols());
+          J1t_invR_J2->noalias() += J1.transpose() * J2;
+        }
       }
-      map_t::const_iterator it = mapCopy.begin();
-      map_t::const_iterator it_end = mapCopy.end();
-      // Start the recursion
-      buildHessianBlock(sqrtInvR.transpose() * e, outHessian, outRhs, it, it_end);
     }
 
     JACOBIAN_CONTAINER_SPARSE_TEMPLATE
     bool JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::isFinite(const DesignVariable& dv) const
     {
-      map_t::const_iterator it = _jacobianMap.find(const_cast<DesignVariable*>(&dv));
-      SM_ASSERT_TRUE(Exception, it != _jacobianMap.end(), "The design variable does not exist in the container");
-      return it->second.allFinite();
+      return Jacobian(&dv).allFinite();
     }
 
     JACOBIAN_CONTAINER_SPARSE_TEMPLATE
-    const Eigen::MatrixXd& JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::Jacobian(const DesignVariable* dv) const
+    typename JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::ConstJacobianMap JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::Jacobian(const DesignVariable* dv) const
     {
-      map_t::const_iterator it = _jacobianMap.find(const_cast<DesignVariable* >(dv));
-      SM_ASSERT_TRUE(Exception, it != _jacobianMap.end(), "The design variable does not exist in the container");
-      return it->second;
+      typename entry_vector_t::const_iterator it = findEntry(dv);
+      SM_ASSERT_TRUE(Exception, it != _entries.end() && it->designVariable == dv, "The design variable does not exist in the container");
+      return jacobianMap(*it);
     }
 
     /// \brief Get design variable i.
@@ -153,10 +144,7 @@ namespace aslam {
     DesignVariable* JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::designVariable(size_t i)
     {
       SM_ASSERT_LT(Exception, i, numDesignVariables(), "Index out of range");
-      map_t::iterator it = _jacobianMap.begin();
-      for (size_t ii = 0; ii < i; ++ii)
-        it++;
-      return it->first;
+      return _entries[i].designVariable;
     }
 
     /// \brief Get design variable i.
@@ -164,29 +152,34 @@ namespace aslam {
     const DesignVariable* JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::designVariable(size_t i) const
     {
       SM_ASSERT_LT(Exception, i, numDesignVariables(), "Index out of range");
-      map_t::const_iterator it = _jacobianMap.begin();
-      for (size_t ii = 0; ii < i; ++ii)
-        it++;
-      return it->first;
+      return _entries[i].designVariable;
     }
 
   JACOBIAN_CONTAINER_SPARSE_TEMPLATE
   void JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::reset(int rows) {
+    SM_ASSERT_TRUE(Exception, Rows == Eigen::Dynamic || rows == Rows, "");
     clear();
-    _rows = rows;
+    setRows(rows);
   }
-  
+
+    JACOBIAN_CONTAINER_SPARSE_TEMPLATE
+    void JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::reserve(std::size_t numDesignVariables, std::size_t numValues)
+    {
+      _entries.reserve(numDesignVariables);
+      _buffer.reserve(numValues);
+    }
+
     /// \brief Clear the contents of this container
     JACOBIAN_CONTAINER_SPARSE_TEMPLATE
     void JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::clear()
     {
-      _jacobianMap.clear();
+      _entries.clear();
+      _buffer.clear();
     }
 
     JACOBIAN_CONTAINER_SPARSE_TEMPLATE
     void JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::setZero() {
-      for (auto& dvJacPair : _jacobianMap)
-        dvJacPair.second.setZero();
+      std::fill(_buffer.begin(), _buffer.end(), 0.0);
     }
 
     JACOBIAN_CONTAINER_SPARSE_TEMPLATE
@@ -211,12 +204,11 @@ namespace aslam {
       rows[0] = _rows;
       /// Step 2: fill the Jacobian
       SparseBlockMatrix J(rows, colBlockIndices, true);
-      map_t::const_iterator it = _jacobianMap.begin();
-      for (int col = 0; it != _jacobianMap.end(); ++it, col++) {
+      for (const Entry& entry : _entries) {
         const bool allocateBlock = true;
-        SM_ASSERT_GE_LT_DBG(aslam::IndexOutOfBoundsException, it->first->blockIndex(), 0, static_cast<int>(colBlockIndices.size()), "Block index is out of bounds");
-        Eigen::MatrixXd& Ji = *J.block(0, it->first->blockIndex(), allocateBlock);
-        Ji = it->second;
+        SM_ASSERT_GE_LT_DBG(aslam::IndexOutOfBoundsException, entry.designVariable->blockIndex(), 0, static_cast<int>(colBlockIndices.size()), "Block index is out of bounds");
+        Eigen::MatrixXd& Ji = *J.block(0, entry.designVariable->blockIndex(), allocateBlock);
+        Ji = jacobianMap(entry);
       }
       return J;
     }
@@ -229,18 +221,16 @@ namespace aslam {
       rows[0] = _rows;
       std::vector<int> cols(numDesignVariables());
       int sum = 0;
-      map_t::const_iterator it = _jacobianMap.begin();
-      for (int i = 0 ; it != _jacobianMap.end(); ++it, ++i) {
-        sum += it->first->minimalDimensions();
+      for (size_t i = 0; i < _entries.size(); ++i) {
+        sum += _entries[i].cols;
         cols[i] = sum;
       }
       /// Step 2: fill the Jacobian
       SparseBlockMatrix J(rows, cols, true);
-      it = _jacobianMap.begin();
-      for (int col = 0; it != _jacobianMap.end(); ++it, col++) {
+      for (size_t i = 0; i < _entries.size(); ++i) {
         const bool allocateBlock = true;
-        Eigen::MatrixXd& Ji = *J.block(0, col, allocateBlock);
-        Ji = it->second;
+        Eigen::MatrixXd& Ji = *J.block(0, i, allocateBlock);
+        Ji = jacobianMap(_entries[i]);
       }
       return J;
     }
@@ -249,9 +239,8 @@ namespace aslam {
     int JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::cols() const
     {
       int sum = 0;
-      map_t::const_iterator it = _jacobianMap.begin();
-      for (int i = 0 ; it != _jacobianMap.end(); ++it, ++i) {
-        sum += it->first->minimalDimensions();
+      for (const Entry& entry : _entries) {
+        sum += entry.cols;
       }
       return sum;
     }
@@ -260,12 +249,16 @@ namespace aslam {
     template <typename MATRIX>
     EIGEN_ALWAYS_INLINE void JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::addJacobian(DesignVariable* dv, const MATRIX& jacobian)
     {
-      map_t::iterator it = _jacobianMap.find(dv);
-      if (it == _jacobianMap.end()) {
-          _jacobianMap.emplace(dv, jacobian);
+      SM_ASSERT_EQ_DBG(Exception, jacobian.rows(), _rows, "The Jacobian must have the same number of rows as this container");
+      typename entry_vector_t::iterator it = findEntry(dv);
+      if (it == _entries.end() || it->designVariable->blockIndex() != dv->blockIndex()) {
+        const Entry entry = { dv, static_cast<int>(jacobian.cols()), _buffer.size() };
+        _buffer.resize(_buffer.size() + _rows * entry.cols);
+        jacobianMap(entry).noalias() = jacobian;
+        _entries.insert(it, entry);
       } else {
-        SM_ASSERT_TRUE_DBG(Exception, it->first == dv, "Two design variables had the same block index but different pointer values");
-          it->second.noalias() += jacobian;
+        SM_ASSERT_TRUE_DBG(Exception, it->designVariable == dv, "Two design variables had the same block index but different pointer values");
+        jacobianMap(*it).noalias() += jacobian;
       }
     }
 
@@ -288,32 +281,12 @@ namespace aslam {
       SM_ASSERT_EQ(Exception, _rows, rhs._rows, "The JacobianContainers cannot be added. They don't have the same number of rows.");
       if (applyChainRule != nullptr)
         SM_ASSERT_EQ(Exception, applyChainRule->cols(), rhs._rows, "Wrong dimension of chain rule matrix");
-      // Merge the two maps.
-      // They are sorted by block it->first->blockIndex() so we can be smart about this.
-      map_t::iterator lt = _jacobianMap.begin();
-      const map_t::iterator lt_end = _jacobianMap.end();
-      map_t::const_iterator rt = rhs._jacobianMap.begin();
-      map_t::const_iterator rt_end = rhs._jacobianMap.end();
-      bool done = rt == rt_end;
-      for (; lt != lt_end && !done; ++lt) {
-        // The maps are sorted by block index. FFWD the rhs map
-        // inserting elements until we find the next possible
-        // equal element.
-        while (!done && rt->first->blockIndex() < lt->first->blockIndex()) {
-          _jacobianMap.insert(lt, std::make_pair(rt->first, applyChainRule == nullptr ? rt->second : (*applyChainRule)*rt->second));
-          ++rt;
-          done = (rt == rt_end);
-        }
-        // If these keys match the Jacobians add
-        if (!done && rt->first->blockIndex() == lt->first->blockIndex()) {
-          SM_ASSERT_TRUE_DBG(Exception, rt->first == lt->first, "Two design variables had the same block index but different pointer values");
-          // add the Jacobians.
-          lt->second += applyChainRule == nullptr ? rt->second : (*applyChainRule)*rt->second;
-        }
-      }
-      // Now the lhs list is done...add the remaining elements of the rhs list.
-      for (; rt != rt_end; rt++) {
-        _jacobianMap.insert(lt, std::make_pair(rt->first, applyChainRule == nullptr ? rt->second : (*applyChainRule)*rt->second));
+      // Both entry lists are sorted by block index, so each lookup only has to search a short list.
+      for (const Entry& entry : rhs._entries) {
+        if (applyChainRule == nullptr)
+          addJacobian(entry.designVariable, rhs.jacobianMap(entry));
+        else
+          addJacobian(entry.designVariable, (*applyChainRule) * rhs.jacobianMap(entry));
       }
     }
 
@@ -321,15 +294,19 @@ namespace aslam {
     template<typename DERIVED>
     void JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::addLargeLhs(const JacobianContainerSparse& rhs, const Eigen::MatrixBase<DERIVED>* applyChainRule /*= nullptr*/)
     {
-      for (auto dvJacPair : rhs)
-        add(dvJacPair.first, applyChainRule == nullptr ? dvJacPair.second : (*applyChainRule)*dvJacPair.second);
+      for (auto dvJacPair : rhs) {
+        if (applyChainRule == nullptr)
+          add(dvJacPair.first, dvJacPair.second);
+        else
+          add(dvJacPair.first, (*applyChainRule)*dvJacPair.second);
+      }
     }
 
     JACOBIAN_CONTAINER_SPARSE_TEMPLATE
     inline void JACOBIAN_CONTAINER_SPARSE_CLASS_TEMPLATE::addTo(JacobianContainer& jc)
     {
-      for (auto& dvJacPair : _jacobianMap)
-        jc.add(dvJacPair.first, dvJacPair.second);
+      for (const Entry& entry : _entries)
+        jc.add(entry.designVariable, jacobianMap(entry));
     }
 
     // Explicit template instantiation
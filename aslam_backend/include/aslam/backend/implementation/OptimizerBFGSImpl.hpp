@@ -19,6 +19,8 @@ inline void OptimizerOptionsBFGS::serialize(Archive & ar, const unsigned int /*v
   ar & BOOST_SERIALIZATION_NVP(linesearch);
   ar & BOOST_SERIALIZATION_NVP(useDenseJacobianContainer);
   ar & BOOST_SERIALIZATION_NVP(regularizer);
+  ar & BOOST_SERIALIZATION_NVP(historySize);
+  ar & BOOST_SERIALIZATION_NVP(useDesignVariableScaling);
 }
 
 } /* namespace aslam */
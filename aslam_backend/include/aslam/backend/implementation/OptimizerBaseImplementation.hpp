@@ -25,6 +25,9 @@ inline void OptimizerOptionsBase::serialize(Archive & ar, const unsigned int /*v
   ar & BOOST_SERIALIZATION_NVP(maxIterations);
   ar & BOOST_SERIALIZATION_NVP(numThreadsJacobian);
   ar & BOOST_SERIALIZATION_NVP(numThreadsError);
+  ar & BOOST_SERIALIZATION_NVP(useThreadPool);
+  ar & BOOST_SERIALIZATION_NVP(threadPoolChunkSize);
+  ar & BOOST_SERIALIZATION_NVP(balanceThreadLoad);
 }
 
 template<class Archive>
@@ -8,6 +8,7 @@
 #ifndef INCLUDE_ASLAM_BACKEND_UTIL_COSTFUNCTIONINTERFACE_HPP_
 #define INCLUDE_ASLAM_BACKEND_UTIL_COSTFUNCTIONINTERFACE_HPP_
 
+#include <aslam/Exceptions.hpp>
 #include <aslam/backend/util/CommonDefinitions.hpp> //RowVectorType, ColumnVectorType
 
 namespace aslam
@@ -27,6 +28,20 @@ struct CostFunctionInterface
   virtual double evaluateError() const = 0;
   virtual void computeGradient(RowVectorType& gradient) = 0;
   virtual const std::vector<DesignVariable*>& getDesignVariables() = 0;
+
+  /// \brief Whether evaluateAtStep() is implemented and may be called concurrently from several threads
+  virtual bool supportsConcurrentEvaluation() const { return false; }
+
+  /**
+   * Evaluate the error and optionally the gradient at the current state updated by \p dx, without modifying
+   * the design variables. Concurrent calls must not interfere with each other.
+   * @param dx Update of the design variables in minimal coordinates, as for applyStateUpdate()
+   * @param gradient If not NULL, the gradient at the updated state is written to it
+   * @return The error at the updated state
+   */
+  virtual double evaluateAtStep(const RowVectorType& /* dx */, RowVectorType* /* gradient */) {
+    SM_THROW(aslam::Exception, "This cost function does not support evaluations at a step");
+  }
 };
 
 } /* namespace aslam */
@@ -0,0 +1,87 @@
+#ifndef INCLUDE_ASLAM_BACKEND_UTIL_LOADBALANCER_HPP_
+#define INCLUDE_ASLAM_BACKEND_UTIL_LOADBALANCER_HPP_
+
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+namespace aslam {
+namespace backend {
+namespace util {
+
+/**
+ * \struct ThreadedJobStatistics
+ * Timing statistics of the last run of a threaded job
+ */
+struct ThreadedJobStatistics {
+  std::vector<double> busyTime; /// \brief The time in seconds each thread spent working on the job
+  double wallTime = 0.0; /// \brief The time in seconds from the start to the end of the job
+
+  /// \brief Clear the statistics for a job with \p numThreads threads
+  void reset(std::size_t numThreads);
+
+  /// \brief The sum of the busy times of all threads
+  double totalBusyTime() const;
+
+  /// \brief The ratio of the maximum to the mean busy time of the threads. 1 means perfectly balanced.
+  double imbalance() const;
+};
+
+/// \brief Stream operator for ThreadedJobStatistics
+std::ostream& operator<<(std::ostream& out, const ThreadedJobStatistics& statistics);
+
+/**
+ * \class LoadBalancer
+ * Balances a range of items with heterogeneous processing cost over multiple threads.
+ *
+ * The balancer keeps an estimate of the cost of every item. The estimates are initialized from cost hints
+ * and refined with the measured processing times of the chunks. The range can then be cut into chunks of
+ * equal estimated cost instead of equal size.
+ */
+class LoadBalancer {
+ public:
+  /// \brief Initialize the cost estimates with one (relative) hint per item. Non-positive hints default to 1.
+  void init(const std::vector<double>& costHints);
+
+  /// \brief The number of items
+  std::size_t size() const { return _costs.size(); }
+
+  /// \brief The current cost estimates
+  const std::vector<double>& getCosts() const { return _costs; }
+
+  /// \brief Cut the range into \p numChunks chunks of approximately equal estimated cost.
+  ///        Returns the chunk boundaries, starting with 0 and ending with size().
+  const std::vector<std::size_t>& computeChunkBoundaries(std::size_t numChunks);
+
+  /// \brief Mark the begin of a job run with \p numThreads threads
+  void beginJob(std::size_t numThreads);
+
+  /// \brief Refine the estimates of the items (start .. end - 1), which took \p duration seconds to process on thread \p threadId.
+  ///        May be called concurrently for disjoint ranges and threads.
+  void addMeasurement(std::size_t threadId, std::size_t start, std::size_t end, double duration);
+
+  /// \brief Mark the end of a job run that took \p wallTime seconds
+  void endJob(double wallTime);
+
+  /// \brief The statistics of the last job run
+  const ThreadedJobStatistics& getStatistics() const { return _statistics; }
+
+ private:
+  /// \brief The cost estimate of each item
+  std::vector<double> _costs;
+
+  /// \brief The chunk boundaries computed last
+  std::vector<std::size_t> _chunkBoundaries;
+
+  /// \brief Whether the estimates are based on measurements already, otherwise they are based on the hints
+  bool _isCalibrated = false;
+
+  /// \brief The statistics of the last job run
+  ThreadedJobStatistics _statistics;
+};
+
+} // namespace util
+} // namespace backend
+} // namespace aslam
+
+#endif /* INCLUDE_ASLAM_BACKEND_UTIL_LOADBALANCER_HPP_ */
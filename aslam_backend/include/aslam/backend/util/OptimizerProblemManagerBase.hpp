@@ -29,6 +29,10 @@ class OptimizerProblemManagerBase : public OptimizerBase
   bool isInitialized() override { return _problemManager.isInitialized(); }
   const std::vector<DesignVariable*>& getDesignVariables() const override { return _problemManager.designVariables(); }
 
+  /// \brief Add a replica of the problem, see ProblemManager::addReplica(). Optimizers may evaluate candidate steps
+  ///        concurrently on the replicas.
+  void addProblemReplica(boost::shared_ptr<OptimizationProblemBase> replica) { _problemManager.addReplica(replica); }
+
   /// \brief return the total dimension of all squared error terms together
   size_t getTotalDimSquaredErrorTerms() {
     return problemManager().getTotalDimSquaredErrorTerms();
@@ -37,7 +41,10 @@ class OptimizerProblemManagerBase : public OptimizerBase
  protected:
   const ProblemManager& problemManager() const { return _problemManager; }
   ProblemManager& problemManager() { return _problemManager; }
-  void initializeImplementation() override { _problemManager.initialize(); }
+  void initializeImplementation() override {
+    _problemManager.initialize();
+    _problemManager.setThreadedJobOptions(getOptions().getThreadedJobOptions());
+  }
 
  private:
   ProblemManager _problemManager; /// \brief Problem manager
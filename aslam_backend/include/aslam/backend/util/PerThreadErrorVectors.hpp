@@ -0,0 +1,77 @@
+#ifndef INCLUDE_ASLAM_BACKEND_UTIL_PERTHREADERRORVECTORS_HPP_
+#define INCLUDE_ASLAM_BACKEND_UTIL_PERTHREADERRORVECTORS_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <sm/assert_macros.hpp>
+
+namespace aslam {
+namespace backend {
+namespace util {
+
+/**
+ * \class PerThreadErrorVectors
+ * Reusable error vectors for the threads of a threaded job.
+ *
+ * Every thread keeps one vector per error dimension, so assigning the error of a term never resizes the vector,
+ * even if the dimensions of consecutive error terms differ.
+ */
+class PerThreadErrorVectors {
+ public:
+  PerThreadErrorVectors() = default;
+  /// \brief The vectors are scratch space, so copies start without any
+  PerThreadErrorVectors(const PerThreadErrorVectors& /* other */) { }
+  PerThreadErrorVectors& operator=(const PerThreadErrorVectors& /* other */) { return *this; }
+
+  /// \brief Make sure there are vectors for each of \p numThreads threads.
+  ///        Must not be called while a job is using the vectors.
+  void resize(std::size_t numThreads)
+  {
+    _vectors.reserve(numThreads);
+    while (_vectors.size() < numThreads) {
+      _vectors.emplace_back();
+      grow(_vectors.back(), _maxDimension);
+    }
+  }
+
+  /// \brief Allocate the vectors in all threads for the errors of any of the error terms \p errors
+  template <typename ERROR_TERM>
+  void reserve(const std::vector<ERROR_TERM*>& errors)
+  {
+    for (const ERROR_TERM* e : errors)
+      _maxDimension = std::max<std::size_t>(_maxDimension, e->dimension());
+    for (auto& vectors : _vectors)
+      grow(vectors, _maxDimension);
+  }
+
+  /// \brief Get the vector of thread \p threadId with \p dimension rows
+  Eigen::VectorXd& get(std::size_t threadId, int dimension)
+  {
+    SM_ASSERT_LT_DBG(std::out_of_range, threadId, _vectors.size(), "There are no error vectors for this thread");
+    std::vector<Eigen::VectorXd>& vectors = _vectors[threadId];
+    // Error terms not passed to reserve() allocate on first use only
+    grow(vectors, dimension);
+    return vectors[dimension];
+  }
+
+ private:
+  /// \brief Add the vectors up to dimension \p maxDimension
+  static void grow(std::vector<Eigen::VectorXd>& vectors, std::size_t maxDimension)
+  {
+    while (vectors.size() <= maxDimension)
+      vectors.emplace_back(vectors.size());
+  }
+
+  std::vector<std::vector<Eigen::VectorXd> > _vectors; /// \brief The vectors of every thread, indexed by their dimension
+  std::size_t _maxDimension = 0; /// \brief The largest error dimension to allocate vectors for
+};
+
+} // namespace util
+} // namespace backend
+} // namespace aslam
+
+#endif /* INCLUDE_ASLAM_BACKEND_UTIL_PERTHREADERRORVECTORS_HPP_ */
@@ -0,0 +1,82 @@
+#ifndef INCLUDE_ASLAM_BACKEND_UTIL_PERTHREADJACOBIANCONTAINERS_HPP_
+#define INCLUDE_ASLAM_BACKEND_UTIL_PERTHREADJACOBIANCONTAINERS_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <sm/assert_macros.hpp>
+
+#include <aslam/backend/JacobianContainerSparse.hpp>
+
+namespace aslam {
+namespace backend {
+namespace util {
+
+/**
+ * \class PerThreadJacobianContainers
+ * One reusable Jacobian container per thread of a threaded job.
+ *
+ * Instead of constructing a container for every error term, a thread resets its own container.
+ * The containers are pre-sized for the largest error term, so evaluating Jacobians does not allocate.
+ */
+template <int Rows = Eigen::Dynamic>
+class PerThreadJacobianContainers {
+ public:
+  typedef JacobianContainerSparse<Rows> container_t;
+
+  PerThreadJacobianContainers() = default;
+  /// \brief The containers are scratch space, so copies start without any
+  PerThreadJacobianContainers(const PerThreadJacobianContainers& /* other */) { }
+  PerThreadJacobianContainers& operator=(const PerThreadJacobianContainers& /* other */) { return *this; }
+
+  /// \brief Make sure there is a container for each of \p numThreads threads.
+  ///        Must not be called while a job is using the containers.
+  void resize(std::size_t numThreads)
+  {
+    _containers.reserve(numThreads);
+    while (_containers.size() < numThreads) {
+      _containers.emplace_back(new container_t(Rows == Eigen::Dynamic ? 1 : Rows));
+      _containers.back()->reserve(_numDesignVariables, _numValues);
+    }
+  }
+
+  /// \brief Reserve memory in all containers for the Jacobians of any of the error terms \p errors
+  template <typename ERROR_TERM>
+  void reserve(const std::vector<ERROR_TERM*>& errors)
+  {
+    for (const ERROR_TERM* e : errors) {
+      std::size_t cols = 0;
+      for (const DesignVariable* dv : e->designVariables())
+        cols += dv->minimalDimensions();
+      _numDesignVariables = std::max(_numDesignVariables, e->designVariables().size());
+      _numValues = std::max(_numValues, e->dimension() * cols);
+    }
+    for (auto& jc : _containers)
+      jc->reserve(_numDesignVariables, _numValues);
+  }
+
+  /// \brief The number of containers
+  std::size_t size() const { return _containers.size(); }
+
+  /// \brief Get the container of thread \p threadId, cleared and set to \p rows rows
+  container_t& get(std::size_t threadId, int rows)
+  {
+    SM_ASSERT_LT_DBG(std::out_of_range, threadId, _containers.size(), "There is no Jacobian container for this thread");
+    container_t& jc = *_containers[threadId];
+    jc.reset(rows);
+    return jc;
+  }
+
+ private:
+  std::vector<std::unique_ptr<container_t> > _containers;
+  std::size_t _numDesignVariables = 0; /// \brief The number of Jacobians to reserve memory for
+  std::size_t _numValues = 0; /// \brief The number of Jacobian entries to reserve memory for
+};
+
+} // namespace util
+} // namespace backend
+} // namespace aslam
+
+#endif /* INCLUDE_ASLAM_BACKEND_UTIL_PERTHREADJACOBIANCONTAINERS_HPP_ */
@@ -11,9 +11,13 @@
 #include <vector>
 
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/recursive_mutex.hpp>
 
 #include "CommonDefinitions.hpp"
 #include "CostFunctionInterface.hpp"
+#include "PerThreadErrorVectors.hpp"
+#include "PerThreadJacobianContainers.hpp"
+#include "ThreadedRangeProcessor.hpp"
 
 #include "../../Exceptions.hpp"
 #include "../JacobianContainerDense.hpp"
@@ -103,6 +107,41 @@ class ProblemManager {
   /// \brief Returns a flattened version of the design variables' parameters
   Eigen::VectorXd getFlattenedDesignVariableParameters() const;
 
+  /// \brief Set the design variables' parameters from a flattened version as returned by getFlattenedDesignVariableParameters()
+  void setFlattenedDesignVariableParameters(const Eigen::VectorXd& x);
+
+  /**
+   * Add a replica of the problem for the evaluations at explicit parameters. The replica must have the same active
+   * design variables, with the same dimensions and scaling, and the same error terms as the problem of this manager,
+   * but it must own separate design variable objects. Each replica serves one evaluation at a time, so evaluations
+   * from as many threads as there are replicas run concurrently. initialize() initializes the replicas as well and
+   * checks that they still match the problem.
+   */
+  void addReplica(boost::shared_ptr<OptimizationProblemBase> replica);
+
+  /// \brief The number of replicas used for the evaluations at explicit parameters
+  size_t numReplicas() const;
+
+  /// \brief Remove all replicas
+  void clearReplicas();
+
+  /**
+   * Evaluate the objective function at the flattened parameters \p x, see getFlattenedDesignVariableParameters().
+   * If replicas were added, the evaluation runs on a free replica and leaves the design variables of this problem
+   * untouched. Otherwise the parameters are swapped into the design variables and the previous ones are restored
+   * afterwards. Such evaluations from several threads are serialized with all other evaluations of the problem, so
+   * none of them sees the temporary parameters.
+   */
+  double evaluateErrorAt(const Eigen::VectorXd& x, size_t nThreads);
+
+  /// \brief compute the gradient of the objective function at the flattened parameters \p x, like evaluateErrorAt()
+  void computeGradientAt(const Eigen::VectorXd& x, RowVectorType& outGrad, size_t nThreads, bool useMEstimator, bool applyDvScaling, bool useDenseJacobianContainer);
+
+  /// \brief evaluate the objective function and, if \p outGrad is not NULL, its gradient at the current state updated by \p dx,
+  ///        as applied by applyStateUpdate(). The design variables are left unchanged, see evaluateErrorAt().
+  double evaluateAtStep(const RowVectorType& dx, RowVectorType* outGrad, size_t nThreadsError, size_t nThreadsJacobian,
+                        bool useMEstimator, bool applyDvScaling, bool useDenseJacobianContainer);
+
   /// \brief compute the current gradient of the objective function
   void computeGradient(RowVectorType& outGrad, size_t nThreads, bool useMEstimator, bool applyDvScaling, bool useDenseJacobianContainer);
 
@@ -111,22 +150,36 @@ class ProblemManager {
 
   /// \brief computes the gradient of a specific error term
   void addGradientForErrorTerm(RowVectorType& J, ErrorTerm* e, bool useMEstimator, bool useDenseJacobianContainer);
+  void addGradientForErrorTerm(JacobianContainerSparse<>& jc, ColumnVectorType& ev, RowVectorType& J, ErrorTerm* e, bool useMEstimator);
   void addGradientForErrorTerm(JacobianContainerSparse<1>& jc, RowVectorType& J, ScalarNonSquaredErrorTerm* e, bool useMEstimator);
   void addGradientForErrorTerm(JacobianContainerDense<RowVectorType&, 1>& jc, ScalarNonSquaredErrorTerm* e, bool useMEstimator);
 
   const std::vector<ErrorTerm*>& getErrorTerms() const {
     return _errorTermsS;
   }
+
+  /// \brief The scheduling options for the multi-threaded computations
+  const util::ThreadedJobOptions& getThreadedJobOptions() const { return _threadedJobOptions; }
+  void setThreadedJobOptions(const util::ThreadedJobOptions& options) { _threadedJobOptions = options; }
  protected:
   /// \brief Set the initialized status
   void setInitialized(bool isInitialized) { _isInitialized = isInitialized; }
 
  private:
+  struct Replica;
+  struct ReplicaPool;
+
   /// \brief Evaluate the gradient of the objective function
   void evaluateGradients(size_t threadId, size_t startIdx, size_t endIdx, RowVectorType& grad, bool useMEstimator, bool useDenseJacobianContainer);
 
-  /// \brief Evaluate the objective function
-  void sumErrorTerms(size_t /* threadId */, size_t startIdx, size_t endIdx, double& err) const;
+  /// \brief Throw if \p replica cannot stand in for this problem, see addReplica()
+  void checkReplica(const ProblemManager& replica) const;
+
+  /// \brief Sum the gradients of the threads into the entries (startIdx .. endIdx - 1) of \p outGrad
+  void sumThreadGradients(size_t /* threadId */, size_t startIdx, size_t endIdx, RowVectorType& outGrad) const;
+
+  /// \brief Evaluate the objective function for each error term
+  void evaluateErrorTerms(size_t /* threadId */, size_t startIdx, size_t endIdx, std::vector<double>& errors) const;
 
  private:
 
@@ -155,6 +208,29 @@ class ProblemManager {
   /// \brief Whether the optimizer is correctly initialized
   bool _isInitialized = false;
 
+  /// \brief The scheduling options for the multi-threaded computations
+  util::ThreadedJobOptions _threadedJobOptions;
+
+  /// \brief The gradients computed by the threads, reused between calls to computeGradient()
+  std::vector<RowVectorType> _threadGradients;
+
+  /// \brief The timer of computeGradient(), constructed once so computing the gradient does not allocate
+  Timer _computeGradientTimer{"ProblemManager: Compute gradient", true};
+
+  /// \brief The weighted errors of the squared error terms, reused by the threads
+  util::PerThreadErrorVectors _errorVectors;
+
+  /// \brief The Jacobian containers reused by the threads for squared and non-squared error terms
+  util::PerThreadJacobianContainers<> _jacobianContainersS;
+  util::PerThreadJacobianContainers<1> _jacobianContainersNS;
+
+  /// \brief Serializes the evaluations, updates and parameter changes of the design variables. Copies share it, as they
+  ///        share the design variables.
+  boost::shared_ptr<boost::recursive_mutex> _evaluationMutex = boost::shared_ptr<boost::recursive_mutex>(new boost::recursive_mutex());
+
+  /// \brief The replicas for the evaluations at explicit parameters, shared by copies as well
+  boost::shared_ptr<ReplicaPool> _replicaPool;
+
 };
 
 namespace details
@@ -199,6 +275,11 @@ inline boost::shared_ptr<CostFunctionInterface> getCostFunction(ProblemManager&
     double evaluateError() const override { return _pm.evaluateError(_numThreadsError); }
     void computeGradient(RowVectorType& gradient) override { _pm.computeGradient(gradient, _numThreadsJacobian, _useMEstimator, _applyDvScaling, _useDenseJacobianContainer); }
     const std::vector<DesignVariable*>& getDesignVariables() override { return _pm.designVariables(); };
+    // The evaluations at a step only run concurrently on replicas of the problem
+    bool supportsConcurrentEvaluation() const override { return _pm.numReplicas() > 0; }
+    double evaluateAtStep(const RowVectorType& dx, RowVectorType* gradient) override {
+      return _pm.evaluateAtStep(dx, gradient, _numThreadsError, _numThreadsJacobian, _useMEstimator, _applyDvScaling, _useDenseJacobianContainer);
+    }
    private:
     ProblemManager& _pm;
     typename details::CostFunctionParameterTraits<UseMEstimatorRef>::const_bool_t _useMEstimator;
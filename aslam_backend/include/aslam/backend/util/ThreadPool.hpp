@@ -0,0 +1,133 @@
+#ifndef INCLUDE_ASLAM_BACKEND_UTIL_THREADPOOL_HPP_
+#define INCLUDE_ASLAM_BACKEND_UTIL_THREADPOOL_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace aslam {
+namespace backend {
+namespace util {
+
+/**
+ * \class ThreadPool
+ * A persistent pool of worker threads processing index ranges with chunked dynamic scheduling.
+ *
+ * The range is split into chunks, either of fixed size or at given boundaries. The chunks are
+ * initially distributed in contiguous shares over the participants. Every participant claims
+ * chunks from the front of its own share and steals chunks from the other shares once its own is
+ * exhausted. The calling thread always takes part as participant 0, so a pool with n workers runs
+ * jobs with up to n + 1 participants. Workers are spawned lazily on first use and live until the pool
+ * is destroyed.
+ *
+ * Parallel loops issued from inside a running job are executed serially by the calling thread.
+ * Concurrent calls from different threads are serialized.
+ */
+class ThreadPool {
+ public:
+  /// \brief A job working on the subrange (start .. end - 1), called as job(participant, start, end).
+  ///        Calls with the same participant index never run concurrently.
+  typedef boost::function<void(std::size_t, std::size_t, std::size_t)> RangeJob;
+
+  /// \brief The number of chunks per participant if the chunk size is chosen automatically
+  static constexpr std::size_t kChunksPerParticipant = 8;
+
+  /// \brief Constructor, spawns \p numWorkers worker threads
+  explicit ThreadPool(std::size_t numWorkers = 0);
+
+  /// \brief Destructor, joins all workers
+  ~ThreadPool();
+
+  /// \brief The process-wide pool shared by all optimizers.
+  ///        The pool runs one job at a time: optimizers running concurrently in different threads wait for each
+  ///        other on every parallel loop, so their jobs do not overlap. Such optimizers should disable
+  ///        ThreadedJobOptions::useThreadPool to spawn their own threads instead.
+  static ThreadPool& instance();
+
+  /// \brief The number of worker threads currently alive
+  std::size_t numWorkers() const;
+
+  /// \brief Make sure that at least \p numWorkers worker threads are alive
+  void reserve(std::size_t numWorkers);
+
+  /**
+   * Runs \p job over the range (0 .. rangeLength - 1) with at most \p numParticipants participants.
+   * Blocks until the whole range has been processed and rethrows the first exception thrown by a job.
+   *
+   * @param job The job to process the range with
+   * @param rangeLength The length of the range
+   * @param numParticipants The maximum number of threads (including the calling one) to use
+   * @param chunkSize The number of indices claimed at once. 0 chooses a chunk size automatically.
+   */
+  void parallelFor(const RangeJob& job, std::size_t rangeLength, std::size_t numParticipants, std::size_t chunkSize = 0);
+
+  /**
+   * Runs \p job over the range (0 .. chunkBoundaries.back() - 1) split into the chunks
+   * (chunkBoundaries[i] .. chunkBoundaries[i + 1] - 1). Use this to balance chunks by cost instead of size.
+   *
+   * @param job The job to process the range with
+   * @param chunkBoundaries Non-decreasing chunk boundaries starting with 0
+   * @param numParticipants The maximum number of threads (including the calling one) to use
+   */
+  void parallelFor(const RangeJob& job, const std::vector<std::size_t>& chunkBoundaries, std::size_t numParticipants);
+
+  /// \brief Whether the current thread is executing a job of any pool
+  static bool isInsideJob();
+
+ private:
+  struct Share;
+  struct Task;
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /// \brief Run \p task with the workers and the calling thread
+  void run(Task& task);
+
+  /// \brief Main loop of worker \p workerIndex, waiting for tasks newer than \p seenGeneration
+  void workerLoop(std::size_t workerIndex, std::size_t seenGeneration);
+
+  /// \brief Process chunks of \p task as participant \p participant
+  void participate(Task& task, std::size_t participant);
+
+  /// \brief Spawn workers until there are \p numWorkers of them. Requires _mutex to be locked and no task to be running.
+  void spawnWorkers(std::size_t numWorkers);
+
+  /// \brief Serializes calls to parallelFor()
+  boost::mutex _submitMutex;
+
+  /// \brief The shares of the participants of the current task, guarded by _submitMutex
+  std::unique_ptr<Share[]> _shares;
+  std::size_t _numShares = 0;
+
+  /// \brief Protects the state shared with the workers
+  mutable boost::mutex _mutex;
+  boost::condition_variable _wakeCondition;
+  boost::condition_variable _doneCondition;
+
+  /// \brief The worker threads
+  std::vector<boost::thread*> _workers;
+
+  /// \brief The task currently processed, NULL if idle
+  Task* _task = nullptr;
+
+  /// \brief Incremented for each new task to wake up the workers
+  std::size_t _generation = 0;
+
+  /// \brief The number of workers still working on the current task
+  std::size_t _numBusyWorkers = 0;
+
+  /// \brief Signals the workers to exit
+  bool _shutdown = false;
+};
+
+} // namespace util
+} // namespace backend
+} // namespace aslam
+
+#endif /* INCLUDE_ASLAM_BACKEND_UTIL_THREADPOOL_HPP_ */
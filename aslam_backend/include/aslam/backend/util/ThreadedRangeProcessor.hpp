@@ -1,31 +1,53 @@
 #ifndef INCLUDE_ASLAM_BACKEND_THREADEDVECTORPROCESSOR_HPP_
 #define INCLUDE_ASLAM_BACKEND_THREADEDVECTORPROCESSOR_HPP_
 
+#include <cstddef>
 #include <vector>
 
 #include <boost/function.hpp>
 #include <boost/bind.hpp>
 
+#include "LoadBalancer.hpp"
+
 namespace aslam {
 namespace backend {
 namespace util {
 
 /**
- * The job will be run nThreads times in parallel. The index range (0 .. rangeLength - 1) will be partitioned into nThreads many subranges the job instances should work on.
+ * \struct ThreadedJobOptions
+ * Controls how a threaded job is scheduled
+ */
+struct ThreadedJobOptions {
+  bool useThreadPool = true; /// \brief Run on the shared persistent thread pool with dynamic scheduling instead of spawning threads on every call
+  std::size_t chunkSize = 0; /// \brief The number of indices a pool thread claims at once. 0 chooses a chunk size automatically.
+  bool balanceLoad = true; /// \brief Cut the range into chunks of equal estimated cost instead of equal size where cost estimates are available
+};
+
+/**
+ * The index range (0 .. rangeLength - 1) will be processed by up to nThreads threads in parallel.
+ * With the thread pool enabled, the range is split into chunks which are claimed dynamically by the threads, so a thread may
+ * call the job several times. Otherwise nThreads threads are spawned and each is given one subrange of equal length.
  * It throws the exception thrown in the first job throwing an exception unless non is thrown.
  *
  * @param job
- *  The job will be run nThreads times in parallel.
- *  The first argument will be the job index {0 .. nThreads - 1}).
+ *  The first argument will be the thread index {0 .. nThreads - 1}). Calls with the same thread index never run concurrently.
  *  The second (=:a) and third (=:b) argument specify which subrange of (0..rangeLength-1) the job should work on as (a..b-1).
  * @param rangeLength specifies the length of the range (0 .. rangeLength - 1), which will be processed by the job function after dividing it in subranges.
- * @param number of threads to create
+ * @param nThreads maximum number of threads to use
+ * @param options scheduling options
  */
 
-void runThreadedJob(boost::function<void(size_t, size_t, size_t)> job, size_t rangeLength, size_t nThreads);
+void runThreadedJob(boost::function<void(size_t, size_t, size_t)> job, size_t rangeLength, size_t nThreads, const ThreadedJobOptions& options = ThreadedJobOptions());
+
+/**
+ * Like runThreadedJob above, for the range (0 .. loadBalancer.size() - 1). The processing time of every chunk is measured and
+ * used to refine the cost estimates of \p loadBalancer. If options.balanceLoad is set, the range is split into chunks of equal
+ * estimated cost. The per-thread busy times are available from loadBalancer.getStatistics() afterwards.
+ */
+void runThreadedJob(boost::function<void(size_t, size_t, size_t)> job, LoadBalancer& loadBalancer, size_t nThreads, const ThreadedJobOptions& options = ThreadedJobOptions());
 
 /**
- * The job will be run nThreads times in parallel. The index range (0 .. rangeLength - 1) will be partitioned into nThreads many subranges the job instances should work on.
+ * The index range (0 .. rangeLength - 1) will be processed by up to out.size() threads in parallel, see runThreadedJob.
  * The i-th job thread will be given a output reference taken from out[i].
  * It throws the exception thrown in the first job throwing an exception unless non is thrown.
  *
@@ -37,11 +59,12 @@ void runThreadedJob(boost::function<void(size_t, size_t, size_t)> job, size_t ra
  * custom length of a range, NOT related to \p out. This range
  * is related to external containers the \p function works upon.
  * @param out the vector of output variables.
+ * @param options scheduling options
  */
 
 template <typename Output>
-void runThreadedFunction(boost::function<void(size_t, size_t, size_t, Output&)> function, size_t rangeLength, std::vector<Output>& out){
-  runThreadedJob(boost::bind(function, _1, _2, _3, boost::bind(static_cast<Output & (std::vector<Output>::*)(size_t) >(&std::vector<Output>::at), &out, _1)), rangeLength, out.size());
+void runThreadedFunction(boost::function<void(size_t, size_t, size_t, Output&)> function, size_t rangeLength, std::vector<Output>& out, const ThreadedJobOptions& options = ThreadedJobOptions()){
+  runThreadedJob(boost::bind(function, _1, _2, _3, boost::bind(static_cast<Output & (std::vector<Output>::*)(size_t) >(&std::vector<Output>::at), &out, _1)), rangeLength, out.size(), options);
 }
 
 }
@@ -116,6 +116,24 @@ Eigen::VectorXd getFlattenedDesignVariableParameters(const Container& designVari
   return p;
 }
 
+/// \brief Set a list of design variables from a vector as returned by getFlattenedDesignVariableParameters()
+template <typename Container>
+void setFlattenedDesignVariableParameters(const Container& designVariables, const Eigen::VectorXd& v)
+{
+  int cnt = 0;
+  Eigen::MatrixXd p;
+
+  for (auto& dv : designVariables) {
+    dv->getParameters(p);
+    const int d = p.size();
+    SM_ASSERT_LE(aslam::Exception, cnt + d, v.size(), "The vector is too short for the design variables");
+    p = Eigen::Map<const Eigen::MatrixXd>(v.data() + cnt, p.rows(), p.cols());
+    dv->setParameters(p);
+    cnt += d;
+  }
+  SM_ASSERT_EQ(aslam::Exception, cnt, v.size(), "The vector is too long for the design variables");
+}
+
 template <typename Container, typename Vector>
 void applyStateUpdate(const Container& designVariables, const Vector& dx)
 {
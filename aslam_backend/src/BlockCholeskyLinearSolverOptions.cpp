@@ -25,16 +25,20 @@ namespace aslam {
 /* Constructors and Destructor                                                */
 /******************************************************************************/
 
-      BlockCholeskyLinearSolverOptions::BlockCholeskyLinearSolverOptions() {}
-      
+    BlockCholeskyLinearSolverOptions::BlockCholeskyLinearSolverOptions() :
+        parallelAssembly(true) {
+    }
+
     BlockCholeskyLinearSolverOptions::BlockCholeskyLinearSolverOptions(
-        const BlockCholeskyLinearSolverOptions& /* other */) {
+        const BlockCholeskyLinearSolverOptions& other) :
+        parallelAssembly(other.parallelAssembly) {
     }
 
     BlockCholeskyLinearSolverOptions&
     BlockCholeskyLinearSolverOptions::operator =
         (const BlockCholeskyLinearSolverOptions& other) {
       if (this != &other) {
+        parallelAssembly = other.parallelAssembly;
       }
       return *this;
     }
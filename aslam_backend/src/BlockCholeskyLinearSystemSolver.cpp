@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <numeric>
 
 #include <aslam/backend/BlockCholeskyLinearSystemSolver.hpp>
@@ -5,6 +6,8 @@
 #include <sparse_block_matrix/linear_solver_spqr.h>
 #include <aslam/backend/ErrorTerm.hpp>
 #include <sm/PropertyTree.hpp>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
 
 namespace aslam {
   namespace backend {
@@ -16,7 +19,7 @@ namespace aslam {
 
     BlockCholeskyLinearSystemSolver::BlockCholeskyLinearSystemSolver(const sm::PropertyTree& config) {
       _solverType = config.getString("solverType", "cholesky");
-      // NO OPTIONS CURRENTLY IMPLEMENTED
+      _options.parallelAssembly = config.getBool("parallelAssembly", _options.parallelAssembly);
       // USING C++11 would allow to do constructor delegation and more elegant code
       if(_solverType == "cholesky") {
         _solver.reset(new sparse_block_matrix::LinearSolverCholmod<Eigen::MatrixXd>());
@@ -54,15 +57,50 @@ namespace aslam {
       std::partial_sum(blocks.begin(), blocks.end(), blocks.begin());
       // Now we can initialized the sparse Hessian matrix.
       _H._M = SparseBlockMatrix(blocks, blocks);
+      initParallelAssembly();
     }
 
+    void BlockCholeskyLinearSystemSolver::initParallelAssembly()
+    {
+      _contributions.clear();
+      _contributions.resize(_errorTerms.size());
+      _columnContributions.clear();
+      _columnContributions.resize(_H._M.bCols());
+      std::vector<double> columnCosts(_H._M.bCols(), 0.0);
+      for (size_t i = 0; i < _errorTerms.size(); ++i) {
+        ErrorTermContribution& contribution = _contributions[i];
+        for (size_t k = 0; k < _errorTerms[i]->numDesignVariables(); ++k) {
+          const DesignVariable* dv = _errorTerms[i]->designVariable(k);
+          if (dv->isActive() && dv->blockIndex() >= 0)
+            contribution.blocks.push_back(dv->blockIndex());
+        }
+        std::sort(contribution.blocks.begin(), contribution.blocks.end());
+        contribution.blocks.erase(std::unique(contribution.blocks.begin(), contribution.blocks.end()), contribution.blocks.end());
+        const size_t nBlocks = contribution.blocks.size();
+        contribution.hessianBlocks.resize(nBlocks * (nBlocks + 1) / 2);
+        contribution.rhsSegments.resize(nBlocks);
+        for (size_t j = 0; j < nBlocks; ++j) {
+          _columnContributions[contribution.blocks[j]].push_back(std::make_pair(i, j));
+          columnCosts[contribution.blocks[j]] += j + 2; // j + 1 Hessian blocks and one right-hand-side segment
+        }
+      }
+      _contributionLoadBalancer.init(getEvaluationCostHints(_errorTerms));
+      _accumulationLoadBalancer.init(columnCosts);
+      // The per thread matrices have to match the new block structure
+      _threadHessians.clear();
+      _threadRhs.clear();
+    }
 
-  void BlockCholeskyLinearSystemSolver::buildSystem(size_t /* nThreads */, bool useMEstimator)
+    void BlockCholeskyLinearSystemSolver::buildSystem(size_t nThreads, bool useMEstimator)
+    {
+      if (_options.parallelAssembly)
+        buildSystemParallel(std::max<size_t>(1, nThreads), useMEstimator);
+      else
+        buildSystemSerial(useMEstimator);
+    }
+
+    void BlockCholeskyLinearSystemSolver::buildSystemSerial(bool useMEstimator)
     {
-      // \todo make multithreaded. This is complicated as it requires synchronized access to the block matrix.
-      //       A little bit of effort should make this possible by initializing the structure and adding
-      //       a mutex for each block and having writers for each jacobian that have a list of mutexes.
-      //       Save it for later.
       _H._M.clear(false);
       _rhs.setZero();
       std::vector<ErrorTerm*>::iterator it, it_end;
@@ -73,10 +111,73 @@ namespace aslam {
       }
     }
 
+    void BlockCholeskyLinearSystemSolver::buildSystemParallel(size_t nThreads, bool useMEstimator)
+    {
+      while (_threadHessians.size() < nThreads) {
+        _threadHessians.push_back(boost::make_shared<SparseBlockMatrix>(_H._M.rowBlockIndices(), _H._M.colBlockIndices()));
+        _threadRhs.push_back(Eigen::VectorXd::Zero(_H._M.rows()));
+      }
+      try {
+        setupThreadedJob(boost::bind(&BlockCholeskyLinearSystemSolver::evaluateContributions, this, _1, _2, _3, _4), nThreads, useMEstimator, &_contributionLoadBalancer);
+      } catch (...) {
+        // The per thread matrices may hold partial contributions now
+        _threadHessians.clear();
+        _threadRhs.clear();
+        throw;
+      }
+      _H._M.clear(false);
+      _rhs.setZero();
+      util::runThreadedJob(boost::bind(&BlockCholeskyLinearSystemSolver::accumulateContributions, this, _1, _2, _3), _accumulationLoadBalancer, nThreads, _threadedJobOptions);
+    }
+
+    void BlockCholeskyLinearSystemSolver::evaluateContributions(size_t threadId, size_t startIdx, size_t endIdx, bool useMEstimator)
+    {
+      SparseBlockMatrix& H = *_threadHessians[threadId];
+      Eigen::VectorXd& rhs = _threadRhs[threadId];
+      for (size_t i = startIdx; i < endIdx; ++i) {
+        _errorTerms[i]->buildHessian(H, rhs, useMEstimator);
+        // Move the contribution out of the thread's matrices, leaving them zero for the next error term.
+        ErrorTermContribution& contribution = _contributions[i];
+        for (size_t j = 0; j < contribution.blocks.size(); ++j) {
+          const int col = contribution.blocks[j];
+          Eigen::VectorXd::SegmentReturnType segment = rhs.segment(H.colBaseOfBlock(col), H.colsOfBlock(col));
+          contribution.rhsSegments[j] = segment;
+          segment.setZero();
+          for (size_t k = 0; k <= j; ++k) {
+            Eigen::MatrixXd* block = H.block(contribution.blocks[k], col);
+            Eigen::MatrixXd& hessianBlock = contribution.hessianBlocks[j * (j + 1) / 2 + k];
+            if (block != NULL) {
+              hessianBlock = *block;
+              block->setZero();
+            } else {
+              hessianBlock.resize(0, 0);
+            }
+          }
+        }
+      }
+    }
+
+    void BlockCholeskyLinearSystemSolver::accumulateContributions(size_t /* threadId */, size_t startIdx, size_t endIdx)
+    {
+      for (size_t col = startIdx; col < endIdx; ++col) {
+        Eigen::VectorXd::SegmentReturnType rhsSegment = _rhs.segment(_H._M.colBaseOfBlock(col), _H._M.colsOfBlock(col));
+        for (const std::pair<size_t, size_t>& entry : _columnContributions[col]) {
+          const ErrorTermContribution& contribution = _contributions[entry.first];
+          const size_t j = entry.second;
+          rhsSegment += contribution.rhsSegments[j];
+          for (size_t k = 0; k <= j; ++k) {
+            const Eigen::MatrixXd& hessianBlock = contribution.hessianBlocks[j * (j + 1) / 2 + k];
+            if (hessianBlock.size() > 0)
+              *_H._M.block(contribution.blocks[k], col, true) += hessianBlock;
+          }
+        }
+      }
+    }
+
     bool BlockCholeskyLinearSystemSolver::solveSystem(Eigen::VectorXd& outDx)
     {
+      const Eigen::VectorXd d = _useDiagonalConditioner ? Eigen::VectorXd(_diagonalConditioner.cwiseProduct(_diagonalConditioner)) : Eigen::VectorXd();
       if (_useDiagonalConditioner) {
-        Eigen::VectorXd d = _diagonalConditioner.cwiseProduct(_diagonalConditioner);
         // Augment the diagonal
         int rowBase = 0;
         for (int i = 0; i < _H._M.bRows(); ++i) {
@@ -94,7 +195,7 @@ namespace aslam {
         int rowBase = 0;
         for (int i = 0; i < _H._M.bRows(); ++i) {
           Eigen::MatrixXd& block = *_H._M.block(i, i, true);
-          block.diagonal() -= _diagonalConditioner.segment(rowBase, block.rows());
+          block.diagonal() -= d.segment(rowBase, block.rows());
           rowBase += block.rows();
         }
       }
@@ -125,8 +226,8 @@ namespace aslam {
     {
       // Not sure why I have to do this.
       //_solver->init();
+      const Eigen::VectorXd d = _useDiagonalConditioner ? Eigen::VectorXd(_diagonalConditioner.cwiseProduct(_diagonalConditioner)) : Eigen::VectorXd();
       if (_useDiagonalConditioner) {
-        Eigen::VectorXd d = _diagonalConditioner.cwiseProduct(_diagonalConditioner);
         // Augment the diagonal
         int rowBase = 0;
         for (int i = 0; i < _H._M.bRows(); ++i) {
@@ -143,7 +244,7 @@ namespace aslam {
         int rowBase = 0;
         for (int i = 0; i < _H._M.bRows(); ++i) {
           Eigen::MatrixXd& block = *_H._M.block(i, i, true);
-          block.diagonal() -= _diagonalConditioner.segment(rowBase, block.rows());
+          block.diagonal() -= d.segment(rowBase, block.rows());
           rowBase += block.rows();
         }
       }
@@ -0,0 +1,231 @@
+#include <aslam/backend/CompressedColumnHessianBuilder.hpp>
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include <aslam/backend/ErrorTerm.hpp>
+#include <aslam/Exceptions.hpp>
+
+namespace aslam {
+  namespace backend {
+
+    CompressedColumnHessianBuilder::CompressedColumnHessianBuilder() : _rhs(NULL)
+    {
+    }
+
+    CompressedColumnHessianBuilder::~CompressedColumnHessianBuilder()
+    {
+    }
+
+    bool CompressedColumnHessianBuilder::initMatrixStructure(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors)
+    {
+      _errorTerms = errors;
+      _jacobianContainers.reserve(errors);
+      _errorVectors.reserve(errors);
+
+      std::vector<int> blockDimension(dvs.size());
+      std::vector<int> blockColumnBase(dvs.size());
+      int columnBase = 0;
+      for (size_t i = 0; i < dvs.size(); ++i) {
+        SM_ASSERT_EQ_DBG(Exception, dvs[i]->blockIndex(), (int)i, "The design variables must be sorted by block index");
+        blockDimension[i] = dvs[i]->minimalDimensions();
+        blockColumnBase[i] = columnBase;
+        columnBase += blockDimension[i];
+      }
+
+      // The blocks coupled to each block column from above, and the diagonal block
+      std::vector< std::vector<int> > coupledBlocks(dvs.size());
+      for (size_t j = 0; j < dvs.size(); ++j)
+        coupledBlocks[j].push_back(j);
+      std::vector<int> blocks;
+      for (const ErrorTerm* e : errors) {
+        blocks.clear();
+        for (size_t k = 0; k < e->numDesignVariables(); ++k) {
+          const DesignVariable* dv = e->designVariable(k);
+          if (dv->isActive() && dv->blockIndex() >= 0)
+            blocks.push_back(dv->blockIndex());
+        }
+        std::sort(blocks.begin(), blocks.end());
+        blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+        for (size_t b = 1; b < blocks.size(); ++b) {
+          for (size_t a = 0; a < b; ++a)
+            coupledBlocks[blocks[b]].push_back(blocks[a]);
+        }
+      }
+      std::vector<int> blockColPtr(1, 0);
+      std::vector<int> blockRowInd;
+      for (std::vector<int>& column : coupledBlocks) {
+        std::sort(column.begin(), column.end());
+        column.erase(std::unique(column.begin(), column.end()), column.end());
+        blockRowInd.insert(blockRowInd.end(), column.begin(), column.end());
+        blockColPtr.push_back(blockRowInd.size());
+        std::vector<int>().swap(column);
+      }
+
+      const bool samePattern = blockDimension == _blockDimension && blockColPtr == _blockColPtr && blockRowInd == _blockRowInd;
+      _blockDimension.swap(blockDimension);
+      _blockColumnBase.swap(blockColumnBase);
+      _blockColPtr.swap(blockColPtr);
+      _blockRowInd.swap(blockRowInd);
+      if (samePattern)
+        return true;
+
+      // Expand the block pattern to the scalar columns. The diagonal block comes last, so only its upper triangle is stored.
+      _blockRowOffset.resize(_blockRowInd.size());
+      _colPtr.assign(1, 0);
+      _rowInd.clear();
+      for (size_t j = 0; j + 1 < _blockColPtr.size(); ++j) {
+        int offset = 0;
+        for (int p = _blockColPtr[j]; p < _blockColPtr[j + 1]; ++p) {
+          _blockRowOffset[p] = offset;
+          offset += _blockDimension[_blockRowInd[p]];
+        }
+        for (int c = 0; c < _blockDimension[j]; ++c) {
+          for (int p = _blockColPtr[j]; p < _blockColPtr[j + 1]; ++p) {
+            const int i = _blockRowInd[p];
+            const int rows = i == (int)j ? c + 1 : _blockDimension[i];
+            for (int r = 0; r < rows; ++r)
+              _rowInd.push_back(_blockColumnBase[i] + r);
+          }
+          _colPtr.push_back(_rowInd.size());
+        }
+      }
+      _values.assign(_rowInd.size(), 0.0);
+      _chunkValues.clear();
+      _chunkRhs.clear();
+      return false;
+    }
+
+    void CompressedColumnHessianBuilder::buildSystem(size_t nThreads, bool useMEstimator, Eigen::VectorXd& outRhs, const util::ThreadedJobOptions& options)
+    {
+      nThreads = std::max<size_t>(1, nThreads);
+      const size_t numChunks = std::max<size_t>(1, std::min(nThreads, _errorTerms.size()));
+      _chunkBoundaries.resize(numChunks + 1);
+      for (size_t k = 0; k <= numChunks; ++k)
+        _chunkBoundaries[k] = k * _errorTerms.size() / numChunks;
+      _chunkValues.resize(numChunks - 1);
+      _chunkRhs.resize(numChunks - 1);
+      for (size_t k = 0; k + 1 < numChunks; ++k) {
+        _chunkValues[k].assign(_values.size(), 0.0);
+        _chunkRhs[k] = Eigen::VectorXd::Zero(cols());
+      }
+      std::fill(_values.begin(), _values.end(), 0.0);
+      outRhs = Eigen::VectorXd::Zero(cols());
+      _rhs = &outRhs;
+      _jacobianContainers.resize(nThreads);
+      _errorVectors.resize(nThreads);
+      _threadBlocks.resize(nThreads);
+
+      util::runThreadedJob(boost::bind(&CompressedColumnHessianBuilder::buildChunks, this, _1, _2, _3, useMEstimator), numChunks, nThreads, options);
+      if (numChunks > 1) {
+        util::runThreadedJob(boost::bind(&CompressedColumnHessianBuilder::sumChunks, this, _1, _2, _3), _values.size(), nThreads, options);
+        for (const Eigen::VectorXd& rhs : _chunkRhs)
+          outRhs += rhs;
+      }
+      _rhs = NULL;
+    }
+
+    void CompressedColumnHessianBuilder::buildChunks(size_t threadId, size_t startIdx, size_t endIdx, bool useMEstimator)
+    {
+      Eigen::MatrixXd& block = _threadBlocks[threadId];
+      for (size_t k = startIdx; k < endIdx; ++k) {
+        double* values = k == 0 ? &_values[0] : &_chunkValues[k - 1][0];
+        Eigen::VectorXd& rhs = k == 0 ? *_rhs : _chunkRhs[k - 1];
+        for (size_t i = _chunkBoundaries[k]; i < _chunkBoundaries[k + 1]; ++i) {
+          ErrorTerm* errorTerm = _errorTerms[i];
+          JacobianContainerSparse<Eigen::Dynamic>& jc = _jacobianContainers.get(threadId, errorTerm->dimension());
+          Eigen::VectorXd& e = _errorVectors.get(threadId, errorTerm->dimension());
+          errorTerm->getWeightedJacobians(jc, useMEstimator);
+          errorTerm->getWeightedError(e, useMEstimator);
+          for (auto a = jc.begin(); a != jc.end(); ++a) {
+            const int blockRow = a->first->blockIndex();
+            rhs.segment(_blockColumnBase[blockRow], _blockDimension[blockRow]).noalias() -= a->second.transpose() * e;
+            for (auto b = jc.begin(); b != jc.end(); ++b) {
+              const int blockCol = b->first->blockIndex();
+              if (blockCol < blockRow)
+                continue;
+              block.noalias() = a->second.transpose() * b->second;
+              const int offset = blockOffset(blockRow, blockCol);
+              const int* colPtr = &_colPtr[_blockColumnBase[blockCol]];
+              for (int c = 0; c < block.cols(); ++c) {
+                double* column = values + colPtr[c] + offset;
+                const int rows = blockRow == blockCol ? c + 1 : block.rows();
+                for (int r = 0; r < rows; ++r)
+                  column[r] += block(r, c);
+              }
+            }
+          }
+        }
+      }
+    }
+
+    void CompressedColumnHessianBuilder::sumChunks(size_t /* threadId */, size_t startIdx, size_t endIdx)
+    {
+      for (const std::vector<double>& chunk : _chunkValues) {
+        for (size_t i = startIdx; i < endIdx; ++i)
+          _values[i] += chunk[i];
+      }
+    }
+
+    int CompressedColumnHessianBuilder::blockOffset(int blockRow, int blockCol) const
+    {
+      const std::vector<int>::const_iterator begin = _blockRowInd.begin() + _blockColPtr[blockCol];
+      const std::vector<int>::const_iterator end = _blockRowInd.begin() + _blockColPtr[blockCol + 1];
+      const std::vector<int>::const_iterator it = std::lower_bound(begin, end, blockRow);
+      SM_ASSERT_TRUE_DBG(Exception, it != end && *it == blockRow, "Block (" << blockRow << ", " << blockCol << ") is not in the pattern of the Hessian");
+      return _blockRowOffset[it - _blockRowInd.begin()];
+    }
+
+    void CompressedColumnHessianBuilder::multiply(const Eigen::VectorXd& x, Eigen::VectorXd& outY) const
+    {
+      SM_ASSERT_EQ(Exception, (size_t)x.size(), cols(), "Incompatible vector size");
+      outY = Eigen::VectorXd::Zero(cols());
+      for (size_t c = 0; c < cols(); ++c) {
+        for (int k = _colPtr[c]; k < _colPtr[c + 1]; ++k) {
+          const int r = _rowInd[k];
+          outY[r] += _values[k] * x[c];
+          if (r != (int)c)
+            outY[c] += _values[k] * x[r];
+        }
+      }
+    }
+
+    void CompressedColumnHessianBuilder::getView(cholmod_sparse* outView, double* values) const
+    {
+      outView->nrow = cols();
+      outView->ncol = cols();
+      outView->nzmax = nnz();
+      outView->p = (void*)&_colPtr[0];
+      outView->i = (void*)(_rowInd.empty() ? NULL : &_rowInd[0]);
+      outView->nz = NULL;
+      outView->x = (void*)values;
+      outView->z = NULL;
+      // Only the upper triangle is stored
+      outView->stype = 1;
+      outView->itype = CHOLMOD_INT;
+      outView->xtype = CHOLMOD_REAL;
+      outView->dtype = CHOLMOD_DOUBLE;
+      outView->sorted = 1;
+      outView->packed = 1;
+    }
+
+    void CompressedColumnHessianBuilder::getBlockStructure(std::vector<int>& outColPtr, std::vector<int>& outRowInd) const
+    {
+      outColPtr = _blockColPtr;
+      outRowInd = _blockRowInd;
+    }
+
+    size_t CompressedColumnHessianBuilder::getMemoryUsage() const
+    {
+      size_t bytes = (_colPtr.capacity() + _rowInd.capacity() + _blockColPtr.capacity() + _blockRowInd.capacity() + _blockRowOffset.capacity()) * sizeof(int)
+          + _values.capacity() * sizeof(double);
+      for (const std::vector<double>& chunk : _chunkValues)
+        bytes += chunk.capacity() * sizeof(double);
+      for (const Eigen::VectorXd& rhs : _chunkRhs)
+        bytes += rhs.size() * sizeof(double);
+      return bytes;
+    }
+
+  } // namespace backend
+} // namespace aslam
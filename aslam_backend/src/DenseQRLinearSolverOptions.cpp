@@ -25,16 +25,22 @@ namespace aslam {
 /* Constructors and Destructor                                                */
 /******************************************************************************/
 
-      DenseQRLinearSolverOptions::DenseQRLinearSolverOptions() {}
-        
-      
+    DenseQRLinearSolverOptions::DenseQRLinearSolverOptions() :
+        decomposition(COL_PIV_HOUSEHOLDER_QR),
+        normalEquationsMinRcond(1e-10) {
+    }
+
     DenseQRLinearSolverOptions::DenseQRLinearSolverOptions(
-        const DenseQRLinearSolverOptions& /* other */) {
+        const DenseQRLinearSolverOptions& other) :
+        decomposition(other.decomposition),
+        normalEquationsMinRcond(other.normalEquationsMinRcond) {
     }
 
     DenseQRLinearSolverOptions& DenseQRLinearSolverOptions::operator =
         (const DenseQRLinearSolverOptions& other) {
       if (this != &other) {
+        decomposition = other.decomposition;
+        normalEquationsMinRcond = other.normalEquationsMinRcond;
       }
       return *this;
     }
@@ -2,6 +2,8 @@
 #include <aslam/backend/ErrorTerm.hpp>
 #include <Eigen/Dense> // householderQr.solve
 #include <sm/PropertyTree.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
 
 namespace aslam {
   namespace backend {
@@ -24,50 +26,158 @@ namespace aslam {
       return &_J;
     }
 
-  void DenseQrLinearSystemSolver::initMatrixStructureImplementation(const std::vector<DesignVariable*>& /* dvs */, const std::vector<ErrorTerm*>& /* errors */, bool /* useDiagonalConditioner */)
+  void DenseQrLinearSystemSolver::initMatrixStructureImplementation(const std::vector<DesignVariable*>& /* dvs */, const std::vector<ErrorTerm*>& /* errors */, bool useDiagonalConditioner)
     {
-      // \todo Verify that this is similar to the "reserve()" feature in a standard vector.
-      _J._M.resize(_JRows, _JCols);
+      _useDiagonalConditioner = useDiagonalConditioner;
+      // Only the blocks of the error terms are overwritten by buildSystem(), the rest stays zero
+      _J._M.setZero(_JRows, _JCols);
+      // The conditioner rows are appended to a preallocated copy of the Jacobian instead of resizing it for every solve
+      _systemE = Eigen::VectorXd::Zero(_JRows + _JCols);
+      if (_useDiagonalConditioner && !useNormalEquations())
+        _workspace.augmentedJ.resize(_JRows + _JCols, _JCols);
+      _hessianValid = false;
     }
 
     void DenseQrLinearSystemSolver::buildSystem(size_t nThreads, bool useMEstimator)
     {
-      _J._M.setZero();
-      setupThreadedJob(boost::bind(&DenseQrLinearSystemSolver::evaluateJacobians, this, _1, _2, _3, _4), nThreads, useMEstimator);
-      _rhs = _J._M.transpose() * _e;
+      _nThreads = std::max<size_t>(1, nThreads);
+      while (_jacobianContainers.size() < _nThreads)
+        _jacobianContainers.emplace_back(new JacobianContainerRows(_J._M));
+      setupThreadedJob(boost::bind(&DenseQrLinearSystemSolver::evaluateJacobians, this, _1, _2, _3, _4), _nThreads, useMEstimator);
+      _systemE.head(_JRows) = _e;
+      _rhs.noalias() = _J._M.transpose() * _e;
+      _hessianValid = false;
     }
 
 
     bool DenseQrLinearSystemSolver::solveSystem(Eigen::VectorXd& outDx)
     {
-      if (_useDiagonalConditioner) {
-        // Append the diagonal. Thanks to the ceres developers for this trick.
-        _J._M.conservativeResize(_JRows + _JCols, Eigen::NoChange);
-        _J._M.bottomRows(_JCols) = _diagonalConditioner.asDiagonal();
-        // Append zeros to make the sizes match.
-        _e.conservativeResize(_JRows + _JCols);
-        _e.tail(_JCols) = Eigen::VectorXd::Zero(_JCols);
+      if (useNormalEquations() && !_hessianValid)
+        computeHessian();
+      bool fellBack = false;
+      const bool success = solve(_useDiagonalConditioner ? &_diagonalConditioner : NULL, _workspace, outDx, fellBack);
+      _numNormalEquationsFallbacks += fellBack;
+      return success;
+    }
+
+    bool DenseQrLinearSystemSolver::useNormalEquations() const
+    {
+      return _options.decomposition == DenseQRLinearSolverOptions::NORMAL_EQUATIONS_LLT
+          || _options.decomposition == DenseQRLinearSolverOptions::NORMAL_EQUATIONS_LDLT;
+    }
+
+    bool DenseQrLinearSystemSolver::solve(const Eigen::VectorXd* conditioner, Workspace& workspace, Eigen::VectorXd& outDx, bool& outFellBack) const
+    {
+      outFellBack = false;
+      if (useNormalEquations()) {
+        if (solveNormalEquations(conditioner, workspace, outDx))
+          return true;
+        outFellBack = true;
       }
-      outDx = _J._M.colPivHouseholderQr().solve(_e);
-      if (_useDiagonalConditioner) {
-        // Remove the diagonal
-        _J._M.conservativeResize(_JRows, Eigen::NoChange);
-        _e.conservativeResize(_JRows);
+      solveQr(conditioner, _options.decomposition != DenseQRLinearSolverOptions::HOUSEHOLDER_QR, workspace, outDx);
+      return true;
+    }
+
+    bool DenseQrLinearSystemSolver::solveNormalEquations(const Eigen::VectorXd* conditioner, Workspace& workspace, Eigen::VectorXd& outDx) const
+    {
+      SM_ASSERT_TRUE_DBG(Exception, _hessianValid, "The normal equations have not been formed");
+      workspace.dampedHessian = _hessian;
+      if (conditioner)
+        workspace.dampedHessian.diagonal() += conditioner->cwiseAbs2();
+      // Squaring the condition number of J is only acceptable if the damped Hessian is well conditioned
+      if (_options.decomposition == DenseQRLinearSolverOptions::NORMAL_EQUATIONS_LLT) {
+        workspace.llt.compute(workspace.dampedHessian);
+        if (workspace.llt.info() != Eigen::Success || !(workspace.llt.rcond() >= _options.normalEquationsMinRcond))
+          return false;
+        outDx = workspace.llt.solve(_rhs);
+      } else {
+        workspace.ldlt.compute(workspace.dampedHessian);
+        // A zero pivot is skipped by the solve of LDLT but hides the singularity from its condition estimate
+        if (workspace.ldlt.info() != Eigen::Success || !(workspace.ldlt.vectorD().minCoeff() > 0.0)
+            || !(workspace.ldlt.rcond() >= _options.normalEquationsMinRcond))
+          return false;
+        outDx = workspace.ldlt.solve(_rhs);
       }
       return true;
     }
 
+    void DenseQrLinearSystemSolver::solveQr(const Eigen::VectorXd* conditioner, bool pivoting, Workspace& workspace, Eigen::VectorXd& outDx) const
+    {
+      if (conditioner) {
+        // Append the diagonal. Thanks to the ceres developers for this trick.
+        workspace.augmentedJ.resize(_JRows + _JCols, _JCols);
+        workspace.augmentedJ.topRows(_JRows) = _J._M;
+        workspace.augmentedJ.bottomRows(_JCols) = conditioner->asDiagonal();
+        if (pivoting)
+          outDx = workspace.colPivQr.compute(workspace.augmentedJ).solve(_systemE);
+        else
+          outDx = workspace.qr.compute(workspace.augmentedJ).solve(_systemE);
+      } else {
+        if (pivoting)
+          outDx = workspace.colPivQr.compute(_J._M).solve(_systemE.head(_JRows));
+        else
+          outDx = workspace.qr.compute(_J._M).solve(_systemE.head(_JRows));
+      }
+    }
+
+    void DenseQrLinearSystemSolver::computeHessian()
+    {
+      // A static partition of the rows, so the result only depends on the number of threads
+      const size_t numChunks = std::max<size_t>(1, std::min(_nThreads, _JRows));
+      _chunkBoundaries.resize(numChunks + 1);
+      for (size_t k = 0; k <= numChunks; ++k)
+        _chunkBoundaries[k] = k * _JRows / numChunks;
+      _chunkHessians.resize(numChunks - 1);
+      util::runThreadedJob(boost::bind(&DenseQrLinearSystemSolver::computeChunkHessians, this, _1, _2, _3), numChunks, _nThreads, _threadedJobOptions);
+      for (const Eigen::MatrixXd& H : _chunkHessians)
+        _hessian += H;
+      _hessianValid = true;
+    }
+
+    void DenseQrLinearSystemSolver::computeChunkHessians(size_t /* threadId */, size_t startIdx, size_t endIdx)
+    {
+      for (size_t k = startIdx; k < endIdx; ++k) {
+        Eigen::MatrixXd& H = k == 0 ? _hessian : _chunkHessians[k - 1];
+        H.setZero(_JCols, _JCols);
+        H.selfadjointView<Eigen::Lower>().rankUpdate(_J._M.middleRows(_chunkBoundaries[k], _chunkBoundaries[k + 1] - _chunkBoundaries[k]).transpose());
+      }
+    }
+
 
-  void DenseQrLinearSystemSolver::evaluateJacobians(size_t /* threadId */, size_t startIdx, size_t endIdx, bool useMEstimator)
+    void DenseQrLinearSystemSolver::solveSystems(const std::vector<double>& conditioners, size_t nThreads, std::vector<Eigen::VectorXd>& outDx)
+    {
+      if (!_useDiagonalConditioner || conditioners.empty()) {
+        LinearSystemSolver::solveSystems(conditioners, nThreads, outDx);
+        return;
+      }
+      nThreads = std::max<size_t>(1, nThreads);
+      if (useNormalEquations() && !_hessianValid)
+        computeHessian();
+      outDx.resize(conditioners.size());
+      _threadWorkspaces.resize(nThreads);
+      std::vector<char> fellBack(conditioners.size(), 0);
+      util::runThreadedJob([this, &conditioners, &outDx, &fellBack](size_t threadId, size_t startIdx, size_t endIdx) {
+        Eigen::VectorXd conditioner;
+        bool solveFellBack;
+        for (size_t i = startIdx; i < endIdx; ++i) {
+          conditioner = Eigen::VectorXd::Constant(_JCols, conditioners[i]);
+          if (!solve(&conditioner, _threadWorkspaces[threadId], outDx[i], solveFellBack))
+            outDx[i].resize(0);
+          fellBack[i] = solveFellBack;
+        }
+      }, conditioners.size(), nThreads, _threadedJobOptions);
+      _numNormalEquationsFallbacks += std::count(fellBack.begin(), fellBack.end(), 1);
+      setConstantConditioner(conditioners.back());
+    }
+
+
+  void DenseQrLinearSystemSolver::evaluateJacobians(size_t threadId, size_t startIdx, size_t endIdx, bool useMEstimator)
     {
       for (size_t i = startIdx; i < endIdx; ++i) {
-        JacobianContainerSparse<Eigen::Dynamic> jc(_errorTerms[i]->dimension());
         ErrorTerm* e = _errorTerms[i];
+        JacobianContainerRows& jc = *_jacobianContainers[threadId];
+        jc.reset(e->rowBase(), e->dimension(), e->designVariables());
         e->getWeightedJacobians(jc, useMEstimator);
-        auto it = jc.begin();
-        for (; it != jc.end(); ++it) {
-          _J._M.block(e->rowBase(), it->first->columnBase(), it->second.rows(), it->second.cols()) = it->second;
-        }
       }
     }
 
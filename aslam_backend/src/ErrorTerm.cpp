@@ -17,6 +17,21 @@ namespace aslam {
       evaluateJacobiansImplementation(outJ);
     }
 
+    double ErrorTerm::evaluateErrorAndJacobiansImplementation(JacobianContainer & outJ)
+    {
+      const double squaredError = evaluateErrorImplementation();
+      evaluateJacobiansImplementation(outJ);
+      return squaredError;
+    }
+
+    double ErrorTerm::evaluateWeightedErrorAndJacobians(Eigen::VectorXd& outE, JacobianContainer& outJc, bool useMEstimator)
+    {
+      updateRawSquaredError();
+      getWeightedError(outE, useMEstimator);
+      getWeightedJacobians(outJc, useMEstimator);
+      return getSquaredError();
+    }
+
     /// \brief build this error term's part of the Hessian matrix.
     ///
     /// the i/o variables outHessian and outRhs are the full Hessian and rhs in the Gauss-Newton
@@ -101,6 +116,14 @@ namespace aslam {
       return _designVariables;
     }
 
+    double ErrorTerm::getEvaluationCostHint() const
+    {
+      size_t cols = 0;
+      for (const DesignVariable* dv : _designVariables)
+        cols += dv->minimalDimensions();
+      return static_cast<double>(dimension() * (cols + 1));
+    }
+
     /// \brief Set the column base of this error term in the Jacobian matrix.
     void ErrorTerm::setRowBase(size_t b)
     {
@@ -1,5 +1,8 @@
 #include <aslam/backend/LevenbergMarquardtTrustRegionPolicy.hpp>
+#include <aslam/backend/util/ThreadedRangeProcessor.hpp>
 #include <sm/PropertyTree.hpp>
+#include <algorithm>
+#include <vector>
 
 namespace aslam {
     namespace backend {
@@ -9,7 +12,8 @@ namespace aslam {
         _gammaInit(3),
         _betaInit(2),
         _pInit(3),
-        _muInit(2)
+        _muInit(2),
+        _numTrialLambdas(1)
     {
 
     }
@@ -18,7 +22,8 @@ namespace aslam {
         _gammaInit(3),
         _betaInit(2),
         _pInit(3),
-        _muInit(2)
+        _muInit(2),
+        _numTrialLambdas(1)
     {
 
     }
@@ -29,6 +34,12 @@ namespace aslam {
       _betaInit   = config.getDouble("betaInit", 2.0); 
       _pInit      = config.getInt("pInit", 3);
       _muInit     = config.getDouble("muInit", 2.0);
+      setNumTrialLambdas(config.getInt("numTrialLambdas", 1));
+    }
+
+    void LevenbergMarquardtTrustRegionPolicy::setNumTrialLambdas(int numTrialLambdas) {
+      SM_ASSERT_GE(Exception, numTrialLambdas, 1, "At least one damping value has to be tried");
+      _numTrialLambdas = numTrialLambdas;
     }
     
         LevenbergMarquardtTrustRegionPolicy::~LevenbergMarquardtTrustRegionPolicy() {}
@@ -47,7 +58,7 @@ namespace aslam {
         }
         
         // Returns true if the solution was successful
-    bool LevenbergMarquardtTrustRegionPolicy::solveSystemImplementation(double /* J */, bool previousIterationFailed, int nThreads, Eigen::VectorXd& outDx)
+    bool LevenbergMarquardtTrustRegionPolicy::solveSystemImplementation(double J, bool previousIterationFailed, int nThreads, Eigen::VectorXd& outDx)
         {
             SM_ASSERT_TRUE(Exception, _solver.get() != NULL, "The solver is null");
             
@@ -58,7 +69,10 @@ namespace aslam {
                 ///get Rho and update Lambda:
                 double rho = getLmRho(outDx);
               
-                if (previousIterationFailed ) {
+                if (previousIterationFailed && _numTrialLambdas > 1 && _trialCost) {
+                  // The last step was a regression. Try several increased damping values at once.
+                  return solveTrialLambdas(J, nThreads, outDx);
+                } else if (previousIterationFailed ) {
                   // The last step was a regression.
                   _mu *= 2;
                   _lambda *= _mu;
@@ -88,10 +102,63 @@ namespace aslam {
             return _solver->solveSystem(outDx);
         }
         
+    bool LevenbergMarquardtTrustRegionPolicy::solveTrialLambdas(double J, int nThreads, Eigen::VectorXd& outDx)
+    {
+      // The damping values the next _numTrialLambdas regressions would try
+      std::vector<double> lambdas(_numTrialLambdas), mus(_numTrialLambdas);
+      double lambda = _lambda, mu = _mu;
+      for (int i = 0; i < _numTrialLambdas; ++i) {
+        mu *= 2;
+        lambda *= mu;
+        lambdas[i] = lambda;
+        mus[i] = mu;
+      }
+
+      std::vector<Eigen::VectorXd> dxs;
+      _solver->solveSystems(lambdas, nThreads, dxs);
+
+      // Take the least damped step that decreases the cost. The steps are evaluated in batches of concurrent trials, the
+      // batches after the one of the taken step are skipped. If no step decreases the cost, the most damped one is the
+      // best guess.
+      std::vector<double> costs(_numTrialLambdas);
+      int best = -1, lastSolved = -1;
+      for (int begin = 0; begin < _numTrialLambdas && best < 0; begin += _numConcurrentTrials) {
+        const int end = std::min<int>(_numTrialLambdas, begin + _numConcurrentTrials);
+        util::runThreadedJob([&](size_t /* threadId */, size_t startIdx, size_t endIdx) {
+          for (size_t i = begin + startIdx; i < begin + endIdx; ++i) {
+            if (dxs[i].size() > 0)
+              costs[i] = _trialCost(dxs[i]);
+          }
+        }, end - begin, end - begin);
+        for (int i = begin; i < end && best < 0; ++i) {
+          if (dxs[i].size() == 0)
+            continue;
+          lastSolved = i;
+          if (costs[i] < J)
+            best = i;
+        }
+      }
+      if (best < 0)
+        best = lastSolved;
+      if (best < 0) {
+        _lambda = lambdas.back();
+        _mu = mus.back();
+        return false;
+      }
+
+      _lambda = lambdas[best];
+      _mu = mus[best];
+      _solver->setConstantConditioner(_lambda);
+      outDx = dxs[best];
+      return true;
+    }
+
         /// \brief print the current state to a stream (no newlines).
         std::ostream & LevenbergMarquardtTrustRegionPolicy::printState(std::ostream & out) const
         {
             out << "LM - lambda:" << _lambda << " mu:" << _mu;
+            if (_numTrialLambdas > 1)
+              out << " trials:" << _numTrialLambdas;
             return out;
         }
 
@@ -1,5 +1,6 @@
 #include <cmath>
 #include <aslam/backend/util/utils.hpp>
+#include <aslam/backend/util/ThreadedRangeProcessor.hpp>
 #include <aslam/backend/LineSearch.hpp>
 #include <Eigen/Dense>
 #include <sm/eigen/assert_macros.hpp>
@@ -400,6 +401,7 @@ LineSearchOptions::LineSearchOptions(const sm::PropertyTree& config)
   nMaxIterWolfe1 = config.getInt("nMaxIterWolfe1", nMaxIterWolfe1);
   nMaxIterWolfe2 = config.getInt("nMaxIterWolfe2", nMaxIterWolfe2);
   nMaxIterZoom = config.getInt("nMaxIterZoom", nMaxIterZoom);
+  numParallelEvaluations = config.getInt("numParallelEvaluations", numParallelEvaluations);
   check();
 }
 
@@ -413,6 +415,7 @@ void LineSearchOptions::check() const {
   SM_ASSERT_GT(Exception, nMaxIterWolfe1, 0, "");
   SM_ASSERT_GT(Exception, nMaxIterWolfe2, 0, "");
   SM_ASSERT_GT(Exception, nMaxIterZoom, 0, "");
+  SM_ASSERT_GT(Exception, numParallelEvaluations, 0, "");
 }
 
 ostream& operator<<(ostream& out, const aslam::backend::LineSearchOptions& options)
@@ -427,7 +430,8 @@ ostream& operator<<(ostream& out, const aslam::backend::LineSearchOptions& optio
   out << "\tinitialStepLength: " << options.initialStepLength << endl;
   out << "\tnMaxIterWolfe1: " << options.nMaxIterWolfe1 << endl;
   out << "\tnMaxIterWolfe2: " << options.nMaxIterWolfe2 << endl;
-  out << "\tnMaxIterZoom: " << options.nMaxIterZoom;
+  out << "\tnMaxIterZoom: " << options.nMaxIterZoom << endl;
+  out << "\tnumParallelEvaluations: " << options.numParallelEvaluations;
   return out;
 }
 
@@ -463,6 +467,7 @@ void LineSearch::initialize(boost::optional<const RowVectorType&> searchDirectio
   _stepLength = 0.0;
   _errorOutdated = _derrorOutdated = true;
   _errorOld = std::numeric_limits<double>::signaling_NaN();
+  _speculativeStepLengths.clear();
 
   if (error)
     _error = error.get();
@@ -486,6 +491,7 @@ void LineSearch::initialize(boost::optional<const RowVectorType&> searchDirectio
 void LineSearch::setSearchDirection(const RowVectorType& searchDirection) {
   using namespace Eigen;
   _stepLength = 0.0; // if the search direction changed, we must avoid skipping updates with same step lengths
+  _speculativeStepLengths.clear();
   _searchDirection = searchDirection;
   _derror = computeErrorDerivative();
   _derrorOutdated = false;
@@ -520,6 +526,48 @@ void LineSearch::applyStateUpdate(const double s) {
 }
 
 
+bool LineSearch::isSpeculative() const {
+  return _options.numParallelEvaluations > 1 && _costFunction->supportsConcurrentEvaluation();
+}
+
+
+void LineSearch::evaluateSpeculatively(double stepLength, std::size_t n) {
+  _speculativeStepLengths.resize(n);
+  _speculativeErrors.resize(n);
+  _speculativeGradients.resize(n);
+  for (std::size_t j = 0; j < n; ++j)
+    _speculativeStepLengths[j] = stepLength * std::pow(2.0, static_cast<double>(j));
+
+  // The steps are relative to the current state
+  util::runThreadedJob([this](size_t /* threadId */, size_t startIdx, size_t endIdx) {
+    for (size_t j = startIdx; j < endIdx; ++j) {
+      const RowVectorType dx = (_speculativeStepLengths[j] - _stepLength) * _searchDirection;
+      _speculativeErrors[j] = _costFunction->evaluateAtStep(dx, &_speculativeGradients[j]);
+    }
+  }, n, n);
+
+  for (std::size_t j = 0; j < n; ++j) {
+    if (_evalErrorCallback) _evalErrorCallback();
+    if (_evalGradCallback) _evalGradCallback();
+  }
+  SM_VERBOSE_STREAM_NAMED("optimization.linesearch", "LineSearch: evaluated " << n << " step lengths in parallel starting at " << stepLength);
+}
+
+
+void LineSearch::applySpeculativeStateUpdate(const double s) {
+  this->applyStateUpdate(s);
+  for (std::size_t j = 0; j < _speculativeStepLengths.size(); ++j) {
+    if (_speculativeStepLengths[j] == s) {
+      _error = _speculativeErrors[j];
+      _gradient = _speculativeGradients[j];
+      _derror = computeErrorDerivative();
+      _errorOutdated = _derrorOutdated = false;
+      return;
+    }
+  }
+}
+
+
 void LineSearch::updateError() {
   if (_errorOutdated) {
     const double errorOld = _error;
@@ -756,7 +804,11 @@ bool LineSearch::lineSearchWolfe2() {
   double errorStepMin = error0;
   double derrorStepMin = derror0;
 
-  this->applyStateUpdate(maxStepLength); // Move to position x + maxStepLength*searchDirection
+  const bool speculative = this->isSpeculative();
+  if (speculative)
+    this->evaluateSpeculatively(maxStepLength, std::min(_options.numParallelEvaluations, _options.nMaxIterWolfe2));
+
+  this->applySpeculativeStateUpdate(maxStepLength); // Move to position x + maxStepLength*searchDirection
   this->updateError();
   double errorStepMax = getError();
 //  double derrorStepMax; // evaluated below
@@ -804,7 +856,11 @@ bool LineSearch::lineSearchWolfe2() {
     maxStepLength = maxStepLengthNew;
     errorStepMin = errorStepMax;
 
-    this->applyStateUpdate(maxStepLength);
+    // The next batch starts where the previous one ended
+    if (speculative && _speculativeStepLengths.back() < maxStepLength)
+      this->evaluateSpeculatively(maxStepLength, std::max<std::size_t>(1, std::min(_options.numParallelEvaluations, _options.nMaxIterWolfe2 - i - 1)));
+
+    this->applySpeculativeStateUpdate(maxStepLength);
     this->updateError();
     errorStepMax = getError();
     derrorStepMin = derrorStepMax;
@@ -813,6 +869,8 @@ bool LineSearch::lineSearchWolfe2() {
 
   }
 
+  _speculativeStepLengths.clear();
+
   if (success)
     SM_FINE_STREAM_NAMED("optimization.linesearch", setprecision(20) << "LineSearch: wolfe2 -- converged, final step length " << getCurrentStepLength() <<
                          ", final error " << getError());
@@ -828,21 +886,26 @@ bool LineSearch::lineSearchWolfe12() {
   const double errorOld0 = _errorOld; // _errorOld gets modified by lineSearchWolfe1
   const double error0 = _error;
   const double derror0 = _derror;
+  const RowVectorType gradient0 = _gradient;
 
   utils::DesignVariableState dvstate(_costFunction->getDesignVariables());
 
-  if (!lineSearchWolfe1()) {
-    SM_FINE_STREAM_NAMED("optimization.linesearch", "LineSearch: method wolfe1 failed, trying method wolfe2");
+  // The bracketing of wolfe2 is the part that can be evaluated in parallel
+  const bool speculative = this->isSpeculative();
+  if (!(speculative ? lineSearchWolfe2() : lineSearchWolfe1())) {
+    SM_FINE_STREAM_NAMED("optimization.linesearch", "LineSearch: method " << (speculative ? "wolfe2" : "wolfe1") << " failed, trying method " << (speculative ? "wolfe1" : "wolfe2"));
 
-    // restore error values to the ones before calling lineSearchWolfe1().
+    // restore error values to the ones before calling the first method.
     // These are the values that correspond to step length zero.
     _errorOld = errorOld0;
     _error = error0;
     _derror = derror0;
+    _gradient = gradient0;
     _stepLength = 0.0;
+    _errorOutdated = _derrorOutdated = false;
     dvstate.restore();
 
-    return lineSearchWolfe2();
+    return speculative ? lineSearchWolfe1() : lineSearchWolfe2();
   }
 
   return true;
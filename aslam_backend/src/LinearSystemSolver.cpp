@@ -1,6 +1,5 @@
 #include <aslam/backend/LinearSystemSolver.hpp>
-#include <boost/thread.hpp>
-#include <boost/ref.hpp>
+#include <boost/bind.hpp>
 
 #include <aslam/backend/ErrorTerm.hpp>
 #include <aslam/backend/OptimizerCallbackManager.hpp>
@@ -16,69 +15,29 @@ namespace aslam {
 
     void LinearSystemSolver::evaluateErrors(size_t threadId, size_t startIdx, size_t endIdx, bool useMEstimator)
     {
-      SM_ASSERT_LT_DBG(Exception, threadId, _threadLocalErrors.size(), "Index out of bounds in thread " << threadId);
       SM_ASSERT_LE_DBG(Exception, endIdx, _errorTerms.size(), "Index out of bounds in thread " << threadId);
-      Eigen::VectorXd e;
       for (size_t i = startIdx; i < endIdx; ++i) {
         SM_ASSERT_TRUE_DBG(Exception, _errorTerms[i] != NULL, "Null error term " << i);
-        _threadLocalErrors[threadId] += _errorTerms[i]->evaluateError();
+        _squaredErrors[i] = _errorTerms[i]->evaluateError();
+        Eigen::VectorXd& e = _errorVectors.get(threadId, _errorTerms[i]->dimension());
         _errorTerms[i]->getWeightedError(e, useMEstimator);
         _e.segment(_errorTerms[i]->rowBase(), _errorTerms[i]->dimension()) = -e;
       }
     }
 
-    struct SafeJobReturnValue {
-      SafeJobReturnValue(const std::exception& e) : _e(e) {}
-
-      std::exception _e;
-    };
-
-    struct SafeJob {
-      boost::function<void()> _fn;
-      SafeJobReturnValue* _rval;
-      SafeJob() : _rval(NULL) {}
-      SafeJob(boost::function<void()> fn) : _fn(fn), _rval(NULL) {}
-      ~SafeJob() {
-        if (_rval) delete _rval;
-      }
-
-      void operator()() {
-        try {
-          _fn();
-        } catch (const std::exception& e) {
-          _rval = new SafeJobReturnValue(e);
-          std::cout << "Exception in thread block: " << e.what() << std::endl;
-        }
-      }
-    };
-
-    void LinearSystemSolver::setupThreadedJob(boost::function<void(size_t, size_t, size_t, bool)> job, size_t nThreads, bool useMEstimator)
+    void LinearSystemSolver::setupThreadedJob(boost::function<void(size_t, size_t, size_t, bool)> job, size_t nThreads, bool useMEstimator, util::LoadBalancer* loadBalancer)
     {
-      if (nThreads <= 1) {
+      _errorVectors.resize(std::max<size_t>(1, nThreads));
+      // The lambda is small enough to be stored in the boost::function without allocating
+      auto threadJob = [&job, useMEstimator](size_t threadId, size_t startIdx, size_t endIdx) {
+        job(threadId, startIdx, endIdx, useMEstimator);
+      };
+      if (loadBalancer) {
+        util::runThreadedJob(threadJob, *loadBalancer, std::max<size_t>(1, nThreads), _threadedJobOptions);
+      } else if (nThreads <= 1) {
         job(0, 0, _errorTerms.size(), useMEstimator);
       } else {
-        nThreads = std::min(nThreads, _errorTerms.size());
-        // Give some error terms to each thread.
-        std::vector<int> indices(nThreads + 1, 0);
-        int nJPerThread = std::max(1, (int)(_errorTerms.size() / nThreads));
-        for (unsigned i = 0; i < nThreads; ++i)
-          indices[i + 1] = indices[i] + nJPerThread;
-        // deal with the remainder.
-        indices.back() = _errorTerms.size();
-        // Build a thread pool and evaluate the jacobians.
-        boost::thread_group threads;
-        std::vector<SafeJob> jobs(nThreads);
-        for (size_t i = 0; i < nThreads; ++i) {
-          jobs[i] = SafeJob(boost::bind(job, i, indices[i], indices[i + 1], useMEstimator));
-          threads.create_thread(boost::ref(jobs[i]));
-        }
-        threads.join_all();
-        // Now go through and look for exceptions.
-        for (size_t i = 0; i < nThreads; ++i) {
-          if (jobs[i]._rval) {
-            throw jobs[i]._rval->_e;
-          }
-        }
+        util::runThreadedJob(threadJob, _errorTerms.size(), nThreads, _threadedJobOptions);
       }
     }
 
@@ -86,14 +45,27 @@ namespace aslam {
     double LinearSystemSolver::evaluateError(size_t nThreads, bool useMEstimator, callback::Manager * callback)
     {
       nThreads = std::max((size_t)1, nThreads);
-      _threadLocalErrors.clear();
-      _threadLocalErrors.resize(nThreads, 0.0);
-      setupThreadedJob(boost::bind(&LinearSystemSolver::evaluateErrors, this, _1, _2, _3, _4), nThreads, useMEstimator);
-      // Gather the squared error results from the multiple threads.
+      _squaredErrors.resize(_errorTerms.size());
+      setupThreadedJob(boost::bind(&LinearSystemSolver::evaluateErrors, this, _1, _2, _3, _4), nThreads, useMEstimator, &_errorLoadBalancer);
+      return sumSquaredErrors(callback);
+    }
+
+    double LinearSystemSolver::evaluateErrorAndJacobians(size_t nThreads, bool useMEstimator, callback::Manager * callback)
+    {
+      nThreads = std::max((size_t)1, nThreads);
+      _squaredErrors.resize(_errorTerms.size());
+      if (!evaluateErrorsAndJacobiansImplementation(nThreads, useMEstimator))
+        setupThreadedJob(boost::bind(&LinearSystemSolver::evaluateErrors, this, _1, _2, _3, _4), nThreads, useMEstimator, &_errorLoadBalancer);
+      return sumSquaredErrors(callback);
+    }
+
+    double LinearSystemSolver::sumSquaredErrors(callback::Manager * callback) const
+    {
+      // Gather the squared error results in a fixed order, so the sum does not depend on the scheduling.
       if(callback) callback->issueCallback(callback::event::RESIDUALS_UPDATED{0, 0});
       double error = 0.0;
-      for (unsigned i = 0; i < _threadLocalErrors.size(); ++i)
-        error += _threadLocalErrors[i];
+      for (unsigned i = 0; i < _squaredErrors.size(); ++i)
+        error += _squaredErrors[i];
       return error;
     }
 
@@ -119,11 +91,22 @@ namespace aslam {
       _diagonalConditioner = Eigen::VectorXd::Constant(_JCols, diag);
     }
 
+    void LinearSystemSolver::solveSystems(const std::vector<double>& conditioners, size_t /* nThreads */, std::vector<Eigen::VectorXd>& outDx)
+    {
+      outDx.resize(conditioners.size());
+      for (size_t i = 0; i < conditioners.size(); ++i) {
+        setConstantConditioner(conditioners[i]);
+        if (!solveSystem(outDx[i]))
+          outDx[i].resize(0);
+      }
+    }
+
 
     void LinearSystemSolver::initMatrixStructure(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors, bool useDiagonalConditioner)
     {
       setOrdering(dvs, errors);
       _errorTerms = errors;
+      _errorVectors.reserve(errors);
       // Figure out the size of the Jacobian matrix.
       _JRows = 0;
       std::vector<ErrorTerm*>::const_iterator eit = errors.begin();
@@ -140,6 +123,7 @@ namespace aslam {
       _e.conservativeResize(_JRows);
       _rhs.resize(_JCols);
       _diagonalConditioner = Eigen::VectorXd::Zero(_JCols);
+      _errorLoadBalancer.init(getEvaluationCostHints(errors));
       initMatrixStructureImplementation(dvs, errors, useDiagonalConditioner);
     }
 
@@ -165,5 +149,17 @@ namespace aslam {
     void LinearSystemSolver::handleNewAcceptConstantErrorTerms() {
     }
 
+    std::vector<double> LinearSystemSolver::getEvaluationCostHints(const std::vector<ErrorTerm*>& errors)
+    {
+      std::vector<double> hints(errors.size());
+      for (size_t i = 0; i < errors.size(); ++i)
+        hints[i] = errors[i]->getEvaluationCostHint();
+      return hints;
+    }
+
+    void LinearSystemSolver::setThreadedJobOptions(const util::ThreadedJobOptions& options) {
+      _threadedJobOptions = options;
+    }
+
   } // namespace backend
 }  // namespace aslam
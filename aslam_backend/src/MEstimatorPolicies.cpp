@@ -14,6 +14,9 @@ namespace backend {
 
 MEstimator::~MEstimator() {
 }
+bool MEstimator::isErrorDependent() const {
+  return true;
+}
 
 NoMEstimator::~NoMEstimator() {
 }
@@ -23,6 +26,9 @@ double NoMEstimator::getWeight(double /* squaredError */) const {
 std::string NoMEstimator::name() const {
   return "none";
 }
+bool NoMEstimator::isErrorDependent() const {
+  return false;
+}
 
 GemanMcClureMEstimator::GemanMcClureMEstimator(double sigma2) :
     _sigma2(sigma2) {
@@ -132,6 +138,10 @@ void FixedWeightMEstimator::setWeight(double weight) {
   _weight = weight;
 }
 
+bool FixedWeightMEstimator::isErrorDependent() const {
+  return false;
+}
+
 std::string FixedWeightMEstimator::name() const {
   std::stringstream ss;
   ss << "Fixed-Weight(" << std::setprecision(11) << std::scientific << _weight << ")";
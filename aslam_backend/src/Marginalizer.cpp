@@ -10,8 +10,14 @@
 #include <aslam/backend/DenseQrLinearSystemSolver.hpp>
 #include <Eigen/QR>
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
 #include <aslam/backend/DenseMatrix.hpp>
+#include <aslam/backend/CompressedColumnJacobianTransposeBuilder.hpp>
+#include <aslam/backend/Cholmod.hpp>
+#include <aslam/backend/BlockCholeskyLinearSystemSolver.hpp>
+#include <aslam/backend/util/ThreadedRangeProcessor.hpp>
 
+#include <algorithm>
 #include <iostream>
 
 #include <sm/logging.hpp>
@@ -20,6 +26,318 @@
 namespace aslam {
 namespace backend {
 
+namespace {
+
+/// \brief Computes the covariance E^T (R^T R)^-1 E of the columns selected by E from the lower triangular view \p Rt of R^T.
+///        With R^T Z = E, it is Z^T Z, so only as many triangular solves as E has columns are needed instead of inverting R.
+///        \p Z holds E on input.
+template <typename LOWER_TRIANGULAR>
+void computeSelectedCovariance(const LOWER_TRIANGULAR& Rt, Eigen::MatrixXd& Z, Eigen::MatrixXd& outCov)
+{
+  sm::timing::Timer myTimer("Covariance computation");
+  Rt.solveInPlace(Z);
+  outCov.noalias() = Z.transpose() * Z;
+  myTimer.stop();
+}
+
+/// \brief Computes the top left block of the covariance (R^T R)^-1 from the n x n lower triangular view \p Rt of R^T,
+///        i.e. the covariance of the first numTopRowsInCov columns.
+template <typename LOWER_TRIANGULAR>
+void computeTopCovariance(const LOWER_TRIANGULAR& Rt, Eigen::Index n, size_t numTopRowsInCov, Eigen::MatrixXd& outCov)
+{
+  Eigen::MatrixXd Z = Eigen::MatrixXd::Identity(n, numTopRowsInCov);
+  computeSelectedCovariance(Rt, Z, outCov);
+}
+
+/// \brief Marginalizes with a dense QR decomposition of the Jacobian
+void marginalizeDense(
+			std::vector<aslam::backend::DesignVariable*>& inDesignVariables,
+			std::vector<aslam::backend::ErrorTerm*>& inErrorTerms,
+			int dimOfDesignVariablesToRemove,
+			bool useMEstimator,
+			size_t numTopRowsInCov,
+			size_t numThreads,
+			Eigen::MatrixXd& R_reduced,
+			Eigen::VectorXd& d_reduced,
+			Eigen::MatrixXd& outCov)
+{
+		  aslam::backend::DenseQrLinearSystemSolver qrSolver;
+      qrSolver.initMatrixStructure(inDesignVariables, inErrorTerms, false);
+
+		  qrSolver.evaluateError(numThreads, useMEstimator);
+		  qrSolver.buildSystem(numThreads, useMEstimator);
+
+
+		  const Eigen::MatrixXd& jacobian = qrSolver.getJacobian();
+		  const Eigen::VectorXd& b = qrSolver.e();
+
+		  // check dimension of jacobian
+		  int jrows = jacobian.rows();
+		  int jcols = jacobian.cols();
+
+		  int dimOfRemainingDesignVariables = jcols - dimOfDesignVariablesToRemove;
+
+		  sm::timing::Timer t1("Rank Computation");
+		  // check the rank
+		  Eigen::FullPivLU<Eigen::MatrixXd> lu_decomp(jacobian);
+		  //lu_decomp.setThreshold(1e-20);
+		  double threshold = lu_decomp.threshold();
+		  int rank = lu_decomp.rank();
+		  int fullRank = std::min(jacobian.rows(), jacobian.cols());
+		  SM_DEBUG_STREAM("Rank of jacobian: " << rank << " (full rank: " << fullRank << ", threshold: " << threshold << ")");
+		  bool rankDeficient = rank < fullRank;
+		  if(rankDeficient)
+		  {
+			  SM_WARN("Marginalization jacobian is rank deficient!");
+		  }
+		  t1.stop();
+		  //SM_ASSERT_FALSE(aslam::Exception, rankDeficient, "Right now, we don't want the jacobian to be rank deficient - ever...");
+
+		  if (jrows < jcols)
+		  {
+			  SM_THROW(aslam::Exception, "underdetermined LSE!");
+		  } else {
+			  // PTF: Do we know what will happen when the jacobian matrix is rank deficient?
+			  // MB: yes, bad things!
+
+              // do QR decomposition
+			  sm::timing::Timer myTimer("QR Decomposition");
+        Eigen::HouseholderQR<Eigen::MatrixXd> qr(jacobian);
+			  // the rows below the first jcols are zero
+			  Eigen::MatrixXd R = qr.matrixQR().topRows(jcols).triangularView<Eigen::Upper>();
+			  // apply the Householder reflections to b instead of forming Q
+			  Eigen::VectorXd d = qr.householderQ().transpose()*b;
+			  myTimer.stop();
+
+			  // get the top left block
+			  SM_ASSERT_GE(aslam::Exception, static_cast<size_t>(R.rows()), numTopRowsInCov, "Cannot extract " << numTopRowsInCov << " rows of R because it only has " << R.rows() << " rows.");
+			  SM_ASSERT_GE(aslam::Exception, static_cast<size_t>(R.cols()), numTopRowsInCov, "Cannot extract " << numTopRowsInCov << " cols of R because it only has " << R.cols() << " cols.");
+
+			  if(numTopRowsInCov > 0)
+			  {
+          computeTopCovariance(R.transpose().triangularView<Eigen::Lower>(), jcols, numTopRowsInCov, outCov);
+			  }
+
+        // cut off the zero rows at the bottom
+        R_reduced = R.block(dimOfDesignVariablesToRemove, dimOfDesignVariablesToRemove, dimOfRemainingDesignVariables, dimOfRemainingDesignVariables);
+        d_reduced = d.segment(dimOfDesignVariablesToRemove, dimOfRemainingDesignVariables);
+		  }
+}
+
+#ifndef QRSOLVER_DISABLED
+/// \brief Marginalizes with the sparse QR decomposition of SuiteSparseQR.
+///
+/// The columns are ordered with COLAMD constrained to two groups, the design variables to remove in front of the
+/// remaining ones, so the bottom right block of R belongs to the remaining design variables only. Without CCOLAMD the
+/// natural order is kept. Q^T b is computed during the factorization and Q is never formed. Returns false if the
+/// Jacobian is underdetermined or rank deficient.
+bool marginalizeSparse(
+			std::vector<aslam::backend::DesignVariable*>& inDesignVariables,
+			std::vector<aslam::backend::ErrorTerm*>& inErrorTerms,
+			int dimOfDesignVariablesToRemove,
+			bool useMEstimator,
+			size_t numTopRowsInCov,
+			size_t numThreads,
+			Eigen::MatrixXd& R_reduced,
+			Eigen::VectorXd& d_reduced,
+			Eigen::MatrixXd& outCov)
+{
+  // spqr is only available with LONG indices
+  typedef SuiteSparse_long index_t;
+  CompressedColumnJacobianTransposeBuilder<index_t> jacobianBuilder;
+  jacobianBuilder.initMatrixStructure(inDesignVariables, inErrorTerms);
+  CompressedColumnMatrix<index_t>& J_transpose = jacobianBuilder.J_transpose();
+  const int jrows = J_transpose.cols();
+  const int jcols = J_transpose.rows();
+  if (jrows < jcols)
+    return false;
+
+  Eigen::VectorXd b(jrows);
+  std::vector<double> squaredErrors(inErrorTerms.size());
+  jacobianBuilder.evaluateErrorsAndJacobians(numThreads, useMEstimator, b, squaredErrors);
+  jacobianBuilder.buildSystem(numThreads, useMEstimator);
+
+  sm::timing::Timer myTimer("Sparse QR Decomposition");
+  Cholmod<index_t> cholmod;
+  cholmod_sparse cholmodJt;
+  J_transpose.getView(&cholmodJt);
+  cholmod_dense cholmodB;
+  cholmod.view(b, &cholmodB);
+  // Column k of R belongs to column permutation[k] of J
+  std::vector<index_t> constraints(jcols), permutation(jcols);
+  for (int c = 0; c < jcols; ++c)
+    constraints[c] = c < dimOfDesignVariablesToRemove ? 0 : 1;
+  const bool reordered = cholmod.constrainedColamd(&cholmodJt, &constraints[0], &permutation[0]);
+  if (!reordered) {
+    SM_DEBUG_STREAM("The constrained COLAMD ordering is not available, keeping the natural column order");
+    for (int c = 0; c < jcols; ++c)
+      permutation[c] = c;
+  }
+  cholmod_sparse* R = NULL;
+  cholmod_dense* QTb = NULL;
+  const index_t rank = cholmod.getR(&cholmodJt, &cholmodB, &R, &QTb, SPQR_DEFAULT_TOL, reordered ? &permutation[0] : NULL);
+  myTimer.stop();
+  SM_DEBUG_STREAM("Rank of jacobian: " << rank << " (full rank: " << jcols << ")");
+  if (rank < jcols)
+  {
+    SM_WARN("Marginalization jacobian is rank deficient, falling back to the dense QR decomposition!");
+    cholmod.free(R);
+    cholmod.free(QTb);
+    return false;
+  }
+
+  // R is upper triangular, so its bottom right block only has entries in the columns of the remaining design variables.
+  // Their order is undone for the prior, which does not need a triangular R.
+  const int dimOfRemainingDesignVariables = jcols - dimOfDesignVariablesToRemove;
+  Eigen::SparseMatrix<double> Rsparse;
+  std::vector<Eigen::Triplet<double> > Rentries;
+  R_reduced = Eigen::MatrixXd::Zero(dimOfRemainingDesignVariables, dimOfRemainingDesignVariables);
+  const index_t* colPtr = static_cast<const index_t*>(R->p);
+  const index_t* rowInd = static_cast<const index_t*>(R->i);
+  const double* values = static_cast<const double*>(R->x);
+  for (int c = 0; c < jcols; ++c) {
+    for (index_t k = colPtr[c]; k < colPtr[c + 1]; ++k) {
+      if (numTopRowsInCov > 0)
+        Rentries.emplace_back(rowInd[k], c, values[k]);
+      if (rowInd[k] >= dimOfDesignVariablesToRemove)
+        R_reduced(rowInd[k] - dimOfDesignVariablesToRemove, permutation[c] - dimOfDesignVariablesToRemove) = values[k];
+    }
+  }
+  d_reduced = Eigen::Map<const Eigen::VectorXd>(static_cast<const double*>(QTb->x), QTb->nrow).segment(dimOfDesignVariablesToRemove, dimOfRemainingDesignVariables);
+  cholmod.free(R);
+  cholmod.free(QTb);
+
+  if (numTopRowsInCov > 0)
+  {
+    SM_ASSERT_GE(aslam::Exception, static_cast<size_t>(jcols), numTopRowsInCov, "Cannot extract " << numTopRowsInCov << " rows of R because it only has " << jcols << " rows.");
+    Rsparse.resize(jcols, jcols);
+    Rsparse.setFromTriplets(Rentries.begin(), Rentries.end());
+    // select the columns of R of the first numTopRowsInCov columns of J
+    Eigen::MatrixXd Z = Eigen::MatrixXd::Zero(jcols, numTopRowsInCov);
+    for (int c = 0; c < jcols; ++c) {
+      if (permutation[c] < static_cast<index_t>(numTopRowsInCov))
+        Z(c, permutation[c]) = 1.0;
+    }
+    computeSelectedCovariance(Rsparse.transpose().triangularView<Eigen::Lower>(), Z, outCov);
+  }
+  return true;
+}
+#endif
+
+/// \brief Marginalizes by eliminating the removed design variables from the Hessian H = J^T J.
+///
+/// With H_mm = L L^T, X = L^-1 H_mr and R_rr^T R_rr = H_rr - X^T X, the upper triangular Cholesky factor of H is
+/// [L^T X; 0 R_rr], so the prior equals the one of the QR decomposition up to the signs of its rows. Only the columns
+/// of X of remaining design variables coupled to the removed ones are nonzero, and only their blocks of X^T X are
+/// formed. Returns false if H is not positive definite.
+bool marginalizeSchurComplement(
+			std::vector<aslam::backend::DesignVariable*>& inDesignVariables,
+			std::vector<aslam::backend::ErrorTerm*>& inErrorTerms,
+			int numberOfInputDesignVariablesToRemove,
+			int dimOfDesignVariablesToRemove,
+			bool useMEstimator,
+			size_t numTopRowsInCov,
+			size_t numThreads,
+			Eigen::MatrixXd& R_reduced,
+			Eigen::VectorXd& d_reduced,
+			Eigen::MatrixXd& outCov)
+{
+  typedef BlockCholeskyLinearSystemSolver::SparseBlockMatrix SparseBlockMatrix;
+  numThreads = std::max<size_t>(1, numThreads);
+
+  sm::timing::Timer assemblyTimer("Hessian Assembly");
+  BlockCholeskyLinearSolverOptions solverOptions;
+  solverOptions.parallelAssembly = true;
+  BlockCholeskyLinearSystemSolver solver("cholesky", solverOptions);
+  solver.initMatrixStructure(inDesignVariables, inErrorTerms, false);
+  solver.evaluateError(numThreads, useMEstimator);
+  solver.buildSystem(numThreads, useMEstimator);
+  SparseBlockMatrix H;
+  solver.copyHessian(H);
+  const Eigen::VectorXd& rhs = solver.rhs();
+  assemblyTimer.stop();
+
+  sm::timing::Timer eliminationTimer("Schur Complement");
+  const int numToRemove = numberOfInputDesignVariablesToRemove;
+  const int m = dimOfDesignVariablesToRemove;
+  const int r = H.cols() - m;
+  // Gather H_mm and H_mr from the upper triangle and find the remaining blocks coupled to the removed ones
+  Eigen::MatrixXd H_mm = Eigen::MatrixXd::Zero(m, m);
+  Eigen::MatrixXd X = Eigen::MatrixXd::Zero(m, r);
+  std::vector<int> coupledBlocks;
+  for (int c = 0; c < H.bCols(); ++c) {
+    for (const SparseBlockMatrix::IntBlockMap::value_type& block : H.blockCols()[c]) {
+      if (block.first >= numToRemove)
+        break;
+      if (c < numToRemove) {
+        H_mm.block(H.rowBaseOfBlock(block.first), H.colBaseOfBlock(c), block.second->rows(), block.second->cols()) = *block.second;
+      } else {
+        X.block(H.rowBaseOfBlock(block.first), H.colBaseOfBlock(c) - m, block.second->rows(), block.second->cols()) = *block.second;
+        if (coupledBlocks.empty() || coupledBlocks.back() != c)
+          coupledBlocks.push_back(c);
+      }
+    }
+  }
+  Eigen::LLT<Eigen::MatrixXd> llt_mm(H_mm.selfadjointView<Eigen::Upper>());
+  if (llt_mm.info() != Eigen::Success)
+  {
+    SM_WARN("The Hessian of the marginalized design variables is not positive definite, falling back to the dense QR decomposition!");
+    return false;
+  }
+  llt_mm.matrixL().solveInPlace(X);
+  Eigen::VectorXd y = rhs.head(m);
+  llt_mm.matrixL().solveInPlace(y);
+
+  // The upper triangle of S = H_rr - X^T X. Every block column is written by one thread only.
+  Eigen::MatrixXd S = Eigen::MatrixXd::Zero(r, r);
+  util::runThreadedJob([&](size_t /* threadId */, size_t startIdx, size_t endIdx) {
+    for (size_t c = startIdx + numToRemove; c < endIdx + numToRemove; ++c) {
+      const int colBase = H.colBaseOfBlock(c) - m;
+      const int cols = H.colsOfBlock(c);
+      for (const SparseBlockMatrix::IntBlockMap::value_type& block : H.blockCols()[c]) {
+        if (block.first >= numToRemove)
+          S.block(H.rowBaseOfBlock(block.first) - m, colBase, block.second->rows(), cols) = *block.second;
+      }
+      if (!std::binary_search(coupledBlocks.begin(), coupledBlocks.end(), (int)c))
+        continue;
+      for (int b : coupledBlocks) {
+        if (b > (int)c)
+          break;
+        const int rowBase = H.colBaseOfBlock(b) - m;
+        S.block(rowBase, colBase, H.colsOfBlock(b), cols).noalias() -= X.middleCols(rowBase, H.colsOfBlock(b)).transpose() * X.middleCols(colBase, cols);
+      }
+    }
+  }, H.bCols() - numToRemove, numThreads);
+  const Eigen::VectorXd g = rhs.tail(r) - X.transpose() * y;
+
+  Eigen::LLT<Eigen::MatrixXd> llt_rr(S.selfadjointView<Eigen::Upper>());
+  eliminationTimer.stop();
+  if (llt_rr.info() != Eigen::Success)
+  {
+    SM_WARN("The Schur complement of the marginalized design variables is not positive definite, falling back to the dense QR decomposition!");
+    return false;
+  }
+  R_reduced = llt_rr.matrixU();
+  d_reduced = g;
+  llt_rr.matrixL().solveInPlace(d_reduced);
+
+  if (numTopRowsInCov > 0)
+  {
+    SM_ASSERT_GE(aslam::Exception, static_cast<size_t>(H.cols()), numTopRowsInCov, "Cannot extract " << numTopRowsInCov << " rows of R because it only has " << H.cols() << " rows.");
+    // Solve R^T Z = [I; 0] block wise with R = [L^T X; 0 R_rr], see computeTopCovariance()
+    sm::timing::Timer covarianceTimer("Covariance computation");
+    Eigen::MatrixXd Z = Eigen::MatrixXd::Identity(m + r, numTopRowsInCov);
+    llt_mm.matrixL().solveInPlace(Z.topRows(m));
+    Z.bottomRows(r).noalias() -= X.transpose() * Z.topRows(m);
+    llt_rr.matrixL().solveInPlace(Z.bottomRows(r));
+    outCov.noalias() = Z.transpose() * Z;
+    covarianceTimer.stop();
+  }
+  return true;
+}
+
+} // namespace
+
 void marginalize(
 			std::vector<aslam::backend::DesignVariable*>& inDesignVariables,
 			std::vector<aslam::backend::ErrorTerm*>& inErrorTerms,
@@ -31,6 +349,23 @@ void marginalize(
 			size_t numTopRowsInCov,
 			size_t numThreads)
 {
+  MarginalizerOptions options;
+  options.numThreads = numThreads;
+  marginalize(inDesignVariables, inErrorTerms, numberOfInputDesignVariablesToRemove, useMEstimator, outPriorErrorTermPtr, outCov, outDesignVariablesInRTop, numTopRowsInCov, options);
+}
+
+void marginalize(
+			std::vector<aslam::backend::DesignVariable*>& inDesignVariables,
+			std::vector<aslam::backend::ErrorTerm*>& inErrorTerms,
+			int numberOfInputDesignVariablesToRemove,
+			bool useMEstimator,
+			boost::shared_ptr<aslam::backend::MarginalizationPriorErrorTerm>& outPriorErrorTermPtr,
+			Eigen::MatrixXd& outCov,
+			std::vector<aslam::backend::DesignVariable*>& outDesignVariablesInRTop,
+			size_t numTopRowsInCov,
+			const MarginalizerOptions& options)
+{
+      const size_t numThreads = options.numThreads;
       sm::timing::Timer t0("aslam::backend::marginalize");
 		  SM_WARN_STREAM_COND(inDesignVariables.size() == 0, "Zero input design variables in the marginalizer!");
 
@@ -95,88 +430,27 @@ void marginalize(
 				dim += (*it)->dimension();
 			}
 
-		  aslam::backend::DenseQrLinearSystemSolver qrSolver;
-      qrSolver.initMatrixStructure(inDesignVariables, inErrorTerms, false);
-
 		  SM_INFO_STREAM("Marginalization optimization problem initialized with " << inDesignVariables.size() << " design variables and " << inErrorTerms.size() << " error terrms");
 		  SM_INFO_STREAM("The Jacobian matrix is " << dim << " x " << columnBase);
 
-		  qrSolver.evaluateError(numThreads, useMEstimator);
-		  qrSolver.buildSystem(numThreads, useMEstimator);
-
-
-		  const Eigen::MatrixXd& jacobian = qrSolver.getJacobian();
-		  const Eigen::VectorXd& b = qrSolver.e();
-
-		  // check dimension of jacobian
-		  int jrows = jacobian.rows();
-		  int jcols = jacobian.cols();
-
-		  int dimOfRemainingDesignVariables = jcols - dimOfDesignVariablesToRemove;
-		  //int dimOfPriorErrorTerm = jrows;
-
-		  sm::timing::Timer t1("Rank Computation");
-		  // check the rank
-		  Eigen::FullPivLU<Eigen::MatrixXd> lu_decomp(jacobian);
-		  //lu_decomp.setThreshold(1e-20);
-		  double threshold = lu_decomp.threshold();
-		  int rank = lu_decomp.rank();
-		  int fullRank = std::min(jacobian.rows(), jacobian.cols());
-		  SM_DEBUG_STREAM("Rank of jacobian: " << rank << " (full rank: " << fullRank << ", threshold: " << threshold << ")");
-		  bool rankDeficient = rank < fullRank;
-		  if(rankDeficient)
-		  {
-			  SM_WARN("Marginalization jacobian is rank deficient!");
-		  }
-		  t1.stop();
-		  //SM_ASSERT_FALSE(aslam::Exception, rankDeficient, "Right now, we don't want the jacobian to be rank deficient - ever...");
-
 		  Eigen::MatrixXd R_reduced;
 		  Eigen::VectorXd d_reduced;
-		  if (jrows < jcols)
+		  bool marginalized = false;
+		  if (options.method == MarginalizerOptions::SPARSE_QR)
 		  {
-			  SM_THROW(aslam::Exception, "underdetermined LSE!");
-			  // underdetermined LSE, don't do QR
-			  R_reduced = jacobian.block(0, dimOfDesignVariablesToRemove, jrows, jcols - dimOfDesignVariablesToRemove);
-			  d_reduced = b;
-
-		  } else {
-			  // PTF: Do we know what will happen when the jacobian matrix is rank deficient?
-			  // MB: yes, bad things!
-
-              // do QR decomposition
-			  sm::timing::Timer myTimer("QR Decomposition");
-        Eigen::HouseholderQR<Eigen::MatrixXd> qr(jacobian);
-			  Eigen::MatrixXd Q = qr.householderQ();
-			  Eigen::MatrixXd R = qr.matrixQR().triangularView<Eigen::Upper>();
-			  Eigen::VectorXd d = Q.transpose()*b;
-			  myTimer.stop();
-
-			  if(numTopRowsInCov > 0)
-			  {
-          sm::timing::Timer myTimer("Covariance computation");
-          Eigen::FullPivLU<Eigen::MatrixXd> lu_decomp(R);
-          Eigen::MatrixXd Rinv = lu_decomp.inverse();
-          Eigen::MatrixXd covariance = Rinv * Rinv.transpose();
-          outCov = covariance.block(0, 0, numTopRowsInCov, numTopRowsInCov);
-          myTimer.stop();
-			  }
-
-//			  size_t numRowsToKeep = rank - dimOfDesignVariablesToRemove;
-//			  SM_ASSERT_TRUE_DBG(aslam::Exception, rankDeficient || (numRowsToKeep == dimOfRemainingDesignVariables), "must be the same if full rank!");
-
-			  // get the top left block
-			  SM_ASSERT_GE(aslam::Exception, static_cast<size_t>(R.rows()), numTopRowsInCov, "Cannot extract " << numTopRowsInCov << " rows of R because it only has " << R.rows() << " rows.");
-			  SM_ASSERT_GE(aslam::Exception, static_cast<size_t>(R.cols()), numTopRowsInCov, "Cannot extract " << numTopRowsInCov << " cols of R because it only has " << R.cols() << " cols.");
-			  //outRtop = R.block(0, 0, numTopRowsInRtop, numTopRowsInRtop);
-
-        // cut off the zero rows at the bottom
-        R_reduced = R.block(dimOfDesignVariablesToRemove, dimOfDesignVariablesToRemove, dimOfRemainingDesignVariables, dimOfRemainingDesignVariables);
-        //R_reduced = R.block(dimOfDesignVariablesToRemove, dimOfDesignVariablesToRemove, numRowsToKeep, dimOfRemainingDesignVariables);
-
-        d_reduced = d.segment(dimOfDesignVariablesToRemove, dimOfRemainingDesignVariables);
-        //d_reduced = d.segment(dimOfDesignVariablesToRemove, numRowsToKeep);
-        //dimOfPriorErrorTerm = dimOfRemainingDesignVariables;
+#ifndef QRSOLVER_DISABLED
+			  marginalized = marginalizeSparse(inDesignVariables, inErrorTerms, dimOfDesignVariablesToRemove, useMEstimator, numTopRowsInCov, numThreads, R_reduced, d_reduced, outCov);
+#else
+			  SM_WARN("The sparse QR decomposition is not available, marginalizing with the dense one.");
+#endif
+		  }
+		  else if (options.method == MarginalizerOptions::SCHUR_COMPLEMENT)
+		  {
+			  marginalized = marginalizeSchurComplement(inDesignVariables, inErrorTerms, numberOfInputDesignVariablesToRemove, dimOfDesignVariablesToRemove, useMEstimator, numTopRowsInCov, numThreads, R_reduced, d_reduced, outCov);
+		  }
+		  if (!marginalized)
+		  {
+			  marginalizeDense(inDesignVariables, inErrorTerms, dimOfDesignVariablesToRemove, useMEstimator, numTopRowsInCov, numThreads, R_reduced, d_reduced, outCov);
 		  }
 
 		  // now create the new error term
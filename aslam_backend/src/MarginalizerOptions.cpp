@@ -0,0 +1,34 @@
+#include "aslam/backend/MarginalizerOptions.h"
+
+namespace aslam {
+  namespace backend {
+
+/******************************************************************************/
+/* Constructors and Destructor                                                */
+/******************************************************************************/
+
+    MarginalizerOptions::MarginalizerOptions() :
+        method(DENSE_QR),
+        numThreads(1) {
+    }
+
+    MarginalizerOptions::MarginalizerOptions(
+        const MarginalizerOptions& other) :
+        method(other.method),
+        numThreads(other.numThreads) {
+    }
+
+    MarginalizerOptions& MarginalizerOptions::operator =
+        (const MarginalizerOptions& other) {
+      if (this != &other) {
+        method = other.method;
+        numThreads = other.numThreads;
+      }
+      return *this;
+    }
+
+    MarginalizerOptions::~MarginalizerOptions() {
+    }
+
+  }
+}
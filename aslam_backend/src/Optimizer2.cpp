@@ -1,6 +1,7 @@
 #include <aslam/backend/Optimizer2.hpp>
 // std::partial_sum
 #include <numeric>
+#include <algorithm>
 #include <aslam/backend/ErrorTerm.hpp>
 // M.inverse()
 #include <Eigen/Dense>
@@ -13,6 +14,7 @@
 #endif
 #include <aslam/backend/sparse_matrix_functions.hpp>
 #include <aslam/backend/BlockCholeskyLinearSystemSolver.hpp>
+#include <aslam/backend/SchurComplementLinearSystemSolver.hpp>
 #include <aslam/backend/SparseCholeskyLinearSystemSolver.hpp>
 #include <aslam/backend/DenseQrLinearSystemSolver.hpp>
 #include <sm/PropertyTree.hpp>
@@ -54,8 +56,12 @@ namespace aslam {
           options.doSchurComplement = config.getBool("doSchurComplement", options.doSchurComplement);
           options.verbose = config.getBool("verbose", options.verbose);
           options.linearSolverMaximumFails = config.getInt("linearSolverMaximumFails", options.linearSolverMaximumFails);
+          options.fuseErrorAndJacobianEvaluation = config.getBool("fuseErrorAndJacobianEvaluation", options.fuseErrorAndJacobianEvaluation);
           options.numThreadsJacobian = getDeprecatedPropertyIfItExists(config, "nThreads", "numThreadsJacobian", (int)options.numThreadsJacobian, static_cast<int(sm::ConstPropertyTree::*)(const std::string&, int) const>(&sm::ConstPropertyTree::getInt));
           options.numThreadsError = config.getInt("numThreadsError", options.numThreadsError);
+          options.useThreadPool = config.getBool("useThreadPool", options.useThreadPool);
+          options.threadPoolChunkSize = config.getInt("threadPoolChunkSize", options.threadPoolChunkSize);
+          options.balanceThreadLoad = config.getBool("balanceThreadLoad", options.balanceThreadLoad);
           options.linearSystemSolver = linearSystemSolver;
           options.trustRegionPolicy = trustRegionPolicy;
           _options = options;
@@ -91,7 +97,10 @@ namespace aslam {
 
         void Optimizer2::initializeLinearSolver()
         {
-          if( ! _options.linearSystemSolver ) {
+          if( ! _options.linearSystemSolver && _options.doSchurComplement ) {
+            _options.verbose && std::cout << "No linear system solver set in the options. Defaulting to the schur_complement solver\n";
+            _solver.reset(new SchurComplementLinearSystemSolver());
+          } else if( ! _options.linearSystemSolver ) {
             _options.verbose && std::cout << "No linear system solver set in the options. Defaulting to the sparse_cholesky solver\n";
             _solver.reset(new SparseCholeskyLinearSystemSolver());
           } else {
@@ -108,6 +117,7 @@ namespace aslam {
             initializeTrustRegionPolicy();
 
             Timer initMx("Optimizer2: Initialize---Matrices");
+            _solver->setThreadedJobOptions(_options.getThreadedJobOptions());
             // Set up the block matrix structure.
             _solver->initMatrixStructure(getDesignVariables(), problemManager().getErrorTerms(), _trustRegionPolicy->requiresAugmentedDiagonal());
             initMx.stop();
@@ -163,7 +173,7 @@ namespace aslam {
 
             // This sets _J
             timeErr.start();
-            evaluateError(true);
+            evaluateStepError();
             timeErr.stop();
             _p_J = _status.error;
             srv.JStart = _p_J;
@@ -180,6 +190,7 @@ namespace aslam {
             SM_ASSERT_TRUE(Exception, _solver.get() != NULL, "The solver is null");
             _trustRegionPolicy->setSolver(_solver);
             _trustRegionPolicy->optimizationStarting(_status.error);
+            _trustRegionPolicy->setTrialCostFunction(boost::bind(&Optimizer2::evaluateTrialStep, this, _1), numConcurrentTrialSteps());
 
             issueCallback<callback::event::OPTIMIZATION_INITIALIZED>();
 
@@ -195,6 +206,9 @@ namespace aslam {
                 SM_ASSERT_EQ(Exception, problemManager().numOptParameters(), size_t(_dx.size()), "_trustRegionPolicy->solveSystem yielded dx with wrong size!");
                 timeSolve.stop();
                 issueCallback<callback::event::LINEAR_SYSTEM_SOLVED>();
+                if (const IterativeSolverStatistics* statistics = _solver->getIterativeSolverStatistics()) {
+                  _callbackManager.issueCallback(callback::event::ITERATIVE_LINEAR_SYSTEM_SOLVED{_status.error, 0, statistics->iterations, statistics->relativeResidual});
+                }
 
                 if (!solutionSuccess) {
                     _options.verbose && std::cout << "[WARNING] System solution failed\n";
@@ -204,12 +218,12 @@ namespace aslam {
                 } else {
                     /// Apply the state update. _A, _b, _dx, and _H are passed in implicitly.
                     timeBackSub.start();
-                    deltaX = applyStateUpdate();
+                    deltaX = applyStateUpdate(_dx);
                     timeBackSub.stop();
                     issueCallback<callback::event::DESIGN_VARIABLES_UPDATED>();
                     // This sets _J
                     timeErr.start();
-                    evaluateError(true);
+                    evaluateStepError();
                     timeErr.stop();
                     deltaJ = _p_J - _status.error;
                     // This was a regression.
@@ -219,6 +233,7 @@ namespace aslam {
                         {
                             _options.verbose && std::cout << "Last step was a regression. Reverting\n";
                             revertLastStateUpdate();
+                            _solver->discardEvaluatedJacobians();
                             srv.failedIterations++;
                             previousIterationFailed = true;
                         }
@@ -240,6 +255,9 @@ namespace aslam {
                     _options.verbose && std::cout << std::endl;
                 }
             } // if the linear solver failed / else
+            // Jacobians evaluated with the last step must not leak into later buildSystem() calls
+            _solver->discardEvaluatedJacobians();
+            _trustRegionPolicy->setTrialCostFunction(TrustRegionPolicy::TrialCostFunction());
             srv.JFinal = _status.error = _p_J;
             srv.dXFinal = deltaX;
             srv.dJFinal = deltaJ;
@@ -272,26 +290,40 @@ namespace aslam {
             }
 
 
-            double Optimizer2::applyStateUpdate()
+            double Optimizer2::applyStateUpdate(const Eigen::VectorXd& dx)
             {
                 // Apply the update to the dense state.
                 int startIdx = 0;
                 for (DesignVariable* d : getDesignVariables()) {
                     const int dbd = d->minimalDimensions();
-                    Eigen::VectorXd dxS = _dx.segment(startIdx, dbd);
+                    Eigen::VectorXd dxS = dx.segment(startIdx, dbd);
                     dxS *= d->scaling();
                     d->update(&dxS[0], dbd);
                     startIdx += dbd;
                 }
                 // Track the maximum delta
                 // \todo: should this be some other metric?
-                double deltaX = _dx.array().abs().maxCoeff();
+                double deltaX = dx.array().abs().maxCoeff();
                 return deltaX;
             }
 
+            size_t Optimizer2::numConcurrentTrialSteps()
+            {
+              // The replicas evaluate the non-squared error terms as well, which Optimizer2 ignores
+              const ProblemManager& pm = problemManager();
+              return pm.numErrorTerms() == pm.getErrorTerms().size() ? std::max<size_t>(1, pm.numReplicas()) : 1;
+            }
 
-
-
+            double Optimizer2::evaluateTrialStep(const Eigen::VectorXd& dx)
+            {
+              if (numConcurrentTrialSteps() > 1)
+                return problemManager().evaluateAtStep(dx.transpose(), nullptr, _options.numThreadsError, 1, false, false, false);
+              SM_ASSERT_TRUE(Exception, _solver.get() != NULL, "The solver is null");
+              applyStateUpdate(dx);
+              const double J = _solver->evaluateError(_options.numThreadsError, true, nullptr);
+              revertLastStateUpdate();
+              return J;
+            }
 
             void Optimizer2::revertLastStateUpdate()
             {
@@ -308,6 +340,16 @@ namespace aslam {
               return _status.error;
             }
 
+            double Optimizer2::evaluateStepError()
+            {
+              if (!_options.fuseErrorAndJacobianEvaluation)
+                return evaluateError(true);
+              SM_ASSERT_TRUE(Exception, _solver.get() != NULL, "The solver is null");
+              _status.error = _solver->evaluateErrorAndJacobians(_options.numThreadsError, true, &_callbackManager);
+              _callbackManager.issueCallback(callback::event::COST_UPDATED{_status.error, _p_J});
+              return _status.error;
+            }
+
 
             /// \brief return the reduced system dx
             const Eigen::VectorXd& Optimizer2::dx() const
@@ -341,8 +383,6 @@ namespace aslam {
 
             void Optimizer2::computeDiagonalCovariances(SparseBlockMatrix& outP, double lambda)
             {
-                SM_THROW(Exception, "Broken");
-
                 std::vector<std::pair<int, int> > blockIndices;
                 for (size_t i = 0; i < getDesignVariables().size(); ++i) {
                     blockIndices.push_back(std::make_pair(i, i));
@@ -350,17 +390,46 @@ namespace aslam {
                 computeCovarianceBlocks(blockIndices, outP, lambda);
             }
 
-    void Optimizer2::computeCovarianceBlocks(const std::vector<std::pair<int, int> > & /* blockIndices */, SparseBlockMatrix& /* outP */, double /* lambda */)
+    void Optimizer2::computeCovarianceBlocks(const std::vector<std::pair<int, int> > & blockIndices, SparseBlockMatrix& outP, double lambda)
             {
-                SM_THROW(Exception, "Broken");
-
+              // Reuse the system and the factorization of the last iteration if the solver can hold the requested conditioner
+              SparseCholeskyLinearSystemSolver* solver = getSolver<SparseCholeskyLinearSystemSolver>(false);
+              boost::shared_ptr<SparseCholeskyLinearSystemSolver> solver_sp;
+              if (solver == nullptr || !solver->isSystemBuilt() || (lambda != 0.0 && !solver->usesDiagonalConditioner())) {
+                solver_sp.reset(new SparseCholeskyLinearSystemSolver());
+                solver_sp->setThreadedJobOptions(_options.getThreadedJobOptions());
+                solver_sp->initMatrixStructure(getDesignVariables(), problemManager().getErrorTerms(), lambda != 0.0);
+                // like the iterations, with the M-estimator and without touching the status of the optimization
+                solver_sp->evaluateError(_options.numThreadsError, true);
+                solver_sp->buildSystem(_options.numThreadsJacobian, true);
+                solver = solver_sp.get();
+              }
+              if (!solver->usesDiagonalConditioner()) {
+                solver->computeCovarianceBlocks(blockIndices, outP, _options.numThreadsJacobian);
+                return;
+              }
+              // the optimizer's solver continues with its own conditioner
+              const Eigen::VectorXd conditioner = solver->getConditioner();
+              solver->setConstantConditioner(lambda);
+              try {
+                solver->computeCovarianceBlocks(blockIndices, outP, _options.numThreadsJacobian);
+              } catch (...) {
+                solver->setConditioner(conditioner);
+                throw;
+              }
+              solver->setConditioner(conditioner);
             }
 
 
-    void Optimizer2::computeCovariances(SparseBlockMatrix& /* outP */, double /* lambda */)
+    void Optimizer2::computeCovariances(SparseBlockMatrix& outP, double lambda)
             {
-                SM_THROW(Exception, "Broken");
-
+                std::vector<std::pair<int, int> > blockIndices;
+                for (size_t i = 0; i < getDesignVariables().size(); ++i) {
+                    for (size_t j = i; j < getDesignVariables().size(); ++j) {
+                        blockIndices.push_back(std::make_pair(i, j));
+                    }
+                }
+                computeCovarianceBlocks(blockIndices, outP, lambda);
             }
 
         void Optimizer2::computeHessian(SparseBlockMatrix& outH, double lambda)
@@ -368,11 +437,12 @@ namespace aslam {
 
               boost::shared_ptr<BlockCholeskyLinearSystemSolver> solver_sp;
               solver_sp.reset(new BlockCholeskyLinearSystemSolver());
+              solver_sp->setThreadedJobOptions(_options.getThreadedJobOptions());
               // True here for creating the diagonal conditioning.
               solver_sp->initMatrixStructure(getDesignVariables(), problemManager().getErrorTerms(), true);
 
               _options.verbose && std::cout << "Setting the diagonal conditioner to: " << lambda << ".\n";
-              evaluateError(false);
+              solver_sp->evaluateError(_options.numThreadsError, false);
               solver_sp->setConstantConditioner(lambda);
               solver_sp->buildSystem(_options.numThreadsJacobian, false);
               solver_sp->copyHessian(outH);
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <iomanip>
+#include <limits>
 #include <aslam/backend/OptimizerBFGS.hpp>
 #include <aslam/backend/ErrorTerm.hpp>
 #include <aslam/backend/ScalarNonSquaredErrorTerm.hpp>
@@ -27,6 +29,8 @@ OptimizerOptionsBFGS::OptimizerOptionsBFGS(const sm::PropertyTree& config)
     : OptimizerOptionsBase(config), linesearch(sm::PropertyTree(config, "linesearch"))
 {
   useDenseJacobianContainer = config.getBool("useDenseJacobianContainer", useDenseJacobianContainer);
+  historySize = config.getInt("historySize", historySize);
+  useDesignVariableScaling = config.getBool("useDesignVariableScaling", useDesignVariableScaling);
   // base options checked by OptimizerOptionsBase
   linesearch.check();
 }
@@ -35,6 +39,7 @@ void OptimizerOptionsBFGS::check() const
 {
   OptimizerOptionsBase::check();
   linesearch.check();
+  SM_ASSERT_GE(Exception, historySize, 0, "historySize must be non-negative (0 = dense BFGS)");
 }
 
 std::ostream& operator<<(std::ostream& out, const aslam::backend::OptimizerOptionsBFGS& options)
@@ -43,7 +48,9 @@ std::ostream& operator<<(std::ostream& out, const aslam::backend::OptimizerOptio
   out << options.linesearch << std::endl;
   out << "OptimizerOptionsBFGS:" << std::endl;
   out << "\tuseDenseJacobianContainer: " << (options.useDenseJacobianContainer ? "TRUE" : "FALSE") << std::endl;
-  out << "\thasRegularizer: " << ((options.regularizer != nullptr) ? "TRUE" : "FALSE");
+  out << "\thasRegularizer: " << ((options.regularizer != nullptr) ? "TRUE" : "FALSE") << std::endl;
+  out << "\thistorySize: " << options.historySize << std::endl;
+  out << "\tuseDesignVariableScaling: " << (options.useDesignVariableScaling ? "TRUE" : "FALSE");
   return out;
 }
 
@@ -73,17 +80,102 @@ OptimizerBFGS::~OptimizerBFGS()
 }
 
 void OptimizerBFGS::resetImplementation() {
-  _Bk.setIdentity(problemManager().numOptParameters(), problemManager().numOptParameters());
+  resetInverseHessian();
   _linesearch.initialize();
 }
 
+void OptimizerBFGS::resetInverseHessian() {
+  const int n = problemManager().numOptParameters();
+  _H0.setOnes(n);
+  if (_options.useDesignVariableScaling) {
+    // The optimization runs in the coordinates x / scaling, in which the gradient is scaled once and the step once more
+    problemManager().applyDesignVariableScaling(_H0);
+    problemManager().applyDesignVariableScaling(_H0);
+  }
+  if (_options.historySize == 0) {
+    _Bk = _H0.asDiagonal();
+    _S.resize(0, 0);
+    _Y.resize(0, 0);
+  } else {
+    _Bk.resize(0, 0);
+    _S.resize(n, _options.historySize);
+    _Y.resize(n, _options.historySize);
+    _rho.resize(_options.historySize);
+    _alpha.resize(_options.historySize);
+  }
+  _newest = -1;
+  _numPairs = 0;
+}
+
+void OptimizerBFGS::computeSearchDirection(const RowVectorType& gradient, RowVectorType& outDirection) {
+  if (_options.historySize == 0) {
+    outDirection.noalias() = -gradient * _Bk; // _Bk is symmetric
+    return;
+  }
+
+  // Two-loop recursion, from the newest to the oldest pair and back
+  const int m = _options.historySize;
+  outDirection = -gradient;
+  for (int k = 0, i = _newest; k < _numPairs; ++k, i = (i + m - 1) % m) {
+    _alpha[i] = _rho[i] * _S.col(i).dot(outDirection);
+    outDirection -= _alpha[i] * _Y.col(i).transpose();
+  }
+  if (_numPairs > 0) {
+    // Scale the initial inverse Hessian to the curvature along the newest step
+    const double gamma = 1.0 / (_rho[_newest] * _Y.col(_newest).cwiseAbs2().dot(_H0));
+    outDirection.array() *= gamma * _H0.array();
+  } else {
+    outDirection.array() *= _H0.array();
+  }
+  for (int k = 0, i = (_newest + m - _numPairs + 1) % m; k < _numPairs; ++k, i = (i + 1) % m) {
+    const double beta = _rho[i] * _Y.col(i).dot(outDirection);
+    outDirection += (_alpha[i] - beta) * _S.col(i).transpose();
+  }
+}
+
+void OptimizerBFGS::updateInverseHessian(const RowVectorType& sk, const RowVectorType& yk) {
+  const double yksk = yk.dot(sk);
+
+  if (_options.historySize == 0) {
+    double rhok = 1./yksk;
+    if (std::isinf(rhok)) {
+      rhok = 1000.0;
+      SM_WARN("Divide-by-zero encountered: rhok assumed large");
+    }
+    // Sherman-Morrison formula _Bk = A * _Bk * A^T + rhok * sk^T * sk with A = I - rhok * sk^T * yk, expanded
+    // to rank-one updates to avoid the dense n x n temporaries
+    const Eigen::VectorXd Bkyk = _Bk * yk.transpose();
+    const double ykBkyk = yk.dot(Bkyk);
+    _Bk.noalias() -= (rhok * sk.transpose()) * Bkyk.transpose();
+    _Bk.noalias() -= Bkyk * (rhok * sk);
+    _Bk.noalias() += ((rhok * rhok * ykBkyk + rhok) * sk.transpose()) * sk;
+    return;
+  }
+
+  // Skip pairs without positive curvature, they would make the approximation indefinite
+  if (!(yksk > std::numeric_limits<double>::epsilon() * sk.norm() * yk.norm())) {
+    SM_DEBUG_STREAM_NAMED("optimization", "OptimizerBFGS: Skipping L-BFGS update with curvature " << yksk);
+    return;
+  }
+  const int m = _options.historySize;
+  _newest = (_newest + 1) % m;
+  _numPairs = std::min(_numPairs + 1, m);
+  _S.col(_newest) = sk.transpose();
+  _Y.col(_newest) = yk.transpose();
+  _rho[_newest] = 1./yksk;
+}
+
 void OptimizerBFGS::optimizeImplementation()
 {
   Timer timeUpdateHessian("OptimizerBFGS: Update---Hessian", true);
 
   using namespace Eigen;
 
-  const MatrixXd I = MatrixXd::Identity(problemManager().numOptParameters(), problemManager().numOptParameters());
+  // The options may have been changed since the last reset
+  const int n = problemManager().numOptParameters();
+  if (_options.historySize == 0 ? _Bk.rows() != n : (_S.cols() != _options.historySize || _S.rows() != n))
+    resetInverseHessian();
+
   RowVectorType gfk, gfkp1;
   gfk = _linesearch.getGradient();
   _status.gradientNorm = gfk.norm();
@@ -104,19 +196,19 @@ void OptimizerBFGS::optimizeImplementation()
       // compute search direction
       // Note: this could fail due to numerical issues making the inverse Hessian approximation negative definite
       // and resulting in an ascent direction where the eigenvalues become negative. We rely on the line search to detect
-      // that here, and reset the inverse Hessian to the identity matrix. This will be done only once, if it fails the exception
+      // that here, and reset the inverse Hessian to its initial diagonal. This will be done only once, if it fails the exception
       // is re-thrown. Instead of resetting to identity we could of course do something smarter.
       RowVectorType pk;
       for(std::size_t j=0; j<2; ++j) {
         try {
-          pk = -_Bk*gfk.transpose();
+          computeSearchDirection(gfk, pk);
           _linesearch.setSearchDirection(pk);
           break;
         } catch (const std::exception& e) {
           if (j == 0) {
-            SM_WARN("Inverse Hessian approximation became negative, resetting to identity matrix. "
+            SM_WARN("Inverse Hessian approximation became negative, resetting to its initial diagonal. "
                 "Check your problem setup anyways and potentially re-scale your parameters.");
-            _Bk = I;
+            resetInverseHessian();
           } else {
             throw;
           }
@@ -147,19 +239,10 @@ void OptimizerBFGS::optimizeImplementation()
       // Update Hessian
       timeUpdateHessian.start();
 
-      RowVectorType sk = alpha_k * pk;
-      RowVectorType yk = gfkp1 - gfk;
+      const RowVectorType sk = alpha_k * pk;
+      const RowVectorType yk = gfkp1 - gfk;
       gfk = gfkp1;
-
-      double rhok = 1./(yk*sk.transpose());
-      if (std::isinf(rhok)) {
-        rhok = 1000.0;
-        SM_WARN("Divide-by-zero encountered: rhok assumed large");
-      }
-
-      MatrixXd C = sk.transpose() * yk * rhok;
-      MatrixXd A = I - C;
-      _Bk = A * (_Bk * A.transpose()) + (rhok * sk.transpose() * sk); // Sherman-Morrison formula
+      updateInverseHessian(sk, yk);
 
       timeUpdateHessian.stop();
 
@@ -30,6 +30,9 @@ OptimizerOptionsBase::OptimizerOptionsBase(const sm::PropertyTree& config) {
   maxIterations = config.getInt("maxIterations", maxIterations);
   numThreadsJacobian = config.getInt("numThreadsJacobian", numThreadsJacobian);
   numThreadsError = config.getInt("numThreadsError", numThreadsError);
+  useThreadPool = config.getBool("useThreadPool", useThreadPool);
+  threadPoolChunkSize = config.getInt("threadPoolChunkSize", threadPoolChunkSize);
+  balanceThreadLoad = config.getBool("balanceThreadLoad", balanceThreadLoad);
 
   this->check();
 }
@@ -43,6 +46,15 @@ void OptimizerOptionsBase::check() const
   SM_ASSERT_GE( Exception, maxIterations, -1, "");
 }
 
+util::ThreadedJobOptions OptimizerOptionsBase::getThreadedJobOptions() const
+{
+  util::ThreadedJobOptions options;
+  options.useThreadPool = useThreadPool;
+  options.chunkSize = threadPoolChunkSize;
+  options.balanceLoad = balanceThreadLoad;
+  return options;
+}
+
 std::ostream& operator<<(std::ostream& out, const aslam::backend::OptimizerOptionsBase& options)
 {
   out << "OptimizerOptions:" << std::endl;
@@ -51,7 +63,10 @@ std::ostream& operator<<(std::ostream& out, const aslam::backend::OptimizerOptio
   out << "\tconvergenceDeltaError: " << options.convergenceDeltaError << std::endl;
   out << "\tmaxIterations: " << options.maxIterations << std::endl;
   out << "\tnumThreadsJacobian: " << options.numThreadsJacobian << std::endl;
-  out << "\tnumThreadsError: " << options.numThreadsError;
+  out << "\tnumThreadsError: " << options.numThreadsError << std::endl;
+  out << "\tuseThreadPool: " << options.useThreadPool << std::endl;
+  out << "\tthreadPoolChunkSize: " << options.threadPoolChunkSize << std::endl;
+  out << "\tbalanceThreadLoad: " << options.balanceThreadLoad;
   return out;
 }
 
@@ -1,6 +1,7 @@
 #include <aslam/backend/OptimizerRprop.hpp>
 #include <aslam/backend/ErrorTerm.hpp>
 #include <aslam/backend/ScalarNonSquaredErrorTerm.hpp>
+#include <aslam/backend/JacobianContainerDense.hpp>
 #include <Eigen/Dense>
 #include <sm/eigen/assert_macros.hpp>
 #include <aslam/backend/sparse_matrix_functions.hpp>
@@ -95,11 +96,72 @@ OptimizerRprop::~OptimizerRprop()
 
 void OptimizerRprop::resetImplementation() {
   _dx = ColumnVectorType::Constant(problemManager().numOptParameters(), 0.0);
+  _gradient = RowVectorType::Constant(problemManager().numOptParameters(), 0.0);
   _prev_gradient = ColumnVectorType::Constant(problemManager().numOptParameters(), 0.0);
   _prev_error = std::numeric_limits<double>::max();
   _delta = ColumnVectorType::Constant(problemManager().numOptParameters(), _options.initialDelta);
 }
 
+template <OptimizerOptionsRprop::Method METHOD>
+double OptimizerRprop::computeStep(const bool errorIncreased)
+{
+  // Note: see http://citeseerx.ist.psu.edu/viewdoc/summary?doi=10.1.1.17.1332
+  // for a good description of the algorithms.
+  // The method is a template parameter and the loop body is free of branches on it, so the compiler can vectorize
+  // the loop over the raw buffers.
+  const std::size_t n = _gradient.size();
+  const double* gradient = _gradient.data();
+  double* prevGradient = _prev_gradient.data();
+  double* delta = _delta.data();
+  double* dx = _dx.data();
+  const double etaPlus = _options.etaPlus;
+  const double etaMinus = _options.etaMinus;
+  const double maxDelta = _options.maxDelta;
+  const double minDelta = _options.minDelta;
+
+  double maxAbsDx = 0.0;
+  for (std::size_t d = 0; d < n; ++d) {
+
+    // determine whether gradient direction switched and adapt delta
+    const double g = gradient[d];
+    const double gg = prevGradient[d] * g;
+    const bool switchYes = gg < 0.0;
+    delta[d] = gg > 0.0 ? std::min(delta[d] * etaPlus, maxDelta) : (switchYes ? std::max(delta[d] * etaMinus, minDelta) : delta[d]);
+    const double step = -sign(g) * delta[d];
+
+    switch (METHOD) {
+      // RPROP_PLUS
+      // With backtracking. If gradient switched direction, revert this update.
+      case OptimizerOptionsRprop::RPROP_PLUS:
+        dx[d] = switchYes ? -dx[d] : step;
+        break;
+      // RPROP_MINUS
+      // No backtracking. Reduce step-length if gradient switched direction,
+      // Increase step-length if gradient in same direction.
+      case OptimizerOptionsRprop::RPROP_MINUS:
+        dx[d] = step;
+        break;
+      // IRPROP_MINUS
+      // In case gradient direction switched, stay at this point for one iteration and
+      // then move into the direction of the gradient with half the step-length.
+      case OptimizerOptionsRprop::IRPROP_MINUS:
+        dx[d] = switchYes ? 0.0 : step;
+        break;
+      // IRPROP_PLUS
+      // Revert only weight updates that have caused changes of the corresponding
+      // partial derivatives in case of an error increase.
+      case OptimizerOptionsRprop::IRPROP_PLUS:
+        dx[d] = switchYes ? (errorIncreased ? -dx[d] : 0.0) : step;
+        break;
+    }
+
+    // All methods but RPROP_MINUS forget a switched gradient, this forces switchYes=false in the next step
+    prevGradient[d] = (METHOD != OptimizerOptionsRprop::RPROP_MINUS && switchYes) ? 0.0 : g;
+    maxAbsDx = std::max(maxAbsDx, std::fabs(dx[d]));
+  }
+  return maxAbsDx;
+}
+
 void OptimizerRprop::optimizeImplementation()
 {
   Timer timeGrad("OptimizerRprop: Compute---Gradient", true);
@@ -117,24 +179,21 @@ void OptimizerRprop::optimizeImplementation()
 
     _status.convergence = ConvergenceStatus::IN_PROGRESS;
 
-    RowVectorType gradient;
     timeGrad.start();
-    problemManager().computeGradient(gradient, _options.numThreadsJacobian, false /*useMEstimator*/, false /*use scaling */, _options.useDenseJacobianContainer /*useDenseJacobianContainer*/);
+    problemManager().computeGradient(_gradient, _options.numThreadsJacobian, false /*useMEstimator*/, false /*use scaling */, _options.useDenseJacobianContainer /*useDenseJacobianContainer*/);
 
-    // optionally add regularizer
+    // optionally add regularizer, its Jacobian is accumulated into the gradient in place
     if (_options.regularizer) {
-      JacobianContainerSparse<1> jc(1);
+      JacobianContainerDense<RowVectorType&, 1> jc(_gradient);
       _options.regularizer->evaluateJacobians(jc);
-      SM_FINER_STREAM_NAMED("optimization", "RPROP: Regularization term gradient: " << jc.asDenseMatrix());
-      gradient += jc.asDenseMatrix();
     }
     _status.numJacobianEvaluations++;
     timeGrad.stop();
 
-    SM_ASSERT_TRUE_DBG(Exception, gradient.allFinite (), "Gradient " << gradient.format(IOFormat(2, DontAlignCols, ", ", ", ", "", "", "[", "]")) << " is not finite");
+    SM_ASSERT_TRUE_DBG(Exception, _gradient.allFinite (), "Gradient " << _gradient.format(IOFormat(2, DontAlignCols, ", ", ", ", "", "", "[", "]")) << " is not finite");
 
     timeStep.start();
-    _status.gradientNorm = gradient.norm();
+    _status.gradientNorm = _gradient.norm();
 
     if (_status.gradientNorm < _options.convergenceGradientNorm) {
       _status.convergence = ConvergenceStatus::GRADIENT_NORM;
@@ -152,83 +211,20 @@ void OptimizerRprop::optimizeImplementation()
       _prev_error = _status.error;
     }
 
-    // determine whether gradient direction switched
-    Eigen::Matrix<double, 1, Eigen::Dynamic> gg = _prev_gradient.cwiseProduct(gradient);
-    Eigen::Matrix<bool, 1, Eigen::Dynamic> switchNo = gg.array() > 0.0;
-    Eigen::Matrix<bool, 1, Eigen::Dynamic> switchYes = gg.array() < 0.0;
-    _prev_gradient = gradient;
-
-    for (std::size_t d = 0; d < problemManager().numOptParameters(); ++d) {
-
-      // Adapt delta
-      if (switchNo(d))
-        _delta(d) = std::min(_delta(d) * _options.etaPlus, _options.maxDelta);
-      else if (switchYes(d))
-        _delta(d) = std::max(_delta(d) * _options.etaMinus, _options.minDelta);
-
-      // Note: see http://citeseerx.ist.psu.edu/viewdoc/summary?doi=10.1.1.17.1332
-      // for a good description of the algorithms
-      switch (_options.method) {
-
-        // RPROP_PLUS
-        // With backtracking. If gradient switched direction, revert this update.
-        case OptimizerOptionsRprop::RPROP_PLUS:
-        {
-          // Compute design variable update vector
-          if (switchYes(d)) {
-            _dx(d) = -_dx(d); // revert update
-            _prev_gradient(d) = 0.0; // this forces switchYes=false in the next step
-          } else {
-            _dx(d) = -sign(gradient(d))*_delta(d);
-          }
-
-          break;
-        }
-
-        // RPROP_MINUS
-        // No backtracking. Reduce step-length if gradient switched direction,
-        // Increase step-length if gradient in same direction.
-        case OptimizerOptionsRprop::RPROP_MINUS:
-        {
-          // Compute design variable update vector
-          _dx(d) = -sign(gradient(d))*_delta(d);
-
-          break;
-        }
-        // IRPROP_MINUS
-        // In case gradient direction switched, stay at this point for one iteration and
-        // then move into the direction of the gradient with half the step-length.
-        case OptimizerOptionsRprop::IRPROP_MINUS:
-        {
-          // Compute design variable update vector
-          if (switchYes(d))
-            _dx(d) = _prev_gradient(d) = 0.0;
-          else
-            _dx(d) = -sign(gradient(d))*_delta(d);
-
-          break;
-        }
-        // IRPROP_PLUS
-        // Revert only weight updates that have caused changes of the corresponding
-        // partial derivatives in case of an error increase.
-        case OptimizerOptionsRprop::IRPROP_PLUS:
-        {
-
-          // Compute design variable update vector
-          if (switchYes(d)) {
-            if (errorIncreased)
-              _dx(d) = -_dx(d); // revert update if gradient direction switched and error increased
-            else
-              _dx(d) = 0.0;
-            _prev_gradient(d) = 0.0; // this forces switchYes=false in the next step
-          } else {
-            _dx(d) = -sign(gradient(d))*_delta(d);
-          }
-
-          break;
-        }
-      }
-
+    double maxDeltaX = 0.0;
+    switch (_options.method) {
+      case OptimizerOptionsRprop::RPROP_PLUS:
+        maxDeltaX = computeStep<OptimizerOptionsRprop::RPROP_PLUS>(errorIncreased);
+        break;
+      case OptimizerOptionsRprop::RPROP_MINUS:
+        maxDeltaX = computeStep<OptimizerOptionsRprop::RPROP_MINUS>(errorIncreased);
+        break;
+      case OptimizerOptionsRprop::IRPROP_MINUS:
+        maxDeltaX = computeStep<OptimizerOptionsRprop::IRPROP_MINUS>(errorIncreased);
+        break;
+      case OptimizerOptionsRprop::IRPROP_PLUS:
+        maxDeltaX = computeStep<OptimizerOptionsRprop::IRPROP_PLUS>(errorIncreased);
+        break;
     }
 
     timeStep.stop();
@@ -239,7 +235,7 @@ void OptimizerRprop::optimizeImplementation()
     timeUpdate.stop();
     _callbackManager.issueCallback( callback::event::DESIGN_VARIABLES_UPDATED{} );
 
-    _status.maxDeltaX = _dx.cwiseAbs().maxCoeff();
+    _status.maxDeltaX = maxDeltaX;
     if (_status.maxDeltaX < _options.convergenceDeltaX) {
       _status.convergence = ConvergenceStatus::DX;
       SM_DEBUG_STREAM_NAMED("optimization", "RPROP: Maximum dx coefficient " << _status.maxDeltaX <<
@@ -258,7 +254,7 @@ void OptimizerRprop::optimizeImplementation()
     }
 
     SM_FINE_STREAM_NAMED("optimization", _status << std::endl <<
-                         "\tgradient: " << gradient << std::endl <<
+                         "\tgradient: " << _gradient << std::endl <<
                          "\tdx: " << _dx.transpose() << std::endl <<
                          "\tdelta: " << _delta.transpose());
 
@@ -0,0 +1,37 @@
+#include "aslam/backend/PcgLinearSolverOptions.h"
+
+namespace aslam {
+  namespace backend {
+
+/******************************************************************************/
+/* Constructors and Destructor                                                */
+/******************************************************************************/
+
+    PcgLinearSolverOptions::PcgLinearSolverOptions() :
+        preconditioner(BLOCK_JACOBI),
+        tolerance(1e-6),
+        maxIterations(0) {
+    }
+
+    PcgLinearSolverOptions::PcgLinearSolverOptions(
+        const PcgLinearSolverOptions& other) :
+        preconditioner(other.preconditioner),
+        tolerance(other.tolerance),
+        maxIterations(other.maxIterations) {
+    }
+
+    PcgLinearSolverOptions& PcgLinearSolverOptions::operator =
+        (const PcgLinearSolverOptions& other) {
+      if (this != &other) {
+        preconditioner = other.preconditioner;
+        tolerance = other.tolerance;
+        maxIterations = other.maxIterations;
+      }
+      return *this;
+    }
+
+    PcgLinearSolverOptions::~PcgLinearSolverOptions() {
+    }
+
+  }
+}
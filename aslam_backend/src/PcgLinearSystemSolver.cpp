@@ -0,0 +1,443 @@
+#include <algorithm>
+
+#include <aslam/backend/PcgLinearSystemSolver.hpp>
+#include <aslam/backend/ErrorTerm.hpp>
+#include <sm/PropertyTree.hpp>
+#include <boost/bind.hpp>
+#include <Eigen/Cholesky>
+#include <Eigen/Eigenvalues>
+
+namespace aslam {
+  namespace backend {
+
+    PcgLinearSystemSolver::PcgLinearSystemSolver(const PcgLinearSolverOptions& options) :
+        _useSchurJacobi(false),
+        _nThreads(1),
+        _forcingTolerance(0.0),
+        _options(options) {
+    }
+
+    PcgLinearSystemSolver::PcgLinearSystemSolver(const sm::PropertyTree& config) :
+        _useSchurJacobi(false),
+        _nThreads(1),
+        _forcingTolerance(0.0) {
+      const std::string preconditioner = config.getString("preconditioner", "block_jacobi");
+      if (preconditioner == "none") {
+        _options.preconditioner = PcgLinearSolverOptions::NONE;
+      } else if (preconditioner == "schur_jacobi") {
+        _options.preconditioner = PcgLinearSolverOptions::SCHUR_JACOBI;
+      } else if (preconditioner == "block_jacobi") {
+        _options.preconditioner = PcgLinearSolverOptions::BLOCK_JACOBI;
+      } else {
+        std::cout << "Unknown preconditioner " << preconditioner << ". Try \"none\", \"block_jacobi\" or \"schur_jacobi\"\nDefaulting to block_jacobi.\n";
+        _options.preconditioner = PcgLinearSolverOptions::BLOCK_JACOBI;
+      }
+      _options.tolerance = config.getDouble("tolerance", _options.tolerance);
+      _options.maxIterations = config.getInt("maxIterations", _options.maxIterations);
+    }
+
+    PcgLinearSystemSolver::~PcgLinearSystemSolver()
+    {
+    }
+
+    void PcgLinearSystemSolver::initMatrixStructureImplementation(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors, bool useDiagonalConditioner)
+    {
+      _errorTerms = errors;
+      _useDiagonalConditioner = useDiagonalConditioner;
+      _jacobianBuilder.updateMatrixStructure(dvs, errors);
+
+      _blockDimension.resize(dvs.size());
+      _blockColumnBase.resize(dvs.size());
+      for (size_t i = 0; i < dvs.size(); ++i) {
+        _blockDimension[i] = dvs[i]->minimalDimensions();
+        _blockColumnBase[i] = dvs[i]->columnBase();
+      }
+      initColumnGroups();
+
+      _diagonalBlocks.resize(dvs.size());
+      _inverseBlocks.resize(dvs.size());
+      _useSchurJacobi = false;
+      _marginalized.clear();
+      _marginalizedBlocks.clear();
+      _keptBlocks.clear();
+      _blockCouplings.clear();
+      if (_options.preconditioner == PcgLinearSolverOptions::SCHUR_JACOBI) {
+        for (size_t i = 0; i < dvs.size(); ++i)
+          (dvs[i]->isMarginalized() ? _marginalizedBlocks : _keptBlocks).push_back(i);
+        _useSchurJacobi = !_marginalizedBlocks.empty();
+        if (_useSchurJacobi)
+          initSchurJacobiStructure();
+      }
+    }
+
+    void PcgLinearSystemSolver::initColumnGroups()
+    {
+      const CompressedColumnMatrix<int>& J_transpose = _jacobianBuilder.J_transpose();
+      const int* colPtr = J_transpose.col_ptr().data();
+      const int* rowInd = J_transpose.row_ind().data();
+      const int numColumns = J_transpose.cols();
+
+      // The block of every row of J^T
+      std::vector<int> rowBlock(J_transpose.rows(), -1);
+      for (size_t b = 0; b < _blockDimension.size(); ++b)
+        std::fill(rowBlock.begin() + _blockColumnBase[b], rowBlock.begin() + _blockColumnBase[b] + _blockDimension[b], b);
+
+      _columnGroups.clear();
+      _segments.clear();
+      for (int c = 0; c < numColumns; ) {
+        const int stride = colPtr[c + 1] - colPtr[c];
+        // Consecutive columns with the same rows share the segments, usually these are the columns of an error term
+        int end = c + 1;
+        while (end < numColumns && colPtr[end + 1] - colPtr[end] == stride &&
+               std::equal(rowInd + colPtr[c], rowInd + colPtr[c + 1], rowInd + colPtr[end]))
+          ++end;
+        if (stride > 0) {
+          ColumnGroup group;
+          group.firstColumn = c;
+          group.numColumns = end - c;
+          group.valuePtr = colPtr[c];
+          group.stride = stride;
+          group.segmentBegin = _segments.size();
+          for (int k = 0; k < stride; ) {
+            Segment segment;
+            segment.block = rowBlock[rowInd[colPtr[c] + k]];
+            segment.offset = k;
+            SM_ASSERT_GE_DBG(Exception, segment.block, 0, "Row " << rowInd[colPtr[c] + k] << " of the Jacobian transpose does not belong to a design variable");
+            SM_ASSERT_EQ_DBG(Exception, rowInd[colPtr[c] + k], _blockColumnBase[segment.block], "The rows of a design variable are expected to be contiguous");
+            _segments.push_back(segment);
+            k += _blockDimension[segment.block];
+          }
+          group.segmentEnd = _segments.size();
+          _columnGroups.push_back(group);
+        }
+        c = end;
+      }
+
+      _blockSegments.clear();
+      _blockSegments.resize(_blockDimension.size());
+      std::vector<double> groupCosts(_columnGroups.size()), blockCosts(_blockDimension.size(), 1.0);
+      for (size_t g = 0; g < _columnGroups.size(); ++g) {
+        const ColumnGroup& group = _columnGroups[g];
+        groupCosts[g] = group.numColumns * group.stride;
+        for (int s = group.segmentBegin; s < group.segmentEnd; ++s) {
+          _blockSegments[_segments[s].block].push_back(std::make_pair(g, s));
+          blockCosts[_segments[s].block] += group.numColumns * _blockDimension[_segments[s].block];
+        }
+      }
+      _columnGroupLoadBalancer.init(groupCosts);
+      _blockLoadBalancer.init(blockCosts);
+    }
+
+    void PcgLinearSystemSolver::initSchurJacobiStructure()
+    {
+      std::vector<int> marginalizedIndex(_blockDimension.size(), -1);
+      _marginalized.resize(_marginalizedBlocks.size());
+      for (size_t k = 0; k < _marginalizedBlocks.size(); ++k) {
+        marginalizedIndex[_marginalizedBlocks[k]] = k;
+        _marginalized[k].block = _marginalizedBlocks[k];
+      }
+      for (const ColumnGroup& group : _columnGroups) {
+        int marginalizedBlock = -1;
+        for (int s = group.segmentBegin; s < group.segmentEnd; ++s) {
+          const int b = _segments[s].block;
+          if (marginalizedIndex[b] >= 0 && b != marginalizedBlock) {
+            SM_ASSERT_LT(Exception, marginalizedBlock, 0, "An error term couples the marginalized blocks " << marginalizedBlock << " and " << b
+                         << ". The marginalized design variables must be independent of each other for the SCHUR_JACOBI preconditioner.");
+            marginalizedBlock = b;
+          }
+        }
+        if (marginalizedBlock < 0)
+          continue;
+        std::vector<int>& coupledBlocks = _marginalized[marginalizedIndex[marginalizedBlock]].coupledBlocks;
+        for (int s = group.segmentBegin; s < group.segmentEnd; ++s) {
+          if (_segments[s].block != marginalizedBlock)
+            coupledBlocks.push_back(_segments[s].block);
+        }
+      }
+      _blockCouplings.resize(_blockDimension.size());
+      for (size_t k = 0; k < _marginalized.size(); ++k) {
+        std::vector<int>& coupledBlocks = _marginalized[k].coupledBlocks;
+        std::sort(coupledBlocks.begin(), coupledBlocks.end());
+        coupledBlocks.erase(std::unique(coupledBlocks.begin(), coupledBlocks.end()), coupledBlocks.end());
+        _marginalized[k].couplings.resize(coupledBlocks.size());
+        for (size_t p = 0; p < coupledBlocks.size(); ++p)
+          _blockCouplings[coupledBlocks[p]].push_back(std::make_pair(k, p));
+      }
+    }
+
+    void PcgLinearSystemSolver::buildSystem(size_t nThreads, bool useMEstimator)
+    {
+      _nThreads = std::max<size_t>(1, nThreads);
+      _jacobianBuilder.buildSystem(_nThreads, useMEstimator, _threadedJobOptions);
+      multiplyJacobianTranspose(_e, _rhs);
+
+      // The parts of the preconditioner that do not depend on the conditioner
+      if (_options.preconditioner != PcgLinearSolverOptions::NONE) {
+        util::runThreadedJob(boost::bind(&PcgLinearSystemSolver::computeDiagonalBlocks, this, _1, _2, _3), _blockDimension.size(), _nThreads, _threadedJobOptions);
+        if (_useSchurJacobi)
+          util::runThreadedJob(boost::bind(&PcgLinearSystemSolver::computeCouplings, this, _1, _2, _3), _marginalized.size(), _nThreads, _threadedJobOptions);
+      }
+    }
+
+    PcgLinearSystemSolver::ConstJacobianMap PcgLinearSystemSolver::jacobianBlock(const ColumnGroup& group, const Segment& segment) const
+    {
+      const double* values = _jacobianBuilder.J_transpose().values().data();
+      return ConstJacobianMap(values + group.valuePtr + segment.offset, _blockDimension[segment.block], group.numColumns, Eigen::OuterStride<>(group.stride));
+    }
+
+    void PcgLinearSystemSolver::multiplyJacobian(const Eigen::VectorXd& x, Eigen::VectorXd& outY)
+    {
+      // Columns of J^T without segments belong to constant error terms
+      outY.setZero(_jacobianBuilder.J_transpose().cols());
+      util::runThreadedJob(boost::bind(&PcgLinearSystemSolver::multiplyJacobianRange, this, _1, _2, _3, &x, &outY), _columnGroupLoadBalancer, _nThreads, _threadedJobOptions);
+    }
+
+    void PcgLinearSystemSolver::multiplyJacobianRange(size_t /* threadId */, size_t startIdx, size_t endIdx, const Eigen::VectorXd* x, Eigen::VectorXd* outY) const
+    {
+      for (size_t g = startIdx; g < endIdx; ++g) {
+        const ColumnGroup& group = _columnGroups[g];
+        Eigen::VectorXd::SegmentReturnType y = outY->segment(group.firstColumn, group.numColumns);
+        for (int s = group.segmentBegin; s < group.segmentEnd; ++s)
+          y.noalias() += jacobianBlock(group, _segments[s]).transpose() * blockSegment(*x, _segments[s].block);
+      }
+    }
+
+    void PcgLinearSystemSolver::multiplyJacobianTranspose(const Eigen::VectorXd& x, Eigen::VectorXd& outY)
+    {
+      outY.resize(_jacobianBuilder.J_transpose().rows());
+      util::runThreadedJob(boost::bind(&PcgLinearSystemSolver::multiplyJacobianTransposeRange, this, _1, _2, _3, &x, &outY), _blockLoadBalancer, _nThreads, _threadedJobOptions);
+    }
+
+    void PcgLinearSystemSolver::multiplyJacobianTransposeRange(size_t /* threadId */, size_t startIdx, size_t endIdx, const Eigen::VectorXd* x, Eigen::VectorXd* outY) const
+    {
+      // Every block is written by exactly one thread, which makes the result independent of the number of threads
+      for (size_t b = startIdx; b < endIdx; ++b) {
+        Eigen::VectorXd::SegmentReturnType y = blockSegment(*outY, b);
+        y.setZero();
+        for (const std::pair<int, int>& entry : _blockSegments[b]) {
+          const ColumnGroup& group = _columnGroups[entry.first];
+          y.noalias() += jacobianBlock(group, _segments[entry.second]) * x->segment(group.firstColumn, group.numColumns);
+        }
+      }
+    }
+
+    void PcgLinearSystemSolver::multiplyHessian(const Eigen::VectorXd& x, Eigen::VectorXd& outY)
+    {
+      multiplyJacobian(x, _Jx);
+      multiplyJacobianTranspose(_Jx, outY);
+      if (_useDiagonalConditioner)
+        outY.array() += _diagonalConditioner.array().square() * x.array();
+    }
+
+    double PcgLinearSystemSolver::rhsJtJrhs()
+    {
+      multiplyJacobian(_rhs, _Jx);
+      return _Jx.squaredNorm();
+    }
+
+    void PcgLinearSystemSolver::computeDiagonalBlocks(size_t /* threadId */, size_t startIdx, size_t endIdx)
+    {
+      for (size_t b = startIdx; b < endIdx; ++b) {
+        Eigen::MatrixXd& D = _diagonalBlocks[b];
+        D.setZero(_blockDimension[b], _blockDimension[b]);
+        for (const std::pair<int, int>& entry : _blockSegments[b]) {
+          const ColumnGroup& group = _columnGroups[entry.first];
+          // A design variable might appear more than once in an error term
+          for (int s = group.segmentBegin; s < group.segmentEnd; ++s) {
+            if (_segments[s].block == static_cast<int>(b))
+              D.noalias() += jacobianBlock(group, _segments[entry.second]) * jacobianBlock(group, _segments[s]).transpose();
+          }
+        }
+      }
+    }
+
+    void PcgLinearSystemSolver::computeCouplings(size_t /* threadId */, size_t startIdx, size_t endIdx)
+    {
+      for (size_t k = startIdx; k < endIdx; ++k) {
+        MarginalizedBlock& marginalized = _marginalized[k];
+        const int m = marginalized.block;
+        for (size_t p = 0; p < marginalized.coupledBlocks.size(); ++p)
+          marginalized.couplings[p].setZero(_blockDimension[marginalized.coupledBlocks[p]], _blockDimension[m]);
+        for (const std::pair<int, int>& entry : _blockSegments[m]) {
+          const ColumnGroup& group = _columnGroups[entry.first];
+          const ConstJacobianMap Jm = jacobianBlock(group, _segments[entry.second]);
+          for (int s = group.segmentBegin; s < group.segmentEnd; ++s) {
+            const int c = _segments[s].block;
+            if (c == m)
+              continue;
+            const size_t p = std::lower_bound(marginalized.coupledBlocks.begin(), marginalized.coupledBlocks.end(), c) - marginalized.coupledBlocks.begin();
+            marginalized.couplings[p].noalias() += jacobianBlock(group, _segments[s]) * Jm.transpose();
+          }
+        }
+      }
+    }
+
+    void PcgLinearSystemSolver::computeSchurBlocks(size_t /* threadId */, size_t startIdx, size_t endIdx)
+    {
+      for (size_t j = startIdx; j < endIdx; ++j) {
+        const int c = _keptBlocks[j];
+        Eigen::MatrixXd S = _diagonalBlocks[c];
+        if (_useDiagonalConditioner)
+          S.diagonal() += blockSegment(_diagonalConditioner, c).cwiseAbs2();
+        for (const std::pair<size_t, size_t>& entry : _blockCouplings[c]) {
+          const MarginalizedBlock& marginalized = _marginalized[entry.first];
+          const Eigen::MatrixXd& C = marginalized.couplings[entry.second];
+          S.noalias() -= C * _inverseBlocks[marginalized.block] * C.transpose();
+        }
+        invertBlock(S, _inverseBlocks[c]);
+      }
+    }
+
+    void PcgLinearSystemSolver::invertBlock(const Eigen::MatrixXd& block, Eigen::MatrixXd& outInverse)
+    {
+      Eigen::LLT<Eigen::MatrixXd> llt(block);
+      if (llt.info() == Eigen::Success) {
+        outInverse = llt.solve(Eigen::MatrixXd::Identity(block.rows(), block.cols()));
+        return;
+      }
+      // A rank deficient block, e.g. of a design variable without error terms. Any positive definite approximation is a valid preconditioner.
+      Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigenSolver(block);
+      const double minEigenvalue = std::max(eigenSolver.eigenvalues().cwiseAbs().maxCoeff() * 1e-12, 1e-12);
+      const Eigen::VectorXd inverseEigenvalues = eigenSolver.eigenvalues().cwiseMax(minEigenvalue).cwiseInverse();
+      outInverse.noalias() = eigenSolver.eigenvectors() * inverseEigenvalues.asDiagonal() * eigenSolver.eigenvectors().transpose();
+    }
+
+    void PcgLinearSystemSolver::computePreconditioner()
+    {
+      if (_options.preconditioner == PcgLinearSolverOptions::NONE)
+        return;
+      const std::vector<int>* blocks = _useSchurJacobi ? &_marginalizedBlocks : NULL;
+      const size_t numBlocks = blocks ? blocks->size() : _blockDimension.size();
+      util::runThreadedJob([this, blocks](size_t /* threadId */, size_t startIdx, size_t endIdx) {
+        for (size_t i = startIdx; i < endIdx; ++i) {
+          const int b = blocks ? (*blocks)[i] : i;
+          Eigen::MatrixXd D = _diagonalBlocks[b];
+          if (_useDiagonalConditioner)
+            D.diagonal() += blockSegment(_diagonalConditioner, b).cwiseAbs2();
+          invertBlock(D, _inverseBlocks[b]);
+        }
+      }, numBlocks, _nThreads, _threadedJobOptions);
+      if (_useSchurJacobi)
+        util::runThreadedJob(boost::bind(&PcgLinearSystemSolver::computeSchurBlocks, this, _1, _2, _3), _keptBlocks.size(), _nThreads, _threadedJobOptions);
+    }
+
+    void PcgLinearSystemSolver::applyPreconditioner(const Eigen::VectorXd& r, Eigen::VectorXd& outZ)
+    {
+      outZ.resize(r.size());
+      if (_options.preconditioner == PcgLinearSolverOptions::NONE) {
+        outZ = r;
+      } else if (!_useSchurJacobi) {
+        util::runThreadedJob(boost::bind(&PcgLinearSystemSolver::applyBlockInverses, this, _1, _2, _3, (const std::vector<int>*)NULL, &r, &outZ), _blockDimension.size(), _nThreads, _threadedJobOptions);
+      } else {
+        // Block LDL^T with the Schur complement of the kept blocks approximated by its diagonal blocks:
+        // w_m = H_mm^-1 r_m, z_c = S_cc^-1 (r_c - sum_m H_cm w_m), z_m = w_m - H_mm^-1 sum_c H_cm^T z_c
+        util::runThreadedJob(boost::bind(&PcgLinearSystemSolver::applyBlockInverses, this, _1, _2, _3, &_marginalizedBlocks, &r, &outZ), _marginalizedBlocks.size(), _nThreads, _threadedJobOptions);
+        util::runThreadedJob(boost::bind(&PcgLinearSystemSolver::eliminateCouplings, this, _1, _2, _3, &r, &outZ), _keptBlocks.size(), _nThreads, _threadedJobOptions);
+        util::runThreadedJob(boost::bind(&PcgLinearSystemSolver::backSubstituteCouplings, this, _1, _2, _3, &outZ), _marginalized.size(), _nThreads, _threadedJobOptions);
+      }
+    }
+
+    void PcgLinearSystemSolver::applyBlockInverses(size_t /* threadId */, size_t startIdx, size_t endIdx, const std::vector<int>* blocks, const Eigen::VectorXd* r, Eigen::VectorXd* outZ) const
+    {
+      for (size_t i = startIdx; i < endIdx; ++i) {
+        const int b = blocks ? (*blocks)[i] : i;
+        blockSegment(*outZ, b).noalias() = _inverseBlocks[b] * blockSegment(*r, b);
+      }
+    }
+
+    void PcgLinearSystemSolver::eliminateCouplings(size_t /* threadId */, size_t startIdx, size_t endIdx, const Eigen::VectorXd* r, Eigen::VectorXd* outZ) const
+    {
+      for (size_t j = startIdx; j < endIdx; ++j) {
+        const int c = _keptBlocks[j];
+        Eigen::VectorXd a = blockSegment(*r, c);
+        for (const std::pair<size_t, size_t>& entry : _blockCouplings[c]) {
+          const MarginalizedBlock& marginalized = _marginalized[entry.first];
+          a.noalias() -= marginalized.couplings[entry.second] * blockSegment(*outZ, marginalized.block);
+        }
+        blockSegment(*outZ, c).noalias() = _inverseBlocks[c] * a;
+      }
+    }
+
+    void PcgLinearSystemSolver::backSubstituteCouplings(size_t /* threadId */, size_t startIdx, size_t endIdx, Eigen::VectorXd* outZ) const
+    {
+      for (size_t k = startIdx; k < endIdx; ++k) {
+        const MarginalizedBlock& marginalized = _marginalized[k];
+        const int m = marginalized.block;
+        Eigen::VectorXd b = Eigen::VectorXd::Zero(_blockDimension[m]);
+        for (size_t p = 0; p < marginalized.coupledBlocks.size(); ++p)
+          b.noalias() += marginalized.couplings[p].transpose() * blockSegment(*outZ, marginalized.coupledBlocks[p]);
+        blockSegment(*outZ, m).noalias() -= _inverseBlocks[m] * b;
+      }
+    }
+
+    bool PcgLinearSystemSolver::solveSystem(Eigen::VectorXd& outDx)
+    {
+      const Eigen::VectorXd& b = _rhs;
+      const int n = b.size();
+      const double rhsNorm = b.norm();
+      const double relativeTolerance = _forcingTolerance > 0.0 ? _forcingTolerance : _options.tolerance;
+      const size_t maxIterations = _options.maxIterations > 0 ? _options.maxIterations : std::max(n, 1);
+      _statistics = IterativeSolverStatistics();
+
+      _x.setZero(n);
+      if (rhsNorm == 0.0) {
+        _statistics.converged = true;
+        outDx = _x;
+        return true;
+      }
+      computePreconditioner();
+      _r = b;
+      applyPreconditioner(_r, _z);
+      _p = _z;
+      double rz = _r.dot(_z);
+      double residualNorm = rhsNorm;
+      while (_statistics.iterations < maxIterations) {
+        multiplyHessian(_p, _q);
+        const double pq = _p.dot(_q);
+        // Stop at directions of non-positive curvature, which only appear due to round-off
+        if (!(pq > 0.0))
+          break;
+        const double alpha = rz / pq;
+        _x.noalias() += alpha * _p;
+        _r.noalias() -= alpha * _q;
+        ++_statistics.iterations;
+        residualNorm = _r.norm();
+        if (residualNorm <= relativeTolerance * rhsNorm) {
+          _statistics.converged = true;
+          break;
+        }
+        applyPreconditioner(_r, _z);
+        const double rzNew = _r.dot(_z);
+        _p = _z + (rzNew / rz) * _p;
+        rz = rzNew;
+      }
+      _statistics.relativeResidual = residualNorm / rhsNorm;
+      if (_statistics.iterations == 0 || !_x.allFinite())
+        return false;
+      outDx = _x;
+      return true;
+    }
+
+    const PcgLinearSolverOptions& PcgLinearSystemSolver::getOptions() const {
+      return _options;
+    }
+
+    PcgLinearSolverOptions& PcgLinearSystemSolver::getOptions() {
+      return _options;
+    }
+
+    void PcgLinearSystemSolver::setOptions(const PcgLinearSolverOptions& options) {
+      _options = options;
+    }
+
+    void PcgLinearSystemSolver::handleNewAcceptConstantErrorTerms() {
+      _jacobianBuilder.J_transpose().setAcceptConstantErrorTerms(isAcceptConstantErrorTerms());
+    }
+
+    bool PcgLinearSystemSolver::evaluateErrorsAndJacobiansImplementation(size_t nThreads, bool useMEstimator) {
+      _jacobianBuilder.evaluateErrorsAndJacobians(nThreads, useMEstimator, _e, _squaredErrors, _threadedJobOptions);
+      return true;
+    }
+
+  } // namespace backend
+} // namespace aslam
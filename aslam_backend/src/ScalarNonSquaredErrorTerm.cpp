@@ -7,7 +7,9 @@ namespace aslam {
 namespace backend {
 
 ScalarNonSquaredErrorTerm::ScalarNonSquaredErrorTerm() :
-        _mEstimatorPolicy(boost::make_shared<NoMEstimator>()), _error(0.0), _w(0.0), _timestamp(0)
+        _mEstimatorPolicy(boost::make_shared<NoMEstimator>()), _error(0.0), _w(0.0), _timestamp(0),
+        _evalRawJacobianTimer("ScalarNonSquaredErrorTerm: evaluateRawJacobians", true),
+        _evalWeightedJacobianTimer("ScalarNonSquaredErrorTerm: evaluateWeightedJacobians", true)
 {
 }
 
@@ -21,14 +23,16 @@ double ScalarNonSquaredErrorTerm::updateRawError()
 }
 
 void ScalarNonSquaredErrorTerm::evaluateRawJacobians(JacobianContainer& outJ) {
-  Timer t("ScalarNonSquaredErrorTerm: evaluateRawJacobians", false);
+  _evalRawJacobianTimer.start();
   evaluateJacobiansImplementation(outJ.apply(_w));
+  _evalRawJacobianTimer.stop();
 }
 
 void ScalarNonSquaredErrorTerm::evaluateWeightedJacobians(JacobianContainer& outJ)
 {
-  Timer t("ScalarNonSquaredErrorTerm: evaluateWeightedJacobians", false);
+  _evalWeightedJacobianTimer.start();
   evaluateJacobiansImplementation(outJ.apply(_w * _mEstimatorPolicy->getWeight(getRawError())));
+  _evalWeightedJacobianTimer.stop();
 }
 
 /// \brief set the M-Estimator policy. This function takes a squared error
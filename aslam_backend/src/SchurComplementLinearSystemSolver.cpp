@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <numeric>
+
+#include <aslam/backend/SchurComplementLinearSystemSolver.hpp>
+#include <sparse_block_matrix/linear_solver_cholmod.h>
+#include <sparse_block_matrix/linear_solver_dense.h>
+#include <aslam/backend/ErrorTerm.hpp>
+#include <sm/PropertyTree.hpp>
+#include <boost/bind.hpp>
+#include <Eigen/Cholesky>
+
+namespace aslam {
+  namespace backend {
+
+    SchurComplementLinearSystemSolver::SchurComplementLinearSystemSolver(const std::string & reducedSolver, const BlockCholeskyLinearSolverOptions& options) :
+        BlockCholeskyLinearSystemSolver("cholesky", options),
+        _nThreads(1),
+        _reducedSolverType(reducedSolver) {
+      initReducedSolver();
+    }
+
+    SchurComplementLinearSystemSolver::SchurComplementLinearSystemSolver(const sm::PropertyTree& config) :
+        BlockCholeskyLinearSystemSolver(config),
+        _nThreads(1) {
+      _reducedSolverType = config.getString("reducedSolverType", "cholesky");
+      initReducedSolver();
+    }
+
+    SchurComplementLinearSystemSolver::~SchurComplementLinearSystemSolver()
+    {
+    }
+
+    void SchurComplementLinearSystemSolver::initReducedSolver()
+    {
+      if(_reducedSolverType == "cholesky") {
+        _reducedSolver.reset(new sparse_block_matrix::LinearSolverCholmod<Eigen::MatrixXd>());
+      } else if(_reducedSolverType == "dense") {
+        _reducedSolver.reset(new sparse_block_matrix::LinearSolverDense<Eigen::MatrixXd>());
+      } else {
+        std::cout << "Unknown reduced solver type " << _reducedSolverType << ". Try \"cholesky\" or \"dense\"\nDefaulting to cholesky.\n";
+        _reducedSolver.reset(new sparse_block_matrix::LinearSolverCholmod<Eigen::MatrixXd>());
+      }
+      _reducedSolver->init();
+    }
+
+    void SchurComplementLinearSystemSolver::initMatrixStructureImplementation(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors, bool useDiagonalConditioner)
+    {
+      BlockCholeskyLinearSystemSolver::initMatrixStructureImplementation(dvs, errors, useDiagonalConditioner);
+      initReducedSolver();
+
+      // Split the blocks into the marginalized and the kept ones
+      _marginalized.clear();
+      _keptBlocks.clear();
+      _reducedIndex.assign(dvs.size(), -1);
+      std::vector<int> marginalizedIndex(dvs.size(), -1);
+      std::vector<int> reducedBlocks;
+      for (size_t i = 0; i < dvs.size(); ++i) {
+        if (dvs[i]->isMarginalized()) {
+          marginalizedIndex[i] = _marginalized.size();
+          _marginalized.push_back(MarginalizedBlock());
+          _marginalized.back().block = i;
+        } else {
+          _reducedIndex[i] = _keptBlocks.size();
+          _keptBlocks.push_back(i);
+          reducedBlocks.push_back(dvs[i]->minimalDimensions());
+        }
+      }
+      std::partial_sum(reducedBlocks.begin(), reducedBlocks.end(), reducedBlocks.begin());
+      _S = SparseBlockMatrix(reducedBlocks, reducedBlocks);
+      for (size_t j = 0; j < _keptBlocks.size(); ++j)
+        _S.block(j, j, true);
+
+      // Collect the couplings of the marginalized blocks and the structure of the reduced system
+      std::vector<int> blocks;
+      for (size_t i = 0; i < errors.size(); ++i) {
+        blocks.clear();
+        for (size_t k = 0; k < errors[i]->numDesignVariables(); ++k) {
+          const DesignVariable* dv = errors[i]->designVariable(k);
+          if (dv->isActive() && dv->blockIndex() >= 0)
+            blocks.push_back(dv->blockIndex());
+        }
+        std::sort(blocks.begin(), blocks.end());
+        blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+        int marginalizedBlock = -1;
+        for (int b : blocks) {
+          if (marginalizedIndex[b] >= 0) {
+            SM_ASSERT_LT(Exception, marginalizedBlock, 0, "Error term " << i << " couples the marginalized blocks " << marginalizedBlock << " and " << b
+                         << ". The marginalized design variables must be independent of each other.");
+            marginalizedBlock = b;
+          }
+        }
+        if (marginalizedBlock >= 0) {
+          std::vector<int>& coupledBlocks = _marginalized[marginalizedIndex[marginalizedBlock]].coupledBlocks;
+          for (int b : blocks) {
+            if (b != marginalizedBlock)
+              coupledBlocks.push_back(b);
+          }
+        } else {
+          for (size_t j = 0; j < blocks.size(); ++j)
+            for (size_t k = 0; k < j; ++k)
+              _S.block(_reducedIndex[blocks[k]], _reducedIndex[blocks[j]], true);
+        }
+      }
+
+      // The elimination of a marginalized block fills in the reduced system between all its coupled blocks
+      _reducedColumnCouplings.clear();
+      _reducedColumnCouplings.resize(_keptBlocks.size());
+      std::vector<double> eliminationCosts(_marginalized.size()), reductionCosts(_keptBlocks.size(), 1.0);
+      for (size_t k = 0; k < _marginalized.size(); ++k) {
+        MarginalizedBlock& marginalized = _marginalized[k];
+        std::vector<int>& coupledBlocks = marginalized.coupledBlocks;
+        std::sort(coupledBlocks.begin(), coupledBlocks.end());
+        coupledBlocks.erase(std::unique(coupledBlocks.begin(), coupledBlocks.end()), coupledBlocks.end());
+        marginalized.couplings.resize(coupledBlocks.size());
+        marginalized.scaledCouplings.resize(coupledBlocks.size());
+        eliminationCosts[k] = coupledBlocks.size() + 1;
+        for (size_t j = 0; j < coupledBlocks.size(); ++j) {
+          const int col = _reducedIndex[coupledBlocks[j]];
+          _reducedColumnCouplings[col].push_back(std::make_pair(k, j));
+          reductionCosts[col] += j + 2; // j + 1 blocks and one right-hand-side segment
+          for (size_t i = 0; i <= j; ++i)
+            _S.block(_reducedIndex[coupledBlocks[i]], col, true);
+        }
+      }
+      _eliminationLoadBalancer.init(eliminationCosts);
+      _reductionLoadBalancer.init(reductionCosts);
+      _reducedRhs.resize(_S.rows());
+      _reducedDx.resize(_S.rows());
+    }
+
+    void SchurComplementLinearSystemSolver::buildSystem(size_t nThreads, bool useMEstimator)
+    {
+      _nThreads = std::max<size_t>(1, nThreads);
+      BlockCholeskyLinearSystemSolver::buildSystem(nThreads, useMEstimator);
+    }
+
+    Eigen::VectorXd SchurComplementLinearSystemSolver::diagonalAugmentation(int block) const
+    {
+      return _diagonalConditioner.segment(_H._M.colBaseOfBlock(block), _H._M.colsOfBlock(block)).cwiseAbs2();
+    }
+
+    bool SchurComplementLinearSystemSolver::solveSystem(Eigen::VectorXd& outDx)
+    {
+      util::runThreadedJob(boost::bind(&SchurComplementLinearSystemSolver::eliminateBlocks, this, _1, _2, _3), _eliminationLoadBalancer, _nThreads, _threadedJobOptions);
+      for (const MarginalizedBlock& marginalized : _marginalized) {
+        if (!marginalized.success)
+          return false;
+      }
+      util::runThreadedJob(boost::bind(&SchurComplementLinearSystemSolver::buildReducedColumns, this, _1, _2, _3), _reductionLoadBalancer, _nThreads, _threadedJobOptions);
+
+      // Solve the reduced system
+      if (_S.rows() > 0 && !_reducedSolver->solve(_S, _reducedDx.data(), _reducedRhs.data())) {
+        // Start over with a fresh solver like the BlockCholeskyLinearSystemSolver does
+        initReducedSolver();
+        return false;
+      }
+      outDx.resize(_H._M.rows());
+      for (size_t j = 0; j < _keptBlocks.size(); ++j)
+        outDx.segment(_H._M.colBaseOfBlock(_keptBlocks[j]), _S.colsOfBlock(j)) = _reducedDx.segment(_S.colBaseOfBlock(j), _S.colsOfBlock(j));
+
+      util::runThreadedJob(boost::bind(&SchurComplementLinearSystemSolver::backSubstitute, this, _1, _2, _3, &outDx), _eliminationLoadBalancer, _nThreads, _threadedJobOptions);
+      return true;
+    }
+
+    void SchurComplementLinearSystemSolver::eliminateBlocks(size_t /* threadId */, size_t startIdx, size_t endIdx)
+    {
+      for (size_t k = startIdx; k < endIdx; ++k) {
+        MarginalizedBlock& marginalized = _marginalized[k];
+        const int m = marginalized.block;
+        const int dim = _H._M.colsOfBlock(m);
+        const Eigen::MatrixXd* diagonalBlock = _H._M.block(m, m);
+        Eigen::MatrixXd D = diagonalBlock != NULL ? *diagonalBlock : Eigen::MatrixXd::Zero(dim, dim);
+        if (_useDiagonalConditioner)
+          D.diagonal() += diagonalAugmentation(m);
+        Eigen::LLT<Eigen::MatrixXd, Eigen::Upper> llt(D);
+        marginalized.success = llt.info() == Eigen::Success;
+        if (!marginalized.success)
+          continue;
+        marginalized.inverse = llt.solve(Eigen::MatrixXd::Identity(dim, dim));
+        for (size_t p = 0; p < marginalized.coupledBlocks.size(); ++p) {
+          // Only the upper triangle is stored
+          const int c = marginalized.coupledBlocks[p];
+          Eigen::MatrixXd& coupling = marginalized.couplings[p];
+          const Eigen::MatrixXd* block = c < m ? _H._M.block(c, m) : _H._M.block(m, c);
+          if (block == NULL)
+            coupling.setZero(_H._M.colsOfBlock(c), dim);
+          else if (c < m)
+            coupling = *block;
+          else
+            coupling = block->transpose();
+          marginalized.scaledCouplings[p].noalias() = coupling * marginalized.inverse;
+        }
+      }
+    }
+
+    void SchurComplementLinearSystemSolver::buildReducedColumns(size_t /* threadId */, size_t startIdx, size_t endIdx)
+    {
+      for (size_t j = startIdx; j < endIdx; ++j) {
+        const int c = _keptBlocks[j];
+        // Copy the kept part of the block column of the Hessian
+        for (const SparseBlockMatrix::IntBlockMap::value_type& entry : _S.blockCols()[j])
+          entry.second->setZero();
+        for (const SparseBlockMatrix::IntBlockMap::value_type& entry : _H._M.blockCols()[c]) {
+          if (entry.first <= c && _reducedIndex[entry.first] >= 0)
+            *_S.block(_reducedIndex[entry.first], j, true) += *entry.second;
+        }
+        if (_useDiagonalConditioner)
+          _S.block(j, j, true)->diagonal() += diagonalAugmentation(c);
+        Eigen::VectorXd::SegmentReturnType rhsSegment = _reducedRhs.segment(_S.colBaseOfBlock(j), _S.colsOfBlock(j));
+        rhsSegment = _rhs.segment(_H._M.colBaseOfBlock(c), _H._M.colsOfBlock(c));
+
+        // Subtract the contributions of the marginalized blocks coupled to this column
+        for (const std::pair<size_t, size_t>& entry : _reducedColumnCouplings[j]) {
+          const MarginalizedBlock& marginalized = _marginalized[entry.first];
+          const size_t pj = entry.second;
+          for (size_t pi = 0; pi <= pj; ++pi)
+            _S.block(_reducedIndex[marginalized.coupledBlocks[pi]], j, true)->noalias() -= marginalized.scaledCouplings[pi] * marginalized.couplings[pj].transpose();
+          rhsSegment.noalias() -= marginalized.scaledCouplings[pj] * _rhs.segment(_H._M.colBaseOfBlock(marginalized.block), _H._M.colsOfBlock(marginalized.block));
+        }
+      }
+    }
+
+    void SchurComplementLinearSystemSolver::backSubstitute(size_t /* threadId */, size_t startIdx, size_t endIdx, Eigen::VectorXd* outDx)
+    {
+      for (size_t k = startIdx; k < endIdx; ++k) {
+        const MarginalizedBlock& marginalized = _marginalized[k];
+        const int m = marginalized.block;
+        Eigen::VectorXd b = _rhs.segment(_H._M.colBaseOfBlock(m), _H._M.colsOfBlock(m));
+        for (size_t p = 0; p < marginalized.coupledBlocks.size(); ++p) {
+          const int j = _reducedIndex[marginalized.coupledBlocks[p]];
+          b.noalias() -= marginalized.couplings[p].transpose() * _reducedDx.segment(_S.colBaseOfBlock(j), _S.colsOfBlock(j));
+        }
+        outDx->segment(_H._M.colBaseOfBlock(m), _H._M.colsOfBlock(m)).noalias() = marginalized.inverse * b;
+      }
+    }
+
+    double SchurComplementLinearSystemSolver::rhsJtJrhs()
+    {
+      // Only the upper triangle of the Hessian is stored, the strictly upper blocks count twice
+      const Eigen::VectorXd& rhs = _rhs;
+      double rhsJtJrhs = 0.0;
+      for (int c = 0; c < _H._M.bCols(); ++c) {
+        const Eigen::VectorXd::ConstSegmentReturnType x_c = rhs.segment(_H._M.colBaseOfBlock(c), _H._M.colsOfBlock(c));
+        for (const SparseBlockMatrix::IntBlockMap::value_type& entry : _H._M.blockCols()[c]) {
+          const int r = entry.first;
+          if (r > c)
+            continue;
+          const double value = rhs.segment(_H._M.rowBaseOfBlock(r), _H._M.rowsOfBlock(r)).dot(*entry.second * x_c);
+          rhsJtJrhs += r == c ? value : 2.0 * value;
+        }
+      }
+      return rhsJtJrhs;
+    }
+
+  } // namespace backend
+} // namespace aslam
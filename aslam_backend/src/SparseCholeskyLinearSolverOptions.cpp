@@ -25,16 +25,26 @@ namespace aslam {
 /* Constructors and Destructor                                                */
 /******************************************************************************/
 
-      SparseCholeskyLinearSolverOptions::SparseCholeskyLinearSolverOptions() {}
-      
+    SparseCholeskyLinearSolverOptions::SparseCholeskyLinearSolverOptions() :
+        ordering(SCALAR_AMD),
+        cacheHessian(false),
+        assembleHessian(false) {
+    }
+
     SparseCholeskyLinearSolverOptions::SparseCholeskyLinearSolverOptions(
-        const SparseCholeskyLinearSolverOptions& /* other */) {
+        const SparseCholeskyLinearSolverOptions& other) :
+        ordering(other.ordering),
+        cacheHessian(other.cacheHessian),
+        assembleHessian(other.assembleHessian) {
     }
 
     SparseCholeskyLinearSolverOptions&
     SparseCholeskyLinearSolverOptions::operator =
         (const SparseCholeskyLinearSolverOptions& other) {
       if (this != &other) {
+        ordering = other.ordering;
+        cacheHessian = other.cacheHessian;
+        assembleHessian = other.assembleHessian;
       }
       return *this;
     }
@@ -1,26 +1,65 @@
 #include <aslam/backend/SparseCholeskyLinearSystemSolver.hpp>
 #include <sm/PropertyTree.hpp>
+#include <sm/logging.hpp>
+#include <sparse_block_matrix/marginal_covariance_cholesky.h>
+#include <aslam/backend/util/ThreadedRangeProcessor.hpp>
+#include <algorithm>
+#include <numeric>
 
 namespace aslam {
   namespace backend {
-    SparseCholeskyLinearSystemSolver::SparseCholeskyLinearSystemSolver(const SparseCholeskyLinearSolverOptions& options) : _factor(NULL), _options(options) {}
+    SparseCholeskyLinearSystemSolver::SparseCholeskyLinearSystemSolver(const SparseCholeskyLinearSolverOptions& options) : _factor(NULL), _factorOrdering(options.ordering), _options(options) {}
   SparseCholeskyLinearSystemSolver::SparseCholeskyLinearSystemSolver(const sm::PropertyTree& /* config */) :
         _factor(NULL) {
+      _factorOrdering = _options.ordering;
       // NO OPTIONS CURRENTLY IMPLEMENTED
       // USING C++11 would allow to do constructor delegation and more elegant code
     }
-    SparseCholeskyLinearSystemSolver::~SparseCholeskyLinearSystemSolver() {}
+    SparseCholeskyLinearSystemSolver::~SparseCholeskyLinearSystemSolver()
+    {
+      freeHessian();
+      if (_factor)
+        _cholmod.free(_factor);
+    }
 
     void SparseCholeskyLinearSystemSolver::initMatrixStructureImplementation(const std::vector<DesignVariable*>& dvs, const std::vector<ErrorTerm*>& errors, bool useDiagonalConditioner)
     {
       _errorTerms = errors;
-      if (_factor) {
-        _cholmod.free(_factor);
-        _factor = NULL;
-      }
+      freeHessian();
+      _isSystemBuilt = false;
+      _isFactorCurrent = false;
       // std::cout << "init structure\n";
+      // The ordering and the symbolic factorization only depend on the pattern of J^T J,
+      // which does not change if the new error terms couple design variables that are coupled already.
+      // Each builder compares with its own last structure, which is only current if it has been used for it.
+      bool sameCoupling;
+      if (_options.assembleHessian) {
+        sameCoupling = _hessianBuilder.initMatrixStructure(dvs, errors) && _assembleHessian;
+      } else {
+        typedef CompressedColumnJacobianTransposeBuilder<int>::StructureUpdate StructureUpdate;
+        const StructureUpdate update = _jacobianBuilder.updateMatrixStructure(dvs, errors);
+        sameCoupling = (update == StructureUpdate::Unchanged || update == StructureUpdate::Extended) && !_assembleHessian;
+      }
+      _assembleHessian = _options.assembleHessian;
+      if (!sameCoupling || _options.ordering != _factorOrdering)
+        _ordering.clear();
+      if (_factor && sameCoupling && useDiagonalConditioner == _useDiagonalConditioner && _options.ordering == _factorOrdering
+          && system() == _factorSystem) {
+        ++_numSymbolicFactorizationReuses;
+      } else {
+        if (_factor) {
+          _cholmod.free(_factor);
+          _factor = NULL;
+        }
+        ++_numSymbolicFactorizationMisses;
+      }
       _useDiagonalConditioner = useDiagonalConditioner;
-      _jacobianBuilder.initMatrixStructure(dvs, errors);
+      if (_assembleHessian) {
+        _dampedHessianValues.assign(_hessianBuilder.nnz(), 0.0);
+        _hessianBuilder.getView(&_cholmodLhs, _dampedHessianValues.data());
+        _cholmod.view(_rhs, &_cholmodRhs);
+        return;
+      }
       CompressedColumnMatrix<int>& J_transpose = _jacobianBuilder.J_transpose();
       if (_useDiagonalConditioner) {
         J_transpose.pushConstantDiagonalBlock(1.0);
@@ -39,33 +78,81 @@ namespace aslam {
     void SparseCholeskyLinearSystemSolver::buildSystem(size_t nThreads, bool useMEstimator)
     {
       //std::cout << "build system\n";
-      _jacobianBuilder.buildSystem(nThreads, useMEstimator);
+      _nThreads = std::max<size_t>(1, nThreads);
+      freeHessian();
+      _isSystemBuilt = true;
+      _isFactorCurrent = false;
+      if (_assembleHessian) {
+        _hessianBuilder.buildSystem(_nThreads, useMEstimator, _rhs, _threadedJobOptions);
+        return;
+      }
+      _jacobianBuilder.buildSystem(_nThreads, useMEstimator, _threadedJobOptions);
       CompressedColumnMatrix<int>& J_transpose = _jacobianBuilder.J_transpose();
-      J_transpose.rightMultiply(_e, _rhs);
+      J_transpose.rightMultiply(_e, _rhs, _nThreads, _threadedJobOptions);
       // std::cout << "build system complete\n";
     }
 
     bool SparseCholeskyLinearSystemSolver::solveSystem(Eigen::VectorXd& outDx)
     {
       CompressedColumnMatrix<int>& J_transpose = _jacobianBuilder.J_transpose();
-      if (_useDiagonalConditioner) {
-        J_transpose.pushDiagonalBlock(_diagonalConditioner);
+      cholmod_sparse* lhs = &_cholmodLhs;
+      const System system = this->system();
+      const bool pushDiagonal = _useDiagonalConditioner && system == System::JacobianTranspose;
+      if (system == System::AssembledHessian) {
+        // Damp a copy of the assembled J^T J, the diagonal entry is the last one of each column
+        const std::vector<double>& values = _hessianBuilder.values();
+        std::copy(values.begin(), values.end(), _dampedHessianValues.begin());
+        if (_useDiagonalConditioner) {
+          const std::vector<int>& colPtr = _hessianBuilder.col_ptr();
+          for (size_t c = 0; c < _hessianBuilder.cols(); ++c)
+            _dampedHessianValues[colPtr[c + 1] - 1] += _diagonalConditioner[c] * _diagonalConditioner[c];
+        }
+        _hessianBuilder.getView(&_cholmodLhs, _dampedHessianValues.data());
+      } else if (system == System::CachedHessian) {
+        if (!_hessian)
+          computeHessian();
+        // Damp the cached J^T J instead of forming it again for each conditioner
+        double* values = static_cast<double*>(_hessian->x);
+        std::copy(_hessianValues.begin(), _hessianValues.end(), values);
+        if (_useDiagonalConditioner) {
+          for (size_t c = 0; c < _hessianDiagonal.size(); ++c)
+            values[_hessianDiagonal[c]] += _diagonalConditioner[c] * _diagonalConditioner[c];
+        }
+        lhs = _hessian;
+      } else {
+        if (pushDiagonal) {
+          J_transpose.pushDiagonalBlock(_diagonalConditioner);
+        }
+        J_transpose.getView(&_cholmodLhs);
       }
-      J_transpose.getView(&_cholmodLhs);
       _cholmod.view(_rhs, &_cholmodRhs);
       // std::cout << "solve system\n";
+      if (_factor && _factorSystem != system) {
+        // The factor of J^T can not be used for J^T J and vice versa
+        _cholmod.free(_factor);
+        _factor = NULL;
+      }
       if (!_factor) {
         // std::cout << "\tAnalyze system\n";
         // Now do the symbolic analysis with cholmod.
-        _factor = _cholmod.analyze(&_cholmodLhs);
+        _factorOrdering = _options.ordering;
+        _factorSystem = system;
+        if (_options.ordering == SparseCholeskyLinearSolverOptions::SCALAR_AMD) {
+          _factor = _cholmod.analyze(lhs);
+        } else {
+          if (_ordering.empty())
+            computeOrdering();
+          _factor = _cholmod.analyze(lhs, &_ordering[0]);
+        }
         //  std::cout << "\tanalyze system complete\n";
       }
       // Now we can solve the system.
-      outDx.resize(J_transpose.rows());
-      cholmod_dense* sol = _cholmod.solve(&_cholmodLhs, _factor, &_cholmodRhs);
-      if (_useDiagonalConditioner) {
+      outDx.resize(JCols());
+      cholmod_dense* sol = _cholmod.solve(lhs, _factor, &_cholmodRhs);
+      if (pushDiagonal) {
         J_transpose.popDiagonalBlock();
       }
+      _isFactorCurrent = sol != NULL;
       if (!sol) {
         std::cout << "Solution failed\n";
         return false;
@@ -88,6 +175,242 @@ namespace aslam {
       return true;
     }
 
+    void SparseCholeskyLinearSystemSolver::solveSystems(const std::vector<double>& conditioners, size_t nThreads, std::vector<Eigen::VectorXd>& outDx)
+    {
+      if (conditioners.size() <= 1 || nThreads <= 1 || !_useDiagonalConditioner) {
+        LinearSystemSolver::solveSystems(conditioners, nThreads, outDx);
+        return;
+      }
+      nThreads = std::min(nThreads, conditioners.size() - 1);
+      // The last solve does the symbolic factorization if needed and leaves its conditioner set
+      outDx.resize(conditioners.size());
+      setConstantConditioner(conditioners.back());
+      if (!solveSystem(outDx.back()))
+        outDx.back().resize(0);
+
+      // The undamped values of the factored matrix and the entries the conditioner goes to. J^T is damped by the appended
+      // diagonal block c I, J^T J by adding c^2 to its diagonal.
+      const System system = this->system();
+      const bool isHessian = system != System::JacobianTranspose;
+      CompressedColumnMatrix<int>& J_transpose = _jacobianBuilder.J_transpose();
+      cholmod_sparse lhs;
+      std::vector<double> undampedValues;
+      std::vector<int> dampedEntries(JCols());
+      if (system == System::AssembledHessian) {
+        lhs = _cholmodLhs;
+        undampedValues = _hessianBuilder.values();
+        const std::vector<int>& colPtr = _hessianBuilder.col_ptr();
+        for (size_t c = 0; c < dampedEntries.size(); ++c)
+          dampedEntries[c] = colPtr[c + 1] - 1;
+      } else if (system == System::CachedHessian) {
+        lhs = *_hessian;
+        undampedValues = _hessianValues;
+        dampedEntries = _hessianDiagonal;
+      } else {
+        J_transpose.pushConstantDiagonalBlock(0.0);
+        J_transpose.getView(&lhs);
+        undampedValues = J_transpose.values();
+        for (size_t c = 0; c < dampedEntries.size(); ++c)
+          dampedEntries[c] = undampedValues.size() - dampedEntries.size() + c;
+      }
+
+      // CHOLMOD is thread safe for distinct cholmod_common objects, so every thread has its own one and its own copy of the factor
+      try {
+        util::runThreadedJob([&](size_t /* threadId */, size_t startIdx, size_t endIdx) {
+          Cholmod<> cholmod;
+          cholmod_factor* factor = cholmod.copy(_factor);
+          std::vector<double> values = undampedValues;
+          cholmod_sparse threadLhs = lhs;
+          threadLhs.x = values.data();
+          cholmod_dense rhs;
+          cholmod.view(_rhs, &rhs);
+          for (size_t i = startIdx; i < endIdx; ++i) {
+            const double c = conditioners[i];
+            for (const int k : dampedEntries)
+              values[k] = isHessian ? undampedValues[k] + c * c : c;
+            cholmod_dense* sol = cholmod.solve(&threadLhs, factor, &rhs);
+            if (!sol) {
+              outDx[i].resize(0);
+              continue;
+            }
+            outDx[i] = Eigen::Map<const Eigen::VectorXd>(static_cast<const double*>(sol->x), sol->nrow);
+            cholmod.free(sol);
+          }
+          cholmod.free(factor);
+        }, conditioners.size() - 1, nThreads, _threadedJobOptions);
+      } catch (...) {
+        if (!isHessian)
+          J_transpose.popDiagonalBlock();
+        throw;
+      }
+      if (!isHessian)
+        J_transpose.popDiagonalBlock();
+    }
+
+    void SparseCholeskyLinearSystemSolver::setConditioner(const Eigen::VectorXd& diag)
+    {
+      if (diag.size() != _diagonalConditioner.size() || diag != _diagonalConditioner)
+        _isFactorCurrent = false;
+      LinearSystemSolver::setConditioner(diag);
+    }
+
+    void SparseCholeskyLinearSystemSolver::setConstantConditioner(double diag)
+    {
+      setConditioner(Eigen::VectorXd::Constant(JCols(), diag));
+    }
+
+    void SparseCholeskyLinearSystemSolver::computeCovarianceBlocks(const std::vector<std::pair<int, int> >& blockIndices, SparseBlockMatrix& outP, size_t nThreads)
+    {
+      SM_ASSERT_TRUE(Exception, _isSystemBuilt, "The system has to be built before computing covariances");
+      if (!_isFactorCurrent) {
+        Eigen::VectorXd dx;
+        SM_ASSERT_TRUE(Exception, solveSystem(dx), "The factorization of the system failed");
+      }
+      std::vector<int> rowBlockIndices = _assembleHessian ? _hessianBuilder.designVariableDimensions() : _jacobianBuilder.designVariableDimensions();
+      std::partial_sum(rowBlockIndices.begin(), rowBlockIndices.end(), rowBlockIndices.begin());
+      outP = SparseBlockMatrix(rowBlockIndices, rowBlockIndices);
+      if (blockIndices.empty())
+        return;
+
+      // The recursion needs a simplicial LL' factor, whose columns start with the diagonal entry.
+      // The factor maps row k of the permuted system to row Perm[k], the recursion needs the inverse.
+      cholmod_factor* L = _cholmod.copyToSimplicialLL(_factor);
+      const int n = L->n;
+      std::vector<int> inversePermutation(n);
+      const int* permutation = static_cast<const int*>(L->Perm);
+      for (int k = 0; k < n; ++k)
+        inversePermutation[permutation[k]] = k;
+
+      // Every chunk has its own cache of computed entries
+      const size_t numChunks = std::max<size_t>(1, std::min(nThreads, blockIndices.size()));
+      std::vector<SparseBlockMatrix> chunkP(numChunks);
+      try {
+        util::runThreadedJob([&](size_t /* threadId */, size_t startIdx, size_t endIdx) {
+          for (size_t k = startIdx; k < endIdx; ++k) {
+            sparse_block_matrix::MarginalCovarianceCholesky covariance;
+            covariance.setCholeskyFactor(n, static_cast<int*>(L->p), static_cast<int*>(L->i), static_cast<double*>(L->x), &inversePermutation[0]);
+            const std::vector<std::pair<int, int> > chunk(blockIndices.begin() + k * blockIndices.size() / numChunks,
+                                                          blockIndices.begin() + (k + 1) * blockIndices.size() / numChunks);
+            covariance.computeCovariance(chunkP[k], rowBlockIndices, chunk);
+          }
+        }, numChunks, numChunks, _threadedJobOptions);
+      } catch (...) {
+        _cholmod.free(L);
+        throw;
+      }
+      _cholmod.free(L);
+
+      for (size_t k = 0; k < numChunks; ++k) {
+        for (size_t i = k * blockIndices.size() / numChunks; i < (k + 1) * blockIndices.size() / numChunks; ++i)
+          *outP.block(blockIndices[i].first, blockIndices[i].second, true) = *chunkP[k].block(blockIndices[i].first, blockIndices[i].second);
+      }
+    }
+
+    SparseCholeskyLinearSystemSolver::System SparseCholeskyLinearSystemSolver::system() const
+    {
+      if (_assembleHessian)
+        return System::AssembledHessian;
+      return _options.cacheHessian ? System::CachedHessian : System::JacobianTranspose;
+    }
+
+    void SparseCholeskyLinearSystemSolver::computeHessian()
+    {
+      // Append a zero diagonal to J^T, so every diagonal entry is in the pattern of J^T J and can be damped,
+      // also for design variables without any error term. Their undamped diagonal entry is zero.
+      CompressedColumnMatrix<int>& J_transpose = _jacobianBuilder.J_transpose();
+      J_transpose.pushConstantDiagonalBlock(0.0);
+      J_transpose.getView(&_cholmodLhs);
+      _hessian = _cholmod.aat(&_cholmodLhs);
+      J_transpose.popDiagonalBlock();
+      J_transpose.getView(&_cholmodLhs);
+      SM_ASSERT_TRUE(Exception, _hessian != NULL, "Computing J^T J failed");
+      const int* colPtr = static_cast<const int*>(_hessian->p);
+      const int* rowInd = static_cast<const int*>(_hessian->i);
+      const double* values = static_cast<const double*>(_hessian->x);
+      _hessianValues.assign(values, values + colPtr[_hessian->ncol]);
+      _hessianDiagonal.assign(_hessian->ncol, -1);
+      for (size_t c = 0; c < _hessian->ncol; ++c) {
+        for (int k = colPtr[c]; k < colPtr[c + 1]; ++k) {
+          if (rowInd[k] == (int)c) {
+            _hessianDiagonal[c] = k;
+            break;
+          }
+        }
+        SM_ASSERT_GE_DBG(Exception, _hessianDiagonal[c], 0, "The diagonal entry of column " << c << " is missing in the pattern of the Hessian");
+      }
+    }
+
+    void SparseCholeskyLinearSystemSolver::freeHessian()
+    {
+      if (_hessian) {
+        _cholmod.free(_hessian);
+        _hessian = nullptr;
+      }
+    }
+
+    void SparseCholeskyLinearSystemSolver::computeOrdering()
+    {
+      // View the block structure of J^T as a pattern matrix, AMD, COLAMD and METIS order its rows for the factorization of J^T J.
+      // The block structure of the assembled Hessian is the upper triangle of the symmetric pattern of J^T J itself.
+      std::vector<int> colPtr, rowInd;
+      if (_assembleHessian)
+        _hessianBuilder.getBlockStructure(colPtr, rowInd);
+      else
+        _jacobianBuilder.getBlockStructure(colPtr, rowInd);
+      const std::vector<int>& dimensions = _assembleHessian ? _hessianBuilder.designVariableDimensions() : _jacobianBuilder.designVariableDimensions();
+      cholmod_sparse blocks;
+      blocks.nrow = dimensions.size();
+      blocks.ncol = colPtr.size() - 1;
+      blocks.nzmax = rowInd.size();
+      blocks.p = &colPtr[0];
+      blocks.i = rowInd.empty() ? NULL : &rowInd[0];
+      blocks.nz = NULL;
+      blocks.x = NULL;
+      blocks.z = NULL;
+      blocks.stype = _assembleHessian ? 1 : 0;
+      blocks.itype = CholmodIndexTraits<int>::IType;
+      blocks.xtype = CHOLMOD_PATTERN;
+      blocks.dtype = CholmodValueTraits<double>::DType;
+      blocks.sorted = 1;
+      blocks.packed = 1;
+
+      std::vector<int> blockOrdering(dimensions.size());
+      bool success = false;
+      switch (_options.ordering) {
+        case SparseCholeskyLinearSolverOptions::BLOCK_COLAMD:
+          if (!_assembleHessian) {
+            success = _cholmod.colamd(&blocks, &blockOrdering[0]);
+            break;
+          }
+          SM_WARN_STREAM("COLAMD needs the Jacobian, which is not formed for the assembled Hessian. Using AMD instead.");
+          success = _cholmod.amd(&blocks, &blockOrdering[0]);
+          break;
+        case SparseCholeskyLinearSolverOptions::BLOCK_NESTED_DISSECTION:
+          success = _cholmod.nestedDissection(&blocks, &blockOrdering[0]);
+          if (success)
+            break;
+          SM_WARN_STREAM("Nested dissection ordering failed, CHOLMOD might have been built without METIS. Using AMD instead.");
+          // fall through
+        default:
+          success = _cholmod.amd(&blocks, &blockOrdering[0]);
+          break;
+      }
+      SM_ASSERT_TRUE(Exception, success, "Computing the fill-reducing ordering of the design variables failed");
+
+      std::vector<int> columnBases(dimensions.size());
+      int columnBase = 0;
+      for (size_t i = 0; i < dimensions.size(); ++i) {
+        columnBases[i] = columnBase;
+        columnBase += dimensions[i];
+      }
+      _ordering.clear();
+      _ordering.reserve(columnBase);
+      for (int block : blockOrdering) {
+        for (int c = 0; c < dimensions[block]; ++c)
+          _ordering.push_back(columnBases[block] + c);
+      }
+    }
+
     const SparseCholeskyLinearSolverOptions&
     SparseCholeskyLinearSystemSolver::getOptions() const {
       return _options;
@@ -101,18 +424,44 @@ namespace aslam {
     void SparseCholeskyLinearSystemSolver::setOptions(
         const SparseCholeskyLinearSolverOptions& options) {
       _options = options;
+      _isFactorCurrent = false;
     }
       
     double SparseCholeskyLinearSystemSolver::rhsJtJrhs() {
+        if (_assembleHessian) {
+          Eigen::VectorXd JtJrhs;
+          _hessianBuilder.multiply(_rhs, JtJrhs);
+          return _rhs.dot(JtJrhs);
+        }
         CompressedColumnMatrix<int>& J_transpose = _jacobianBuilder.J_transpose();
         Eigen::VectorXd Jrhs;
-        J_transpose.leftMultiply(_rhs, Jrhs);
+        J_transpose.leftMultiply(_rhs, Jrhs, _nThreads, _threadedJobOptions);
         return Jrhs.squaredNorm();
     }
       
     void SparseCholeskyLinearSystemSolver::handleNewAcceptConstantErrorTerms() {
       _jacobianBuilder.J_transpose().setAcceptConstantErrorTerms(isAcceptConstantErrorTerms());
     }
+
+    size_t SparseCholeskyLinearSystemSolver::getMemoryUsage() const {
+      size_t bytes = _cholmod.getPeakMemoryUsage();
+      if (_assembleHessian)
+        return bytes + _hessianBuilder.getMemoryUsage() + _dampedHessianValues.capacity() * sizeof(double);
+      const CompressedColumnMatrix<int>& J_transpose = _jacobianBuilder.J_transpose();
+      bytes += J_transpose.values().capacity() * sizeof(double)
+          + (J_transpose.row_ind().capacity() + J_transpose.col_ptr().capacity()) * sizeof(int);
+      if (_hessian)
+        bytes += _hessianValues.capacity() * sizeof(double) + _hessianDiagonal.capacity() * sizeof(int);
+      return bytes;
+    }
+
+    bool SparseCholeskyLinearSystemSolver::evaluateErrorsAndJacobiansImplementation(size_t nThreads, bool useMEstimator) {
+      // The assembled Hessian is built from the Jacobians of the error terms directly, only the errors are evaluated
+      if (_assembleHessian)
+        return false;
+      _jacobianBuilder.evaluateErrorsAndJacobians(nThreads, useMEstimator, _e, _squaredErrors, _threadedJobOptions);
+      return true;
+    }
   } // namespace backend
 }  // namespace aslam
 
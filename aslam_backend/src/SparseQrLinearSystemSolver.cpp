@@ -54,9 +54,10 @@ namespace aslam {
     void SparseQrLinearSystemSolver::buildSystem(size_t nThreads, bool useMEstimator)
     {
       //std::cout << "build system\n";
-      _jacobianBuilder.buildSystem(nThreads, useMEstimator);
+      _nThreads = std::max<size_t>(1, nThreads);
+      _jacobianBuilder.buildSystem(_nThreads, useMEstimator, _threadedJobOptions);
       CompressedColumnMatrix<SuiteSparse_long>& J_transpose = _jacobianBuilder.J_transpose();
-      J_transpose.rightMultiply(_e, _rhs);
+      J_transpose.rightMultiply(_e, _rhs, _nThreads, _threadedJobOptions);
       //std::cout << "build system complete\n";
       _R.clear();
     }
@@ -186,12 +187,17 @@ namespace aslam {
     double SparseQrLinearSystemSolver::rhsJtJrhs() {
         CompressedColumnMatrix<SuiteSparse_long>& J_transpose = _jacobianBuilder.J_transpose();
         Eigen::VectorXd Jrhs;
-        J_transpose.leftMultiply(_rhs, Jrhs);
+        J_transpose.leftMultiply(_rhs, Jrhs, _nThreads, _threadedJobOptions);
         return Jrhs.squaredNorm();
     }
       
     void SparseQrLinearSystemSolver::handleNewAcceptConstantErrorTerms() {
       _jacobianBuilder.J_transpose().setAcceptConstantErrorTerms(isAcceptConstantErrorTerms());
     }
+
+    bool SparseQrLinearSystemSolver::evaluateErrorsAndJacobiansImplementation(size_t nThreads, bool useMEstimator) {
+      _jacobianBuilder.evaluateErrorsAndJacobians(nThreads, useMEstimator, _e, _squaredErrors, _threadedJobOptions);
+      return true;
+    }
   } // namespace backend
 } // namespace aslam
@@ -1,9 +1,17 @@
+#include <algorithm>
+
 #include <aslam/backend/TrustRegionPolicy.hpp>
 
 namespace aslam {
     namespace backend {
         
-        TrustRegionPolicy::TrustRegionPolicy(){}
+        TrustRegionPolicy::TrustRegionPolicy() :
+            _numConcurrentTrials(1),
+            _minForcingTolerance(0.0),
+            _maxForcingTolerance(0.0),
+            _forcingTolerance(0.0)
+        {
+        }
         TrustRegionPolicy::~TrustRegionPolicy(){}
             
 
@@ -43,11 +51,53 @@ namespace aslam {
             }
             _J = J;
 
+            if (_maxForcingTolerance > 0.0) {
+                _forcingTolerance = computeForcingTolerance(previousIterationFailed);
+                _solver->setForcingTolerance(_forcingTolerance);
+            }
             const bool success = solveSystemImplementation(J, previousIterationFailed, nThreads, outDx);
             _isFirstIteration = false;
             return success;
         }
 
+        void TrustRegionPolicy::setTrialCostFunction(const TrialCostFunction& trialCost, size_t numConcurrentTrials)
+        {
+            SM_ASSERT_GE(Exception, numConcurrentTrials, 1, "At least one trial step has to be evaluated at a time");
+            _trialCost = trialCost;
+            _numConcurrentTrials = numConcurrentTrials;
+        }
+
+        void TrustRegionPolicy::setForcingSequence(double minTolerance, double maxTolerance)
+        {
+            SM_ASSERT_LE(Exception, minTolerance, maxTolerance, "The bounds of the forcing sequence are not ordered");
+            _minForcingTolerance = minTolerance;
+            _maxForcingTolerance = maxTolerance;
+            _forcingTolerance = 0.0;
+            if (_maxForcingTolerance <= 0.0 && _solver) {
+                _solver->setForcingTolerance(0.0);
+            }
+        }
+
+        double TrustRegionPolicy::computeForcingTolerance(bool previousIterationFailed) const
+        {
+            if (_isFirstIteration) {
+                return _maxForcingTolerance;
+            }
+            if (previousIterationFailed) {
+                // The cost did not change, keep the accuracy of the failed step
+                return _forcingTolerance;
+            }
+            // For least squares, the squared ratio of the residual norms is the ratio of the costs
+            const double gamma = 0.9;
+            double eta = _p_J > 0.0 ? gamma * _J / _p_J : _minForcingTolerance;
+            // Do not let the tolerance drop much faster than in the previous iteration
+            const double safeguard = gamma * _forcingTolerance * _forcingTolerance;
+            if (safeguard > 0.1) {
+                eta = std::max(eta, safeguard);
+            }
+            return std::min(_maxForcingTolerance, std::max(_minForcingTolerance, eta));
+        }
+
         double TrustRegionPolicy::get_dJ()
         {
             return _p_J - _J;
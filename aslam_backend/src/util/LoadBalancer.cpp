@@ -0,0 +1,120 @@
+#include <aslam/backend/util/LoadBalancer.hpp>
+
+#include <algorithm>
+#include <numeric>
+
+#include <sm/assert_macros.hpp>
+
+namespace aslam {
+namespace backend {
+namespace util {
+
+namespace {
+
+/// \brief Weight of a new measurement relative to the current estimate once the estimates are calibrated
+const double kMeasurementWeight = 0.5;
+
+} // namespace
+
+void ThreadedJobStatistics::reset(std::size_t numThreads)
+{
+  busyTime.assign(numThreads, 0.0);
+  wallTime = 0.0;
+}
+
+double ThreadedJobStatistics::totalBusyTime() const
+{
+  return std::accumulate(busyTime.begin(), busyTime.end(), 0.0);
+}
+
+double ThreadedJobStatistics::imbalance() const
+{
+  const double total = totalBusyTime();
+  if (total <= 0.0)
+    return 1.0;
+  return *std::max_element(busyTime.begin(), busyTime.end()) * busyTime.size() / total;
+}
+
+std::ostream& operator<<(std::ostream& out, const ThreadedJobStatistics& statistics)
+{
+  out << "ThreadedJobStatistics:" << std::endl;
+  out << "\twall time: " << statistics.wallTime << std::endl;
+  out << "\tbusy time:";
+  for (const double t : statistics.busyTime)
+    out << " " << t;
+  out << std::endl;
+  out << "\timbalance: " << statistics.imbalance();
+  return out;
+}
+
+void LoadBalancer::init(const std::vector<double>& costHints)
+{
+  _costs.resize(costHints.size());
+  for (std::size_t i = 0; i < costHints.size(); ++i)
+    _costs[i] = costHints[i] > 0.0 ? costHints[i] : 1.0;
+  _chunkBoundaries.clear();
+  _isCalibrated = false;
+  _statistics.reset(0);
+}
+
+const std::vector<std::size_t>& LoadBalancer::computeChunkBoundaries(std::size_t numChunks)
+{
+  SM_ASSERT_GT(std::invalid_argument, numChunks, 0, "");
+  numChunks = std::max<std::size_t>(1, std::min(numChunks, _costs.size()));
+  const double totalCost = std::accumulate(_costs.begin(), _costs.end(), 0.0);
+
+  _chunkBoundaries.resize(numChunks + 1);
+  _chunkBoundaries.front() = 0;
+  // Without any estimated cost, e.g. after measuring durations below the clock resolution, split evenly by count
+  if (!(totalCost > 0.0)) {
+    for (std::size_t chunk = 1; chunk <= numChunks; ++chunk)
+      _chunkBoundaries[chunk] = chunk * _costs.size() / numChunks;
+    return _chunkBoundaries;
+  }
+  std::size_t chunk = 1;
+  double cost = 0.0;
+  for (std::size_t i = 0; i < _costs.size() && chunk < numChunks; ++i) {
+    cost += _costs[i];
+    // Close the chunk as soon as the accumulated cost reaches its share of the total
+    while (chunk < numChunks && cost >= totalCost * chunk / numChunks)
+      _chunkBoundaries[chunk++] = i + 1;
+  }
+  while (chunk <= numChunks)
+    _chunkBoundaries[chunk++] = _costs.size();
+  return _chunkBoundaries;
+}
+
+void LoadBalancer::beginJob(std::size_t numThreads)
+{
+  _statistics.reset(numThreads);
+}
+
+void LoadBalancer::addMeasurement(std::size_t threadId, std::size_t start, std::size_t end, double duration)
+{
+  SM_ASSERT_LE_DBG(std::out_of_range, end, _costs.size(), "");
+  SM_ASSERT_LT_DBG(std::out_of_range, threadId, _statistics.busyTime.size(), "");
+  _statistics.busyTime[threadId] += duration;
+  if (start >= end)
+    return;
+
+  // Scale the estimates of the chunk such that they sum up to the (smoothed) measured duration
+  const double estimate = std::accumulate(_costs.begin() + start, _costs.begin() + end, 0.0);
+  const double target = _isCalibrated ? (1.0 - kMeasurementWeight) * estimate + kMeasurementWeight * duration : duration;
+  if (estimate > 0.0) {
+    const double factor = target / estimate;
+    for (std::size_t i = start; i < end; ++i)
+      _costs[i] *= factor;
+  } else {
+    std::fill(_costs.begin() + start, _costs.begin() + end, target / (end - start));
+  }
+}
+
+void LoadBalancer::endJob(double wallTime)
+{
+  _statistics.wallTime = wallTime;
+  _isCalibrated = true;
+}
+
+} // namespace util
+} // namespace backend
+} // namespace aslam
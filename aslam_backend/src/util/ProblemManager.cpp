@@ -6,19 +6,70 @@
 #include <aslam/backend/JacobianContainerDense.hpp>
 
 #include <aslam/backend/util/ThreadedRangeProcessor.hpp>
+#include <aslam/backend/util/utils.hpp>
 
+#include <atomic>
+#include <boost/thread/mutex.hpp>
 
 #include <sm/logging.hpp>
 
 namespace aslam {
 namespace backend {
 
+namespace {
+
+/// \brief Saves the parameters of the design variables and restores them when going out of scope
+class ScopedDesignVariableState {
+ public:
+  explicit ScopedDesignVariableState(const std::vector<DesignVariable*>& dvs) : _state(dvs) { }
+  ~ScopedDesignVariableState() { _state.restore(); }
+ private:
+  utils::DesignVariableState _state;
+};
+
+} // namespace
+
+/// \brief A replica of the problem with its own design variables, serving one evaluation at a time
+struct ProblemManager::Replica {
+  explicit Replica(boost::shared_ptr<OptimizationProblemBase> problem) : manager(problem) { }
+  ProblemManager manager;
+  boost::mutex mutex;
+};
+
+/// \brief The replicas of a problem
+struct ProblemManager::ReplicaPool {
+  std::vector< boost::shared_ptr<Replica> > replicas;
+  /// \brief The replica to try first for the next evaluation, so the waiting evaluations spread over the replicas
+  std::atomic<size_t> next{0};
+
+  /// \brief Lock a free replica with \p lock, or wait for one if all of them are busy. The replica is set up to schedule
+  ///        its threaded jobs with \p options.
+  ProblemManager& acquire(boost::unique_lock<boost::mutex>& lock, const util::ThreadedJobOptions& options)
+  {
+    const size_t start = next++ % replicas.size();
+    for (size_t i = 0; i < replicas.size(); ++i) {
+      Replica& replica = *replicas[(start + i) % replicas.size()];
+      boost::unique_lock<boost::mutex> replicaLock(replica.mutex, boost::try_to_lock);
+      if (replicaLock.owns_lock()) {
+        lock.swap(replicaLock);
+        replica.manager.setThreadedJobOptions(options);
+        return replica.manager;
+      }
+    }
+    boost::unique_lock<boost::mutex>(replicas[start]->mutex).swap(lock);
+    replicas[start]->manager.setThreadedJobOptions(options);
+    return replicas[start]->manager;
+  }
+};
+
 ProblemManager::ProblemManager()
+  : _replicaPool(new ReplicaPool())
 {
 
 }
 
 ProblemManager::ProblemManager(boost::shared_ptr<OptimizationProblemBase> problem)
+  : _replicaPool(new ReplicaPool())
 {
   setProblem(problem);
   initialize();
@@ -85,6 +136,15 @@ void ProblemManager::initialize()
   }
   initEt.stop();
   SM_ASSERT_FALSE(Exception, _errorTermsNS.empty() && _errorTermsS.empty(), "It is illegal to run the optimizer with no error terms.");
+  _jacobianContainersS.reserve(_errorTermsS);
+  _jacobianContainersNS.reserve(_errorTermsNS);
+  _errorVectors.reserve(_errorTermsS);
+
+  for (const boost::shared_ptr<Replica>& replica : _replicaPool->replicas) {
+    boost::mutex::scoped_lock lock(replica->mutex);
+    replica->manager.initialize();
+    checkReplica(replica->manager);
+  }
 
   _isInitialized = true;
 
@@ -120,16 +180,39 @@ void ProblemManager::checkProblemSetup() const
 void ProblemManager::computeGradient(RowVectorType& outGrad, size_t nThreads, bool useMEstimator, bool applyDvScaling, bool useDenseJacobianContainer)
 {
   SM_ASSERT_GT(Exception, nThreads, 0, "");
-  Timer t("ProblemManager: Compute gradient", false);
-  std::vector<RowVectorType> gradients(nThreads, RowVectorType::Zero(1, _numOptParameters)); // compute gradients separately in different threads and add in the end
-  boost::function<void(size_t, size_t, size_t, RowVectorType&)> job(boost::bind(&ProblemManager::evaluateGradients, this, _1, _2, _3, _4, useMEstimator, useDenseJacobianContainer));
-  util::runThreadedFunction(job, _numErrorTerms, gradients);
-  // Add up the gradients
-  outGrad = gradients[0];
-  for (std::size_t i = 1; i<gradients.size(); i++)
-    outGrad += gradients[i];
+  boost::recursive_mutex::scoped_lock lock(*_evaluationMutex);
+  _computeGradientTimer.start();
+  // compute gradients separately in different threads and add in the end
+  _threadGradients.resize(nThreads);
+  for (auto& gradient : _threadGradients)
+    gradient.setZero(1, _numOptParameters);
+  _errorVectors.resize(nThreads);
+  _jacobianContainersS.resize(nThreads);
+  _jacobianContainersNS.resize(nThreads);
+  // The lambdas are small enough to be stored in the boost::function without allocating
+  util::runThreadedJob([this, useMEstimator, useDenseJacobianContainer](size_t threadId, size_t startIdx, size_t endIdx) {
+    evaluateGradients(threadId, startIdx, endIdx, _threadGradients[threadId], useMEstimator, useDenseJacobianContainer);
+  }, _numErrorTerms, nThreads, _threadedJobOptions);
+  // Add up the gradients, in parallel over disjoint ranges of the parameters
+  if (_threadGradients.size() == 1) {
+    outGrad.swap(_threadGradients[0]);
+  } else {
+    outGrad.resize(1, _numOptParameters);
+    util::runThreadedJob([this, &outGrad](size_t threadId, size_t startIdx, size_t endIdx) {
+      sumThreadGradients(threadId, startIdx, endIdx, outGrad);
+    }, _numOptParameters, nThreads, _threadedJobOptions);
+  }
   if (applyDvScaling)
     applyDesignVariableScaling(outGrad);
+  _computeGradientTimer.stop();
+}
+
+void ProblemManager::sumThreadGradients(size_t /* threadId */, size_t startIdx, size_t endIdx, RowVectorType& outGrad) const
+{
+  const size_t n = endIdx - startIdx;
+  outGrad.segment(startIdx, n) = _threadGradients[0].segment(startIdx, n);
+  for (std::size_t i = 1; i < _threadGradients.size(); i++)
+    outGrad.segment(startIdx, n) += _threadGradients[i].segment(startIdx, n);
 }
 
 void ProblemManager::applyDesignVariableScaling(RowVectorType& outGrad) const {
@@ -138,26 +221,32 @@ void ProblemManager::applyDesignVariableScaling(RowVectorType& outGrad) const {
 }
 
 void ProblemManager::addGradientForErrorTerm(RowVectorType& J, ErrorTerm* e, bool useMEstimator, bool useDenseJacobianContainer) {
-  e->updateRawSquaredError();
   ColumnVectorType ev;
-  e->getWeightedError(ev, useMEstimator);
-  ev *= 2.0;
-
   if (useDenseJacobianContainer) {
+    e->updateRawSquaredError();
+    e->getWeightedError(ev, useMEstimator);
+    ev *= 2.0;
     Eigen::MatrixXd J2 = Eigen::MatrixXd::Zero(e->dimension(), J.cols());
     JacobianContainerDense<Eigen::MatrixXd&, Eigen::Dynamic> jc(J2);
     e->getWeightedJacobians(jc, useMEstimator);
     J += ev.transpose() * J2;
   } else {
     JacobianContainerSparse<Eigen::Dynamic> jc(e->dimension());
-    e->getWeightedJacobians(jc, useMEstimator);
-    for (const auto& dvJacPair : jc) { // iterate over design variables of this error term
-      RowVectorType grad = ev.transpose()*dvJacPair.second;
-      J.block(0 /*e->rowBase()*/, dvJacPair.first->columnBase(), grad.rows(), grad.cols()) += grad;
-    }
+    addGradientForErrorTerm(jc, ev, J, e, useMEstimator);
   }
 }
 
+void ProblemManager::addGradientForErrorTerm(JacobianContainerSparse<>& jc, ColumnVectorType& ev, RowVectorType& J, ErrorTerm* e, bool useMEstimator) {
+  e->updateRawSquaredError();
+  e->getWeightedError(ev, useMEstimator);
+  ev *= 2.0;
+
+  jc.reset(e->dimension());
+  e->getWeightedJacobians(jc, useMEstimator);
+  for (const auto& dvJacPair : jc) // iterate over design variables of this error term
+    J.block(0 /*e->rowBase()*/, dvJacPair.first->columnBase(), 1, dvJacPair.second.cols()).noalias() += ev.transpose()*dvJacPair.second;
+}
+
 void ProblemManager::addGradientForErrorTerm(JacobianContainerSparse<1>& jc, RowVectorType& J, ScalarNonSquaredErrorTerm* e, bool useMEstimator) {
   e->evaluateJacobians(jc, useMEstimator);
   for (const auto& dvJacPair : jc) // iterate over design variables of this error term
@@ -170,10 +259,11 @@ void ProblemManager::addGradientForErrorTerm(JacobianContainerDense<RowVectorTyp
 
 
 double ProblemManager::evaluateError(const size_t nThreads /*= 1*/) const {
+  boost::recursive_mutex::scoped_lock lock(*_evaluationMutex);
 
-  std::vector<double> errors(nThreads, 0.0);
-  boost::function<void(size_t, size_t, size_t, double&)> job(boost::bind(&ProblemManager::sumErrorTerms, this, _1, _2, _3, _4));
-  util::runThreadedFunction(job, _numErrorTerms, errors);
+  // Store the error of each term and sum up in a fixed order, so the result does not depend on the scheduling
+  std::vector<double> errors(_numErrorTerms, 0.0);
+  util::runThreadedJob(boost::bind(&ProblemManager::evaluateErrorTerms, this, _1, _2, _3, boost::ref(errors)), _numErrorTerms, nThreads, _threadedJobOptions);
 
   double error = 0.0;
   for (auto e : errors)
@@ -187,13 +277,15 @@ double ProblemManager::evaluateError(const size_t nThreads /*= 1*/) const {
 void ProblemManager::applyStateUpdate(const ColumnVectorType& dx)
 {
   Timer t("ProblemManager: Apply state update", false);
+  boost::recursive_mutex::scoped_lock lock(*_evaluationMutex);
   // Apply the update to the dense state.
+  // The scaled update is only reallocated if the dimension changes between design variables
   int startIdx = 0;
+  Eigen::VectorXd dxS;
   for (size_t i = 0; i < _designVariables.size(); i++) {
     DesignVariable* d = _designVariables[i];
     const int dbd = d->minimalDimensions();
-    Eigen::VectorXd dxS = dx.segment(startIdx, dbd);
-    dxS *= d->scaling();
+    dxS = dx.segment(startIdx, dbd) * d->scaling();
     d->update(&dxS[0], dbd);
     startIdx += dbd;
   }
@@ -202,11 +294,13 @@ void ProblemManager::applyStateUpdate(const ColumnVectorType& dx)
 void ProblemManager::revertLastStateUpdate()
 {
   Timer t("ProblemManager: Revert last state update", false);
+  boost::recursive_mutex::scoped_lock lock(*_evaluationMutex);
   for (size_t i = 0; i < _designVariables.size(); i++)
     _designVariables[i]->revertUpdate();
 }
 
 void ProblemManager::saveDesignVariables() {
+  boost::recursive_mutex::scoped_lock lock(*_evaluationMutex);
   _dvState.resize(numDesignVariables());
   for (size_t i = 0; i < numDesignVariables(); i++) {
     _dvState[i].first = designVariable(i);
@@ -215,46 +309,105 @@ void ProblemManager::saveDesignVariables() {
 }
 
 void ProblemManager::restoreDesignVariables() {
+  boost::recursive_mutex::scoped_lock lock(*_evaluationMutex);
   for (auto& dvParamPair : _dvState)
     dvParamPair.first->setParameters(dvParamPair.second);
 }
 
 Eigen::VectorXd ProblemManager::getFlattenedDesignVariableParameters() const {
+  // The parameters of non-vector-space design variables are flattened in column-major order
+  boost::recursive_mutex::scoped_lock lock(*_evaluationMutex);
+  return utils::getFlattenedDesignVariableParameters(_designVariables);
+}
 
-  // Allocate memory so vector-space design variables fit into the output vector
-  int numParametersMin = 0;
-  for (auto& dv : _designVariables)
-    numParametersMin += dv->minimalDimensions();
+void ProblemManager::setFlattenedDesignVariableParameters(const Eigen::VectorXd& x) {
+  boost::recursive_mutex::scoped_lock lock(*_evaluationMutex);
+  utils::setFlattenedDesignVariableParameters(_designVariables, x);
+}
+
+void ProblemManager::addReplica(boost::shared_ptr<OptimizationProblemBase> replica) {
+  boost::shared_ptr<Replica> r(new Replica(replica));
+  if (_isInitialized)
+    checkReplica(r->manager);
+  _replicaPool->replicas.push_back(r);
+}
 
-  Eigen::VectorXd rval(numParametersMin);
+void ProblemManager::checkReplica(const ProblemManager& pm) const {
+  SM_ASSERT_EQ(Exception, pm.numDesignVariables(), numDesignVariables(), "The replica has a different number of active design variables");
+  SM_ASSERT_EQ(Exception, pm.numOptParameters(), numOptParameters(), "The replica has a different number of parameters");
+  SM_ASSERT_EQ(Exception, pm.numErrorTerms(), numErrorTerms(), "The replica has a different number of error terms");
+  SM_ASSERT_EQ(Exception, pm.getTotalDimSquaredErrorTerms(), getTotalDimSquaredErrorTerms(), "The replica has a different error dimension");
+  SM_ASSERT_EQ(Exception, pm.getFlattenedDesignVariableParameters().size(), getFlattenedDesignVariableParameters().size(),
+               "The design variables of the replica have a different number of parameters");
+  for (size_t i = 0; i < _designVariables.size(); ++i)
+    SM_ASSERT_NE(Exception, pm._designVariables[i], _designVariables[i], "The replica must not share design variable " << i);
+}
 
-  int cnt = 0;
-  for (auto& dv : _designVariables) {
-    Eigen::MatrixXd p;
-    dv->getParameters(p);
-    int d = p.size();
-    p.conservativeResize(d, 1);
+size_t ProblemManager::numReplicas() const {
+  return _replicaPool->replicas.size();
+}
 
-    // Resize has to be performed if we have non-vector-space design variables
-    int newSize = cnt + d;
-    if (newSize > numParametersMin)
-      rval.conservativeResize(newSize);
+void ProblemManager::clearReplicas() {
+  _replicaPool->replicas.clear();
+}
 
-    rval.segment(cnt, d) = p;
-    cnt += d;
+double ProblemManager::evaluateErrorAt(const Eigen::VectorXd& x, size_t nThreads) {
+  if (numReplicas() > 0) {
+    boost::unique_lock<boost::mutex> replicaLock;
+    ProblemManager& replica = _replicaPool->acquire(replicaLock, _threadedJobOptions);
+    replica.setFlattenedDesignVariableParameters(x);
+    return replica.evaluateError(nThreads);
   }
+  boost::recursive_mutex::scoped_lock lock(*_evaluationMutex);
+  ScopedDesignVariableState state(_designVariables);
+  setFlattenedDesignVariableParameters(x);
+  return evaluateError(nThreads);
+}
 
-  return rval;
+void ProblemManager::computeGradientAt(const Eigen::VectorXd& x, RowVectorType& outGrad, size_t nThreads, bool useMEstimator, bool applyDvScaling, bool useDenseJacobianContainer) {
+  if (numReplicas() > 0) {
+    boost::unique_lock<boost::mutex> replicaLock;
+    ProblemManager& replica = _replicaPool->acquire(replicaLock, _threadedJobOptions);
+    replica.setFlattenedDesignVariableParameters(x);
+    replica.computeGradient(outGrad, nThreads, useMEstimator, applyDvScaling, useDenseJacobianContainer);
+    return;
+  }
+  boost::recursive_mutex::scoped_lock lock(*_evaluationMutex);
+  ScopedDesignVariableState state(_designVariables);
+  setFlattenedDesignVariableParameters(x);
+  computeGradient(outGrad, nThreads, useMEstimator, applyDvScaling, useDenseJacobianContainer);
+}
 
+double ProblemManager::evaluateAtStep(const RowVectorType& dx, RowVectorType* outGrad, size_t nThreadsError, size_t nThreadsJacobian,
+                                      bool useMEstimator, bool applyDvScaling, bool useDenseJacobianContainer) {
+  if (numReplicas() > 0) {
+    // The replica is moved to the current state, then updated like the design variables of this problem would be
+    const Eigen::VectorXd x = getFlattenedDesignVariableParameters();
+    boost::unique_lock<boost::mutex> replicaLock;
+    ProblemManager& replica = _replicaPool->acquire(replicaLock, _threadedJobOptions);
+    replica.setFlattenedDesignVariableParameters(x);
+    replica.applyStateUpdate(dx.transpose());
+    const double error = replica.evaluateError(nThreadsError);
+    if (outGrad)
+      replica.computeGradient(*outGrad, nThreadsJacobian, useMEstimator, applyDvScaling, useDenseJacobianContainer);
+    return error;
+  }
+  boost::recursive_mutex::scoped_lock lock(*_evaluationMutex);
+  ScopedDesignVariableState state(_designVariables);
+  applyStateUpdate(dx.transpose());
+  const double error = evaluateError(nThreadsError);
+  if (outGrad)
+    computeGradient(*outGrad, nThreadsJacobian, useMEstimator, applyDvScaling, useDenseJacobianContainer);
+  return error;
 }
 
-void ProblemManager::sumErrorTerms(size_t /* threadId */, size_t startIdx, size_t endIdx, double& err) const {
+void ProblemManager::evaluateErrorTerms(size_t /* threadId */, size_t startIdx, size_t endIdx, std::vector<double>& errors) const {
   SM_ASSERT_LE_DBG(Exception, endIdx, _numErrorTerms, "");
   for (size_t i = startIdx; i < endIdx; ++i) { // iterate through error terms
     if (i < _errorTermsNS.size())
-      err += _errorTermsNS[i]->evaluateError();
+      errors[i] = _errorTermsNS[i]->evaluateError();
     else
-      err += _errorTermsS[i - _errorTermsNS.size()]->evaluateError();
+      errors[i] = _errorTermsS[i - _errorTermsNS.size()]->evaluateError();
   }
 }
 
@@ -266,7 +419,7 @@ void ProblemManager::sumErrorTerms(size_t /* threadId */, size_t startIdx, size_
  * @param useMEstimator Whether or not to use an MEstimator
  * @param J The gradient for the specified error terms
  */
-void ProblemManager::evaluateGradients(size_t /* threadId */, size_t startIdx, size_t endIdx, RowVectorType& J, bool useMEstimator, bool useDenseJacobianContainer)
+void ProblemManager::evaluateGradients(size_t threadId, size_t startIdx, size_t endIdx, RowVectorType& J, bool useMEstimator, bool useDenseJacobianContainer)
 {
   SM_ASSERT_LE_DBG(Exception, endIdx, _numErrorTerms, "");
 
@@ -281,18 +434,18 @@ void ProblemManager::evaluateGradients(size_t /* threadId */, size_t startIdx, s
   }
   else
   {
-    JacobianContainerSparse<1> jc(1);
     for (; cnt < endIdx && cnt < _errorTermsNS.size(); ++cnt)
-    {
-      jc.clear();
-      addGradientForErrorTerm(jc, J, _errorTermsNS[cnt], useMEstimator);
-    }
+      addGradientForErrorTerm(_jacobianContainersNS.get(threadId, 1), J, _errorTermsNS[cnt], useMEstimator);
   }
 
   // process squared error terms
   for (; cnt < endIdx; ++cnt)
   {
-    addGradientForErrorTerm(J, _errorTermsS[cnt - _errorTermsNS.size()], useMEstimator, useDenseJacobianContainer);
+    ErrorTerm* e = _errorTermsS[cnt - _errorTermsNS.size()];
+    if (useDenseJacobianContainer)
+      addGradientForErrorTerm(J, e, useMEstimator, useDenseJacobianContainer);
+    else
+      addGradientForErrorTerm(_jacobianContainersS.get(threadId, e->dimension()), _errorVectors.get(threadId, e->dimension()), J, e, useMEstimator);
   }
 
 }
@@ -0,0 +1,245 @@
+#include <aslam/backend/util/ThreadPool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include <boost/bind.hpp>
+
+#include <sm/assert_macros.hpp>
+
+namespace aslam {
+namespace backend {
+namespace util {
+
+namespace {
+
+/// \brief Whether the current thread is executing a job
+thread_local bool tlsInsideJob = false;
+
+/// \brief Marks the current thread as executing a job for the lifetime of the object
+struct InsideJobGuard {
+  InsideJobGuard() : _previous(tlsInsideJob) { tlsInsideJob = true; }
+  ~InsideJobGuard() { tlsInsideJob = _previous; }
+  bool _previous;
+};
+
+} // namespace
+
+/// \brief A contiguous range of chunks, initially assigned to one participant
+struct ThreadPool::Share {
+  std::atomic<std::size_t> next;
+  std::size_t end;
+  char padding[64 - sizeof(std::atomic<std::size_t>) - sizeof(std::size_t)]; // avoid false sharing of the cursors
+};
+
+struct ThreadPool::Task {
+  Task(const RangeJob& job, std::size_t rangeLength, std::size_t chunkSize, const std::vector<std::size_t>* chunkBoundaries, std::size_t numChunks, std::size_t numParticipants)
+      : job(job), rangeLength(rangeLength), chunkSize(chunkSize), chunkBoundaries(chunkBoundaries),
+        numChunks(numChunks), numParticipants(numParticipants), abort(false)
+  {
+  }
+
+  /// \brief Distribute the chunks over \p taskShares, which has room for numParticipants shares
+  void initShares(Share* taskShares) {
+    shares = taskShares;
+    const std::size_t shareLength = numChunks / numParticipants;
+    const std::size_t remainder = numChunks % numParticipants;
+    std::size_t start = 0;
+    for (std::size_t i = 0; i < numParticipants; ++i) {
+      shares[i].next = start;
+      start += shareLength + (i < remainder ? 1 : 0);
+      shares[i].end = start;
+    }
+  }
+
+  /// \brief Run the job on chunk \p chunk
+  void runChunk(std::size_t participant, std::size_t chunk) const {
+    if (chunkBoundaries) {
+      if ((*chunkBoundaries)[chunk] < (*chunkBoundaries)[chunk + 1])
+        job(participant, (*chunkBoundaries)[chunk], (*chunkBoundaries)[chunk + 1]);
+    } else {
+      const std::size_t start = chunk * chunkSize;
+      job(participant, start, std::min(start + chunkSize, rangeLength));
+    }
+  }
+
+  const RangeJob& job;
+  const std::size_t rangeLength;
+  const std::size_t chunkSize; /// \brief The chunk size if chunkBoundaries is NULL
+  const std::vector<std::size_t>* chunkBoundaries; /// \brief Explicit chunk boundaries, may be NULL
+  const std::size_t numChunks;
+  Share* shares = nullptr; /// \brief The shares of the participants, owned by the pool
+  const std::size_t numParticipants;
+  std::atomic<bool> abort;
+  std::exception_ptr exception; /// \brief The first exception thrown by a job, guarded by ThreadPool::_mutex
+};
+
+ThreadPool::ThreadPool(std::size_t numWorkers)
+{
+  boost::mutex::scoped_lock lock(_mutex);
+  spawnWorkers(numWorkers);
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    _shutdown = true;
+  }
+  _wakeCondition.notify_all();
+  for (boost::thread* worker : _workers) {
+    worker->join();
+    delete worker;
+  }
+}
+
+ThreadPool& ThreadPool::instance()
+{
+  static ThreadPool pool;
+  return pool;
+}
+
+std::size_t ThreadPool::numWorkers() const
+{
+  boost::mutex::scoped_lock lock(_mutex);
+  return _workers.size();
+}
+
+void ThreadPool::reserve(std::size_t numWorkers)
+{
+  boost::mutex::scoped_lock submitLock(_submitMutex);
+  boost::mutex::scoped_lock lock(_mutex);
+  spawnWorkers(numWorkers);
+}
+
+bool ThreadPool::isInsideJob()
+{
+  return tlsInsideJob;
+}
+
+void ThreadPool::spawnWorkers(std::size_t numWorkers)
+{
+  while (_workers.size() < numWorkers)
+    _workers.push_back(new boost::thread(boost::bind(&ThreadPool::workerLoop, this, _workers.size(), _generation)));
+}
+
+void ThreadPool::parallelFor(const RangeJob& job, std::size_t rangeLength, std::size_t numParticipants, std::size_t chunkSize)
+{
+  if (rangeLength == 0) // nothing to process here
+    return;
+
+  numParticipants = std::max<std::size_t>(1, std::min(numParticipants, rangeLength));
+  if (numParticipants == 1 || isInsideJob()) {
+    job(0, 0, rangeLength);
+    return;
+  }
+
+  if (chunkSize == 0)
+    chunkSize = std::max<std::size_t>(1, rangeLength / (numParticipants * kChunksPerParticipant));
+
+  Task task(job, rangeLength, chunkSize, nullptr, (rangeLength + chunkSize - 1) / chunkSize, numParticipants);
+  run(task);
+}
+
+void ThreadPool::parallelFor(const RangeJob& job, const std::vector<std::size_t>& chunkBoundaries, std::size_t numParticipants)
+{
+  SM_ASSERT_FALSE(std::invalid_argument, chunkBoundaries.empty(), "The chunk boundaries must contain at least the end of the range");
+  const std::size_t numChunks = chunkBoundaries.size() - 1;
+  const std::size_t rangeLength = chunkBoundaries.back();
+  if (rangeLength == 0) // nothing to process here
+    return;
+
+  numParticipants = std::max<std::size_t>(1, std::min(numParticipants, numChunks));
+  if (numParticipants == 1 || isInsideJob()) {
+    job(0, 0, rangeLength);
+    return;
+  }
+
+  Task task(job, rangeLength, 0, &chunkBoundaries, numChunks, numParticipants);
+  run(task);
+}
+
+void ThreadPool::run(Task& task)
+{
+  boost::mutex::scoped_lock submitLock(_submitMutex);
+  // The shares are reused between tasks, so steady-state jobs don't allocate
+  if (_numShares < task.numParticipants) {
+    _shares.reset(new Share[task.numParticipants]);
+    _numShares = task.numParticipants;
+  }
+  task.initShares(_shares.get());
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    spawnWorkers(task.numParticipants - 1);
+    _task = &task;
+    _numBusyWorkers = task.numParticipants - 1;
+    ++_generation;
+  }
+  _wakeCondition.notify_all();
+
+  participate(task, 0);
+
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    while (_numBusyWorkers > 0)
+      _doneCondition.wait(lock);
+    _task = nullptr;
+  }
+
+  if (task.exception)
+    std::rethrow_exception(task.exception);
+}
+
+void ThreadPool::workerLoop(std::size_t workerIndex, std::size_t seenGeneration)
+{
+  const std::size_t participant = workerIndex + 1;
+  while (true) {
+    Task* task = nullptr;
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      while (!_shutdown && _generation == seenGeneration)
+        _wakeCondition.wait(lock);
+      if (_shutdown)
+        return;
+      seenGeneration = _generation;
+      if (_task == nullptr || participant >= _task->numParticipants)
+        continue;
+      task = _task;
+    }
+
+    participate(*task, participant);
+
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      if (--_numBusyWorkers == 0)
+        _doneCondition.notify_one();
+    }
+  }
+}
+
+void ThreadPool::participate(Task& task, std::size_t participant)
+{
+  InsideJobGuard guard;
+  try {
+    // Start with the own share and steal from the following ones afterwards
+    for (std::size_t i = 0; i < task.numParticipants; ++i) {
+      Share& share = task.shares[(participant + i) % task.numParticipants];
+      while (!task.abort.load(std::memory_order_relaxed)) {
+        const std::size_t chunk = share.next.fetch_add(1);
+        if (chunk >= share.end)
+          break;
+        task.runChunk(participant, chunk);
+      }
+    }
+  } catch (...) {
+    boost::mutex::scoped_lock lock(_mutex);
+    if (!task.exception)
+      task.exception = std::current_exception();
+    task.abort = true;
+  }
+}
+
+} // namespace util
+} // namespace backend
+} // namespace aslam
@@ -1,9 +1,12 @@
 #include <aslam/backend/util/ThreadedRangeProcessor.hpp>
 
+#include <chrono>
 #include <exception>
 
 #include <boost/thread.hpp>
 
+#include <aslam/backend/util/ThreadPool.hpp>
+
 #include <sm/logging.hpp>
 #include <sm/assert_macros.hpp>
 
@@ -11,33 +14,80 @@ namespace aslam {
 namespace backend {
 namespace util {
 
-/// \brief The return value for a safe job
-struct SafeJobReturnValue {
-  SafeJobReturnValue(const std::exception& e) : _e(e) {}
-  std::exception _e;
-};
+namespace {
 
 /// \brief Functor running a job catching all exceptions
 struct SafeJob {
   boost::function<void()> _fn;
-  SafeJobReturnValue* _rval;
-  SafeJob() : _rval(NULL) {}
-  SafeJob(boost::function<void()> fn) : _fn(fn), _rval(NULL) {}
-  ~SafeJob() {
-    if (_rval) delete _rval;
-  }
+  std::exception_ptr _exception;
+  SafeJob() {}
+  SafeJob(boost::function<void()> fn) : _fn(fn) {}
 
   void operator()() {
     try {
       _fn();
     } catch (const std::exception& e) {
-      _rval = new SafeJobReturnValue(e);
+      _exception = std::current_exception();
       SM_FATAL_STREAM("Exception in thread block: " << e.what());
+    } catch (...) {
+      _exception = std::current_exception();
     }
   }
 };
 
-void runThreadedJob(boost::function<void(size_t, size_t, size_t)> job, size_t rangeLength, size_t nThreads)
+/// \brief Runs the job spawning one thread per subrange (indices[i] .. indices[i + 1] - 1)
+void spawnThreadedJob(boost::function<void(size_t, size_t, size_t)> job, const std::vector<size_t>& indices)
+{
+  const size_t nThreads = indices.size() - 1;
+
+  // Build a thread pool and execute the jobs.
+  boost::thread_group threads;
+  std::vector<SafeJob> jobs(nThreads);
+  for (size_t i = 0; i < nThreads; ++i) {
+    jobs[i] = SafeJob(boost::bind(job, i, indices[i], indices[i + 1]));
+    threads.create_thread(boost::ref(jobs[i]));
+  }
+  threads.join_all();
+  // Now go through and look for exceptions.
+  for (size_t i = 0; i < nThreads; ++i) {
+    if (jobs[i]._exception)
+      std::rethrow_exception(jobs[i]._exception);
+  }
+}
+
+/// \brief Compute the sub-ranges of equal length for each thread.
+std::vector<size_t> computeEqualSubranges(size_t rangeLength, size_t nThreads)
+{
+  std::vector<size_t> indices(nThreads + 1, 0);
+  size_t nJPerThread = std::max<size_t>(1, rangeLength / nThreads);
+  for (unsigned i = 0; i < nThreads; ++i)
+    indices[i + 1] = indices[i] + nJPerThread;
+  // deal with the remainder.
+  indices.back() = rangeLength;
+  return indices;
+}
+
+/// \brief Functor measuring the processing time of every chunk
+struct MeasuredJob {
+  MeasuredJob(const boost::function<void(size_t, size_t, size_t)>& job, LoadBalancer& loadBalancer) : _job(job), _loadBalancer(loadBalancer) {}
+
+  void operator()(size_t threadId, size_t startIdx, size_t endIdx) {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    _job(threadId, startIdx, endIdx);
+    _loadBalancer.addMeasurement(threadId, startIdx, endIdx, secondsSince(start));
+  }
+
+  static double secondsSince(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  const boost::function<void(size_t, size_t, size_t)>& _job;
+  LoadBalancer& _loadBalancer;
+};
+
+} // namespace
+
+void runThreadedJob(boost::function<void(size_t, size_t, size_t)> job, size_t rangeLength, size_t nThreads, const ThreadedJobOptions& options)
 {
   SM_ASSERT_GT(std::runtime_error, nThreads, 0, "");
   if (rangeLength == 0) // nothing to process here
@@ -45,31 +95,37 @@ void runThreadedJob(boost::function<void(size_t, size_t, size_t)> job, size_t ra
 
   if (nThreads == 1) {
     job(0, 0, rangeLength);
+  } else if (options.useThreadPool) {
+    ThreadPool::instance().parallelFor(job, rangeLength, nThreads, options.chunkSize);
   } else {
-    nThreads = std::min(nThreads, rangeLength);
-
-    // Compute the sub-ranges for each thread.
-    std::vector<int> indices(nThreads + 1, 0);
-    int nJPerThread = std::max(1, static_cast<int>(rangeLength / nThreads));
-    for (unsigned i = 0; i < nThreads; ++i)
-      indices[i + 1] = indices[i] + nJPerThread;
-    // deal with the remainder.
-    indices.back() = rangeLength;
-
-    // Build a thread pool and execute the jobs.
-    boost::thread_group threads;
-    std::vector<SafeJob> jobs(nThreads);
-    for (size_t i = 0; i < nThreads; ++i) {
-      jobs[i] = SafeJob(boost::bind(job, i, indices[i], indices[i + 1]));
-      threads.create_thread(boost::ref(jobs[i]));
-    }
-    threads.join_all();
-    // Now go through and look for exceptions.
-    for (size_t i = 0; i < nThreads; ++i) {
-      if (jobs[i]._rval != nullptr)
-        throw jobs[i]._rval->_e;
+    spawnThreadedJob(job, computeEqualSubranges(rangeLength, std::min(nThreads, rangeLength)));
+  }
+}
+
+void runThreadedJob(boost::function<void(size_t, size_t, size_t)> job, LoadBalancer& loadBalancer, size_t nThreads, const ThreadedJobOptions& options)
+{
+  SM_ASSERT_GT(std::runtime_error, nThreads, 0, "");
+  const size_t rangeLength = loadBalancer.size();
+  nThreads = std::max<size_t>(1, std::min(nThreads, rangeLength));
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  loadBalancer.beginJob(nThreads);
+  MeasuredJob measuredJob(job, loadBalancer);
+  if (rangeLength == 0) {
+    // nothing to process here
+  } else if (nThreads == 1) {
+    measuredJob(0, 0, rangeLength);
+  } else if (options.useThreadPool) {
+    if (options.balanceLoad) {
+      const size_t nChunks = options.chunkSize > 0 ? (rangeLength + options.chunkSize - 1) / options.chunkSize : nThreads * ThreadPool::kChunksPerParticipant;
+      ThreadPool::instance().parallelFor(boost::ref(measuredJob), loadBalancer.computeChunkBoundaries(nChunks), nThreads);
+    } else {
+      ThreadPool::instance().parallelFor(boost::ref(measuredJob), rangeLength, nThreads, options.chunkSize);
     }
+  } else {
+    spawnThreadedJob(boost::ref(measuredJob), options.balanceLoad ? loadBalancer.computeChunkBoundaries(nThreads) : computeEqualSubranges(rangeLength, nThreads));
   }
+  loadBalancer.endJob(MeasuredJob::secondsSince(start));
 }
 
 }
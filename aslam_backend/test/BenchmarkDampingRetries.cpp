@@ -0,0 +1,114 @@
+/*
+ * BenchmarkDampingRetries.cpp
+ *
+ * Measures the cost of the solves of Levenberg-Marquardt after rejected steps, where only the damping changes,
+ * with and without the cached Hessian of the sparse Cholesky solver. The problem is structure-from-motion-like:
+ * 6-dimensional poses observe 3-dimensional landmarks within a window of neighbouring poses. Each system is
+ * solved for the sequence of damping values of consecutive rejected steps.
+ */
+
+// standard includes
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// boost includes
+#include <boost/program_options.hpp>
+
+// Schweizer Messer includes
+#include <sm/logging.hpp>
+#include <sm/timing/Timer.hpp>
+
+// aslam backend includes
+#include <aslam/backend/ErrorTerm.hpp>
+#include <aslam/backend/SparseCholeskyLinearSystemSolver.hpp>
+
+#include "BenchmarkProblems.hpp"
+
+using namespace std;
+using namespace aslam::backend;
+
+namespace {
+
+void benchmark(bool cacheHessian, const string& name, const vector<DesignVariable*>& dvs, const vector<ErrorTerm*>& errs,
+               size_t nSystems, size_t nRetries)
+{
+  SparseCholeskyLinearSolverOptions options;
+  options.cacheHessian = cacheHessian;
+  SparseCholeskyLinearSystemSolver solver(options);
+  solver.initMatrixStructure(dvs, errs, true);
+
+  Eigen::VectorXd dx;
+  size_t failures = 0;
+  for (size_t s = 0; s < nSystems; ++s) {
+    solver.evaluateError(1, false);
+    solver.buildSystem(1, false);
+    // The damping sequence of consecutive rejected steps: mu *= 2, lambda *= mu
+    double lambda = 1e-3, mu = 2;
+    solver.setConstantConditioner(lambda);
+    {
+      sm::timing::Timer timer(name + " -- first solve", false);
+      failures += !solver.solveSystem(dx);
+    }
+    for (size_t r = 0; r < nRetries; ++r) {
+      mu *= 2;
+      lambda *= mu;
+      solver.setConstantConditioner(lambda);
+      sm::timing::Timer timer(name + " -- solve after rejected step", false);
+      failures += !solver.solveSystem(dx);
+    }
+  }
+  cout << name << ": nnz(L) = " << solver.getFactorNonZeros() << ", failed solves: " << failures << endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  try
+  {
+    string verbosity = "Info";
+    size_t nPoses = 500;
+    size_t nLandmarks = 20000;
+    size_t nObservations = 20;
+    size_t window = 40;
+    size_t nSystems = 5;
+    size_t nRetries = 4;
+
+    namespace po = boost::program_options;
+    po::options_description desc("benchmark_damping_retries options");
+    desc.add_options()
+      ("help", "Produce help message")
+      ("verbosity,v", po::value(&verbosity)->default_value(verbosity), "Verbosity string")
+      ("num-poses", po::value(&nPoses)->default_value(nPoses), "Number of 6-dimensional design variables")
+      ("num-landmarks", po::value(&nLandmarks)->default_value(nLandmarks), "Number of 3-dimensional design variables")
+      ("num-observations", po::value(&nObservations)->default_value(nObservations), "Number of poses observing each landmark")
+      ("window", po::value(&window)->default_value(window), "Number of consecutive poses a landmark can be observed from")
+      ("num-systems", po::value(&nSystems)->default_value(nSystems), "Number of times the system is built")
+      ("num-retries", po::value(&nRetries)->default_value(nRetries), "Number of rejected steps per system")
+    ;
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    if (vm.count("help")) {
+      cout << desc << endl;
+      return EXIT_SUCCESS;
+    }
+    po::notify(vm);
+    sm::logging::setLevel(sm::logging::levels::fromString(verbosity));
+    srand(0);
+    BundleAdjustmentProblem problem(nPoses, nLandmarks, nObservations, window);
+
+    benchmark(false, "conditioner appended to J^T", problem.dvs, problem.errs, nSystems, nRetries);
+    benchmark(true, "cached Hessian", problem.dvs, problem.errs, nSystems, nRetries);
+
+    sm::timing::Timing::print(cout, sm::timing::SortType::SORT_BY_TOTAL);
+
+  }
+  catch (exception& e)
+  {
+    SM_FATAL_STREAM(e.what());
+    return EXIT_FAILURE;
+  }
+
+}
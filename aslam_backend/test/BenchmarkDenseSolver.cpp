@@ -0,0 +1,141 @@
+/*
+ * BenchmarkDenseSolver.cpp
+ *
+ * Compares the decompositions of the dense QR solver on small calibration-like problems of 50 to 500 parameters.
+ * 5-dimensional design variables are constrained by residuals that involve two of them each. Every built system
+ * is solved for a few damping values, as Levenberg-Marquardt does after rejected steps.
+ */
+
+// standard includes
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// boost includes
+#include <boost/program_options.hpp>
+
+// Schweizer Messer includes
+#include <sm/logging.hpp>
+#include <sm/timing/Timer.hpp>
+
+// aslam backend includes
+#include <aslam/backend/ErrorTerm.hpp>
+#include <aslam/backend/DenseQrLinearSystemSolver.hpp>
+
+#include "BenchmarkProblems.hpp"
+
+using namespace std;
+using namespace aslam::backend;
+
+namespace {
+
+/// \brief A residual of two design variables with constant random Jacobians
+typedef RandomError<6, 5, 5> ResidualError;
+
+void benchmark(DenseQRLinearSolverOptions::Decomposition decomposition, const string& name, const vector<DesignVariable*>& dvs,
+               const vector<ErrorTerm*>& errs, size_t nSystems, size_t nRetries, size_t nThreads, Eigen::VectorXd& inOutReferenceDx)
+{
+  DenseQRLinearSolverOptions options;
+  options.decomposition = decomposition;
+  DenseQrLinearSystemSolver solver(options);
+  solver.initMatrixStructure(dvs, errs, true);
+
+  Eigen::VectorXd dx;
+  for (size_t s = 0; s < nSystems; ++s) {
+    solver.evaluateErrorAndJacobians(nThreads, false);
+    solver.buildSystem(nThreads, false);
+    double lambda = 1e-3;
+    for (size_t r = 0; r <= nRetries; ++r, lambda *= 10) {
+      solver.setConstantConditioner(lambda);
+      sm::timing::Timer timer(name + " -- solve", false);
+      solver.solveSystem(dx);
+    }
+  }
+  if (inOutReferenceDx.size() == 0)
+    inOutReferenceDx = dx;
+  cout << "  " << name << ": max deviation from the first decomposition = " << (dx - inOutReferenceDx).lpNorm<Eigen::Infinity>()
+       << ", fallbacks to QR: " << solver.getNumNormalEquationsFallbacks() << endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  try
+  {
+    string verbosity = "Info";
+    vector<size_t> nParameters = {50, 100, 200, 500};
+    size_t rowsPerParameter = 4;
+    size_t nSystems = 5;
+    size_t nRetries = 3;
+    size_t nThreads = 1;
+
+    namespace po = boost::program_options;
+    po::options_description desc("benchmark_dense_solver options");
+    desc.add_options()
+      ("help", "Produce help message")
+      ("verbosity,v", po::value(&verbosity)->default_value(verbosity), "Verbosity string")
+      ("num-parameters", po::value(&nParameters)->multitoken(), "Numbers of parameters of the problems, multiples of 5 (default: 50 100 200 500)")
+      ("rows-per-parameter", po::value(&rowsPerParameter)->default_value(rowsPerParameter), "Number of residuals per parameter")
+      ("num-systems", po::value(&nSystems)->default_value(nSystems), "Number of times each system is built")
+      ("num-retries", po::value(&nRetries)->default_value(nRetries), "Number of additional solves with a larger damping per system")
+      ("num-threads", po::value(&nThreads)->default_value(nThreads), "Number of threads to build the system and the normal equations")
+    ;
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    if (vm.count("help")) {
+      cout << desc << endl;
+      return EXIT_SUCCESS;
+    }
+    po::notify(vm);
+    sm::logging::setLevel(sm::logging::levels::fromString(verbosity));
+
+    srand(0);
+    for (const size_t n : nParameters) {
+      const size_t nDesignVariables = max<size_t>(2, n / 5);
+      vector<DummyDesignVariable<5> > designVariables(nDesignVariables);
+      vector<DesignVariable*> dvs;
+      int columnBase = 0;
+      for (size_t i = 0; i < designVariables.size(); ++i) {
+        dvs.push_back(&designVariables[i]);
+        dvs[i]->setActive(true);
+        dvs[i]->setBlockIndex(i);
+        dvs[i]->setColumnBase(columnBase);
+        columnBase += dvs[i]->minimalDimensions();
+      }
+
+      vector<unique_ptr<ResidualError> > errorTerms;
+      vector<ErrorTerm*> errs;
+      int rowBase = 0;
+      const size_t nErrorTerms = max<size_t>(nDesignVariables, rowsPerParameter * columnBase / 6);
+      for (size_t i = 0; i < nErrorTerms; ++i) {
+        // A chain through all design variables first, then random pairs
+        const size_t a = i < nDesignVariables ? i : rand() % nDesignVariables;
+        const size_t b = (a + 1 + (i < nDesignVariables ? 0 : rand() % (nDesignVariables - 1))) % nDesignVariables;
+        errorTerms.emplace_back(new ResidualError(dvs[a], dvs[b]));
+        errs.push_back(errorTerms.back().get());
+        errs.back()->setRowBase(rowBase);
+        rowBase += errs.back()->dimension();
+      }
+
+      cout << columnBase << " parameters, " << rowBase << " residuals:" << endl;
+      const string prefix = to_string(columnBase) + " parameters, ";
+      Eigen::VectorXd referenceDx;
+      benchmark(DenseQRLinearSolverOptions::COL_PIV_HOUSEHOLDER_QR, prefix + "column pivoting QR", dvs, errs, nSystems, nRetries, nThreads, referenceDx);
+      benchmark(DenseQRLinearSolverOptions::HOUSEHOLDER_QR, prefix + "blocked QR", dvs, errs, nSystems, nRetries, nThreads, referenceDx);
+      benchmark(DenseQRLinearSolverOptions::NORMAL_EQUATIONS_LLT, prefix + "normal equations LLT", dvs, errs, nSystems, nRetries, nThreads, referenceDx);
+      benchmark(DenseQRLinearSolverOptions::NORMAL_EQUATIONS_LDLT, prefix + "normal equations LDLT", dvs, errs, nSystems, nRetries, nThreads, referenceDx);
+    }
+
+    sm::timing::Timing::print(cout, sm::timing::SortType::SORT_BY_TOTAL);
+
+  }
+  catch (exception& e)
+  {
+    SM_FATAL_STREAM(e.what());
+    return EXIT_FAILURE;
+  }
+
+}
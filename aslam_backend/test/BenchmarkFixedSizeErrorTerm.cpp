@@ -0,0 +1,186 @@
+/*
+ * BenchmarkFixedSizeErrorTerm.cpp
+ *
+ * Compares error terms with fixed-size design variables, ErrorTermFs<2, 6, 3>, against
+ * their dynamic counterpart, ErrorTermFs<2>, for a reprojection-like problem: the Hessian
+ * assembly into a SparseBlockMatrix and the assembly of the compressed column J^T.
+ */
+
+// standard includes
+#include <memory>
+#include <vector>
+#include <string>
+
+// boost includes
+#include <boost/program_options.hpp>
+
+// Schweizer Messer includes
+#include <sm/logging.hpp>
+#include <sm/timing/Timer.hpp>
+
+// aslam backend includes
+#include <aslam/backend/CompressedColumnJacobianTransposeBuilder.hpp>
+#include <aslam/backend/ErrorTerm.hpp>
+
+#include "DummyDesignVariable.hpp"
+
+using namespace std;
+using namespace aslam::backend;
+
+namespace {
+
+/// \brief The values of a reprojection error term with respect to a pose and a landmark
+struct ReprojectionData {
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  Eigen::Vector2d error = Eigen::Vector2d::Random();
+  Eigen::Matrix<double, 2, 6> J_pose = Eigen::Matrix<double, 2, 6>::Random();
+  Eigen::Matrix<double, 2, 3> J_landmark = Eigen::Matrix<double, 2, 3>::Random();
+  Eigen::Matrix2d invR = (Eigen::Matrix2d() << 2.0, 0.5, 0.5, 1.0).finished();
+};
+
+class DynamicReprojectionError : public ErrorTermFs<2> {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  DynamicReprojectionError(DesignVariable* pose, DesignVariable* landmark) : _pose(pose), _landmark(landmark) {
+    setDesignVariables(pose, landmark);
+    setInvR(_data.invR);
+  }
+ protected:
+  double evaluateErrorImplementation() override {
+    setError(_data.error);
+    return evaluateChiSquaredError();
+  }
+  void evaluateJacobiansImplementation(JacobianContainer& outJ) override {
+    outJ.add(_pose, _data.J_pose);
+    outJ.add(_landmark, _data.J_landmark);
+  }
+ private:
+  DesignVariable* _pose;
+  DesignVariable* _landmark;
+  ReprojectionData _data;
+};
+
+class FixedSizeReprojectionError : public ErrorTermFs<2, 6, 3> {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  FixedSizeReprojectionError(DesignVariable* pose, DesignVariable* landmark) {
+    setDesignVariables(pose, landmark);
+    setInvR(_data.invR);
+  }
+ protected:
+  double evaluateErrorImplementation() override {
+    setError(_data.error);
+    return evaluateChiSquaredError();
+  }
+  void evaluateFixedSizeJacobiansImplementation(jacobian_t& outJ) override {
+    jacobianBlock<0>(outJ) = _data.J_pose;
+    jacobianBlock<1>(outJ) = _data.J_landmark;
+  }
+ private:
+  ReprojectionData _data;
+};
+
+template <typename ERROR_TERM>
+void benchmark(const string& name, vector<DesignVariable*>& poses, vector<DesignVariable*>& landmarks, size_t nErrorTerms, size_t nIterations)
+{
+  vector<unique_ptr<ERROR_TERM> > errorTerms;
+  vector<ErrorTerm*> errs;
+  vector<DesignVariable*> dvs(poses);
+  dvs.insert(dvs.end(), landmarks.begin(), landmarks.end());
+  int rowBase = 0;
+  for (size_t i = 0; i < nErrorTerms; ++i) {
+    errorTerms.emplace_back(new ERROR_TERM(poses[i % poses.size()], landmarks[i % landmarks.size()]));
+    errs.push_back(errorTerms.back().get());
+    errs.back()->setRowBase(rowBase);
+    rowBase += errs.back()->dimension();
+    errs.back()->evaluateError();
+  }
+
+  vector<int> blocks;
+  int cols = 0;
+  for (DesignVariable* dv : dvs) {
+    cols += dv->minimalDimensions();
+    blocks.push_back(cols);
+  }
+  SparseBlockMatrix H(blocks, blocks, true);
+  Eigen::VectorXd rhs(cols);
+  {
+    sm::timing::Timer timer(name + " -- Hessian", false);
+    for (size_t it = 0; it < nIterations; ++it) {
+      H.clear(false);
+      rhs.setZero();
+      for (ErrorTerm* e : errs)
+        e->buildHessian(H, rhs, false);
+    }
+  }
+
+  CompressedColumnJacobianTransposeBuilder<int> builder;
+  builder.initMatrixStructure(dvs, errs);
+  {
+    sm::timing::Timer timer(name + " -- Jacobian transpose", false);
+    for (size_t it = 0; it < nIterations; ++it)
+      builder.buildSystem(1, false);
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  try
+  {
+    string verbosity = "Info";
+    size_t nIterations = 100;
+    size_t nPoses = 100;
+    size_t nLandmarks = 1000;
+    size_t nErrorTerms = 20000;
+
+    namespace po = boost::program_options;
+    po::options_description desc("benchmark_fixed_size_error_term options");
+    desc.add_options()
+      ("help", "Produce help message")
+      ("verbosity,v", po::value(&verbosity)->default_value(verbosity), "Verbosity string")
+      ("num-iterations", po::value(&nIterations)->default_value(nIterations), "Number of iterations")
+      ("num-poses", po::value(&nPoses)->default_value(nPoses), "Number of 6-dimensional design variables")
+      ("num-landmarks", po::value(&nLandmarks)->default_value(nLandmarks), "Number of 3-dimensional design variables")
+      ("num-error-terms", po::value(&nErrorTerms)->default_value(nErrorTerms), "Number of 2-dimensional error terms")
+    ;
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    if (vm.count("help")) {
+      cout << desc << endl;
+      return EXIT_SUCCESS;
+    }
+    po::notify(vm);
+    sm::logging::setLevel(sm::logging::levels::fromString(verbosity));
+
+    vector<DummyDesignVariable<6> > poseVariables(nPoses);
+    vector<DummyDesignVariable<3> > landmarkVariables(nLandmarks);
+    vector<DesignVariable*> poses, landmarks;
+    int blockIndex = 0, columnBase = 0;
+    for (auto& dv : poseVariables)
+      poses.push_back(&dv);
+    for (auto& dv : landmarkVariables)
+      landmarks.push_back(&dv);
+    for (vector<DesignVariable*>* list : { &poses, &landmarks }) {
+      for (DesignVariable* dv : *list) {
+        dv->setActive(true);
+        dv->setBlockIndex(blockIndex++);
+        dv->setColumnBase(columnBase);
+        columnBase += dv->minimalDimensions();
+      }
+    }
+
+    benchmark<DynamicReprojectionError>("ErrorTermFs<2>", poses, landmarks, nErrorTerms, nIterations);
+    benchmark<FixedSizeReprojectionError>("ErrorTermFs<2, 6, 3>", poses, landmarks, nErrorTerms, nIterations);
+
+    sm::timing::Timing::print(cout, sm::timing::SortType::SORT_BY_TOTAL);
+
+  }
+  catch (exception& e)
+  {
+    SM_FATAL_STREAM(e.what());
+    return EXIT_FAILURE;
+  }
+
+}
@@ -0,0 +1,135 @@
+/*
+ * BenchmarkHessianAssembly.cpp
+ *
+ * Compares the time and memory of the sparse Cholesky solver factoring J^T with the ones of assembling J^T J
+ * directly from the error terms, on a tall problem: a few 6-dimensional design variables, e.g. calibration
+ * parameters, are constrained by many residuals, each of which involves two of them.
+ */
+
+// standard includes
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// boost includes
+#include <boost/program_options.hpp>
+
+// Schweizer Messer includes
+#include <sm/logging.hpp>
+#include <sm/timing/Timer.hpp>
+
+// aslam backend includes
+#include <aslam/backend/ErrorTerm.hpp>
+#include <aslam/backend/SparseCholeskyLinearSystemSolver.hpp>
+
+#include "BenchmarkProblems.hpp"
+
+using namespace std;
+using namespace aslam::backend;
+
+namespace {
+
+/// \brief A residual of two design variables with constant random Jacobians
+typedef RandomError<3, 6, 6> ResidualError;
+
+void benchmark(bool assembleHessian, const string& name, const vector<DesignVariable*>& dvs, const vector<ErrorTerm*>& errs,
+               size_t nSystems, size_t nThreads)
+{
+  SparseCholeskyLinearSolverOptions options;
+  options.assembleHessian = assembleHessian;
+  SparseCholeskyLinearSystemSolver solver(options);
+  {
+    sm::timing::Timer timer(name + " -- init structure", false);
+    solver.initMatrixStructure(dvs, errs, true);
+  }
+  solver.setConstantConditioner(1e-3);
+
+  Eigen::VectorXd dx;
+  size_t failures = 0;
+  for (size_t s = 0; s < nSystems; ++s) {
+    {
+      sm::timing::Timer timer(name + " -- evaluate", false);
+      solver.evaluateErrorAndJacobians(nThreads, false);
+    }
+    {
+      sm::timing::Timer timer(name + " -- build system", false);
+      solver.buildSystem(nThreads, false);
+    }
+    sm::timing::Timer timer(name + " -- solve", false);
+    failures += !solver.solveSystem(dx);
+  }
+  cout << name << ": memory = " << solver.getMemoryUsage() / 1024 << " KiB, nnz(L) = " << solver.getFactorNonZeros()
+       << ", failed solves: " << failures << endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  try
+  {
+    string verbosity = "Info";
+    size_t nDesignVariables = 20;
+    size_t nErrorTerms = 200000;
+    size_t nSystems = 5;
+    size_t nThreads = 4;
+
+    namespace po = boost::program_options;
+    po::options_description desc("benchmark_hessian_assembly options");
+    desc.add_options()
+      ("help", "Produce help message")
+      ("verbosity,v", po::value(&verbosity)->default_value(verbosity), "Verbosity string")
+      ("num-design-variables", po::value(&nDesignVariables)->default_value(nDesignVariables), "Number of 6-dimensional design variables")
+      ("num-error-terms", po::value(&nErrorTerms)->default_value(nErrorTerms), "Number of 3-dimensional error terms")
+      ("num-systems", po::value(&nSystems)->default_value(nSystems), "Number of times the system is built and solved")
+      ("num-threads", po::value(&nThreads)->default_value(nThreads), "Number of threads")
+    ;
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    if (vm.count("help")) {
+      cout << desc << endl;
+      return EXIT_SUCCESS;
+    }
+    po::notify(vm);
+    sm::logging::setLevel(sm::logging::levels::fromString(verbosity));
+    nDesignVariables = max<size_t>(2, nDesignVariables);
+
+    vector<DummyDesignVariable<6> > designVariables(nDesignVariables);
+    vector<DesignVariable*> dvs;
+    int columnBase = 0;
+    for (size_t i = 0; i < designVariables.size(); ++i) {
+      dvs.push_back(&designVariables[i]);
+      dvs[i]->setActive(true);
+      dvs[i]->setBlockIndex(i);
+      dvs[i]->setColumnBase(columnBase);
+      columnBase += dvs[i]->minimalDimensions();
+    }
+
+    srand(0);
+    vector<unique_ptr<ResidualError> > errorTerms;
+    vector<ErrorTerm*> errs;
+    int rowBase = 0;
+    for (size_t i = 0; i < nErrorTerms; ++i) {
+      const size_t a = rand() % nDesignVariables;
+      const size_t b = (a + 1 + rand() % (nDesignVariables - 1)) % nDesignVariables;
+      errorTerms.emplace_back(new ResidualError(dvs[a], dvs[b]));
+      errs.push_back(errorTerms.back().get());
+      errs.back()->setRowBase(rowBase);
+      rowBase += errs.back()->dimension();
+    }
+
+    benchmark(false, "J^T", dvs, errs, nSystems, nThreads);
+    benchmark(true, "assembled J^T J", dvs, errs, nSystems, nThreads);
+
+    sm::timing::Timing::print(cout, sm::timing::SortType::SORT_BY_TOTAL);
+
+  }
+  catch (exception& e)
+  {
+    SM_FATAL_STREAM(e.what());
+    return EXIT_FAILURE;
+  }
+
+}
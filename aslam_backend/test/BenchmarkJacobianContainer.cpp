@@ -0,0 +1,166 @@
+/*
+ * BenchmarkJacobianContainer.cpp
+ *
+ * Measures the cost of filling and reading a JacobianContainerSparse the way an
+ * error term evaluation does. The flat container is compared against the former
+ * std::map based layout, both constructed per error term and reused via reset().
+ */
+
+// standard includes
+#include <map>
+#include <vector>
+#include <string>
+
+// boost includes
+#include <boost/program_options.hpp>
+
+// Schweizer Messer includes
+#include <sm/logging.hpp>
+#include <sm/timing/Timer.hpp>
+
+// aslam backend includes
+#include <aslam/backend/JacobianContainerSparse.hpp>
+
+#include "DummyDesignVariable.hpp"
+
+using namespace std;
+using namespace aslam::backend;
+
+namespace {
+
+/// \brief The Jacobian storage used by JacobianContainerSparse before it was flattened
+struct MapJacobianContainer : public JacobianContainer {
+  typedef std::map<DesignVariable*, Eigen::MatrixXd, DesignVariable::BlockIndexOrdering> map_t;
+  static constexpr const int RowsAtCompileTime = Eigen::Dynamic;
+
+  MapJacobianContainer(int rows) : JacobianContainer(rows) { }
+
+  void add(DesignVariable* dv, const Eigen::Ref<const Eigen::MatrixXd>& jacobian) override {
+    internal::JacobianContainerImplHelper::addImpl(*this, dv, jacobian);
+  }
+  void add(DesignVariable* dv) override {
+    internal::JacobianContainerImplHelper::addImpl(*this, dv);
+  }
+  Eigen::MatrixXd asDenseMatrix() const override { return Eigen::MatrixXd(); }
+  bool isFinite(const DesignVariable& dv) const override { return jacobians.at(const_cast<DesignVariable*>(&dv)).allFinite(); }
+
+  template <typename MATRIX>
+  void addJacobian(DesignVariable* dv, const MATRIX& jacobian) {
+    map_t::iterator it = jacobians.find(dv);
+    if (it == jacobians.end())
+      jacobians.emplace(dv, jacobian);
+    else
+      it->second.noalias() += jacobian;
+  }
+
+  void reset(int rows) {
+    jacobians.clear();
+    _rows = rows;
+  }
+
+  map_t::const_iterator begin() const { return jacobians.begin(); }
+  map_t::const_iterator end() const { return jacobians.end(); }
+
+  map_t jacobians;
+};
+
+void addAll(JacobianContainer& jc, const vector<DesignVariable*>& dvs, const Eigen::MatrixXd& J) {
+  for (DesignVariable* dv : dvs)
+    jc.add(dv, J);
+}
+
+/// \brief Mimics an error term evaluation: every design variable contributes twice,
+///        once directly and once through a chain rule. Returns the sum of J^T e to consume the Jacobians.
+template <typename CONTAINER>
+double fillAndRead(CONTAINER& jc, const vector<DesignVariable*>& dvs, const Eigen::MatrixXd& J, const Eigen::MatrixXd& chainRule, const Eigen::VectorXd& e) {
+  addAll(jc, dvs, J);
+  addAll(jc.apply(chainRule), dvs, J);
+  double sum = 0.0;
+  for (auto it = jc.begin(); it != jc.end(); ++it)
+    sum += (it->second.transpose() * e).sum();
+  return sum;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  try
+  {
+    string verbosity = "Info";
+    size_t nIterations = 1000000;
+    int nRows = 3;
+    size_t nDesignVariables = 3;
+
+    namespace po = boost::program_options;
+    po::options_description desc("benchmark_jacobian_container options");
+    desc.add_options()
+      ("help", "Produce help message")
+      ("verbosity,v", po::value(&verbosity)->default_value(verbosity), "Verbosity string")
+      ("num-iterations", po::value(&nIterations)->default_value(nIterations), "Number of simulated error term evaluations")
+      ("num-rows", po::value(&nRows)->default_value(nRows), "Dimension of the error term")
+      ("num-design-variables", po::value(&nDesignVariables)->default_value(nDesignVariables), "Number of 6-dimensional design variables per error term")
+    ;
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    if (vm.count("help")) {
+      cout << desc << endl;
+      return EXIT_SUCCESS;
+    }
+    po::notify(vm);
+    sm::logging::setLevel(sm::logging::levels::fromString(verbosity));
+
+    vector<DummyDesignVariable<6> > designVariables(nDesignVariables);
+    vector<DesignVariable*> dvs;
+    for (size_t i = 0; i < nDesignVariables; ++i) {
+      designVariables[i].setActive(true);
+      designVariables[i].setBlockIndex(nDesignVariables - i); // add in reverse block order
+      dvs.push_back(&designVariables[i]);
+    }
+    const Eigen::MatrixXd J = Eigen::MatrixXd::Random(nRows, 6);
+    const Eigen::MatrixXd chainRule = Eigen::MatrixXd::Random(nRows, nRows);
+    const Eigen::VectorXd e = Eigen::VectorXd::Random(nRows);
+
+    double sum = 0.0;
+    {
+      sm::timing::Timer timer("std::map -- per error term", false);
+      for (size_t i = 0; i < nIterations; ++i) {
+        MapJacobianContainer jc(nRows);
+        sum += fillAndRead(jc, dvs, J, chainRule, e);
+      }
+    }
+    {
+      MapJacobianContainer jc(nRows);
+      sm::timing::Timer timer("std::map -- reset", false);
+      for (size_t i = 0; i < nIterations; ++i) {
+        jc.reset(nRows);
+        sum += fillAndRead(jc, dvs, J, chainRule, e);
+      }
+    }
+    {
+      sm::timing::Timer timer("JacobianContainerSparse -- per error term", false);
+      for (size_t i = 0; i < nIterations; ++i) {
+        JacobianContainerSparse<> jc(nRows);
+        sum += fillAndRead(jc, dvs, J, chainRule, e);
+      }
+    }
+    {
+      JacobianContainerSparse<> jc(nRows);
+      sm::timing::Timer timer("JacobianContainerSparse -- reset", false);
+      for (size_t i = 0; i < nIterations; ++i) {
+        jc.reset(nRows);
+        sum += fillAndRead(jc, dvs, J, chainRule, e);
+      }
+    }
+    SM_DEBUG_STREAM("Checksum: " << sum);
+
+    sm::timing::Timing::print(cout, sm::timing::SortType::SORT_BY_TOTAL);
+
+  }
+  catch (exception& e)
+  {
+    SM_FATAL_STREAM(e.what());
+    return EXIT_FAILURE;
+  }
+
+}
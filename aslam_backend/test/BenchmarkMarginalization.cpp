@@ -0,0 +1,131 @@
+/*
+ * BenchmarkMarginalization.cpp
+ *
+ * Compares the dense QR and the Schur complement marginalization on sliding-window-like problems of growing size.
+ * Every state of the window consists of a 6-dimensional pose and a 9-dimensional speed and bias design variable,
+ * which are tied to the next state by a 15-dimensional motion error. Landmarks are observed by consecutive poses.
+ * The 15 dimensions of the oldest state are marginalized, with all error terms of the window as input.
+ */
+
+// standard includes
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// boost includes
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+
+// Schweizer Messer includes
+#include <sm/logging.hpp>
+#include <sm/timing/Timer.hpp>
+
+// aslam backend includes
+#include <aslam/backend/ErrorTerm.hpp>
+#include <aslam/backend/Marginalizer.hpp>
+
+#include "BenchmarkProblems.hpp"
+
+using namespace std;
+using namespace aslam::backend;
+
+namespace {
+
+typedef RandomError<15, 6, 9, 6, 9> MotionError;
+
+void benchmark(MarginalizerOptions::Method method, const string& name, size_t windowSize, size_t nLandmarks,
+               size_t nObservations, size_t nThreads, size_t nRepetitions)
+{
+  vector<DummyDesignVariable<6> > poses(windowSize);
+  vector<DummyDesignVariable<9> > speedAndBiases(windowSize);
+  vector<DummyDesignVariable<3> > landmarks(windowSize * nLandmarks);
+  // The design variables of the oldest state have to come first
+  vector<DesignVariable*> dvs;
+  for (size_t s = 0; s < windowSize; ++s) {
+    dvs.push_back(&poses[s]);
+    dvs.push_back(&speedAndBiases[s]);
+  }
+  for (auto& dv : landmarks)
+    dvs.push_back(&dv);
+  for (DesignVariable* dv : dvs)
+    dv->setActive(true);
+
+  vector<unique_ptr<ErrorTerm> > errorTerms;
+  for (size_t s = 0; s + 1 < windowSize; ++s)
+    errorTerms.emplace_back(new MotionError(&poses[s], &speedAndBiases[s], &poses[s + 1], &speedAndBiases[s + 1]));
+  for (size_t l = 0; l < landmarks.size(); ++l) {
+    const size_t first = min(l / nLandmarks, windowSize - min(nObservations, windowSize));
+    for (size_t o = 0; o < nObservations && first + o < windowSize; ++o)
+      errorTerms.emplace_back(new ObservationError(&poses[first + o], &landmarks[l]));
+  }
+  vector<ErrorTerm*> errs;
+  for (auto& e : errorTerms)
+    errs.push_back(e.get());
+
+  MarginalizerOptions options;
+  options.method = method;
+  options.numThreads = nThreads;
+  const string label = name + " -- window of " + boost::lexical_cast<string>(windowSize) + " states";
+  for (size_t r = 0; r < nRepetitions; ++r) {
+    boost::shared_ptr<MarginalizationPriorErrorTerm> prior;
+    Eigen::MatrixXd cov;
+    vector<DesignVariable*> top;
+    sm::timing::Timer timer(label, false);
+    marginalize(dvs, errs, 2, false, prior, cov, top, 0, options);
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  try
+  {
+    string verbosity = "Warn";
+    size_t minWindowSize = 5;
+    size_t maxWindowSize = 20;
+    size_t nLandmarks = 10;
+    size_t nObservations = 4;
+    size_t nThreads = 4;
+    size_t nRepetitions = 3;
+
+    namespace po = boost::program_options;
+    po::options_description desc("benchmark_marginalization options");
+    desc.add_options()
+      ("help", "Produce help message")
+      ("verbosity,v", po::value(&verbosity)->default_value(verbosity), "Verbosity string")
+      ("min-window-size", po::value(&minWindowSize)->default_value(minWindowSize), "Number of states of the smallest window")
+      ("max-window-size", po::value(&maxWindowSize)->default_value(maxWindowSize), "Number of states of the largest window, the size is doubled up to it")
+      ("num-landmarks", po::value(&nLandmarks)->default_value(nLandmarks), "Number of landmarks per state")
+      ("num-observations", po::value(&nObservations)->default_value(nObservations), "Number of consecutive poses observing each landmark")
+      ("num-threads", po::value(&nThreads)->default_value(nThreads), "Number of threads")
+      ("num-repetitions", po::value(&nRepetitions)->default_value(nRepetitions), "Number of marginalizations per window size")
+    ;
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    if (vm.count("help")) {
+      cout << desc << endl;
+      return EXIT_SUCCESS;
+    }
+    po::notify(vm);
+    sm::logging::setLevel(sm::logging::levels::fromString(verbosity));
+
+    for (size_t windowSize = max<size_t>(2, minWindowSize); windowSize <= maxWindowSize; windowSize *= 2) {
+      srand(0);
+      benchmark(MarginalizerOptions::DENSE_QR, "dense QR", windowSize, nLandmarks, nObservations, nThreads, nRepetitions);
+      srand(0);
+      benchmark(MarginalizerOptions::SCHUR_COMPLEMENT, "Schur complement", windowSize, nLandmarks, nObservations, nThreads, nRepetitions);
+    }
+
+    sm::timing::Timing::print(cout, sm::timing::SortType::SORT_BY_TOTAL);
+
+  }
+  catch (exception& e)
+  {
+    SM_FATAL_STREAM(e.what());
+    return EXIT_FAILURE;
+  }
+
+}
@@ -0,0 +1,107 @@
+/*
+ * BenchmarkOrdering.cpp
+ *
+ * Compares the fill-reducing orderings of the sparse Cholesky solver on a structure-from-motion-like
+ * problem: 6-dimensional poses observe 3-dimensional landmarks within a window of neighbouring poses.
+ * Reports the number of non-zeros in the factor and the time of the first (symbolic and numeric)
+ * and the second (numeric only) solve.
+ */
+
+// standard includes
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// boost includes
+#include <boost/program_options.hpp>
+
+// Schweizer Messer includes
+#include <sm/logging.hpp>
+#include <sm/timing/Timer.hpp>
+
+// aslam backend includes
+#include <aslam/backend/ErrorTerm.hpp>
+#include <aslam/backend/SparseCholeskyLinearSystemSolver.hpp>
+
+#include "BenchmarkProblems.hpp"
+
+using namespace std;
+using namespace aslam::backend;
+
+namespace {
+
+void benchmark(SparseCholeskyLinearSolverOptions::Ordering ordering, const string& name,
+               const vector<DesignVariable*>& dvs, const vector<ErrorTerm*>& errs)
+{
+  SparseCholeskyLinearSolverOptions options;
+  options.ordering = ordering;
+  SparseCholeskyLinearSystemSolver solver(options);
+  solver.initMatrixStructure(dvs, errs, true);
+  solver.setConditioner(Eigen::VectorXd::Constant(solver.JCols(), 1e-3));
+  solver.evaluateError(1, false);
+  solver.buildSystem(1, false);
+
+  Eigen::VectorXd dx;
+  bool success;
+  {
+    sm::timing::Timer timer(name + " -- ordering, symbolic and numeric factorization", false);
+    success = solver.solveSystem(dx);
+  }
+  {
+    sm::timing::Timer timer(name + " -- numeric factorization", false);
+    success = solver.solveSystem(dx) && success;
+  }
+  cout << name << ": nnz(L) = " << solver.getFactorNonZeros() << (success ? "" : " (solve failed)") << endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  try
+  {
+    string verbosity = "Info";
+    size_t nPoses = 500;
+    size_t nLandmarks = 20000;
+    size_t nObservations = 8;
+    size_t window = 20;
+
+    namespace po = boost::program_options;
+    po::options_description desc("benchmark_ordering options");
+    desc.add_options()
+      ("help", "Produce help message")
+      ("verbosity,v", po::value(&verbosity)->default_value(verbosity), "Verbosity string")
+      ("num-poses", po::value(&nPoses)->default_value(nPoses), "Number of 6-dimensional design variables")
+      ("num-landmarks", po::value(&nLandmarks)->default_value(nLandmarks), "Number of 3-dimensional design variables")
+      ("num-observations", po::value(&nObservations)->default_value(nObservations), "Number of poses observing each landmark")
+      ("window", po::value(&window)->default_value(window), "Number of consecutive poses a landmark can be observed from")
+    ;
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    if (vm.count("help")) {
+      cout << desc << endl;
+      return EXIT_SUCCESS;
+    }
+    po::notify(vm);
+    sm::logging::setLevel(sm::logging::levels::fromString(verbosity));
+    srand(0);
+    BundleAdjustmentProblem problem(nPoses, nLandmarks, nObservations, window);
+    const vector<DesignVariable*>& dvs = problem.dvs;
+    const vector<ErrorTerm*>& errs = problem.errs;
+
+    benchmark(SparseCholeskyLinearSolverOptions::SCALAR_AMD, "scalar AMD", dvs, errs);
+    benchmark(SparseCholeskyLinearSolverOptions::BLOCK_AMD, "block AMD", dvs, errs);
+    benchmark(SparseCholeskyLinearSolverOptions::BLOCK_COLAMD, "block COLAMD", dvs, errs);
+    benchmark(SparseCholeskyLinearSolverOptions::BLOCK_NESTED_DISSECTION, "block nested dissection", dvs, errs);
+
+    sm::timing::Timing::print(cout, sm::timing::SortType::SORT_BY_TOTAL);
+
+  }
+  catch (exception& e)
+  {
+    SM_FATAL_STREAM(e.what());
+    return EXIT_FAILURE;
+  }
+
+}
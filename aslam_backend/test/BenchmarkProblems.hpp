@@ -0,0 +1,79 @@
+#ifndef _BENCHMARKPROBLEMS_H_
+#define _BENCHMARKPROBLEMS_H_
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include <aslam/backend/ErrorTerm.hpp>
+#include "DummyDesignVariable.hpp"
+
+/// \brief An error term with a constant random error and constant random Jacobians
+template <int DIMENSION, int... DIMENSIONS>
+class RandomError : public aslam::backend::ErrorTermFs<DIMENSION, DIMENSIONS...> {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  typedef aslam::backend::ErrorTermFs<DIMENSION, DIMENSIONS...> parent_t;
+  template <typename... DESIGN_VARIABLES>
+  RandomError(DESIGN_VARIABLES*... dvs) {
+    parent_t::setDesignVariables(dvs...);
+  }
+ protected:
+  double evaluateErrorImplementation() override {
+    parent_t::setError(_error);
+    return parent_t::evaluateChiSquaredError();
+  }
+  void evaluateFixedSizeJacobiansImplementation(typename parent_t::jacobian_t& outJ) override {
+    outJ = _J;
+  }
+ private:
+  typename parent_t::error_t _error = parent_t::error_t::Random();
+  typename parent_t::jacobian_t _J = parent_t::jacobian_t::Random();
+};
+
+/// \brief A reprojection-like error term of a 6-dimensional pose and a 3-dimensional landmark
+typedef RandomError<2, 6, 3> ObservationError;
+
+/// \brief A structure-from-motion-like problem: 6-dimensional poses observe 3-dimensional landmarks
+///        within a window of neighbouring poses. The poses come first, all design variables are active
+///        and the block indices, column and row bases are set. The observations are drawn with rand().
+struct BundleAdjustmentProblem {
+  std::vector<DummyDesignVariable<6> > poses;
+  std::vector<DummyDesignVariable<3> > landmarks;
+  std::vector<std::unique_ptr<ObservationError> > errorTerms;
+  std::vector<aslam::backend::DesignVariable*> dvs;
+  std::vector<aslam::backend::ErrorTerm*> errs;
+
+  /// \brief Every landmark is observed \p nObservations times from a random window of \p window consecutive poses.
+  ///        With \p window equal to \p nPoses the observing poses are uniformly distributed.
+  BundleAdjustmentProblem(size_t nPoses, size_t nLandmarks, size_t nObservations, size_t window)
+      : poses(nPoses), landmarks(nLandmarks) {
+    window = std::max(window, nObservations);
+    for (auto& dv : poses)
+      dvs.push_back(&dv);
+    for (auto& dv : landmarks)
+      dvs.push_back(&dv);
+    int columnBase = 0;
+    for (size_t i = 0; i < dvs.size(); ++i) {
+      dvs[i]->setActive(true);
+      dvs[i]->setBlockIndex(i);
+      dvs[i]->setColumnBase(columnBase);
+      columnBase += dvs[i]->minimalDimensions();
+    }
+
+    int rowBase = 0;
+    for (auto& landmark : landmarks) {
+      const size_t first = rand() % (nPoses - std::min(window, nPoses) + 1);
+      for (size_t o = 0; o < nObservations; ++o) {
+        errorTerms.emplace_back(new ObservationError(&poses[(first + rand() % window) % nPoses], &landmark));
+        errs.push_back(errorTerms.back().get());
+        errs.back()->setRowBase(rowBase);
+        rowBase += errs.back()->dimension();
+      }
+    }
+  }
+  BundleAdjustmentProblem(const BundleAdjustmentProblem&) = delete;
+  BundleAdjustmentProblem& operator=(const BundleAdjustmentProblem&) = delete;
+};
+
+#endif /* _BENCHMARKPROBLEMS_H_ */
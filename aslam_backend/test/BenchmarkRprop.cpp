@@ -0,0 +1,187 @@
+/*
+ * BenchmarkRprop.cpp
+ *
+ * Measures the iterations of the Rprop optimizer on a large problem with about one million parameters. The
+ * parameters are split into 8-dimensional design variables, each of which is tied to the next one by a
+ * non-squared scalar error term. The gradient is accumulated with the dense and the sparse Jacobian container
+ * and with one and several threads, the timers of the optimizer split the iterations into gradient, step and update.
+ */
+
+// standard includes
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// boost includes
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+
+// Schweizer Messer includes
+#include <sm/logging.hpp>
+#include <sm/timing/Timer.hpp>
+
+// aslam backend includes
+#include <aslam/backend/OptimizationProblem.hpp>
+#include <aslam/backend/OptimizerRprop.hpp>
+#include <aslam/backend/ScalarNonSquaredErrorTerm.hpp>
+
+using namespace std;
+using namespace aslam::backend;
+
+namespace {
+
+const int D = 8;
+typedef Eigen::Matrix<double, D, 1> vector_t;
+
+/// \brief A vector design variable
+class VectorDesignVariable : public DesignVariable {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  vector_t _v = vector_t::Random();
+  vector_t _p_v = _v;
+ protected:
+  void revertUpdateImplementation() override { _v = _p_v; }
+  void updateImplementation(const double* dp, int /* size */) override {
+    _p_v = _v;
+    _v += Eigen::Map<const vector_t>(dp);
+  }
+  int minimalDimensionsImplementation() const override { return D; }
+  void getParametersImplementation(Eigen::MatrixXd& value) const override { value = _v; }
+  void setParametersImplementation(const Eigen::MatrixXd& value) override {
+    _p_v = _v;
+    _v = value;
+  }
+};
+
+/// \brief The squared residual \f$ (a^T x_i + b^T x_{i+1} - c)^2 \f$ of two neighbouring design variables
+class ChainError : public ScalarNonSquaredErrorTerm {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  ChainError(VectorDesignVariable* first, VectorDesignVariable* second) : _first(first), _second(second) {
+    setDesignVariables(first, second);
+    setWeight(1.0);
+  }
+ protected:
+  double evaluateErrorImplementation() override {
+    const double r = residual();
+    return r*r;
+  }
+  void evaluateJacobiansImplementation(JacobianContainer& outJ) override {
+    const double r = residual();
+    outJ.add(_first, 2.0*r*_a.transpose());
+    outJ.add(_second, 2.0*r*_b.transpose());
+  }
+ private:
+  double residual() const { return _a.dot(_first->_v) + _b.dot(_second->_v) - _c; }
+  VectorDesignVariable* _first;
+  VectorDesignVariable* _second;
+  vector_t _a = vector_t::Random();
+  vector_t _b = vector_t::Random();
+  double _c = vector_t::Random()[0];
+};
+
+typedef vector<vector_t, Eigen::aligned_allocator<vector_t> > state_t;
+
+void benchmark(const vector<VectorDesignVariable*>& dvs, const vector<ChainError*>& errs, const state_t& initialState,
+               bool useDenseJacobianContainer, size_t nThreads, size_t nIterations, size_t nRepetitions)
+{
+  boost::shared_ptr<OptimizationProblem> problem(new OptimizationProblem);
+  for (VectorDesignVariable* dv : dvs)
+    problem->addDesignVariable(dv, false);
+  for (ChainError* e : errs)
+    problem->addErrorTerm(e, false);
+
+  OptimizerRprop::Options options;
+  options.maxIterations = static_cast<int>(nIterations);
+  options.numThreadsJacobian = nThreads;
+  options.numThreadsError = nThreads;
+  // Only a tiny gradient norm terminates the run early
+  options.convergenceGradientNorm = 1e-12;
+  options.convergenceDeltaX = 0.0;
+  options.convergenceDeltaError = 0.0;
+  options.useDenseJacobianContainer = useDenseJacobianContainer;
+  OptimizerRprop optimizer(options);
+  optimizer.setProblem(problem);
+
+  const string label = string(useDenseJacobianContainer ? "dense" : "sparse") + " container -- " +
+      boost::lexical_cast<string>(nThreads) + " thread(s)";
+  for (size_t r = 0; r < nRepetitions; ++r) {
+    // Every run starts from the same state
+    for (size_t i = 0; i < dvs.size(); ++i)
+      dvs[i]->_v = initialState[i];
+    optimizer.initialize();
+    sm::timing::Timer timer(label, false);
+    optimizer.optimize();
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  try
+  {
+    string verbosity = "Warn";
+    size_t nParameters = 1000000;
+    size_t nThreads = 4;
+    size_t nIterations = 10;
+    size_t nRepetitions = 3;
+
+    namespace po = boost::program_options;
+    po::options_description desc("benchmark_rprop options");
+    desc.add_options()
+      ("help", "Produce help message")
+      ("verbosity,v", po::value(&verbosity)->default_value(verbosity), "Verbosity string")
+      ("num-parameters", po::value(&nParameters)->default_value(nParameters), "Number of parameters, rounded down to a multiple of the design variable dimension")
+      ("num-threads", po::value(&nThreads)->default_value(nThreads), "Number of threads of the multi-threaded runs")
+      ("num-iterations", po::value(&nIterations)->default_value(nIterations), "Number of Rprop iterations per run")
+      ("num-repetitions", po::value(&nRepetitions)->default_value(nRepetitions), "Number of runs per configuration")
+    ;
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    if (vm.count("help")) {
+      cout << desc << endl;
+      return EXIT_SUCCESS;
+    }
+    po::notify(vm);
+    sm::logging::setLevel(sm::logging::levels::fromString(verbosity));
+
+    srand(0);
+    const size_t nDesignVariables = max<size_t>(2, nParameters / D);
+    vector<unique_ptr<VectorDesignVariable> > designVariables;
+    vector<VectorDesignVariable*> dvs;
+    for (size_t i = 0; i < nDesignVariables; ++i) {
+      designVariables.emplace_back(new VectorDesignVariable());
+      dvs.push_back(designVariables.back().get());
+      dvs.back()->setActive(true);
+    }
+    vector<unique_ptr<ChainError> > errorTerms;
+    vector<ChainError*> errs;
+    for (size_t i = 0; i + 1 < nDesignVariables; ++i) {
+      errorTerms.emplace_back(new ChainError(dvs[i], dvs[i + 1]));
+      errs.push_back(errorTerms.back().get());
+    }
+    state_t initialState;
+    for (const VectorDesignVariable* dv : dvs)
+      initialState.push_back(dv->_v);
+
+    vector<size_t> threadCounts(1, 1);
+    if (nThreads > 1)
+      threadCounts.push_back(nThreads);
+    for (bool useDenseJacobianContainer : {true, false}) {
+      for (size_t threads : threadCounts)
+        benchmark(dvs, errs, initialState, useDenseJacobianContainer, threads, nIterations, nRepetitions);
+    }
+
+    sm::timing::Timing::print(cout, sm::timing::SortType::SORT_BY_TOTAL);
+
+  }
+  catch (exception& e)
+  {
+    SM_FATAL_STREAM(e.what());
+    return EXIT_FAILURE;
+  }
+
+}
@@ -0,0 +1,120 @@
+/*
+ * BenchmarkSpMV.cpp
+ *
+ * Compares the serial and the multithreaded products of the compressed column Jacobian transpose
+ * of a structure-from-motion-like problem: J^T e, J x and J^T J x, the latter as two products
+ * and fused into one pass over the matrix.
+ */
+
+// standard includes
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// boost includes
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+
+// Schweizer Messer includes
+#include <sm/logging.hpp>
+#include <sm/timing/Timer.hpp>
+
+// aslam backend includes
+#include <aslam/backend/ErrorTerm.hpp>
+#include <aslam/backend/CompressedColumnJacobianTransposeBuilder.hpp>
+
+#include "BenchmarkProblems.hpp"
+
+using namespace std;
+using namespace aslam::backend;
+
+int main(int argc, char** argv)
+{
+  try
+  {
+    string verbosity = "Info";
+    size_t nPoses = 1000;
+    size_t nLandmarks = 200000;
+    size_t nObservations = 8;
+    size_t nRepetitions = 20;
+    vector<size_t> threads = {1, 2, 4, 8};
+
+    namespace po = boost::program_options;
+    po::options_description desc("benchmark_spmv options");
+    desc.add_options()
+      ("help", "Produce help message")
+      ("verbosity,v", po::value(&verbosity)->default_value(verbosity), "Verbosity string")
+      ("num-poses", po::value(&nPoses)->default_value(nPoses), "Number of 6-dimensional design variables")
+      ("num-landmarks", po::value(&nLandmarks)->default_value(nLandmarks), "Number of 3-dimensional design variables")
+      ("num-observations", po::value(&nObservations)->default_value(nObservations), "Number of poses observing each landmark")
+      ("num-repetitions", po::value(&nRepetitions)->default_value(nRepetitions), "Number of times each product is timed")
+      ("threads", po::value(&threads)->multitoken(), "Numbers of threads to benchmark")
+    ;
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    if (vm.count("help")) {
+      cout << desc << endl;
+      return EXIT_SUCCESS;
+    }
+    po::notify(vm);
+    sm::logging::setLevel(sm::logging::levels::fromString(verbosity));
+
+    srand(0);
+    BundleAdjustmentProblem problem(nPoses, nLandmarks, nObservations, nPoses);
+
+    CompressedColumnJacobianTransposeBuilder<int> builder;
+    builder.initMatrixStructure(problem.dvs, problem.errs);
+    builder.buildSystem(threads.back(), false);
+    const CompressedColumnMatrix<int>& J_transpose = builder.J_transpose();
+    cout << "J^T: " << J_transpose.rows() << " x " << J_transpose.cols() << ", nnz = " << J_transpose.nnz() << endl;
+
+    const Eigen::VectorXd e = Eigen::VectorXd::Random(J_transpose.cols());
+    const Eigen::VectorXd x = Eigen::VectorXd::Random(J_transpose.rows());
+    Eigen::VectorXd y, Jx;
+    for (size_t r = 0; r < nRepetitions; ++r) {
+      {
+        sm::timing::Timer timer("serial -- J^T e", false);
+        J_transpose.rightMultiply(e, y);
+      }
+      {
+        sm::timing::Timer timer("serial -- J x", false);
+        J_transpose.leftMultiply(x, Jx);
+      }
+      {
+        sm::timing::Timer timer("serial -- J^T (J x)", false);
+        J_transpose.leftMultiply(x, Jx);
+        J_transpose.rightMultiply(Jx, y);
+      }
+      for (size_t nThreads : threads) {
+        const string suffix = " -- " + boost::lexical_cast<string>(nThreads) + " threads";
+        {
+          sm::timing::Timer timer("threaded -- J^T e" + suffix, false);
+          J_transpose.rightMultiply(e, y, nThreads);
+        }
+        {
+          sm::timing::Timer timer("threaded -- J x" + suffix, false);
+          J_transpose.leftMultiply(x, Jx, nThreads);
+        }
+        {
+          sm::timing::Timer timer("threaded -- J^T (J x)" + suffix, false);
+          J_transpose.leftMultiply(x, Jx, nThreads);
+          J_transpose.rightMultiply(Jx, y, nThreads);
+        }
+        {
+          sm::timing::Timer timer("threaded -- J^T J x fused" + suffix, false);
+          J_transpose.rightMultiplyNormal(x, y, nThreads);
+        }
+      }
+    }
+
+    sm::timing::Timing::print(cout, sm::timing::SortType::SORT_BY_TOTAL);
+
+  }
+  catch (exception& e)
+  {
+    SM_FATAL_STREAM(e.what());
+    return EXIT_FAILURE;
+  }
+
+}
@@ -0,0 +1,127 @@
+/*
+ * BenchmarkThreadPool.cpp
+ *
+ * Compares the persistent thread pool against spawning threads on every call
+ * for the multi-threaded error, Jacobian, Hessian and gradient evaluations.
+ */
+
+// standard includes
+#include <vector>
+#include <string>
+#include <sstream>
+
+// boost includes
+#include <boost/program_options.hpp>
+
+// Schweizer Messer includes
+#include <sm/logging.hpp>
+#include <sm/timing/Timer.hpp>
+
+// aslam backend includes
+#include <aslam/backend/BlockCholeskyLinearSystemSolver.hpp>
+#include <aslam/backend/SparseCholeskyLinearSystemSolver.hpp>
+#include <aslam/backend/util/ProblemManager.hpp>
+#include <aslam/backend/util/ThreadPool.hpp>
+
+#include "SampleDvAndError.hpp"
+
+using namespace std;
+using namespace aslam::backend;
+
+int main(int argc, char** argv)
+{
+  try
+  {
+    string verbosity = "Info";
+    size_t nIterations = 1000;
+    size_t nDesignVariables = 500;
+    size_t nErrorTerms = 3000;
+    vector<size_t> nThreadsList = {2, 4, 8};
+    size_t chunkSize = 0;
+    bool noSpawn = false, noPool = false, noBalance = false;
+
+    namespace po = boost::program_options;
+    po::options_description desc("benchmark_thread_pool options");
+    desc.add_options()
+      ("help", "Produce help message")
+      ("verbosity,v", po::value(&verbosity)->default_value(verbosity), "Verbosity string")
+      ("num-iterations", po::value(&nIterations)->default_value(nIterations), "Number of iterations")
+      ("num-design-variables", po::value(&nDesignVariables)->default_value(nDesignVariables), "Number of design variables")
+      ("num-error-terms", po::value(&nErrorTerms)->default_value(nErrorTerms), "Number of error terms")
+      ("num-threads", po::value< vector<size_t> >(&nThreadsList)->multitoken(), "Numbers of threads to benchmark")
+      ("chunk-size", po::value(&chunkSize)->default_value(chunkSize), "Chunk size of the thread pool, 0 for automatic")
+      ("no-spawn", po::bool_switch(&noSpawn), "Don't profile spawning threads on every call")
+      ("no-pool", po::bool_switch(&noPool), "Don't profile the thread pool")
+      ("no-balance", po::bool_switch(&noBalance), "Split the error terms by number instead of by evaluation cost")
+    ;
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    if (vm.count("help")) {
+      cout << desc << endl;
+      return EXIT_SUCCESS;
+    }
+    po::notify(vm);
+    sm::logging::setLevel(sm::logging::levels::fromString(verbosity));
+
+    boost::shared_ptr<OptimizationProblem> problem = buildProblem(0, nDesignVariables, nErrorTerms);
+    ProblemManager pm(problem);
+
+    SparseCholeskyLinearSystemSolver solver;
+    solver.initMatrixStructure(pm.designVariables(), pm.getErrorTerms(), false);
+    BlockCholeskyLinearSystemSolver blockSolver;
+    blockSolver.initMatrixStructure(pm.designVariables(), pm.getErrorTerms(), false);
+
+    RowVectorType gradient;
+    for (const size_t nThreads : nThreadsList) {
+      for (const bool useThreadPool : {false, true}) {
+        if ((useThreadPool && noPool) || (!useThreadPool && noSpawn))
+          continue;
+
+        util::ThreadedJobOptions options;
+        options.useThreadPool = useThreadPool;
+        options.chunkSize = chunkSize;
+        options.balanceLoad = !noBalance;
+        solver.setThreadedJobOptions(options);
+        blockSolver.setThreadedJobOptions(options);
+        pm.setThreadedJobOptions(options);
+        if (useThreadPool) // exclude spawning the workers from the measurements
+          util::ThreadPool::instance().reserve(nThreads - 1);
+
+        ostringstream label;
+        label << (useThreadPool ? "Pool" : "Spawn") << " -- " << nThreads << " threads: ";
+
+        {
+          sm::timing::Timer timer(label.str() + "Error", false);
+          for (size_t i=0; i<nIterations; ++i)
+            solver.evaluateError(nThreads, false);
+        }
+        SM_INFO_STREAM(label.str() << "Error " << solver.getErrorEvaluationStatistics());
+        {
+          sm::timing::Timer timer(label.str() + "Jacobian", false);
+          for (size_t i=0; i<nIterations; ++i)
+            solver.buildSystem(nThreads, false);
+        }
+        SM_INFO_STREAM(label.str() << "Jacobian " << *solver.getJacobianEvaluationStatistics());
+        {
+          sm::timing::Timer timer(label.str() + "Hessian", false);
+          for (size_t i=0; i<nIterations; ++i)
+            blockSolver.buildSystem(nThreads, false);
+        }
+        {
+          sm::timing::Timer timer(label.str() + "Gradient", false);
+          for (size_t i=0; i<nIterations; ++i)
+            pm.computeGradient(gradient, nThreads, false, false, false);
+        }
+      }
+    }
+
+    sm::timing::Timing::print(cout, sm::timing::SortType::SORT_BY_TOTAL);
+
+  }
+  catch (exception& e)
+  {
+    SM_FATAL_STREAM(e.what());
+    return EXIT_FAILURE;
+  }
+
+}
@@ -1,6 +1,9 @@
 #include <sm/eigen/gtest.hpp>
 
 #include <aslam/backend/CompressedColumnMatrix.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <numeric>
 #include "DummyDesignVariable.hpp"
 #include <aslam/backend/CompressedColumnJacobianTransposeBuilder.hpp>
@@ -164,3 +167,117 @@ TEST(CompressColumnMatrixTestSuite, testAppendDiagonal)
   Eigen::MatrixXd diagDense = diag.asDiagonal();
   ASSERT_DOUBLE_MX_EQ(matDense, diagDense, 1e-6, "");
 }
+
+TEST(CompressColumnMatrixTestSuite, testJcBuilderStructureUpdate)
+{
+  using namespace aslam::backend;
+  typedef CompressedColumnJacobianTransposeBuilder<int>::StructureUpdate StructureUpdate;
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  // Couples the design variables {0}, {1, 2}, {2, 3, 4}, {3}, {4, 5}, {5, 0, 1}
+  buildSystem(6, 12, dvs, errs);
+  std::vector<ErrorTerm*> allErrs(errs);
+
+  CompressedColumnJacobianTransposeBuilder<int> ccjtb;
+  auto expectSameAsInitialized = [&](const std::vector<ErrorTerm*>& errors) {
+    CompressedColumnJacobianTransposeBuilder<int> expected;
+    expected.initMatrixStructure(dvs, errors);
+    expected.buildSystem(1, false);
+    ccjtb.buildSystem(2, false);
+    ASSERT_EQ(expected.J_transpose().cols(), ccjtb.J_transpose().cols());
+    sm::eigen::assertEqual(expected.J_transpose().toDense(), ccjtb.J_transpose().toDense(), SM_SOURCE_FILE_POS);
+  };
+  auto appendError = [&](ErrorTerm* e) {
+    e->setRowBase(errs.back()->rowBase() + errs.back()->dimension());
+    errs.push_back(e);
+    allErrs.push_back(e);
+  };
+
+  EXPECT_EQ(StructureUpdate::Rebuilt, ccjtb.updateMatrixStructure(dvs, errs));
+  expectSameAsInitialized(errs);
+  EXPECT_EQ(StructureUpdate::Unchanged, ccjtb.updateMatrixStructure(dvs, errs));
+  expectSameAsInitialized(errs);
+
+  // The block structure has one column per error term with the block indices of its design variables
+  std::vector<int> colPtr, rowInd;
+  ccjtb.getBlockStructure(colPtr, rowInd);
+  ASSERT_EQ(errs.size() + 1, colPtr.size());
+  for (size_t i = 0; i < errs.size(); ++i) {
+    std::vector<int> blockIndices;
+    for (const DesignVariable* dv : errs[i]->designVariables())
+      blockIndices.push_back(dv->blockIndex());
+    std::sort(blockIndices.begin(), blockIndices.end());
+    EXPECT_EQ(blockIndices, std::vector<int>(rowInd.begin() + colPtr[i], rowInd.begin() + colPtr[i + 1]));
+  }
+
+  appendError(new LinearErr2((Point2d*)dvs[3], (Point2d*)dvs[2]));
+  EXPECT_EQ(StructureUpdate::Extended, ccjtb.updateMatrixStructure(dvs, errs));
+  expectSameAsInitialized(errs);
+
+  appendError(new LinearErr2((Point2d*)dvs[0], (Point2d*)dvs[3]));
+  EXPECT_EQ(StructureUpdate::ExtendedWithNewCoupling, ccjtb.updateMatrixStructure(dvs, errs));
+  expectSameAsInitialized(errs);
+
+  // Removing or reordering error terms changes the structure
+  std::vector<ErrorTerm*> fewerErrs(errs.begin(), errs.end() - 1);
+  EXPECT_EQ(StructureUpdate::Rebuilt, ccjtb.updateMatrixStructure(dvs, fewerErrs));
+  expectSameAsInitialized(fewerErrs);
+  std::swap(errs[0], errs[1]);
+  EXPECT_EQ(StructureUpdate::Rebuilt, ccjtb.updateMatrixStructure(dvs, errs));
+
+  deleteSystem(dvs, allErrs);
+}
+
+TEST(CompressColumnMatrixTestSuite, testThreadedProducts)
+{
+  using namespace aslam::backend;
+  // A sparse matrix with empty rows and columns
+  Eigen::MatrixXd dense = Eigen::MatrixXd::Random(37, 101);
+  dense = (dense.array().abs() < 0.7).select(0.0, dense);
+  dense.row(5).setZero();
+  dense.col(17).setZero();
+  CompressedColumnMatrix<int> M;
+  M.fromDenseTolerance(dense, 0.0);
+
+  const Eigen::VectorXd x = Eigen::VectorXd::Random(dense.cols());
+  const Eigen::VectorXd v = Eigen::VectorXd::Random(dense.rows());
+  Eigen::VectorXd Mx, Mtv;
+  M.rightMultiply(x, Mx);
+  M.leftMultiply(v, Mtv);
+  for (size_t nThreads : {1, 2, 3, 8, 200}) {
+    SCOPED_TRACE(nThreads);
+    Eigen::VectorXd y;
+    M.rightMultiply(x, y, nThreads);
+    ASSERT_DOUBLE_MX_EQ(Mx, y, 1e-10, "Checking A x");
+    M.leftMultiply(v, y, nThreads);
+    ASSERT_DOUBLE_MX_EQ(Mtv, y, 1e-10, "Checking A^T x");
+    M.rightMultiplyNormal(v, y, nThreads);
+    ASSERT_DOUBLE_MX_EQ(dense * (dense.transpose() * v), y, 1e-10, "Checking A A^T x");
+
+    // The result does not depend on the scheduling
+    Eigen::VectorXd y2;
+    M.rightMultiplyNormal(v, y2, nThreads);
+    ASSERT_TRUE(y == y2);
+  }
+
+  // The appended diagonal is ignored like by the serial products
+  M.pushConstantDiagonalBlock(2.0);
+  Eigen::VectorXd y;
+  M.rightMultiply(x, y, 3);
+  ASSERT_DOUBLE_MX_EQ(Mx, y, 1e-10, "Checking A x with an appended diagonal");
+  M.leftMultiply(v, y, 3);
+  ASSERT_DOUBLE_MX_EQ(Mtv, y, 1e-10, "Checking A^T x with an appended diagonal");
+  M.popDiagonalBlock();
+
+  // Zero entries of x multiply their column like in the serial product, so non-finite values propagate
+  Eigen::MatrixXd denseInf = dense;
+  denseInf(3, 20) = std::numeric_limits<double>::infinity();
+  CompressedColumnMatrix<int> Minf;
+  Minf.fromDenseTolerance(denseInf, 0.0);
+  Eigen::VectorXd x0 = x;
+  x0[20] = 0.0;
+  Minf.rightMultiply(x0, Mx);
+  Minf.rightMultiply(x0, y, 3);
+  EXPECT_TRUE(std::isnan(Mx[3]));
+  EXPECT_TRUE(std::isnan(y[3]));
+}
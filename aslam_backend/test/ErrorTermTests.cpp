@@ -173,3 +173,158 @@ TEST(ErrorTermTestSuite, testNonSquaredErrorTerm) {
 
 
 
+
+namespace {
+
+/// \brief A linear error term e = p - J1 x1 - J2 x2 shared by the dynamic and the fixed-size implementation
+struct LinearErrData {
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  Eigen::Vector3d p = Eigen::Vector3d::Random();
+  Eigen::Matrix<double, 3, 1> J1 = Eigen::Matrix<double, 3, 1>::Random();
+  Eigen::Matrix<double, 3, 2> J2 = Eigen::Matrix<double, 3, 2>::Random();
+  Scalar* x1;
+  Point2d* x2;
+
+  Eigen::Vector3d error() const { return p - J1 * x1->_v - J2 * x2->_v; }
+};
+
+class DynamicLinearErr : public aslam::backend::ErrorTermFs<3> {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  DynamicLinearErr(const LinearErrData& d) : _d(d) { setDesignVariables(d.x1, d.x2); }
+ protected:
+  double evaluateErrorImplementation() override {
+    setError(_d.error());
+    return evaluateChiSquaredError();
+  }
+  void evaluateJacobiansImplementation(aslam::backend::JacobianContainer& outJ) override {
+    outJ.add(_d.x1, -_d.J1);
+    outJ.add(_d.x2, -_d.J2);
+  }
+ private:
+  const LinearErrData& _d;
+};
+
+class FixedSizeLinearErr : public aslam::backend::ErrorTermFs<3, 1, 2> {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  FixedSizeLinearErr(const LinearErrData& d) : _d(d) { setDesignVariables(d.x1, d.x2); }
+ protected:
+  double evaluateErrorImplementation() override {
+    setError(_d.error());
+    return evaluateChiSquaredError();
+  }
+  void evaluateFixedSizeJacobiansImplementation(jacobian_t& outJ) override {
+    jacobianBlock<0>(outJ) = -_d.J1;
+    jacobianBlock<1>(outJ) = -_d.J2;
+  }
+ private:
+  const LinearErrData& _d;
+};
+
+} // namespace
+
+TEST(ErrorTermTestSuite, testFixedSizeErrorTermMatchesDynamic)
+{
+  using namespace aslam::backend;
+  try {
+    Scalar x1(Scalar::Vector1d::Random());
+    Point2d x2(Eigen::Vector2d::Random());
+    LinearErrData data;
+    data.x1 = &x1;
+    data.x2 = &x2;
+    DynamicLinearErr dynamicErr(data);
+    FixedSizeLinearErr fixedErr(data);
+    const Eigen::Matrix3d invR = sm::eigen::randomCovariance<3>();
+    for (ErrorTerm* e : std::vector<ErrorTerm*>{ &dynamicErr, &fixedErr }) {
+      e->vsSetInvR(invR);
+      e->setMEstimatorPolicy(boost::make_shared<GemanMcClureMEstimator>(0.5));
+    }
+    x2.setScaling(0.5);
+
+    // Block order matching the design variable order, reversed order and an inactive design variable
+    for (int test = 0; test < 3; ++test) {
+      SCOPED_TRACE(testing::Message() << "test " << test);
+      x1.setActive(test != 2);
+      x2.setActive(true);
+      x1.setBlockIndex(test == 1 ? 1 : 0);
+      x2.setBlockIndex(test == 1 ? 0 : 1);
+      const std::vector<int> blocks = test == 1 ? std::vector<int>{ 2, 3 } : std::vector<int>{ 1, 3 };
+
+      for (bool useMEstimator : { false, true }) {
+        SparseBlockMatrix dynamicH(blocks, blocks, true), fixedH(blocks, blocks, true);
+        Eigen::VectorXd dynamicRhs = Eigen::VectorXd::Zero(3), fixedRhs = Eigen::VectorXd::Zero(3);
+        dynamicErr.evaluateError();
+        fixedErr.evaluateError();
+        EXPECT_DOUBLE_EQ(dynamicErr.getRawSquaredError(), fixedErr.getRawSquaredError());
+        dynamicErr.buildHessian(dynamicH, dynamicRhs, useMEstimator);
+        fixedErr.buildHessian(fixedH, fixedRhs, useMEstimator);
+        sm::eigen::assertNear(dynamicH.toDense(), fixedH.toDense(), 1e-12, SM_SOURCE_FILE_POS, "Hessian");
+        sm::eigen::assertNear(dynamicRhs, fixedRhs, 1e-12, SM_SOURCE_FILE_POS, "rhs");
+
+        JacobianContainerSparse<> dynamicJ(3), fixedJ(3);
+        dynamicErr.getWeightedJacobians(dynamicJ, useMEstimator);
+        fixedErr.getWeightedJacobians(fixedJ, useMEstimator);
+        ASSERT_EQ(dynamicJ.numDesignVariables(), fixedJ.numDesignVariables());
+        sm::eigen::assertNear(dynamicJ.asDenseMatrix(), fixedJ.asDenseMatrix(), 1e-12, SM_SOURCE_FILE_POS, "weighted Jacobian");
+      }
+    }
+    x1.setActive(true);
+    fixedErr.checkJacobiansNumerical();
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
+
+TEST(ErrorTermTestSuite, testFusedErrorAndJacobianEvaluation)
+{
+  using namespace aslam::backend;
+  try {
+    Scalar x1(Scalar::Vector1d::Random());
+    Point2d x2(Eigen::Vector2d::Random());
+    x1.setActive(true);
+    x2.setActive(true);
+    x1.setBlockIndex(0);
+    x2.setBlockIndex(1);
+    LinearErrData data;
+    data.x1 = &x1;
+    data.x2 = &x2;
+    DynamicLinearErr dynamicErr(data);
+    FixedSizeLinearErr fixedErr(data);
+    const Eigen::Matrix3d invR = sm::eigen::randomCovariance<3>();
+
+    std::vector<boost::shared_ptr<MEstimator> > mEstimators = { boost::make_shared<NoMEstimator>(), boost::make_shared<FixedWeightMEstimator>(2.0), boost::make_shared<GemanMcClureMEstimator>(0.5) };
+    for (ErrorTerm* err : std::vector<ErrorTerm*>{ &dynamicErr, &fixedErr }) {
+      err->vsSetInvR(invR);
+      for (const boost::shared_ptr<MEstimator>& mEstimator : mEstimators) {
+        SCOPED_TRACE(mEstimator->name());
+        err->setMEstimatorPolicy(mEstimator);
+        for (bool useMEstimator : { false, true }) {
+          JacobianContainerSparse<> expectedJ(3), J(3);
+          Eigen::VectorXd expectedE, e;
+          const double expectedSquaredError = err->evaluateError();
+          err->getWeightedError(expectedE, useMEstimator);
+          err->getWeightedJacobians(expectedJ, useMEstimator);
+
+          const Eigen::Vector2d dx = Eigen::Vector2d::Random();
+          x2.update(dx.data(), 2);
+          EXPECT_NE(expectedSquaredError, err->evaluateWeightedErrorAndJacobians(e, J, useMEstimator)) << "The error has to be evaluated again";
+          x2.revertUpdate();
+          J.clear();
+          EXPECT_DOUBLE_EQ(expectedSquaredError, err->evaluateWeightedErrorAndJacobians(e, J, useMEstimator));
+          EXPECT_DOUBLE_EQ(expectedSquaredError, err->getSquaredError());
+          sm::eigen::assertNear(e, expectedE, 1e-12, SM_SOURCE_FILE_POS, "weighted error");
+          sm::eigen::assertNear(J.asDenseMatrix(), expectedJ.asDenseMatrix(), 1e-12, SM_SOURCE_FILE_POS, "weighted Jacobian");
+        }
+
+        JacobianContainerSparse<> expectedJ(3), J(3);
+        const double expectedSquaredError = err->evaluateError();
+        err->evaluateJacobians(expectedJ);
+        EXPECT_DOUBLE_EQ(expectedSquaredError, err->evaluateErrorAndJacobians(J));
+        sm::eigen::assertNear(J.asDenseMatrix(), expectedJ.asDenseMatrix(), 1e-12, SM_SOURCE_FILE_POS, "Jacobian");
+      }
+    }
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
@@ -3,6 +3,7 @@
 #include <aslam/backend/JacobianContainerSparse.hpp>
 #include <aslam/backend/JacobianContainerDense.hpp>
 #include <aslam/backend/JacobianContainerPrescale.hpp>
+#include <aslam/backend/JacobianContainerRows.hpp>
 #include <aslam/backend/util/utils.hpp>
 #include <numeric> // std::partial_sum
 #include "DummyDesignVariable.hpp"
@@ -208,6 +209,50 @@ TYPED_TEST(JacobianContainerTests, testAddJacobian)
   }
 }
 
+TEST(JacobianContainerTests, testAddSpecificForJacobianRows)
+{
+  try
+  {
+    using namespace aslam::backend;
+    const int dimensionDv = 2;
+    const int dimensionError = 3;
+    auto dvs = createDesignVariables<dimensionDv>(3, true);
+    dvs[2].setActive(false);
+    std::vector<DesignVariable*> termDvs = { &dvs[0], &dvs[2] };
+
+    // Two error terms in rows 0..2 and 3..5 of a preallocated matrix, filled with garbage
+    Eigen::MatrixXd J = Eigen::MatrixXd::Constant(2 * dimensionError, 3 * dimensionDv, 7.0);
+    Eigen::MatrixXd expected = J;
+    JacobianContainerRows jc(J);
+    jc.reset(dimensionError, dimensionError, termDvs);
+    ASSERT_EQ(dimensionError, jc.rows());
+    // Only the blocks of the active design variables of the term are zeroed
+    expected.block(dimensionError, 0, dimensionError, dimensionDv).setZero();
+    sm::eigen::assertEqual(expected, J, SM_SOURCE_FILE_POS);
+
+    // Contributions to the same design variable are summed up, inactive design variables are skipped
+    const auto J0 = Eigen::Matrix<double, dimensionError, dimensionDv>::Random().eval();
+    const auto J1 = Eigen::Matrix<double, dimensionError, dimensionDv>::Random().eval();
+    jc.add(&dvs[0], J0);
+    jc.add(&dvs[0], J1);
+    jc.add(&dvs[2], J1);
+    expected.block(dimensionError, 0, dimensionError, dimensionDv) = J0 + J1;
+    sm::eigen::assertNear(expected, J, 1e-12, SM_SOURCE_FILE_POS);
+    sm::eigen::assertNear(expected.bottomRows(dimensionError), jc.asDenseMatrix(), 1e-12, SM_SOURCE_FILE_POS);
+    ASSERT_TRUE(jc.isFinite(dvs[0]));
+
+    // The chain rule is applied like in the other containers
+    termDvs = { &dvs[1] };
+    jc.reset(0, dimensionError, termDvs);
+    const Eigen::Matrix3d C = Eigen::Matrix3d::Random();
+    static_cast<JacobianContainer&>(jc.apply(C)).add(&dvs[1], J0);
+    expected.block(0, dimensionDv, dimensionError, dimensionDv) = C * J0;
+    sm::eigen::assertNear(expected, J, 1e-12, SM_SOURCE_FILE_POS);
+  } catch (const std::exception& e) {
+    FAIL() << "Exception: " << e.what();
+  }
+}
+
 TEST(JacobianContainerTests, testAddJacobianPrescaled)
 {
   try
@@ -263,7 +308,7 @@ TEST(JacobianContainerTests, testOrdering)
   // Now check if the ordering is correct.
   // Jacobians should stored in ascending order
   // by block index
-  JacobianContainerSparse<>::map_t::const_iterator itk = jc.begin(),
+  JacobianContainerSparse<>::const_iterator itk = jc.begin(),
                                            itkm1 = jc.begin(),
                                            it_end = jc.end();
   itk++;
@@ -6,8 +6,11 @@
 
 #include <aslam/backend/DenseQrLinearSystemSolver.hpp>
 #include <aslam/backend/SparseCholeskyLinearSystemSolver.hpp>
+#include <aslam/backend/CompressedColumnHessianBuilder.hpp>
 #include <aslam/backend/SparseQrLinearSystemSolver.hpp>
 #include <aslam/backend/BlockCholeskyLinearSystemSolver.hpp>
+#include <aslam/backend/SchurComplementLinearSystemSolver.hpp>
+#include <aslam/backend/PcgLinearSystemSolver.hpp>
 #include <boost/lexical_cast.hpp>
 #include <aslam/backend/Optimizer2.hpp>
 #include <aslam/backend/OptimizationProblem.hpp>
@@ -114,6 +117,245 @@ TEST(LinearSolverTestSuite, testSparseCholesky)
   }
 }
 
+TEST(LinearSolverTestSuite, testSparseCholeskyReusesSymbolicFactorization)
+{
+  using namespace aslam::backend;
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  // Every pair of the 4 design variables is coupled by an error term
+  buildSystem(4, 20, dvs, errs);
+  auto solve = [&](LinearSystemSolver& solver, Eigen::VectorXd& dx) {
+    solver.initMatrixStructure(dvs, errs, false);
+    solver.evaluateError(1, false);
+    solver.buildSystem(1, false);
+    ASSERT_TRUE(solver.solveSystem(dx));
+  };
+  SparseCholeskyLinearSystemSolver solver;
+  Eigen::VectorXd dx, dxExpected;
+  solve(solver, dx);
+  EXPECT_EQ(0u, solver.getNumSymbolicFactorizationReuses());
+  EXPECT_EQ(1u, solver.getNumSymbolicFactorizationMisses());
+  solve(solver, dx);
+  EXPECT_EQ(1u, solver.getNumSymbolicFactorizationReuses());
+  EXPECT_EQ(1u, solver.getNumSymbolicFactorizationMisses());
+
+  // An appended error term within the existing coupling keeps the factorization
+  errs.push_back(new LinearErr2((Point2d*)dvs[0], (Point2d*)dvs[2]));
+  errs.back()->setRowBase(errs[errs.size() - 2]->rowBase() + errs[errs.size() - 2]->dimension());
+  solve(solver, dx);
+  EXPECT_EQ(2u, solver.getNumSymbolicFactorizationReuses());
+  EXPECT_EQ(1u, solver.getNumSymbolicFactorizationMisses());
+  {
+    SparseCholeskyLinearSystemSolver freshSolver;
+    solve(freshSolver, dxExpected);
+    sm::eigen::assertNear(dxExpected, dx, 1e-9, SM_SOURCE_FILE_POS);
+  }
+
+  // Removing it changes the structure
+  delete errs.back();
+  errs.pop_back();
+  solve(solver, dx);
+  EXPECT_EQ(2u, solver.getNumSymbolicFactorizationReuses());
+  EXPECT_EQ(2u, solver.getNumSymbolicFactorizationMisses());
+  deleteSystem(dvs, errs);
+}
+
+TEST(LinearSolverTestSuite, testSparseCholeskyOrderings)
+{
+  using namespace aslam::backend;
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  buildSystem(10, 40, dvs, errs);
+  BlockCholeskyLinearSystemSolver expectedSolver;
+  Eigen::VectorXd dxExpected;
+  expectedSolver.initMatrixStructure(dvs, errs, false);
+  expectedSolver.evaluateError(1, false);
+  expectedSolver.buildSystem(1, false);
+  ASSERT_TRUE(expectedSolver.solveSystem(dxExpected));
+  for (const SparseCholeskyLinearSolverOptions::Ordering ordering : { SparseCholeskyLinearSolverOptions::SCALAR_AMD,
+      SparseCholeskyLinearSolverOptions::BLOCK_AMD, SparseCholeskyLinearSolverOptions::BLOCK_COLAMD,
+      SparseCholeskyLinearSolverOptions::BLOCK_NESTED_DISSECTION }) {
+    SCOPED_TRACE(testing::Message() << "ordering: " << ordering);
+    SparseCholeskyLinearSolverOptions options;
+    options.ordering = ordering;
+    SparseCholeskyLinearSystemSolver solver(options);
+    Eigen::VectorXd dx;
+    for (int i = 0; i < 2; ++i) {
+      solver.initMatrixStructure(dvs, errs, false);
+      solver.evaluateError(1, false);
+      solver.buildSystem(1, false);
+      ASSERT_TRUE(solver.solveSystem(dx));
+      sm::eigen::assertNear(dxExpected, dx, 1e-9, SM_SOURCE_FILE_POS);
+    }
+    EXPECT_GT(solver.getFactorNonZeros(), 0.0);
+    EXPECT_EQ(1u, solver.getNumSymbolicFactorizationMisses());
+  }
+  deleteSystem(dvs, errs);
+}
+
+TEST(LinearSolverTestSuite, testSparseCholeskyCachedHessian)
+{
+  using namespace aslam::backend;
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  buildSystem(10, 40, dvs, errs);
+  SparseCholeskyLinearSystemSolver expectedSolver;
+  SparseCholeskyLinearSolverOptions options;
+  options.cacheHessian = true;
+  SparseCholeskyLinearSystemSolver solver(options);
+  expectedSolver.initMatrixStructure(dvs, errs, true);
+  solver.initMatrixStructure(dvs, errs, true);
+  Eigen::VectorXd dxExpected, dx;
+  // Damping the cached Hessian yields the solutions of the appended conditioner, also after rebuilding the system
+  for (int i = 0; i < 2; ++i) {
+    expectedSolver.evaluateError(1, false);
+    expectedSolver.buildSystem(1, false);
+    solver.evaluateError(1, false);
+    solver.buildSystem(1, false);
+    for (const double lambda : {1e-3, 1e-1, 10.0}) {
+      SCOPED_TRACE(testing::Message() << "lambda: " << lambda);
+      expectedSolver.setConstantConditioner(lambda);
+      solver.setConstantConditioner(lambda);
+      ASSERT_TRUE(expectedSolver.solveSystem(dxExpected));
+      ASSERT_TRUE(solver.solveSystem(dx));
+      sm::eigen::assertNear(dxExpected, dx, 1e-9, SM_SOURCE_FILE_POS);
+    }
+  }
+  deleteSystem(dvs, errs);
+}
+
+TEST(LinearSolverTestSuite, testSparseCholeskyCachedHessianWithUnobservedDesignVariable)
+{
+  using namespace aslam::backend;
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  buildSystem(10, 40, dvs, errs);
+  // An active design variable without any error term, its column of J is empty
+  dvs.push_back(new Point2d(Eigen::Vector2d::Random()));
+  dvs.back()->setActive(true);
+  dvs.back()->setBlockIndex(dvs.size() - 1);
+  dvs.back()->setColumnBase(dvs[dvs.size() - 2]->columnBase() + dvs[dvs.size() - 2]->minimalDimensions());
+  try {
+    SparseCholeskyLinearSystemSolver expectedSolver;
+    SparseCholeskyLinearSolverOptions options;
+    options.cacheHessian = true;
+    SparseCholeskyLinearSystemSolver solver(options);
+    expectedSolver.initMatrixStructure(dvs, errs, true);
+    solver.initMatrixStructure(dvs, errs, true);
+    expectedSolver.evaluateError(1, false);
+    expectedSolver.buildSystem(1, false);
+    solver.evaluateError(1, false);
+    solver.buildSystem(1, false);
+    // The damping regularizes the empty column like the appended conditioner does
+    Eigen::VectorXd dxExpected, dx;
+    expectedSolver.setConstantConditioner(1e-2);
+    solver.setConstantConditioner(1e-2);
+    ASSERT_TRUE(expectedSolver.solveSystem(dxExpected));
+    ASSERT_TRUE(solver.solveSystem(dx));
+    sm::eigen::assertNear(dxExpected, dx, 1e-9, SM_SOURCE_FILE_POS);
+    EXPECT_TRUE(dx.tail<2>().isZero());
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+  deleteSystem(dvs, errs);
+}
+
+TEST(LinearSolverTestSuite, testCompressedColumnHessianBuilder)
+{
+  using namespace aslam::backend;
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  buildSystem(10, 40, dvs, errs);
+  try {
+    for (const bool useM : {false, true}) {
+      SCOPED_TRACE(testing::Message() << "useM: " << useM);
+      DenseQrLinearSystemSolver dense;
+      dense.initMatrixStructure(dvs, errs, false);
+      dense.evaluateError(1, useM);
+      dense.buildSystem(1, useM);
+      const Eigen::MatrixXd J = dense.getJacobian();
+      const Eigen::MatrixXd expectedH = J.transpose() * J;
+
+      CompressedColumnHessianBuilder builder;
+      EXPECT_FALSE(builder.initMatrixStructure(dvs, errs));
+      EXPECT_TRUE(builder.initMatrixStructure(dvs, errs));
+      ASSERT_EQ(dense.JCols(), builder.cols());
+      Eigen::VectorXd rhs1;
+      builder.buildSystem(1, useM, rhs1);
+      ASSERT_DOUBLE_MX_EQ(dense.rhs(), rhs1, 1e-9, "Checking the right-hand side against -J^T e");
+
+      // Only the upper triangle is stored and the diagonal entry is the last one of each column
+      Eigen::MatrixXd H = Eigen::MatrixXd::Zero(builder.cols(), builder.cols());
+      for (size_t c = 0; c < builder.cols(); ++c) {
+        ASSERT_EQ((int)c, builder.row_ind()[builder.col_ptr()[c + 1] - 1]);
+        for (int k = builder.col_ptr()[c]; k < builder.col_ptr()[c + 1]; ++k) {
+          ASSERT_LE(builder.row_ind()[k], (int)c);
+          H(builder.row_ind()[k], c) = builder.values()[k];
+        }
+      }
+      ASSERT_DOUBLE_MX_EQ(Eigen::MatrixXd(expectedH.triangularView<Eigen::Upper>()), H, 1e-9, "Checking the Hessian against J^T J");
+
+      Eigen::VectorXd x = Eigen::VectorXd::Random(builder.cols()), y;
+      builder.multiply(x, y);
+      ASSERT_DOUBLE_MX_EQ(Eigen::VectorXd(expectedH * x), y, 1e-9, "Checking the product with the symmetric Hessian");
+
+      for (const size_t nThreads : {3, 8}) {
+        SCOPED_TRACE(testing::Message() << "nThreads: " << nThreads);
+        Eigen::VectorXd rhs;
+        const std::vector<double> values1 = builder.values();
+        builder.buildSystem(nThreads, useM, rhs);
+        ASSERT_DOUBLE_MX_EQ(rhs1, rhs, 1e-9, "Checking the right-hand side against the serial build");
+        for (size_t k = 0; k < values1.size(); ++k)
+          ASSERT_NEAR(values1[k], builder.values()[k], 1e-9);
+      }
+    }
+    deleteSystem(dvs, errs);
+  } catch (const std::exception& e) {
+    deleteSystem(dvs, errs);
+    FAIL() << e.what();
+  }
+}
+
+TEST(LinearSolverTestSuite, testSparseCholeskyAssembledHessian)
+{
+  using namespace aslam::backend;
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  buildSystem(10, 40, dvs, errs);
+  SparseCholeskyLinearSystemSolver expectedSolver;
+  expectedSolver.initMatrixStructure(dvs, errs, true);
+  Eigen::VectorXd dxExpected, dx;
+  for (const auto ordering : {SparseCholeskyLinearSolverOptions::SCALAR_AMD, SparseCholeskyLinearSolverOptions::BLOCK_AMD,
+                              SparseCholeskyLinearSolverOptions::BLOCK_COLAMD}) {
+    SCOPED_TRACE(testing::Message() << "ordering: " << ordering);
+    SparseCholeskyLinearSolverOptions options;
+    options.ordering = ordering;
+    options.assembleHessian = true;
+    SparseCholeskyLinearSystemSolver solver(options);
+    // The symbolic factorization of the assembled Hessian is kept for the same structure
+    for (int i = 0; i < 2; ++i) {
+      solver.initMatrixStructure(dvs, errs, true);
+      EXPECT_EQ((size_t)i, solver.getNumSymbolicFactorizationReuses());
+      expectedSolver.evaluateError(2, false);
+      expectedSolver.buildSystem(2, false);
+      solver.evaluateError(2, false);
+      solver.buildSystem(2, false);
+      ASSERT_DOUBLE_MX_EQ(expectedSolver.rhs(), solver.rhs(), 1e-9, "Checking the right-hand side");
+      EXPECT_NEAR(expectedSolver.rhsJtJrhs(), solver.rhsJtJrhs(), 1e-9);
+      for (const double lambda : {1e-3, 1e-1, 10.0}) {
+        SCOPED_TRACE(testing::Message() << "lambda: " << lambda);
+        expectedSolver.setConstantConditioner(lambda);
+        solver.setConstantConditioner(lambda);
+        ASSERT_TRUE(expectedSolver.solveSystem(dxExpected));
+        ASSERT_TRUE(solver.solveSystem(dx));
+        sm::eigen::assertNear(dxExpected, dx, 1e-9, SM_SOURCE_FILE_POS);
+      }
+    }
+    EXPECT_GT(solver.getMemoryUsage(), 0u);
+  }
+  deleteSystem(dvs, errs);
+}
+
 TEST(LinearSolverTestSuite, testSparseQR)
 {
   using namespace aslam::backend;
@@ -138,6 +380,254 @@ TEST(LinearSolverTestSuite, testSparseQR)
   }
 }
 
+TEST(LinearSolverTestSuite, testBlockCholeskyParallelAssembly)
+{
+  using namespace aslam::backend;
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  buildSystem(10, 200, dvs, errs);
+  try {
+    for (const bool useM : {false, true}) {
+      BlockCholeskyLinearSolverOptions options;
+      options.parallelAssembly = false;
+      BlockCholeskyLinearSystemSolver serial("cholesky", options);
+      serial.initMatrixStructure(dvs, errs, false);
+      serial.evaluateError(1, useM);
+      serial.buildSystem(1, useM);
+      const Eigen::MatrixXd serialH = serial.Hessian()->toDense();
+      const Eigen::VectorXd serialRhs = serial.rhs();
+
+      BlockCholeskyLinearSystemSolver parallel;
+      ASSERT_TRUE(parallel.getOptions().parallelAssembly);
+      parallel.initMatrixStructure(dvs, errs, false);
+      parallel.evaluateError(1, useM);
+      parallel.buildSystem(1, useM);
+      const Eigen::MatrixXd H1 = parallel.Hessian()->toDense();
+      const Eigen::VectorXd rhs1 = parallel.rhs();
+      ASSERT_DOUBLE_MX_EQ(serialH, H1, 1e-9, "Checking the Hessian against the serial assembly");
+      ASSERT_DOUBLE_MX_EQ(serialRhs, rhs1, 1e-9, "Checking the right-hand side against the serial assembly");
+      ASSERT_NE(nullptr, parallel.getJacobianEvaluationStatistics());
+
+      // The result must be bitwise identical for any number of threads and repeated builds
+      for (const size_t nThreads : {2, 3, 8, 1}) {
+        SCOPED_TRACE(("With " + boost::lexical_cast<std::string>(nThreads) + " threads").c_str());
+        parallel.buildSystem(nThreads, useM);
+        EXPECT_TRUE(H1 == parallel.Hessian()->toDense());
+        EXPECT_TRUE(rhs1 == parallel.rhs());
+        EXPECT_EQ(nThreads, parallel.getJacobianEvaluationStatistics()->busyTime.size());
+      }
+    }
+    deleteSystem(dvs, errs);
+  } catch (const std::exception& e) {
+    deleteSystem(dvs, errs);
+    FAIL() << e.what();
+  }
+}
+
+TEST(LinearSolverTestSuite, testSchurComplement)
+{
+  using namespace aslam::backend;
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  const int P = 6;
+  const int L = 20;
+  buildLandmarkSystem(P, L, dvs, errs);
+  try {
+    for (const std::string reducedSolver : {"cholesky", "dense"}) {
+      for (const bool useDiag : {false, true}) {
+        for (const size_t nThreads : {1, 3}) {
+          SCOPED_TRACE(("Reduced solver " + reducedSolver + (useDiag ? " with" : " without") + " diagonal and "
+                        + boost::lexical_cast<std::string>(nThreads) + " threads").c_str());
+          SchurComplementLinearSystemSolver schur(reducedSolver);
+          schur.initMatrixStructure(dvs, errs, useDiag);
+          ASSERT_EQ((size_t)L, schur.numMarginalizedBlocks());
+          ASSERT_EQ((int)schur.JCols() - 2 * L, schur.reducedDimension());
+          const Eigen::VectorXd diag = Eigen::VectorXd::Random(schur.JCols());
+          if (useDiag)
+            schur.setConditioner(diag);
+          schur.evaluateError(nThreads, false);
+          schur.buildSystem(nThreads, false);
+
+          // Compare against the dense solution of the full system
+          const Eigen::MatrixXd upperH = schur.Hessian()->toDense();
+          Eigen::MatrixXd H = upperH.selfadjointView<Eigen::Upper>();
+          const double rhsJtJrhs = schur.rhs().dot(H * schur.rhs());
+          if (useDiag)
+            H.diagonal() += diag.cwiseAbs2();
+          const Eigen::VectorXd expectedDx = H.ldlt().solve(schur.rhs());
+          Eigen::VectorXd dx;
+          ASSERT_TRUE(schur.solveSystem(dx));
+          ASSERT_DOUBLE_MX_EQ(expectedDx, dx, 1e-6, "Checking the solution");
+          EXPECT_NEAR(rhsJtJrhs, schur.rhsJtJrhs(), 1e-9 * std::abs(rhsJtJrhs));
+
+          // A second solve must not depend on the state of the first one
+          ASSERT_TRUE(schur.solveSystem(dx));
+          ASSERT_DOUBLE_MX_EQ(expectedDx, dx, 1e-6, "Checking the second solution");
+        }
+      }
+    }
+
+    // Marginalized design variables must not be coupled
+    errs.push_back(new LinearErr2((Point2d*)dvs[1], (Point2d*)dvs[3]));
+    errs.back()->setRowBase(errs[errs.size() - 2]->rowBase() + errs[errs.size() - 2]->dimension());
+    SchurComplementLinearSystemSolver schur;
+    EXPECT_ANY_THROW(schur.initMatrixStructure(dvs, errs, false));
+    deleteSystem(dvs, errs);
+  } catch (const std::exception& e) {
+    deleteSystem(dvs, errs);
+    FAIL() << e.what();
+  }
+}
+
+TEST(LinearSolverTestSuite, testPcg)
+{
+  using namespace aslam::backend;
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  const int P = 6;
+  const int L = 20;
+  buildLandmarkSystem(P, L, dvs, errs);
+  try {
+    // The Hessian of the block Cholesky solver is the reference
+    BlockCholeskyLinearSystemSolver reference;
+    reference.initMatrixStructure(dvs, errs, false);
+    reference.evaluateError(1, false);
+    reference.buildSystem(1, false);
+    const Eigen::MatrixXd upperH = reference.Hessian()->toDense();
+    const Eigen::MatrixXd JtJ = upperH.selfadjointView<Eigen::Upper>();
+    const double rhsJtJrhs = reference.rhs().dot(JtJ * reference.rhs());
+
+    const PcgLinearSolverOptions::Preconditioner preconditioners[] = {PcgLinearSolverOptions::NONE, PcgLinearSolverOptions::BLOCK_JACOBI, PcgLinearSolverOptions::SCHUR_JACOBI};
+    for (const PcgLinearSolverOptions::Preconditioner preconditioner : preconditioners) {
+      for (const bool useDiag : {false, true}) {
+        for (const size_t nThreads : {1, 3}) {
+          SCOPED_TRACE(("Preconditioner " + boost::lexical_cast<std::string>(preconditioner) + (useDiag ? " with" : " without") + " diagonal and "
+                        + boost::lexical_cast<std::string>(nThreads) + " threads").c_str());
+          PcgLinearSolverOptions options;
+          options.preconditioner = preconditioner;
+          options.tolerance = 1e-12;
+          PcgLinearSystemSolver pcg(options);
+          pcg.initMatrixStructure(dvs, errs, useDiag);
+          const Eigen::VectorXd diag = Eigen::VectorXd::Random(pcg.JCols());
+          if (useDiag)
+            pcg.setConditioner(diag);
+          pcg.evaluateError(nThreads, false);
+          pcg.buildSystem(nThreads, false);
+          ASSERT_DOUBLE_MX_EQ(reference.rhs(), pcg.rhs(), 1e-9, "Checking the right-hand side");
+          EXPECT_NEAR(rhsJtJrhs, pcg.rhsJtJrhs(), 1e-9 * std::abs(rhsJtJrhs));
+
+          Eigen::MatrixXd H = JtJ;
+          if (useDiag)
+            H.diagonal() += diag.cwiseAbs2();
+          const Eigen::VectorXd x = Eigen::VectorXd::Random(pcg.JCols());
+          Eigen::VectorXd Hx;
+          pcg.multiplyHessian(x, Hx);
+          ASSERT_DOUBLE_MX_EQ(H * x, Hx, 1e-6, "Checking the Hessian product");
+
+          const Eigen::VectorXd expectedDx = H.ldlt().solve(pcg.rhs());
+          Eigen::VectorXd dx;
+          ASSERT_TRUE(pcg.solveSystem(dx));
+          ASSERT_DOUBLE_MX_EQ(expectedDx, dx, 1e-6, "Checking the solution");
+          const IterativeSolverStatistics* statistics = pcg.getIterativeSolverStatistics();
+          ASSERT_TRUE(statistics != NULL);
+          EXPECT_TRUE(statistics->converged);
+          EXPECT_GT(statistics->iterations, 0u);
+          EXPECT_LE(statistics->relativeResidual, 1e-12);
+
+          // A loose forcing tolerance stops the iteration early
+          pcg.setForcingTolerance(0.5);
+          ASSERT_TRUE(pcg.solveSystem(dx));
+          EXPECT_LE(statistics->relativeResidual, 0.5);
+          EXPECT_NEAR((pcg.rhs() - H * dx).norm() / pcg.rhs().norm(), statistics->relativeResidual, 1e-9);
+        }
+      }
+    }
+
+    // The Schur-Jacobi preconditioner eliminates the landmarks exactly, so it needs fewer iterations than block Jacobi
+    size_t iterations[2];
+    for (int i = 0; i < 2; ++i) {
+      PcgLinearSolverOptions options;
+      options.preconditioner = i == 0 ? PcgLinearSolverOptions::BLOCK_JACOBI : PcgLinearSolverOptions::SCHUR_JACOBI;
+      options.tolerance = 1e-10;
+      PcgLinearSystemSolver pcg(options);
+      pcg.initMatrixStructure(dvs, errs, false);
+      pcg.evaluateError(1, false);
+      pcg.buildSystem(1, false);
+      Eigen::VectorXd dx;
+      ASSERT_TRUE(pcg.solveSystem(dx));
+      iterations[i] = pcg.getIterativeSolverStatistics()->iterations;
+    }
+    EXPECT_LE(iterations[1], iterations[0]);
+
+    // Marginalized design variables must not be coupled for the Schur-Jacobi preconditioner
+    errs.push_back(new LinearErr2((Point2d*)dvs[1], (Point2d*)dvs[3]));
+    errs.back()->setRowBase(errs[errs.size() - 2]->rowBase() + errs[errs.size() - 2]->dimension());
+    PcgLinearSolverOptions options;
+    options.preconditioner = PcgLinearSolverOptions::SCHUR_JACOBI;
+    PcgLinearSystemSolver pcg(options);
+    EXPECT_ANY_THROW(pcg.initMatrixStructure(dvs, errs, false));
+    deleteSystem(dvs, errs);
+  } catch (const std::exception& e) {
+    deleteSystem(dvs, errs);
+    FAIL() << e.what();
+  }
+}
+
+TEST(LinearSolverTestSuite, testSolveSystemsForSeveralConditioners)
+{
+  using namespace aslam::backend;
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  buildSystem(4, 20, dvs, errs);
+  try {
+    const std::vector<double> conditioners = {1e-3, 1e-1, 1.0, 10.0, 1e3};
+    for (const size_t nThreads : {1, 3}) {
+      SCOPED_TRACE(("Threads " + boost::lexical_cast<std::string>(nThreads)).c_str());
+      DenseQrLinearSystemSolver solver;
+      solver.initMatrixStructure(dvs, errs, true);
+      solver.evaluateError(1, false);
+      solver.buildSystem(1, false);
+      const Eigen::MatrixXd JtJ = solver.getJacobian().transpose() * solver.getJacobian();
+
+      std::vector<Eigen::VectorXd> dxs;
+      solver.solveSystems(conditioners, nThreads, dxs);
+      ASSERT_EQ(conditioners.size(), dxs.size());
+      for (size_t i = 0; i < conditioners.size(); ++i) {
+        Eigen::MatrixXd H = JtJ;
+        H.diagonal().array() += conditioners[i] * conditioners[i];
+        ASSERT_DOUBLE_MX_EQ(H.ldlt().solve(solver.rhs()), dxs[i], 1e-6, "Checking the solution");
+      }
+      // The last conditioner stays set
+      Eigen::VectorXd dx;
+      ASSERT_TRUE(solver.solveSystem(dx));
+      ASSERT_DOUBLE_MX_EQ(dxs.back(), dx, 1e-9, "Checking the solution for the last conditioner");
+
+      // The sparse Cholesky solver factorizes the other conditioned systems with the symbolic factorization of the last one
+      for (const int system : {0, 1, 2}) {
+        SCOPED_TRACE(testing::Message() << "system: " << system);
+        SparseCholeskyLinearSolverOptions options;
+        options.cacheHessian = system == 1;
+        options.assembleHessian = system == 2;
+        SparseCholeskyLinearSystemSolver cholesky(options);
+        cholesky.initMatrixStructure(dvs, errs, true);
+        cholesky.evaluateError(1, false);
+        cholesky.buildSystem(1, false);
+        std::vector<Eigen::VectorXd> choleskyDxs;
+        cholesky.solveSystems(conditioners, nThreads, choleskyDxs);
+        ASSERT_EQ(conditioners.size(), choleskyDxs.size());
+        for (size_t i = 0; i < conditioners.size(); ++i)
+          ASSERT_DOUBLE_MX_EQ(dxs[i], choleskyDxs[i], 1e-6, "Checking the sparse Cholesky solution");
+        ASSERT_TRUE(cholesky.solveSystem(dx));
+        ASSERT_DOUBLE_MX_EQ(dxs.back(), dx, 1e-9, "Checking the sparse Cholesky solution for the last conditioner");
+      }
+    }
+    deleteSystem(dvs, errs);
+  } catch (const std::exception& e) {
+    deleteSystem(dvs, errs);
+    FAIL() << e.what();
+  }
+}
+
 class ConstZeroError : public ErrorTermFs<1> {
  protected:
   virtual double evaluateErrorImplementation() { return 0; }
@@ -145,6 +635,63 @@ class ConstZeroError : public ErrorTermFs<1> {
   virtual void evaluateJacobiansImplementation(JacobianContainer &) {}
 };
 
+TEST(LinearSolverTestSuite, testDenseDecompositions)
+{
+  using namespace aslam::backend;
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  buildSystem(10, 40, dvs, errs);
+  // A design variable without error terms makes J^T J singular if it is not damped
+  dvs.push_back(new Point2d(Eigen::Vector2d::Random()));
+  dvs.back()->setActive(true);
+  dvs.back()->setBlockIndex(dvs.size() - 1);
+  dvs.back()->setColumnBase(2 * (dvs.size() - 1));
+  try {
+    for (const bool useDiag : {false, true}) {
+      SCOPED_TRACE(testing::Message() << "useDiag: " << useDiag);
+      DenseQrLinearSystemSolver reference;
+      reference.initMatrixStructure(dvs, errs, useDiag);
+      reference.evaluateError(1, false);
+      reference.buildSystem(1, false);
+      for (const auto decomposition : {DenseQRLinearSolverOptions::HOUSEHOLDER_QR, DenseQRLinearSolverOptions::NORMAL_EQUATIONS_LLT,
+                                       DenseQRLinearSolverOptions::NORMAL_EQUATIONS_LDLT}) {
+        // The blocked QR without pivoting needs a Jacobian of full rank
+        if (!useDiag && decomposition == DenseQRLinearSolverOptions::HOUSEHOLDER_QR)
+          continue;
+        SCOPED_TRACE(testing::Message() << "decomposition: " << decomposition);
+        DenseQRLinearSolverOptions options;
+        options.decomposition = decomposition;
+        DenseQrLinearSystemSolver solver(options);
+        solver.initMatrixStructure(dvs, errs, useDiag);
+        solver.evaluateError(3, false);
+        solver.buildSystem(3, false);
+        ASSERT_DOUBLE_MX_EQ(reference.rhs(), solver.rhs(), 1e-9, "Checking the right-hand side");
+        Eigen::VectorXd expectedDx, dx;
+        for (const double lambda : {1e-3, 1e-1, 10.0}) {
+          SCOPED_TRACE(testing::Message() << "lambda: " << lambda);
+          reference.setConstantConditioner(lambda);
+          solver.setConstantConditioner(lambda);
+          ASSERT_TRUE(reference.solveSystem(expectedDx));
+          ASSERT_TRUE(solver.solveSystem(dx));
+          ASSERT_DOUBLE_MX_EQ(expectedDx, dx, 1e-6, "Checking the solution against the column pivoting QR");
+        }
+        // The singular normal equations of the undamped system fall back to QR
+        if (decomposition != DenseQRLinearSolverOptions::HOUSEHOLDER_QR)
+          EXPECT_EQ(useDiag ? 0u : 3u, solver.getNumNormalEquationsFallbacks());
+        if (useDiag) {
+          std::vector<Eigen::VectorXd> dxs;
+          solver.solveSystems({1e-3, 1e-1, 10.0}, 2, dxs);
+          ASSERT_DOUBLE_MX_EQ(dx, dxs.back(), 1e-9, "Checking the parallel solutions");
+        }
+      }
+    }
+    deleteSystem(dvs, errs);
+  } catch (const std::exception& e) {
+    deleteSystem(dvs, errs);
+    FAIL() << e.what();
+  }
+}
+
 TEST(LinearSolverTestSuite, testSparseQRAcceptConstantErrorTerms)
 {
   using namespace aslam::backend;
@@ -87,6 +87,11 @@ protected:
     _v = value;
   }
 
+  /// Computes the difference between the current value and xHat
+  void minimalDifferenceImplementation(const Eigen::MatrixXd& xHat, Eigen::VectorXd& outDifference) const override {
+    outDifference = _v - xHat;
+  }
+
 };
 
 class LinearErr : public aslam::backend::ErrorTermFs<2> {
@@ -275,6 +280,41 @@ inline void buildSystem(int D, int E, std::vector<aslam::backend::DesignVariable
   }
 }
 
+/// \brief Build a system of \p P >= 4 poses and \p L landmarks, which are marginalized. The landmarks are interleaved
+///        with the poses in the block order and each of them shares error terms with three poses but no other landmark.
+inline void buildLandmarkSystem(int P, int L, std::vector<aslam::backend::DesignVariable*>& dvs, std::vector<aslam::backend::ErrorTerm*>& errs)
+{
+  using namespace aslam::backend;
+  std::vector<Point2d*> poses, landmarks;
+  int blockBase = 0;
+  for (int i = 0; i < P + L; ++i) {
+    Point2d* dv = new Point2d(Eigen::Vector2d::Random());
+    const bool isLandmark = (int)landmarks.size() < L && (i % 2 == 1 || (int)poses.size() == P);
+    (isLandmark ? landmarks : poses).push_back(dv);
+    dv->setMarginalized(isLandmark);
+    dv->setActive(true);
+    dv->setBlockIndex(i);
+    dv->setColumnBase(blockBase);
+    blockBase += dv->minimalDimensions();
+    dvs.push_back(dv);
+  }
+  for (int i = 0; i < P; ++i) {
+    errs.push_back(new LinearErr(poses[i]));
+    if (i > 0)
+      errs.push_back(new LinearErr2(poses[i - 1], poses[i]));
+  }
+  for (int i = 0; i < L; ++i) {
+    errs.push_back(new LinearErr2(poses[i % P], landmarks[i]));
+    errs.push_back(new LinearErr2(landmarks[i], poses[(i + 1) % P]));
+    errs.push_back(new LinearErr3(poses[(i + 3) % P], landmarks[i], poses[i % P]));
+  }
+  int rows = 0;
+  for (ErrorTerm* err : errs) {
+    err->setRowBase(rows);
+    rows += err->dimension();
+  }
+}
+
 inline void deleteSystem(std::vector<aslam::backend::DesignVariable*>& dvs, std::vector<aslam::backend::ErrorTerm*>& errs)
 {
   using namespace aslam::backend;
@@ -0,0 +1,285 @@
+#include <sm/eigen/gtest.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <aslam/backend/CompressedColumnJacobianTransposeBuilder.hpp>
+#include <aslam/backend/DenseQrLinearSystemSolver.hpp>
+#include <aslam/backend/LevenbergMarquardtTrustRegionPolicy.hpp>
+#include <aslam/backend/OptimizationProblem.hpp>
+#include <aslam/backend/Optimizer2.hpp>
+#include <aslam/backend/util/ProblemManager.hpp>
+
+#include "SampleDvAndError.hpp"
+
+using namespace aslam::backend;
+
+#ifdef __GLIBC__
+
+// Count the heap allocations by interposing malloc. Eigen allocates with malloc directly,
+// the default operator new calls malloc as well.
+extern "C" void* __libc_malloc(std::size_t size);
+extern "C" void* __libc_calloc(std::size_t num, std::size_t size);
+extern "C" void* __libc_realloc(void* ptr, std::size_t size);
+
+namespace {
+std::atomic<bool> countAllocations(false);
+std::atomic<std::size_t> numAllocations(0);
+
+void recordAllocation() {
+  if (countAllocations.load(std::memory_order_relaxed))
+    ++numAllocations;
+}
+} // namespace
+
+extern "C" void* malloc(std::size_t size) {
+  recordAllocation();
+  return __libc_malloc(size);
+}
+
+extern "C" void* calloc(std::size_t num, std::size_t size) {
+  recordAllocation();
+  return __libc_calloc(num, size);
+}
+
+extern "C" void* realloc(void* ptr, std::size_t size) {
+  recordAllocation();
+  return __libc_realloc(ptr, size);
+}
+
+namespace {
+
+/// \brief Counts the heap allocations of all threads while in scope
+struct AllocationCounter {
+  AllocationCounter() { numAllocations = 0; countAllocations = true; }
+  ~AllocationCounter() { countAllocations = false; }
+  std::size_t count() const { return numAllocations; }
+};
+
+/// \brief A linear error term with stored Jacobians, so the evaluation itself does not allocate
+template <int Dim>
+class StoredJacobianError : public ErrorTermFs<Dim> {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  StoredJacobianError(const std::vector<DesignVariable*>& dvs) {
+    for (DesignVariable* dv : dvs)
+      _J.push_back(Eigen::MatrixXd::Random(Dim, dv->minimalDimensions()));
+    this->setDesignVariables(dvs);
+    this->setInvR(sm::eigen::randomCovariance<Dim>());
+  }
+
+ protected:
+  double evaluateErrorImplementation() override {
+    this->setError(Eigen::Matrix<double, Dim, 1>::Ones());
+    return this->evaluateChiSquaredError();
+  }
+
+  void evaluateJacobiansImplementation(JacobianContainer& outJ) override {
+    for (std::size_t i = 0; i < _J.size(); ++i)
+      outJ.add(this->designVariable(i), _J[i]);
+  }
+
+ private:
+  std::vector<Eigen::MatrixXd> _J;
+};
+
+/// \brief A linear error term of 2d points with stored Jacobians, so the evaluation itself does not allocate
+class LinearPointError : public ErrorTermFs<2> {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  LinearPointError(Point2d* a, Point2d* b) : _a(a), _b(b), _Ja(Eigen::Matrix2d::Random()), _Jb(Eigen::Matrix2d::Random()),
+      _offset(Eigen::Vector2d::Random()) {
+    setDesignVariables(a, b);
+  }
+
+ protected:
+  double evaluateErrorImplementation() override {
+    setError(_Ja * _a->_v + _Jb * _b->_v + _offset);
+    return evaluateChiSquaredError();
+  }
+
+  void evaluateJacobiansImplementation(JacobianContainer& outJ) override {
+    outJ.add(_a, _Ja);
+    outJ.add(_b, _Jb);
+  }
+
+ private:
+  Point2d* _a;
+  Point2d* _b;
+  Eigen::Matrix2d _Ja, _Jb;
+  Eigen::Vector2d _offset;
+};
+
+/// \brief A linear non-squared error term with a stored Jacobian, so the evaluation itself does not allocate
+class StoredJacobianNonSquaredError : public ScalarNonSquaredErrorTerm {
+ public:
+  StoredJacobianNonSquaredError(DesignVariable* dv) : _J(Eigen::MatrixXd::Random(1, dv->minimalDimensions())) {
+    setDesignVariables(dv);
+    setWeight(1.0);
+  }
+
+ protected:
+  double evaluateErrorImplementation() override { return 1.0; }
+
+  void evaluateJacobiansImplementation(JacobianContainer& outJ) override {
+    outJ.add(designVariable(0), _J);
+  }
+
+ private:
+  Eigen::MatrixXd _J;
+};
+
+/// \brief Create \p D design variables and \p E error terms with dimension 2 and, if \p mixDimensions is set, 4.
+///        If \p nonSquaredErrs is given, every design variable gets a non-squared error term in addition.
+void buildStoredJacobianSystem(int D, int E, bool mixDimensions, std::vector<DesignVariable*>& dvs, std::vector<ErrorTerm*>& errs,
+                               std::vector<ScalarNonSquaredErrorTerm*>* nonSquaredErrs = nullptr)
+{
+  int columnBase = 0;
+  for (int i = 0; i < D; ++i) {
+    dvs.push_back(new Point2d(Eigen::Vector2d::Random()));
+    dvs.back()->setActive(true);
+    dvs.back()->setBlockIndex(i);
+    dvs.back()->setColumnBase(columnBase);
+    columnBase += dvs.back()->minimalDimensions();
+  }
+  int rowBase = 0;
+  for (int i = 0; i < E; ++i) {
+    if (mixDimensions && i % 2 == 1)
+      errs.push_back(new StoredJacobianError<4>({ dvs[i % D], dvs[(i + 1) % D], dvs[(i + 2) % D] }));
+    else
+      errs.push_back(new StoredJacobianError<2>({ dvs[i % D], dvs[(i + 1) % D] }));
+    errs.back()->setRowBase(rowBase);
+    rowBase += errs.back()->dimension();
+  }
+  if (nonSquaredErrs) {
+    for (DesignVariable* dv : dvs)
+      nonSquaredErrs->push_back(new StoredJacobianNonSquaredError(dv));
+  }
+}
+
+} // namespace
+
+TEST(AllocationTestSuite, testJacobianTransposeBuilderDoesNotAllocate)
+{
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  buildStoredJacobianSystem(10, 200, true, dvs, errs);
+  for (const std::size_t nThreads : { 1, 4 }) {
+    SCOPED_TRACE(testing::Message() << "nThreads: " << nThreads);
+    CompressedColumnJacobianTransposeBuilder<int> builder;
+    builder.initMatrixStructure(dvs, errs);
+    // Warm up the thread pool and the per-thread Jacobian containers
+    builder.buildSystem(nThreads, false);
+    builder.buildSystem(nThreads, false);
+
+    AllocationCounter counter;
+    builder.buildSystem(nThreads, false);
+    EXPECT_EQ(0u, counter.count());
+  }
+  deleteSystem(dvs, errs);
+}
+
+TEST(AllocationTestSuite, testDenseQrBuildSystemDoesNotAllocate)
+{
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  buildStoredJacobianSystem(10, 200, true, dvs, errs);
+  for (const std::size_t nThreads : { 1, 4 }) {
+    SCOPED_TRACE(testing::Message() << "nThreads: " << nThreads);
+    DenseQrLinearSystemSolver solver;
+    solver.initMatrixStructure(dvs, errs, false);
+    for (int i = 0; i < 2; ++i) {
+      solver.evaluateError(nThreads, false);
+      solver.buildSystem(nThreads, false);
+    }
+
+    AllocationCounter counter;
+    solver.evaluateError(nThreads, false);
+    solver.buildSystem(nThreads, false);
+    EXPECT_EQ(0u, counter.count());
+  }
+  deleteSystem(dvs, errs);
+}
+
+TEST(AllocationTestSuite, testGradientDoesNotAllocate)
+{
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  std::vector<ScalarNonSquaredErrorTerm*> nonSquaredErrs;
+  buildStoredJacobianSystem(10, 200, true, dvs, errs, &nonSquaredErrs);
+  boost::shared_ptr<OptimizationProblem> problem(new OptimizationProblem());
+  for (DesignVariable* dv : dvs)
+    problem->addDesignVariable(dv, false);
+  for (ErrorTerm* err : errs)
+    problem->addErrorTerm(err, false);
+  for (ScalarNonSquaredErrorTerm* err : nonSquaredErrs)
+    problem->addErrorTerm(err, false);
+  for (const std::size_t nThreads : { 1, 4 }) {
+    SCOPED_TRACE(testing::Message() << "nThreads: " << nThreads);
+    ProblemManager pm(problem);
+
+    RowVectorType gradient;
+    pm.computeGradient(gradient, nThreads, false, false, false);
+    pm.computeGradient(gradient, nThreads, false, false, false);
+    AllocationCounter counter;
+    pm.computeGradient(gradient, nThreads, false, false, false);
+    EXPECT_EQ(0u, counter.count());
+  }
+  for (ScalarNonSquaredErrorTerm* err : nonSquaredErrs)
+    delete err;
+  deleteSystem(dvs, errs);
+}
+
+TEST(AllocationTestSuite, testOptimizer2IterationDoesNotAllocate)
+{
+  std::vector<Point2d*> points;
+  std::vector<Eigen::Vector2d, Eigen::aligned_allocator<Eigen::Vector2d> > initialValues;
+  boost::shared_ptr<OptimizationProblem> problem(new OptimizationProblem());
+  for (int i = 0; i < 10; ++i) {
+    initialValues.push_back(Eigen::Vector2d::Random());
+    points.push_back(new Point2d(initialValues.back()));
+    problem->addDesignVariable(points.back(), true);
+    points.back()->setActive(true);
+  }
+  for (int i = 0; i < 100; ++i)
+    problem->addErrorTerm(new LinearPointError(points[i % points.size()], points[(i + 1) % points.size()]), true);
+
+  for (const std::size_t nThreads : { 1, 4 }) {
+    SCOPED_TRACE(testing::Message() << "nThreads: " << nThreads);
+    Optimizer2Options options;
+    options.linearSystemSolver.reset(new DenseQrLinearSystemSolver());
+    options.trustRegionPolicy.reset(new LevenbergMarquardtTrustRegionPolicy());
+    // Never converge, so every optimization runs maxIterations iterations
+    options.convergenceDeltaError = -1.0;
+    options.convergenceDeltaX = -1.0;
+    options.numThreadsError = nThreads;
+    options.numThreadsJacobian = nThreads;
+    Optimizer2 optimizer(options);
+    optimizer.setProblem(problem);
+    // Every optimization starts from the same state, so the measured ones retrace the warm-up
+    auto optimizeFromInitialValues = [&](int maxIterations) {
+      for (std::size_t i = 0; i < points.size(); ++i)
+        points[i]->_v = points[i]->_p_v = initialValues[i];
+      optimizer.options().maxIterations = maxIterations;
+      optimizer.optimize();
+    };
+    optimizeFromInitialValues(8);
+
+    // The set up of an optimization allocates, the iterations (evaluate, build, solve, step) must not
+    std::size_t numAllocations[2];
+    for (const int maxIterations : { 3, 8 }) {
+      AllocationCounter counter;
+      optimizeFromInitialValues(maxIterations);
+      numAllocations[maxIterations == 8] = counter.count();
+    }
+    EXPECT_EQ(8u, optimizer.getStatus().numIterations);
+    EXPECT_EQ(numAllocations[0], numAllocations[1]);
+  }
+}
+
+#endif /* __GLIBC__ */
@@ -7,6 +7,10 @@
 #include <aslam/backend/test/ErrorTermTester.hpp>
 #include "SampleDvAndError.hpp"
 
+#include <atomic>
+
+#include <boost/ptr_container/ptr_vector.hpp>
+
 #include <sm/random.hpp>
 #include <sm/logging.hpp>
 
@@ -154,3 +158,144 @@ TEST(LineSearchTestSuite, testLineSearch)
     FAIL() << e.what();
   }
 }
+
+/// \brief f(x) = sum_i (i + 1) * (x_i - 1)^2 on scalar design variables. Evaluations at a step only read the design variables.
+class QuadraticCostFunction : public CostFunctionInterface {
+ public:
+  QuadraticCostFunction(const std::vector<DesignVariable*>& dvs, bool concurrent) : _dvs(dvs), _concurrent(concurrent) { }
+  double evaluateError() const override {
+    return evaluate(RowVectorType::Zero(_dvs.size()), nullptr);
+  }
+  void computeGradient(RowVectorType& gradient) override {
+    evaluate(RowVectorType::Zero(_dvs.size()), &gradient);
+  }
+  const std::vector<DesignVariable*>& getDesignVariables() override { return _dvs; }
+  bool supportsConcurrentEvaluation() const override { return _concurrent; }
+  double evaluateAtStep(const RowVectorType& dx, RowVectorType* gradient) override {
+    ++numStepEvaluations;
+    return evaluate(dx, gradient);
+  }
+  std::atomic<int> numStepEvaluations{0};
+ private:
+  double evaluate(const RowVectorType& dx, RowVectorType* gradient) const {
+    double error = 0.0;
+    if (gradient)
+      gradient->resize(_dvs.size());
+    for (size_t i = 0; i < _dvs.size(); ++i) {
+      const double x = static_cast<const Scalar*>(_dvs[i])->_v[0] + dx[i];
+      error += (i + 1) * (x - 1.0) * (x - 1.0);
+      if (gradient)
+        (*gradient)[i] = 2.0 * (i + 1) * (x - 1.0);
+    }
+    return error;
+  }
+  std::vector<DesignVariable*> _dvs;
+  const bool _concurrent;
+};
+
+TEST(LineSearchTestSuite, testSpeculativeLineSearch)
+{
+  try {
+    const size_t N = 5;
+    enum LineSearchMethod { WOLFE2, WOLFE12 };
+    for ( auto& method : {WOLFE2, WOLFE12} ) {
+      SCOPED_TRACE(method);
+      // A short initial step needs several doublings in the bracketing phase
+      LineSearchOptions options;
+      options.initialStepLength = 1e-3;
+      options.nMaxIterWolfe2 = 20;
+      options.numParallelEvaluations = 4;
+
+      std::vector<double> stepLengths[2], errors[2];
+      std::vector<RowVectorType> states[2];
+      for (bool concurrent : { false, true }) {
+        boost::ptr_vector<Scalar> scalars;
+        std::vector<DesignVariable*> dvs;
+        for (size_t i = 0; i < N; ++i) {
+          scalars.push_back(new Scalar(Scalar::Vector1d::Constant(-10.0 + i)));
+          scalars.back().setActive(true);
+          dvs.push_back(&scalars.back());
+        }
+        boost::shared_ptr<QuadraticCostFunction> costFunction(new QuadraticCostFunction(dvs, concurrent));
+        LineSearch ls(costFunction, options);
+        EXPECT_EQ(concurrent, ls.isSpeculative());
+        ls.initialize();
+        for (std::size_t iter = 0; iter < 5; iter++) {
+          ls.setSearchDirection(-ls.getGradient());
+          EXPECT_TRUE(method == WOLFE2 ? ls.lineSearchWolfe2() : ls.lineSearchWolfe12());
+          stepLengths[concurrent].push_back(ls.getCurrentStepLength());
+          errors[concurrent].push_back(ls.getError());
+
+          // The state, error and gradient are those of the accepted step length
+          EXPECT_DOUBLE_EQ(costFunction->evaluateError(), ls.getError());
+          RowVectorType gradient;
+          costFunction->computeGradient(gradient);
+          sm::eigen::assertEqual(gradient, ls.getGradient(), SM_SOURCE_FILE_POS);
+          EXPECT_DOUBLE_EQ(ls.getErrorDerivative(), ls.computeErrorDerivative());
+          RowVectorType state(N);
+          for (size_t i = 0; i < N; ++i)
+            state[i] = scalars[i]._v[0];
+          states[concurrent].push_back(state);
+        }
+        EXPECT_EQ(concurrent, costFunction->numStepEvaluations > 0);
+      }
+
+      // The speculative evaluation does not change the step lengths accepted by wolfe2.
+      // With wolfe12, the methods are tried in a different order, but both decrease the error.
+      for (size_t k = 0; k < stepLengths[0].size(); ++k) {
+        if (method == WOLFE12) {
+          if (k > 0)
+            EXPECT_LT(errors[1][k], errors[1][k - 1]);
+          continue;
+        }
+        EXPECT_DOUBLE_EQ(stepLengths[0][k], stepLengths[1][k]);
+        EXPECT_DOUBLE_EQ(errors[0][k], errors[1][k]);
+        sm::eigen::assertNear(states[0][k], states[1][k], 1e-12, SM_SOURCE_FILE_POS);
+      }
+    }
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
+
+TEST(LineSearchTestSuite, testSpeculativeLineSearchOnReplicas)
+{
+  try {
+    LineSearchOptions options;
+    options.initialStepLength = 1e-3;
+    options.nMaxIterWolfe2 = 20;
+    options.numParallelEvaluations = 4;
+
+    std::vector<double> stepLengths[2], errors[2];
+    std::vector<Eigen::VectorXd> states[2];
+    for (bool concurrent : { false, true }) {
+      ProblemManager pm(buildProblem(1, 4, 10));
+      if (concurrent) {
+        for (size_t i = 0; i < options.numParallelEvaluations; ++i)
+          pm.addReplica(buildProblem(1, 4, 10));
+      }
+      auto costFunction = getCostFunction(pm, false, false, false, 1, 1);
+      LineSearch ls(costFunction, options);
+      EXPECT_EQ(concurrent, ls.isSpeculative());
+      ls.initialize();
+      for (std::size_t iter = 0; iter < 5; iter++) {
+        ls.setSearchDirection(-ls.getGradient());
+        EXPECT_TRUE(ls.lineSearchWolfe2());
+        stepLengths[concurrent].push_back(ls.getCurrentStepLength());
+        errors[concurrent].push_back(ls.getError());
+        EXPECT_NEAR(pm.evaluateError(1), ls.getError(), 1e-9 * ls.getError());
+        states[concurrent].push_back(pm.getFlattenedDesignVariableParameters());
+      }
+    }
+
+    // The replicas evaluate the same step lengths as the problem itself
+    for (size_t k = 0; k < stepLengths[0].size(); ++k) {
+      SCOPED_TRACE(k);
+      EXPECT_DOUBLE_EQ(stepLengths[0][k], stepLengths[1][k]);
+      EXPECT_NEAR(errors[0][k], errors[1][k], 1e-9 * errors[0][k]);
+      sm::eigen::assertNear(states[0][k], states[1][k], 1e-9, SM_SOURCE_FILE_POS);
+    }
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
@@ -0,0 +1,138 @@
+#include <sm/eigen/gtest.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <aslam/backend/util/LoadBalancer.hpp>
+#include <aslam/backend/util/ThreadPool.hpp>
+#include <aslam/backend/util/ThreadedRangeProcessor.hpp>
+
+using namespace aslam::backend;
+using namespace aslam::backend::util;
+
+namespace {
+
+/// \brief Sleeps for a time proportional to the cost of each index and counts the visits
+struct SleepingJob {
+  SleepingJob(const std::vector<int>& costs) : costs(costs), visits(costs.size()) {
+    for (auto& v : visits) v = 0;
+  }
+  void operator()(std::size_t /* threadId */, std::size_t startIdx, std::size_t endIdx) {
+    for (std::size_t i = startIdx; i < endIdx; ++i) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100 * costs[i]));
+      ++visits[i];
+    }
+  }
+  const std::vector<int> costs;
+  std::vector<std::atomic<int> > visits;
+};
+
+} // namespace
+
+TEST(LoadBalancerTestSuite, testChunkBoundariesByCost)
+{
+  LoadBalancer balancer;
+  balancer.init({ 1.0, 1.0, 1.0, 1.0, 4.0, 0.0, -1.0, 2.0 });
+  EXPECT_EQ(8u, balancer.size());
+  EXPECT_DOUBLE_EQ(1.0, balancer.getCosts()[5]);
+  EXPECT_DOUBLE_EQ(1.0, balancer.getCosts()[6]);
+
+  const std::vector<std::size_t> boundaries = balancer.computeChunkBoundaries(3);
+  ASSERT_EQ(4u, boundaries.size());
+  EXPECT_EQ(0u, boundaries[0]);
+  EXPECT_EQ(4u, boundaries[1]);
+  EXPECT_EQ(5u, boundaries[2]);
+  EXPECT_EQ(8u, boundaries[3]);
+
+  // More chunks than items: at most one chunk per item, a chunk ends at the expensive item
+  const std::vector<std::size_t> small = balancer.computeChunkBoundaries(100);
+  ASSERT_EQ(9u, small.size());
+  EXPECT_EQ(0u, small.front());
+  EXPECT_EQ(8u, small.back());
+  for (std::size_t i = 1; i < small.size(); ++i)
+    EXPECT_LE(small[i - 1], small[i]);
+  EXPECT_NE(small.end(), std::find(small.begin(), small.end(), 5u));
+}
+
+TEST(LoadBalancerTestSuite, testChunkBoundariesWithoutCost)
+{
+  // Measuring zero durations zeroes all estimates, the items are then split evenly by count
+  LoadBalancer balancer;
+  balancer.init(std::vector<double>(7, 1.0));
+  balancer.beginJob(1);
+  balancer.addMeasurement(0, 0, 7, 0.0);
+  balancer.endJob(0.0);
+  for (const double cost : balancer.getCosts())
+    ASSERT_EQ(0.0, cost);
+
+  const std::vector<std::size_t> boundaries = balancer.computeChunkBoundaries(3);
+  const std::vector<std::size_t> expected = { 0, 2, 4, 7 };
+  EXPECT_EQ(expected, boundaries);
+}
+
+TEST(LoadBalancerTestSuite, testMeasurementsRefineCosts)
+{
+  LoadBalancer balancer;
+  balancer.init(std::vector<double>(4, 1.0));
+  balancer.beginJob(2);
+  balancer.addMeasurement(0, 0, 2, 6.0);
+  balancer.addMeasurement(1, 2, 4, 2.0);
+  balancer.endJob(6.0);
+
+  // The first measurement replaces the hints
+  EXPECT_DOUBLE_EQ(3.0, balancer.getCosts()[0]);
+  EXPECT_DOUBLE_EQ(1.0, balancer.getCosts()[3]);
+  EXPECT_DOUBLE_EQ(8.0, balancer.getStatistics().totalBusyTime());
+  EXPECT_DOUBLE_EQ(1.5, balancer.getStatistics().imbalance());
+  EXPECT_DOUBLE_EQ(6.0, balancer.getStatistics().wallTime);
+
+  // Later measurements are smoothed
+  balancer.beginJob(1);
+  balancer.addMeasurement(0, 0, 1, 1.0);
+  balancer.endJob(1.0);
+  EXPECT_DOUBLE_EQ(2.0, balancer.getCosts()[0]);
+  EXPECT_DOUBLE_EQ(1.0, balancer.getStatistics().imbalance());
+}
+
+TEST(LoadBalancerTestSuite, testBalancedJobProcessesEachIndexOnce)
+{
+  // The expensive items are all at the front, the hints don't know about it
+  std::vector<int> costs(64, 1);
+  for (std::size_t i = 0; i < 8; ++i)
+    costs[i] = 20;
+
+  ThreadedJobOptions options;
+  for (bool useThreadPool : {true, false}) {
+    options.useThreadPool = useThreadPool;
+    LoadBalancer balancer;
+    balancer.init(std::vector<double>(costs.size(), 1.0));
+    for (int run = 0; run < 3; ++run) {
+      SleepingJob job(costs);
+      runThreadedJob(boost::ref(job), balancer, 4, options);
+      for (std::size_t i = 0; i < costs.size(); ++i)
+        ASSERT_EQ(1, job.visits[i]) << "index " << i << " in run " << run;
+      ASSERT_EQ(4u, balancer.getStatistics().busyTime.size());
+      EXPECT_GT(balancer.getStatistics().wallTime, 0.0);
+    }
+    // After calibration the expensive items carry most of the estimated cost
+    EXPECT_GT(balancer.getCosts()[0], 5.0 * balancer.getCosts()[63]);
+  }
+}
+
+TEST(LoadBalancerTestSuite, testChunkBoundariesOnThreadPool)
+{
+  ThreadPool pool;
+  const std::vector<std::size_t> boundaries = { 0, 0, 3, 10, 11, 50 };
+  std::vector<std::atomic<int> > visits(50);
+  for (auto& v : visits) v = 0;
+  pool.parallelFor([&visits](std::size_t, std::size_t startIdx, std::size_t endIdx) {
+    EXPECT_LT(startIdx, endIdx);
+    for (std::size_t i = startIdx; i < endIdx; ++i)
+      ++visits[i];
+  }, boundaries, 3);
+  for (std::size_t i = 0; i < visits.size(); ++i)
+    ASSERT_EQ(1, visits[i]) << "index " << i;
+}
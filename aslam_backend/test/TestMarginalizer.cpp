@@ -0,0 +1,95 @@
+#include <sm/eigen/gtest.hpp>
+
+#include <aslam/backend/Marginalizer.hpp>
+#include <aslam/backend/DenseQrLinearSystemSolver.hpp>
+
+#include "SampleDvAndError.hpp"
+
+using namespace aslam::backend;
+
+namespace {
+
+/// \brief Checks that marginalizing with \p method gives the same prior and covariance as the dense QR decomposition
+void compareWithDenseQr(MarginalizerOptions::Method method, size_t numThreads)
+{
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  try {
+    srand(0);
+    sm::random::seed(0);
+    const int D = 6;
+    const int E = 30;
+    const int numToRemove = 2;
+    const size_t numTopRowsInCov = 4;
+    buildSystem(D, E, dvs, errs);
+
+    boost::shared_ptr<MarginalizationPriorErrorTerm> densePrior, prior;
+    Eigen::MatrixXd denseCov, cov;
+    std::vector<DesignVariable*> denseTop, top;
+    marginalize(dvs, errs, numToRemove, false, densePrior, denseCov, denseTop, numTopRowsInCov, 1);
+    MarginalizerOptions options;
+    options.method = method;
+    options.numThreads = numThreads;
+    marginalize(dvs, errs, numToRemove, false, prior, cov, top, numTopRowsInCov, options);
+
+    ASSERT_EQ(densePrior->dimension(), prior->dimension());
+    ASSERT_EQ(densePrior->numDesignVariables(), prior->numDesignVariables());
+    EXPECT_TRUE(denseTop == top);
+    sm::eigen::assertNear(denseCov, cov, 1e-8, SM_SOURCE_FILE_POS, "Checking the covariances");
+
+    // The covariance is the top left block of the inverse of J^T J
+    int columnBase = 0;
+    for (size_t i = 0; i < dvs.size(); ++i) {
+      dvs[i]->setBlockIndex(i);
+      dvs[i]->setColumnBase(columnBase);
+      columnBase += dvs[i]->minimalDimensions();
+    }
+    int rowBase = 0;
+    for (ErrorTerm* e : errs) {
+      e->setRowBase(rowBase);
+      rowBase += e->dimension();
+    }
+    DenseQrLinearSystemSolver qrSolver;
+    qrSolver.initMatrixStructure(dvs, errs, false);
+    qrSolver.buildSystem(1, false);
+    const Eigen::MatrixXd& J = qrSolver.getJacobian();
+    const Eigen::MatrixXd fullCov = (J.transpose() * J).inverse();
+    sm::eigen::assertNear(fullCov.topLeftCorner(numTopRowsInCov, numTopRowsInCov), cov, 1e-8, SM_SOURCE_FILE_POS, "Checking the covariance against the inverse of the Hessian");
+
+    // The signs of the rows of R and d depend on the decomposition. The squared error ||R dx - d||^2 does not,
+    // and it is equal for all dx iff R^T R, R^T d and d^T d are.
+    for (int trial = 0; trial < 5; ++trial) {
+      SCOPED_TRACE(trial);
+      for (size_t i = numToRemove; i < dvs.size(); ++i) {
+        Eigen::VectorXd dx = Eigen::VectorXd::Random(dvs[i]->minimalDimensions());
+        if (trial == 0)
+          dx.setZero();
+        dvs[i]->update(dx.data(), dx.size());
+      }
+      const double denseError = densePrior->evaluateError();
+      EXPECT_NEAR(denseError, prior->evaluateError(), 1e-8 * (1.0 + denseError));
+      for (size_t i = numToRemove; i < dvs.size(); ++i)
+        dvs[i]->revertUpdate();
+    }
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+  deleteSystem(dvs, errs);
+}
+
+} // namespace
+
+#ifndef QRSOLVER_DISABLED
+TEST(MarginalizerTestSuite, testSparseQrMatchesDenseQr)
+{
+  compareWithDenseQr(MarginalizerOptions::SPARSE_QR, 2);
+}
+#endif
+
+TEST(MarginalizerTestSuite, testSchurComplementMatchesDenseQr)
+{
+  for (size_t numThreads = 1; numThreads <= 3; ++numThreads) {
+    SCOPED_TRACE(numThreads);
+    compareWithDenseQr(MarginalizerOptions::SCHUR_COMPLEMENT, numThreads);
+  }
+}
@@ -7,6 +7,8 @@
 #include <aslam/backend/ErrorTerm.hpp>
 #include <aslam/backend/SparseCholeskyLinearSystemSolver.hpp>
 #include <aslam/backend/BlockCholeskyLinearSystemSolver.hpp>
+#include <aslam/backend/SchurComplementLinearSystemSolver.hpp>
+#include <aslam/backend/PcgLinearSystemSolver.hpp>
 #include <aslam/backend/DenseQrLinearSystemSolver.hpp>
 #include <aslam/backend/LineSearchTrustRegionPolicy.hpp>
 #include <aslam/backend/SparseQrLinearSystemSolver.hpp>
@@ -74,3 +76,331 @@ TEST(Optimizer2TestSuite, compareAllCombinationsOfSolversAndTrustRegionPolicies)
     FAIL() << e.what();
   }
 }
+
+boost::shared_ptr<aslam::backend::OptimizationProblem> buildLandmarkProblem(int seed, int P, int L)
+{
+  using namespace aslam::backend;
+  srand(seed);
+  sm::random::seed(seed);
+  std::vector<DesignVariable*> dvs;
+  std::vector<ErrorTerm*> errs;
+  buildLandmarkSystem(P, L, dvs, errs);
+  boost::shared_ptr<OptimizationProblem> problem(new OptimizationProblem);
+  for (size_t i = 0; i < dvs.size(); ++i) {
+    problem->addDesignVariable(dvs[i], true);
+  }
+  for (size_t i = 0; i < errs.size(); ++i) {
+    problem->addErrorTerm(errs[i], true);
+  }
+  return problem;
+}
+
+TEST(Optimizer2TestSuite, testSchurComplementSolver)
+{
+  using namespace aslam::backend;
+  const int P = 6;
+  const int L = 30;
+  const int seed = 1;
+  try {
+    std::vector<boost::shared_ptr<TrustRegionPolicy>> policies;
+    policies.emplace_back(new LevenbergMarquardtTrustRegionPolicy());
+    policies.emplace_back(new DogLegTrustRegionPolicy());
+    for (boost::shared_ptr<TrustRegionPolicy> policy : policies) {
+      SCOPED_TRACE(policy->name());
+      Optimizer2Options options;
+      options.maxIterations = 5;
+      options.trustRegionPolicy = policy;
+      options.numThreadsJacobian = 2;
+
+      boost::shared_ptr<OptimizationProblem> baseline = buildLandmarkProblem(seed, P, L);
+      options.linearSystemSolver.reset(new DenseQrLinearSystemSolver());
+      Optimizer2 baselineOptimizer(options);
+      baselineOptimizer.setProblem(baseline);
+      baselineOptimizer.optimize();
+
+      boost::shared_ptr<OptimizationProblem> problem = buildLandmarkProblem(seed, P, L);
+      options.linearSystemSolver.reset();
+      options.doSchurComplement = true;
+      Optimizer2 optimizer(options);
+      optimizer.setProblem(problem);
+      optimizer.optimize();
+      ASSERT_EQ("schur_complement", optimizer.getSolver<LinearSystemSolver>()->name());
+
+      for (size_t j = 0; j < baseline->numErrorTerms(); ++j) {
+        double eb = baseline->errorTerm(j)->evaluateError();
+        double ei = problem->errorTerm(j)->evaluateError();
+        ASSERT_NEAR(ei, eb, 1e-6) << "The errors did not reduce in the same way";
+      }
+    }
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
+
+TEST(Optimizer2TestSuite, testPcgSolver)
+{
+  using namespace aslam::backend;
+  const int P = 6;
+  const int L = 30;
+  const int seed = 1;
+  try {
+    std::vector<boost::shared_ptr<TrustRegionPolicy>> policies;
+    policies.emplace_back(new LevenbergMarquardtTrustRegionPolicy());
+    policies.emplace_back(new DogLegTrustRegionPolicy());
+    for (boost::shared_ptr<TrustRegionPolicy> policy : policies) {
+      SCOPED_TRACE(policy->name());
+      Optimizer2Options options;
+      options.maxIterations = 5;
+      options.trustRegionPolicy = policy;
+      options.numThreadsJacobian = 2;
+
+      boost::shared_ptr<OptimizationProblem> baseline = buildLandmarkProblem(seed, P, L);
+      options.linearSystemSolver.reset(new DenseQrLinearSystemSolver());
+      Optimizer2 baselineOptimizer(options);
+      baselineOptimizer.setProblem(baseline);
+      baselineOptimizer.optimize();
+
+      // Solved accurately, the steps are the ones of the direct solver
+      PcgLinearSolverOptions pcgOptions;
+      pcgOptions.preconditioner = PcgLinearSolverOptions::SCHUR_JACOBI;
+      pcgOptions.tolerance = 1e-12;
+      boost::shared_ptr<OptimizationProblem> problem = buildLandmarkProblem(seed, P, L);
+      options.linearSystemSolver.reset(new PcgLinearSystemSolver(pcgOptions));
+      Optimizer2 optimizer(options);
+      optimizer.setProblem(problem);
+      size_t numIterativeSolves = 0;
+      optimizer.callback().add<callback::event::ITERATIVE_LINEAR_SYSTEM_SOLVED>(
+          [&](const callback::event::ITERATIVE_LINEAR_SYSTEM_SOLVED& arg) {
+            ++numIterativeSolves;
+            EXPECT_GT(arg.iterations, 0u);
+            EXPECT_LE(arg.relativeResidual, 1e-12);
+          });
+      optimizer.optimize();
+      EXPECT_EQ(optimizer.getStatus().numIterations, numIterativeSolves);
+
+      for (size_t j = 0; j < baseline->numErrorTerms(); ++j) {
+        double eb = baseline->errorTerm(j)->evaluateError();
+        double ei = problem->errorTerm(j)->evaluateError();
+        ASSERT_NEAR(ei, eb, 1e-6) << "The errors did not reduce in the same way";
+      }
+    }
+
+    // Inexact Newton: the forcing sequence of the trust region policy controls the accuracy of the solves
+    boost::shared_ptr<LevenbergMarquardtTrustRegionPolicy> policy(new LevenbergMarquardtTrustRegionPolicy());
+    policy->setForcingSequence(1e-8, 0.5);
+    Optimizer2Options options;
+    options.maxIterations = 20;
+    options.convergenceDeltaError = 1e-12;
+    options.trustRegionPolicy = policy;
+    options.linearSystemSolver.reset(new PcgLinearSystemSolver());
+    boost::shared_ptr<OptimizationProblem> problem = buildLandmarkProblem(seed, P, L);
+    const double initialCost = [&]() {
+      double cost = 0.0;
+      for (size_t j = 0; j < problem->numErrorTerms(); ++j)
+        cost += problem->errorTerm(j)->evaluateError();
+      return cost;
+    }();
+    Optimizer2 optimizer(options);
+    optimizer.setProblem(problem);
+    std::vector<double> relativeResiduals;
+    optimizer.callback().add<callback::event::ITERATIVE_LINEAR_SYSTEM_SOLVED>(
+        [&](const callback::event::ITERATIVE_LINEAR_SYSTEM_SOLVED& arg) {
+          relativeResiduals.push_back(arg.relativeResidual);
+          EXPECT_LE(arg.relativeResidual, policy->getForcingTolerance());
+        });
+    optimizer.optimize();
+    ASSERT_FALSE(relativeResiduals.empty());
+    EXPECT_LE(relativeResiduals.front(), 0.5);
+    EXPECT_LT(optimizer.J(), initialCost);
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
+
+TEST(Optimizer2TestSuite, testFusedErrorAndJacobianEvaluation)
+{
+  using namespace aslam::backend;
+  const int P = 6;
+  const int L = 30;
+  const int seed = 1;
+  try {
+    std::vector<boost::shared_ptr<TrustRegionPolicy>> policies;
+    policies.emplace_back(new LevenbergMarquardtTrustRegionPolicy());
+    policies.emplace_back(new DogLegTrustRegionPolicy());
+    policies.emplace_back(new GaussNewtonTrustRegionPolicy());
+    for (boost::shared_ptr<TrustRegionPolicy> policy : policies) {
+      SCOPED_TRACE(policy->name());
+      PcgLinearSolverOptions pcgOptions;
+      pcgOptions.tolerance = 1e-12;
+      Optimizer2Options options;
+      options.maxIterations = 10;
+      options.convergenceDeltaError = 1e-12;
+      options.trustRegionPolicy = policy;
+
+      // The fused evaluation yields the same Jacobians, also after rejected steps
+      std::vector<boost::shared_ptr<OptimizationProblem>> problems;
+      std::vector<SolutionReturnValue> results;
+      for (bool fuse : { false, true }) {
+        problems.push_back(buildLandmarkProblem(seed, P, L));
+        options.fuseErrorAndJacobianEvaluation = fuse;
+        options.linearSystemSolver.reset(new PcgLinearSystemSolver(pcgOptions));
+        Optimizer2 optimizer(options);
+        optimizer.setProblem(problems.back());
+        optimizer.optimize();
+        results.push_back(optimizer.getStatus().srv);
+      }
+      EXPECT_EQ(results[0].iterations, results[1].iterations);
+      EXPECT_EQ(results[0].failedIterations, results[1].failedIterations);
+      EXPECT_NEAR(results[0].JFinal, results[1].JFinal, 1e-9 * results[0].JFinal);
+      for (size_t j = 0; j < problems[0]->numErrorTerms(); ++j) {
+        ASSERT_NEAR(problems[0]->errorTerm(j)->evaluateError(), problems[1]->errorTerm(j)->evaluateError(), 1e-9) << "The errors did not reduce in the same way";
+      }
+    }
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
+
+/// \brief The Rosenbrock function as least squares problem, e = [10 (y - x^2), 1 - x]
+class RosenbrockErr : public aslam::backend::ErrorTermFs<2> {
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  Scalar* _x;
+  Scalar* _y;
+
+  RosenbrockErr(Scalar* x, Scalar* y) : _x(x), _y(y) {
+    setDesignVariables(_x, _y);
+  }
+
+  double evaluateErrorImplementation() override {
+    const double x = _x->_v[0], y = _y->_v[0];
+    setError(Eigen::Vector2d(10.0 * (y - x * x), 1.0 - x));
+    return evaluateChiSquaredError();
+  }
+
+  void evaluateJacobiansImplementation(aslam::backend::JacobianContainer & outJ) override {
+    outJ.add(_x, Eigen::Vector2d(-20.0 * _x->_v[0], -1.0));
+    outJ.add(_y, Eigen::Vector2d(10.0, 0.0));
+  }
+};
+
+/// \brief The Rosenbrock problem, started at (-1.2, 1)
+boost::shared_ptr<aslam::backend::OptimizationProblem> buildRosenbrockProblem(Scalar*& x, Scalar*& y, RosenbrockErr*& err)
+{
+  using namespace aslam::backend;
+  x = new Scalar(Scalar::Vector1d::Constant(-1.2));
+  y = new Scalar(Scalar::Vector1d::Constant(1.0));
+  x->setActive(true);
+  y->setActive(true);
+  boost::shared_ptr<OptimizationProblem> problem(new OptimizationProblem);
+  problem->addDesignVariable(x, true);
+  problem->addDesignVariable(y, true);
+  err = new RosenbrockErr(x, y);
+  problem->addErrorTerm(err, true);
+  return problem;
+}
+
+TEST(Optimizer2TestSuite, testMultipleTrialLambdas)
+{
+  using namespace aslam::backend;
+  try {
+    std::vector<SolutionReturnValue> results;
+    for (int numTrialLambdas : { 1, 4 }) {
+      for (size_t numReplicas : { 0, 4 }) {
+        if (numTrialLambdas == 1 && numReplicas > 0)
+          continue;
+        SCOPED_TRACE(testing::Message() << "numTrialLambdas: " << numTrialLambdas << ", numReplicas: " << numReplicas);
+        Scalar *x, *y;
+        RosenbrockErr* err;
+        boost::shared_ptr<OptimizationProblem> problem = buildRosenbrockProblem(x, y, err);
+
+        // With a tiny initial damping, the steps right after a regression often fail as well
+        boost::shared_ptr<LevenbergMarquardtTrustRegionPolicy> policy(new LevenbergMarquardtTrustRegionPolicy(1e-12));
+        policy->setNumTrialLambdas(numTrialLambdas);
+        Optimizer2Options options;
+        options.maxIterations = 200;
+        options.convergenceDeltaX = 1e-10;
+        options.convergenceDeltaError = 1e-16;
+        options.numThreadsError = 2;
+        options.trustRegionPolicy = policy;
+        options.linearSystemSolver.reset(new DenseQrLinearSystemSolver());
+        Optimizer2 optimizer(options);
+        optimizer.setProblem(problem);
+        // The trial steps are evaluated concurrently on the replicas
+        for (size_t i = 0; i < numReplicas; ++i) {
+          Scalar *xr, *yr;
+          RosenbrockErr* errr;
+          optimizer.addProblemReplica(buildRosenbrockProblem(xr, yr, errr));
+        }
+        optimizer.optimize();
+        results.push_back(optimizer.getStatus().srv);
+        EXPECT_DOUBLE_EQ(err->evaluateError(), results.back().JFinal);
+
+        EXPECT_NEAR(1.0, x->_v[0], 1e-4);
+        EXPECT_NEAR(1.0, y->_v[0], 1e-4);
+      }
+    }
+    // Trying several damping values at once saves the sequence of rejected steps
+    EXPECT_GT(results[0].failedIterations, 0);
+    EXPECT_LT(results[1].failedIterations, results[0].failedIterations);
+    // The replicas take the same steps
+    EXPECT_EQ(results[1].iterations, results[2].iterations);
+    EXPECT_EQ(results[1].failedIterations, results[2].failedIterations);
+    EXPECT_DOUBLE_EQ(results[1].JFinal, results[2].JFinal);
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
+
+TEST(Optimizer2TestSuite, testSparseCovarianceRecovery)
+{
+  using namespace aslam::backend;
+  try {
+    boost::shared_ptr<OptimizationProblem> problem = buildLandmarkProblem(1, 6, 30);
+    Optimizer2Options options;
+    options.maxIterations = 20;
+    options.convergenceDeltaError = 1e-12;
+    options.numThreadsJacobian = 2;
+    options.trustRegionPolicy.reset(new LevenbergMarquardtTrustRegionPolicy());
+    options.linearSystemSolver.reset(new SparseCholeskyLinearSystemSolver());
+    Optimizer2 optimizer(options);
+    optimizer.setProblem(problem);
+    optimizer.optimize();
+    const double error = optimizer.getStatus().error;
+    const Eigen::VectorXd conditioner = optimizer.getBaseSolver()->getConditioner();
+
+    // The first call reuses the system of the last iteration, the second one builds a new one at the estimate
+    for (double lambda : { 0.0, 1.0 }) {
+      SCOPED_TRACE(lambda);
+      SparseBlockMatrix H;
+      optimizer.computeHessian(H, lambda);
+      const Eigen::MatrixXd denseP = H.toDense().inverse();
+
+      SparseBlockMatrix P;
+      optimizer.computeCovariances(P, lambda);
+      const double tolerance = 1e-6 * denseP.cwiseAbs().maxCoeff();
+      const Eigen::MatrixXd P_upper = P.toDense().triangularView<Eigen::Upper>();
+      const Eigen::MatrixXd denseP_upper = denseP.triangularView<Eigen::Upper>();
+      sm::eigen::assertNear(denseP_upper, P_upper, tolerance, SM_SOURCE_FILE_POS, "Checking the full covariance");
+
+      SparseBlockMatrix Pdiag;
+      optimizer.computeDiagonalCovariances(Pdiag, lambda);
+      ASSERT_EQ(optimizer.getDesignVariables().size(), (size_t)Pdiag.bRows());
+      for (int i = 0; i < Pdiag.bRows(); ++i) {
+        ASSERT_TRUE(Pdiag.block(i, i) != NULL);
+        const int r = Pdiag.rowBaseOfBlock(i);
+        const int d = Pdiag.rowsOfBlock(i);
+        sm::eigen::assertNear(denseP.block(r, r, d, d), *Pdiag.block(i, i), tolerance, SM_SOURCE_FILE_POS, "Checking a diagonal block");
+        if (i + 1 < Pdiag.bRows())
+          EXPECT_TRUE(Pdiag.block(i, i + 1) == NULL);
+      }
+
+      // The recovery must not change the state of the optimization
+      EXPECT_EQ(error, optimizer.getStatus().error);
+      EXPECT_TRUE(conditioner == optimizer.getBaseSolver()->getConditioner());
+    }
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
@@ -79,3 +79,48 @@ TEST(OptimizerBFGSTestSuite, testBFGS)
     FAIL() << e.what();
   }
 }
+
+TEST(OptimizerBFGSTestSuite, testLimitedMemoryBFGS)
+{
+  try {
+    using namespace aslam::backend;
+    const int D = 4;
+    const int E = 20;
+    const int seed = 1;
+
+    // The dense and the limited-memory variants converge to the same minimum, also with preconditioning
+    std::vector<boost::shared_ptr<OptimizationProblem> > problems;
+    std::vector<double> errors;
+    for (int historySize : { 0, 5, 5 }) {
+      SCOPED_TRACE(historySize);
+      problems.push_back(buildProblem(seed, D, E));
+      OptimizerBFGS::Options options;
+      options.maxIterations = 1000;
+      options.convergenceGradientNorm = 1e-6;
+      options.convergenceDeltaX = 0.0;
+      options.historySize = historySize;
+      options.numThreadsJacobian = 1; // a threaded gradient sum depends on the scheduling
+      options.useDesignVariableScaling = problems.size() == 3;
+      for (size_t i = 0; i < problems.back()->numDesignVariables(); ++i)
+        problems.back()->designVariable(i)->setScaling(0.5 + 0.5 * i);
+      OptimizerBFGS optimizer(options);
+      optimizer.setProblem(problems.back());
+      optimizer.optimize();
+      const auto& ret = optimizer.getStatus();
+      EXPECT_GT(ret.convergence, ConvergenceStatus::FAILURE);
+      EXPECT_LE(ret.gradientNorm, options.convergenceGradientNorm);
+      errors.push_back(ret.error);
+    }
+    for (size_t p = 1; p < problems.size(); ++p) {
+      EXPECT_NEAR(errors[0], errors[p], 1e-9 * errors[0]);
+      for (size_t i = 0; i < problems[0]->numDesignVariables(); ++i) {
+        Eigen::MatrixXd v0, vp;
+        problems[0]->designVariable(i)->getParameters(v0);
+        problems[p]->designVariable(i)->getParameters(vp);
+        sm::eigen::assertNear(v0, vp, 1e-4, SM_SOURCE_FILE_POS, "Checking the minimum");
+      }
+    }
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
@@ -96,6 +96,9 @@ TEST(OptimizerTestSuite, testOptimizerOptions)
     pt.setInt("maxIterations", 1);
     pt.setInt("numThreadsJacobian", 1);
     pt.setInt("numThreadsError", 4);
+    pt.setBool("useThreadPool", false);
+    pt.setInt("threadPoolChunkSize", 16);
+    pt.setBool("balanceThreadLoad", false);
     EXPECT_ANY_THROW(OptimizerOptionsBase options(pt)); // invalid option convergenceGradientNorm
     pt.setDouble("convergenceGradientNorm", 1.0);
     OptimizerOptionsBase options(pt);
@@ -105,6 +108,9 @@ TEST(OptimizerTestSuite, testOptimizerOptions)
     EXPECT_EQ(pt.getInt("maxIterations"), options.maxIterations);
     EXPECT_EQ(pt.getInt("numThreadsJacobian"), options.numThreadsJacobian);
     EXPECT_EQ(pt.getInt("numThreadsError"), options.numThreadsError);
+    EXPECT_EQ(pt.getBool("useThreadPool"), options.useThreadPool);
+    EXPECT_EQ(pt.getInt("threadPoolChunkSize"), options.threadPoolChunkSize);
+    EXPECT_EQ(pt.getBool("balanceThreadLoad"), options.balanceThreadLoad);
   }
 }
 
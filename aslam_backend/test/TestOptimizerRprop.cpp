@@ -150,3 +150,65 @@ TEST(OptimizerRpropTestSuite, testRpropSquaredErrorTerms)
   }
 }
 
+
+TEST(OptimizerRpropTestSuite, testRpropRegularizer)
+{
+  try {
+    using namespace aslam::backend;
+    boost::shared_ptr<OptimizationProblem> problem_ptr(new OptimizationProblem);
+    OptimizationProblem& problem = *problem_ptr;
+    const int P = 2;
+    // Add some design variables.
+    std::vector< boost::shared_ptr<Point2d> > p2d;
+    for (int p = 0; p < P; ++p) {
+      boost::shared_ptr<Point2d> point(new Point2d(Eigen::Vector2d::Random()));
+      p2d.push_back(point);
+      problem.addDesignVariable(point);
+      point->setBlockIndex(p);
+      point->setActive(true);
+    }
+    std::vector< boost::shared_ptr<Point2d> > p2d0;
+    for (auto& dv : p2d) p2d0.emplace_back(new Point2d(*dv));
+
+    // Add some error terms.
+    std::vector< boost::shared_ptr<TestNonSquaredError> > e1;
+    for (int p = 0; p < P; ++p) {
+      for (int e = 0; e < 2; ++e) {
+        boost::shared_ptr<TestNonSquaredError> err(new TestNonSquaredError(p2d[p].get(), TestNonSquaredError::grad_t(p+1, e+1)));
+        err->_p = 1.0;
+        e1.push_back(err);
+        problem.addErrorTerm(err);
+      }
+    }
+
+    // The regularizer only depends on the first design variable, its gradient has to end up in the right columns
+    OptimizerRprop::Options options;
+    options.maxIterations = 500;
+    options.numThreadsJacobian = 2;
+    options.convergenceGradientNorm = 1e-5;
+    boost::shared_ptr<TestNonSquaredError> regularizer(new TestNonSquaredError(p2d[0].get(), TestNonSquaredError::grad_t(1.0, -1.0)));
+    regularizer->_p = 0.0;
+    options.regularizer = regularizer;
+    OptimizerRprop optimizer(options);
+    optimizer.setProblem(problem_ptr);
+
+    for (bool useDenseJacobianContainer : {true, false}) {
+      optimizer.getOptions().useDenseJacobianContainer = useDenseJacobianContainer;
+      optimizer.initialize();
+      for (std::size_t i=0; i<p2d.size(); i++) p2d[i]->_v = p2d0[i]->_v;
+      SCOPED_TRACE(useDenseJacobianContainer);
+      optimizer.optimize();
+      auto ret = optimizer.getStatus();
+      EXPECT_TRUE(ret.success());
+      EXPECT_LE(ret.gradientNorm, 1e-5);
+      // The first point is the least squares solution of its two error terms and the regularizer
+      Eigen::Matrix<double, 3, 2> A;
+      A << 1.0, 1.0, 1.0, 2.0, 1.0, -1.0;
+      const Eigen::Vector2d expected = (A.transpose()*A).ldlt().solve(A.transpose()*Eigen::Vector3d(1.0, 1.0, 0.0));
+      sm::eigen::assertNear(expected, p2d[0]->_v, 1e-3, SM_SOURCE_FILE_POS);
+    }
+
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
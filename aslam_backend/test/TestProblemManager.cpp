@@ -1,6 +1,7 @@
 #include <sm/eigen/gtest.hpp>
 #include <string>
 #include <bitset>
+#include <thread>
 #include <aslam/backend/util/ProblemManager.hpp>
 #include <aslam/backend/JacobianContainerDense.hpp>
 #include <aslam/backend/JacobianContainerSparse.hpp>
@@ -114,5 +115,131 @@ TEST(OptimizationProblemTestSuite, testProblemManager)
     grad_expected.segment(2, 2) = grad1 + grad2;
     pm.computeGradient(grad, 1, useMEstimator, applyDvScaling, useDenseJacobianContainer);
     sm::eigen::assertEqual(grad_expected, grad, SM_SOURCE_FILE_POS, optStr);
+
+    // The per thread gradients are reduced in parallel, more threads than parameters must work as well
+    for (size_t nThreads = 2; nThreads <= 5; nThreads += 3) {
+      pm.computeGradient(grad, nThreads, useMEstimator, applyDvScaling, useDenseJacobianContainer);
+      sm::eigen::assertNear(grad_expected, grad, 1e-12, SM_SOURCE_FILE_POS, optStr);
+    }
+  }
+}
+
+TEST(OptimizationProblemTestSuite, testEvaluationAtExplicitParameters)
+{
+  try {
+    ProblemManager pm;
+    pm.setProblem(buildProblem(1, 4, 10));
+    pm.initialize();
+    const Eigen::VectorXd x0 = pm.getFlattenedDesignVariableParameters();
+    const double error0 = pm.evaluateError(1);
+
+    // Reference errors and gradients, evaluated sequentially by setting the parameters
+    const size_t K = 8;
+    std::vector<Eigen::VectorXd> xs;
+    std::vector<double> errors;
+    std::vector<RowVectorType> gradients(K);
+    for (size_t k = 0; k < K; ++k) {
+      xs.push_back(x0 + Eigen::VectorXd::Random(x0.size()));
+      pm.setFlattenedDesignVariableParameters(xs[k]);
+      sm::eigen::assertEqual(xs[k], pm.getFlattenedDesignVariableParameters(), SM_SOURCE_FILE_POS);
+      errors.push_back(pm.evaluateError(2));
+      pm.computeGradient(gradients[k], 2, false, false, true);
+    }
+    pm.setFlattenedDesignVariableParameters(x0);
+
+    // Concurrent evaluations do not interfere and leave the design variables unchanged
+    std::vector<double> errorsAt(K), errorsAtStep(K);
+    std::vector<RowVectorType> gradientsAt(K), gradientsAtStep(K);
+    std::vector<std::thread> threads;
+    for (size_t k = 0; k < K; ++k) {
+      threads.emplace_back([&, k]() {
+        errorsAt[k] = pm.evaluateErrorAt(xs[k], 2);
+        pm.computeGradientAt(xs[k], gradientsAt[k], 2, false, false, true);
+        errorsAtStep[k] = pm.evaluateAtStep((xs[k] - x0).transpose(), &gradientsAtStep[k], 2, 2, false, false, true);
+      });
+    }
+    for (std::thread& t : threads)
+      t.join();
+
+    sm::eigen::assertEqual(x0, pm.getFlattenedDesignVariableParameters(), SM_SOURCE_FILE_POS);
+    EXPECT_DOUBLE_EQ(error0, pm.evaluateError(1));
+    for (size_t k = 0; k < K; ++k) {
+      SCOPED_TRACE(k);
+      // The gradients are summed up per thread, in an order depending on the scheduling
+      EXPECT_DOUBLE_EQ(errors[k], errorsAt[k]);
+      sm::eigen::assertNear(gradients[k], gradientsAt[k], 1e-12 * gradients[k].norm(), SM_SOURCE_FILE_POS);
+      // The Point2d design variables are updated additively
+      EXPECT_NEAR(errors[k], errorsAtStep[k], 1e-9 * errors[k]);
+      sm::eigen::assertNear(gradients[k], gradientsAtStep[k], 1e-9 * gradients[k].norm(), SM_SOURCE_FILE_POS);
+    }
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
+  }
+}
+
+TEST(OptimizationProblemTestSuite, testEvaluationOnReplicas)
+{
+  try {
+    {
+      // Replicas added before the initialization are checked by initialize()
+      ProblemManager pm;
+      pm.setProblem(buildProblem(1, 4, 10));
+      pm.addReplica(buildProblem(1, 3, 10));
+      EXPECT_ANY_THROW(pm.initialize());
+      pm.clearReplicas();
+      pm.addReplica(buildProblem(1, 4, 10));
+      EXPECT_NO_THROW(pm.initialize());
+    }
+
+    ProblemManager pm;
+    pm.setProblem(buildProblem(1, 4, 10));
+    pm.initialize();
+    EXPECT_ANY_THROW(pm.addReplica(pm.getProblem()));
+    EXPECT_ANY_THROW(pm.addReplica(buildProblem(1, 3, 10)));
+    const size_t numReplicas = 3;
+    for (size_t i = 0; i < numReplicas; ++i)
+      pm.addReplica(buildProblem(1, 4, 10));
+    ASSERT_EQ(numReplicas, pm.numReplicas());
+    const Eigen::VectorXd x0 = pm.getFlattenedDesignVariableParameters();
+    const double error0 = pm.evaluateError(1);
+
+    const size_t K = 8;
+    std::vector<Eigen::VectorXd> xs;
+    std::vector<double> errors;
+    std::vector<RowVectorType> gradients(K);
+    for (size_t k = 0; k < K; ++k) {
+      xs.push_back(x0 + Eigen::VectorXd::Random(x0.size()));
+      pm.setFlattenedDesignVariableParameters(xs[k]);
+      errors.push_back(pm.evaluateError(1));
+      pm.computeGradient(gradients[k], 1, false, false, true);
+    }
+    pm.setFlattenedDesignVariableParameters(x0);
+
+    // The design variables of the problem are never touched, so it can be evaluated while the replicas are busy
+    std::vector<double> errorsAt(K), errorsAtStep(K);
+    std::vector<RowVectorType> gradientsAt(K), gradientsAtStep(K);
+    std::vector<std::thread> threads;
+    for (size_t k = 0; k < K; ++k) {
+      threads.emplace_back([&, k]() {
+        errorsAt[k] = pm.evaluateErrorAt(xs[k], 1);
+        pm.computeGradientAt(xs[k], gradientsAt[k], 1, false, false, true);
+        errorsAtStep[k] = pm.evaluateAtStep((xs[k] - x0).transpose(), &gradientsAtStep[k], 1, 1, false, false, true);
+      });
+    }
+    for (size_t i = 0; i < 100; ++i)
+      EXPECT_EQ(error0, pm.evaluateError(1));
+    for (std::thread& t : threads)
+      t.join();
+
+    sm::eigen::assertEqual(x0, pm.getFlattenedDesignVariableParameters(), SM_SOURCE_FILE_POS);
+    for (size_t k = 0; k < K; ++k) {
+      SCOPED_TRACE(k);
+      EXPECT_DOUBLE_EQ(errors[k], errorsAt[k]);
+      sm::eigen::assertNear(gradients[k], gradientsAt[k], 1e-12 * gradients[k].norm(), SM_SOURCE_FILE_POS);
+      EXPECT_NEAR(errors[k], errorsAtStep[k], 1e-9 * errors[k]);
+      sm::eigen::assertNear(gradients[k], gradientsAtStep[k], 1e-9 * gradients[k].norm(), SM_SOURCE_FILE_POS);
+    }
+  } catch (const std::exception& e) {
+    FAIL() << e.what();
   }
 }
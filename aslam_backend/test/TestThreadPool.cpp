@@ -0,0 +1,95 @@
+#include <sm/eigen/gtest.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include <aslam/backend/util/ThreadPool.hpp>
+#include <aslam/backend/util/ThreadedRangeProcessor.hpp>
+
+using namespace aslam::backend;
+using namespace aslam::backend::util;
+
+namespace {
+
+struct CountingJob {
+  CountingJob(std::size_t rangeLength, std::size_t numThreads) : visits(rangeLength), busy(numThreads) {
+    for (auto& v : visits) v = 0;
+    for (auto& b : busy) b = false;
+  }
+  void operator()(std::size_t threadId, std::size_t startIdx, std::size_t endIdx) {
+    ASSERT_LT(threadId, busy.size());
+    EXPECT_FALSE(busy[threadId].exchange(true)); // no two calls with the same thread index at once
+    for (std::size_t i = startIdx; i < endIdx; ++i)
+      ++visits[i];
+    busy[threadId] = false;
+  }
+  std::vector<std::atomic<int> > visits;
+  std::vector<std::atomic<bool> > busy;
+};
+
+void throwingJob(std::size_t /* threadId */, std::size_t startIdx, std::size_t endIdx) {
+  if (startIdx <= 42 && 42 < endIdx)
+    throw std::invalid_argument("42");
+}
+
+void nestedJob(std::size_t /* threadId */, std::size_t startIdx, std::size_t endIdx, std::atomic<int>& count) {
+  for (std::size_t i = startIdx; i < endIdx; ++i) {
+    CountingJob inner(10, 4);
+    ThreadPool::instance().parallelFor(boost::ref(inner), 10, 4);
+    for (auto& v : inner.visits)
+      count += v;
+  }
+}
+
+} // namespace
+
+TEST(ThreadPoolTestSuite, testEachIndexProcessedOnce)
+{
+  ThreadPool pool;
+  for (std::size_t nThreads : {1, 2, 3, 8, 17}) {
+    for (std::size_t rangeLength : {0, 1, 5, 100, 1001}) {
+      for (std::size_t chunkSize : {0, 1, 7, 2000}) {
+        CountingJob job(rangeLength, nThreads);
+        pool.parallelFor(boost::ref(job), rangeLength, nThreads, chunkSize);
+        for (std::size_t i = 0; i < rangeLength; ++i)
+          ASSERT_EQ(1, job.visits[i]) << "index " << i << " with " << nThreads << " threads and chunk size " << chunkSize;
+      }
+    }
+  }
+  EXPECT_LE(pool.numWorkers(), 16u);
+}
+
+TEST(ThreadPoolTestSuite, testRunThreadedJob)
+{
+  ThreadedJobOptions options;
+  for (bool useThreadPool : {true, false}) {
+    options.useThreadPool = useThreadPool;
+    CountingJob job(1000, 4);
+    runThreadedJob(boost::ref(job), 1000, 4, options);
+    for (std::size_t i = 0; i < 1000; ++i)
+      ASSERT_EQ(1, job.visits[i]);
+  }
+}
+
+TEST(ThreadPoolTestSuite, testExceptionIsRethrown)
+{
+  ThreadedJobOptions options;
+  for (bool useThreadPool : {true, false}) {
+    options.useThreadPool = useThreadPool;
+    EXPECT_THROW(runThreadedJob(&throwingJob, 100, 4, options), std::invalid_argument);
+  }
+  // The pool must still be usable afterwards
+  CountingJob job(100, 4);
+  ThreadPool::instance().parallelFor(boost::ref(job), 100, 4);
+  for (std::size_t i = 0; i < 100; ++i)
+    ASSERT_EQ(1, job.visits[i]);
+}
+
+TEST(ThreadPoolTestSuite, testNestedJobsRunSerially)
+{
+  std::atomic<int> count(0);
+  ThreadPool::instance().parallelFor(boost::bind(&nestedJob, _1, _2, _3, boost::ref(count)), 20, 4);
+  EXPECT_EQ(200, count);
+  EXPECT_FALSE(ThreadPool::isInsideJob());
+}
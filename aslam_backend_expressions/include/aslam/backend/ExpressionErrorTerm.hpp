@@ -14,6 +14,7 @@
 #include <aslam/backend/EuclideanExpression.hpp>
 #include <aslam/backend/GenericMatrixExpression.hpp>
 #include <aslam/backend/GenericScalarExpression.hpp>
+#include <aslam/backend/util/ForwardPass.hpp>
 
 namespace aslam {
 namespace backend {
@@ -121,6 +122,14 @@ class ExpressionErrorTerm : public aslam::backend::ErrorTermFs<IDimension> {
     _expression.evaluateJacobians(jacobians);
   }
 
+  /// \brief evaluate the error and the jacobian in one forward pass, the jacobian reuses the node values of the error
+  virtual double evaluateErrorAndJacobiansImplementation(JacobianContainer & jacobians) override {
+    utils::ForwardPass pass;
+    const double squaredError = evaluateErrorImplementation();
+    evaluateJacobiansImplementation(jacobians);
+    return squaredError;
+  }
+
   inline TExpression getExpression() {
     return _expression;
   }
@@ -2,6 +2,7 @@
 #define ASLAM_BACKEND_GENERIC_MATRIX_EXPRESSION_NODE_HPP
 #include <aslam/backend/JacobianContainer.hpp>
 #include <aslam/backend/Differential.hpp>
+#include <aslam/backend/util/ForwardPass.hpp>
 
 namespace aslam {
 namespace backend {
@@ -43,7 +44,8 @@ class GenericMatrixExpressionNode {
     return _currentValue;
   }
   inline const matrix_t & evaluate() const {
-    evaluateImplementation();
+    // within a forward pass the current value is only computed on the first evaluation
+    utils::ForwardPass::evaluate<bool>(this, [this]() { evaluateImplementation(); return true; });
     /* TODO activate value caching again.
     if (!isConstant() && _valueDirty) {
       evaluateImplementation();
@@ -4,6 +4,7 @@
 #include <boost/shared_ptr.hpp>
 #include <Eigen/Core>
 #include <aslam/backend/JacobianContainer.hpp>
+#include <aslam/backend/util/ForwardPass.hpp>
 #include <aslam/backend/VectorExpressionNode.hpp>
 
 namespace aslam {
@@ -23,7 +24,7 @@ class GenericScalarExpressionNode {
   virtual ~GenericScalarExpressionNode(){}
 
   /// \brief Evaluate the scalar matrix.
-  inline Scalar toScalar() const { return evaluateImplementation(); }
+  inline Scalar toScalar() const { return utils::ForwardPass::evaluate<Scalar>(this, [this]() { return evaluateImplementation(); }); }
 
   /// \brief Evaluate the Jacobians
   void evaluateJacobians(JacobianContainer & outJacobians) const { evaluateJacobiansImplementation(outJacobians); }
@@ -3,6 +3,7 @@
 
 
 #include <aslam/backend/JacobianContainer.hpp>
+#include <aslam/backend/util/ForwardPass.hpp>
 #include <sm/kinematics/quaternion_algebra.hpp>
 #include <boost/shared_ptr.hpp>
 #include <set>
@@ -24,7 +25,9 @@ namespace aslam {
       virtual ~RotationExpressionNode();
 
       /// \brief Evaluate the rotation matrix.
-      EIGEN_ALWAYS_INLINE Eigen::Matrix3d toRotationMatrix() const { return toRotationMatrixImplementation(); }
+      EIGEN_ALWAYS_INLINE Eigen::Matrix3d toRotationMatrix() const {
+        return utils::ForwardPass::evaluate<Eigen::Matrix3d>(this, [this]() { return toRotationMatrixImplementation(); });
+      }
       
       /// \brief Evaluate the Jacobians
       EIGEN_ALWAYS_INLINE void evaluateJacobians(JacobianContainer & outJacobians) const { evaluateJacobiansImplementation(outJacobians); }
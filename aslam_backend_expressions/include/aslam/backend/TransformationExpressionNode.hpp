@@ -3,6 +3,7 @@
 
 #include <Eigen/Core>
 #include <aslam/backend/JacobianContainer.hpp>
+#include <aslam/backend/util/ForwardPass.hpp>
 #include <boost/shared_ptr.hpp>
 #include <set>
 
@@ -22,7 +23,9 @@ namespace aslam {
       virtual ~TransformationExpressionNode();
 
       /// \brief Evaluate the transformation matrix.
-      Eigen::Matrix4d toTransformationMatrix() { return toTransformationMatrixImplementation(); }
+      Eigen::Matrix4d toTransformationMatrix() {
+        return utils::ForwardPass::evaluate<Eigen::Matrix4d>(this, [this]() { return toTransformationMatrixImplementation(); });
+      }
 
       /// \brief Evaluate the Jacobians
       void evaluateJacobians(JacobianContainer & outJacobians) const;   
@@ -2,6 +2,7 @@
 #define ASLAM_BACKEND_VECTOR_EXPRESSION_NODE_HPP
 #include <aslam/backend/JacobianContainer.hpp>
 #include <aslam/backend/Differential.hpp>
+#include <aslam/backend/util/ForwardPass.hpp>
 
 namespace aslam {
   namespace backend {
@@ -17,7 +18,7 @@ namespace aslam {
       VectorExpressionNode() = default;
       virtual ~VectorExpressionNode() = default;
       
-      vector_t evaluate() const { return evaluateImplementation(); }
+      vector_t evaluate() const { return utils::ForwardPass::evaluate<vector_t>(this, [this]() { return evaluateImplementation(); }); }
       vector_t toVector() const { return evaluate(); }
       
       void evaluateJacobians(JacobianContainer & outJacobians) const;
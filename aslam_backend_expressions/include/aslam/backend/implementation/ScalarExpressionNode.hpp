@@ -17,7 +17,7 @@ namespace backend {
 /// \brief Evaluate the scalar matrix.
 double ScalarExpressionNode::toScalar() const
 {
-  return evaluateImplementation();
+  return utils::ForwardPass::evaluate<double>(this, [this]() { return evaluateImplementation(); });
 }
 
 /// \brief Evaluate the Jacobians
@@ -0,0 +1,96 @@
+/*
+ * ForwardPass.hpp
+ *
+ *  Memoization of expression node values between the error and the Jacobian evaluation.
+ */
+
+#ifndef INCLUDE_ASLAM_BACKEND_UTIL_FORWARDPASS_HPP_
+#define INCLUDE_ASLAM_BACKEND_UTIL_FORWARDPASS_HPP_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include <Eigen/Core>
+
+namespace aslam {
+namespace backend {
+namespace utils {
+
+/**
+ * \class ForwardPass
+ * \brief A scope in which expression nodes memoize their values on the calling thread.
+ *
+ * While a ForwardPass is open, the first evaluation of a node stores its value and any further
+ * evaluation of the same node returns the stored value. Jacobian implementations that evaluate
+ * their operands again therefore reuse the values of the preceding error evaluation instead of
+ * evaluating the operand subtrees a second time. The design variables must not change while a
+ * pass is open. The values are stored per thread, so shared nodes may be evaluated concurrently.
+ */
+class ForwardPass {
+ public:
+  ForwardPass() : _outermost(!isOpen()) {
+    if (_outermost) {
+      ++generation();
+      open() = true;
+    }
+  }
+  ~ForwardPass() {
+    if (_outermost)
+      open() = false;
+  }
+  ForwardPass(const ForwardPass &) = delete;
+  ForwardPass & operator=(const ForwardPass &) = delete;
+
+  /// \brief Is a pass open on the calling thread?
+  static bool isOpen() { return open(); }
+
+  /// \brief Get the value of \p node, calling \p evaluate only if it has not been stored in the open pass yet
+  template <typename TValue, typename TEvaluate>
+  static TValue evaluate(const void * node, const TEvaluate & evaluate) {
+    if (!isOpen())
+      return evaluate();
+    Store<TValue> & store = Store<TValue>::instance();
+    if (store.generation != generation()) {
+      store.values.clear();
+      store.generation = generation();
+    }
+    // expression trees are small, a linear search beats hashing and does not allocate once warmed up
+    for (const auto & entry : store.values) {
+      if (entry.first == node)
+        return entry.second;
+    }
+    const TValue value = evaluate();
+    store.values.emplace_back(node, value);
+    return value;
+  }
+
+ private:
+  template <typename TValue>
+  struct Store {
+    typedef std::pair<const void *, TValue> entry_t;
+    std::size_t generation = 0;
+    std::vector<entry_t, Eigen::aligned_allocator<entry_t> > values;
+
+    static Store & instance() {
+      static thread_local Store store;
+      return store;
+    }
+  };
+
+  static bool & open() {
+    static thread_local bool isOpen = false;
+    return isOpen;
+  }
+  static std::size_t & generation() {
+    static thread_local std::size_t passGeneration = 0;
+    return passGeneration;
+  }
+
+  const bool _outermost;
+};
+
+}
+}
+}
+
+#endif /* INCLUDE_ASLAM_BACKEND_UTIL_FORWARDPASS_HPP_ */
@@ -2,6 +2,7 @@
 #include <sm/kinematics/transformations.hpp>
 #include <sm/kinematics/homogeneous_coordinates.hpp>
 #include <aslam/backend/EuclideanExpressionNode.hpp>
+#include <aslam/backend/util/ForwardPass.hpp>
 
 namespace aslam {
   namespace backend {
@@ -20,7 +21,7 @@ namespace aslam {
     /// \brief Evaluate the homogeneous matrix.
     Eigen::Vector4d HomogeneousExpressionNode::toHomogeneous() const
     {
-      return toHomogeneousImplementation();
+      return utils::ForwardPass::evaluate<Eigen::Vector4d>(this, [this]() { return toHomogeneousImplementation(); });
     }
 
       
@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <boost/make_shared.hpp>
 #include <aslam/backend/ExpressionErrorTerm.hpp>
 #include <aslam/backend/test/ErrorTermTester.hpp>
 #include <aslam/backend/ScalarExpression.hpp>
@@ -44,3 +45,97 @@ TEST(ExpressionErrorTermSuite, testScalarToErrorTerm) {
     FAIL()<< e.what();
   }
 }
+
+TEST(ExpressionErrorTermSuite, testFusedEvaluation) {
+  try {
+    using namespace aslam::backend;
+
+    Scalar a(2.0), b(3.0);
+    a.setActive(true);
+    a.setBlockIndex(0);
+    b.setActive(true);
+    b.setBlockIndex(1);
+    ScalarExpression se = ScalarExpression(&a) * ScalarExpression(&b) + ScalarExpression(&a);
+
+    ErrorTerm::Ptr robustError = toErrorTerm(se, 4.0);
+    robustError->setMEstimatorPolicy(boost::make_shared<CauchyMEstimator>(1.0));
+    for (ErrorTerm::Ptr error : std::vector<ErrorTerm::Ptr>{ toErrorTerm(se, 4.0), robustError }) {
+      JacobianContainerSparse<> expectedJ(1), J(1);
+      const double expectedSquaredError = error->evaluateError();
+      error->evaluateJacobians(expectedJ);
+      EXPECT_DOUBLE_EQ(expectedSquaredError, error->evaluateErrorAndJacobians(J));
+      EXPECT_TRUE(J.asDenseMatrix().isApprox(expectedJ.asDenseMatrix()));
+
+      for (bool useMEstimator : { false, true }) {
+        JacobianContainerSparse<> expectedWeightedJ(1), weightedJ(1);
+        Eigen::VectorXd expectedE, e;
+        error->evaluateError();
+        error->getWeightedError(expectedE, useMEstimator);
+        error->getWeightedJacobians(expectedWeightedJ, useMEstimator);
+        EXPECT_DOUBLE_EQ(expectedSquaredError, error->evaluateWeightedErrorAndJacobians(e, weightedJ, useMEstimator));
+        EXPECT_TRUE(e.isApprox(expectedE));
+        EXPECT_TRUE(weightedJ.asDenseMatrix().isApprox(expectedWeightedJ.asDenseMatrix()));
+      }
+    }
+  } catch (const std::exception & e) {
+    FAIL()<< e.what();
+  }
+}
+
+namespace {
+class CountingScalarExpressionNode : public aslam::backend::ScalarExpressionNode {
+ public:
+  CountingScalarExpressionNode(boost::shared_ptr<aslam::backend::ScalarExpressionNode> operand) : _operand(operand) {}
+  mutable int numEvaluations = 0;
+ protected:
+  double evaluateImplementation() const override {
+    ++numEvaluations;
+    return _operand->toScalar();
+  }
+  void evaluateJacobiansImplementation(aslam::backend::JacobianContainer & outJacobians) const override {
+    _operand->evaluateJacobians(outJacobians);
+  }
+  void getDesignVariablesImplementation(aslam::backend::DesignVariable::set_t & designVariables) const override {
+    _operand->getDesignVariables(designVariables);
+  }
+ private:
+  boost::shared_ptr<aslam::backend::ScalarExpressionNode> _operand;
+};
+}
+
+TEST(ExpressionErrorTermSuite, testFusedEvaluationReusesNodeValues) {
+  try {
+    using namespace aslam::backend;
+
+    Scalar a(2.0), b(3.0);
+    a.setActive(true);
+    a.setBlockIndex(0);
+    b.setActive(true);
+    b.setBlockIndex(1);
+    auto countingA = boost::make_shared<CountingScalarExpressionNode>(ScalarExpression(&a).root());
+    auto countingB = boost::make_shared<CountingScalarExpressionNode>(ScalarExpression(&b).root());
+    // the product's Jacobians evaluate both operands again
+    ErrorTerm::Ptr error = toErrorTerm(ScalarExpression(countingA) * ScalarExpression(countingB), 1.0);
+
+    JacobianContainerSparse<> expectedJ(1), J(1);
+    const double expectedSquaredError = error->evaluateError();
+    error->evaluateJacobians(expectedJ);
+    EXPECT_EQ(2, countingA->numEvaluations);
+    EXPECT_EQ(2, countingB->numEvaluations);
+
+    countingA->numEvaluations = countingB->numEvaluations = 0;
+    EXPECT_DOUBLE_EQ(expectedSquaredError, error->evaluateErrorAndJacobians(J));
+    EXPECT_TRUE(J.asDenseMatrix().isApprox(expectedJ.asDenseMatrix()));
+    EXPECT_EQ(1, countingA->numEvaluations);
+    EXPECT_EQ(1, countingB->numEvaluations);
+
+    // the values are only reused within one pass
+    a.setParameters(Eigen::MatrixXd::Ones(1,1) * 5.0);
+    JacobianContainerSparse<> J2(1);
+    EXPECT_DOUBLE_EQ(15.0 * 15.0, error->evaluateErrorAndJacobians(J2));
+    EXPECT_DOUBLE_EQ(3.0, J2.asDenseMatrix()(0, 0));
+    EXPECT_DOUBLE_EQ(5.0, J2.asDenseMatrix()(0, 1));
+  } catch (const std::exception & e) {
+    FAIL()<< e.what();
+  }
+}
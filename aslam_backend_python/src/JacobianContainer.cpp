@@ -21,6 +21,11 @@ Eigen::MatrixXd jc_adm2(const JacobianContainerSparse<Eigen::Dynamic>& jc, const
   return jc.asDenseMatrix(cbi);
 }
 
+Eigen::MatrixXd jc_jacobian(const JacobianContainerSparse<Eigen::Dynamic>& jc, const DesignVariable* dv)
+{
+  return jc.Jacobian(dv);
+}
+
 void addWrapper(JacobianContainer& jc, DesignVariable* designVariable, const Eigen::MatrixXd& mat) {
   jc.add(designVariable, mat);
 }
@@ -67,7 +72,7 @@ void exportJacobianContainer()
     .def("designVariable", make_function((DesignVariable * (JCSparse::*)(size_t))&JCSparse::designVariable, return_internal_reference<>()))
       
     /// Get the Jacobian associated with a particular design variable.
-    .def("Jacobian", &JCSparse::Jacobian, return_value_policy<copy_const_reference>())
+    .def("Jacobian", &jc_jacobian)
 
     .def("applyChainRule", &JCSparse::applyChainRule)
 
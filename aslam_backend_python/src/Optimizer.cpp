@@ -126,6 +126,7 @@ void exportOptimizer()
     class_<Optimizer2, boost::shared_ptr<Optimizer2> >("Optimizer2",init<>())
         .def(init<Optimizer2Options>())
         .def("setProblem", &Optimizer2::setProblem)
+        .def("addProblemReplica", &Optimizer2::addProblemReplica)
 
         /// \brief initialize the optimizer to run on an optimization problem.
         ///        This should be called before calling optimize()
@@ -297,6 +298,7 @@ void exportOptimizer()
         .def_readwrite("nMaxIterWolfe1", &LineSearchOptions::nMaxIterWolfe1)
         .def_readwrite("nMaxIterWolfe2", &LineSearchOptions::nMaxIterWolfe2)
         .def_readwrite("nMaxIterZoom", &LineSearchOptions::nMaxIterZoom)
+        .def_readwrite("numParallelEvaluations", &LineSearchOptions::numParallelEvaluations)
         .def("__str__", &toString<LineSearchOptions>)
         ;
 
@@ -304,6 +306,8 @@ void exportOptimizer()
         .def_readwrite("linesearch", &OptimizerOptionsBFGS::linesearch)
         .def_readwrite("useDenseJacobianContainer", &OptimizerOptionsBFGS::useDenseJacobianContainer)
         .def_readwrite("regularizer", &OptimizerOptionsBFGS::regularizer)
+        .def_readwrite("historySize", &OptimizerOptionsBFGS::historySize)
+        .def_readwrite("useDesignVariableScaling", &OptimizerOptionsBFGS::useDesignVariableScaling)
         .def("__str__", &toString<OptimizerOptionsBFGS>)
         ;
 
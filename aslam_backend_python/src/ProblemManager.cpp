@@ -39,6 +39,9 @@ void exportProblemManager()
     .def("saveDesignVariables", &ProblemManager::saveDesignVariables)
     .def("restoreDesignVariables", &ProblemManager::restoreDesignVariables)
     .def("getFlattenedDesignVariableParameters", &ProblemManager::getFlattenedDesignVariableParameters)
+    .def("addReplica", &ProblemManager::addReplica)
+    .add_property("numReplicas", &ProblemManager::numReplicas)
+    .def("clearReplicas", &ProblemManager::clearReplicas)
     .def("computeGradient", &ProblemManager::computeGradient)
     .def("applyDesignVariableScaling", &ProblemManager::applyDesignVariableScaling)
   ;
@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <cstring>
+
+namespace sparse_block_matrix {
+using namespace Eigen;
+
+template<class MatrixType>
+SparseBlockMatrixCCS<MatrixType>::SparseBlockMatrixCCS() {
+}
+
+template<class MatrixType>
+SparseBlockMatrixCCS<MatrixType>::SparseBlockMatrixCCS(const SparseBlockMatrix<MatrixType>& source) {
+  setStructure(source);
+}
+
+template<class MatrixType>
+void SparseBlockMatrixCCS<MatrixType>::setStructure(const SparseBlockMatrix<MatrixType>& source) {
+  _rowBlockIndices = source.rowBlockIndices();
+  _colBlockIndices = source.colBlockIndices();
+
+  const std::vector<typename SparseBlockMatrix<MatrixType>::IntBlockMap>& blockCols = source.blockCols();
+  _colBlockPtr.resize(blockCols.size() + 1);
+  _panelRows.resize(blockCols.size());
+  _colValuePtr.resize(blockCols.size() + 1);
+  _blockRows.clear();
+  _blockRowOffsets.clear();
+  _blockRows.reserve(source.nonZeroBlocks());
+  _blockRowOffsets.reserve(source.nonZeroBlocks());
+
+  size_t numValues = 0;
+  for (size_t c = 0; c < blockCols.size(); ++c) {
+    _colBlockPtr[c] = _blockRows.size();
+    _colValuePtr[c] = numValues;
+    int panelRows = 0;
+    // the map is sorted by block row
+    for (typename SparseBlockMatrix<MatrixType>::IntBlockMap::const_iterator it = blockCols[c].begin(); it != blockCols[c].end(); ++it) {
+      _blockRows.push_back(it->first);
+      _blockRowOffsets.push_back(panelRows);
+      panelRows += rowsOfBlock(it->first);
+    }
+    _panelRows[c] = panelRows;
+    numValues += panelRows * colsOfBlock(c);
+  }
+  _colBlockPtr.back() = _blockRows.size();
+  _colValuePtr.back() = numValues;
+  _values.resize(numValues);
+
+  setValues(source);
+}
+
+template<class MatrixType>
+bool SparseBlockMatrixCCS<MatrixType>::hasStructure(const SparseBlockMatrix<MatrixType>& source) const {
+  if (source.rowBlockIndices() != _rowBlockIndices || source.colBlockIndices() != _colBlockIndices)
+    return false;
+  for (size_t c = 0; c < source.blockCols().size(); ++c) {
+    if (source.blockCols()[c].size() != static_cast<size_t>(_colBlockPtr[c + 1] - _colBlockPtr[c]))
+      return false;
+    int k = _colBlockPtr[c];
+    for (typename SparseBlockMatrix<MatrixType>::IntBlockMap::const_iterator it = source.blockCols()[c].begin(); it != source.blockCols()[c].end(); ++it, ++k) {
+      if (it->first != _blockRows[k])
+        return false;
+    }
+  }
+  return true;
+}
+
+template<class MatrixType>
+void SparseBlockMatrixCCS<MatrixType>::setValues(const SparseBlockMatrix<MatrixType>& source) {
+  SM_ASSERT_EQ(Exception, source.blockCols().size(), _colBlockIndices.size(), "The source matrix has a different structure");
+  SM_ASSERT_TRUE_DBG(Exception, hasStructure(source), "The source matrix has a different structure");
+  for (size_t c = 0; c < source.blockCols().size(); ++c) {
+    int k = _colBlockPtr[c];
+    for (typename SparseBlockMatrix<MatrixType>::IntBlockMap::const_iterator it = source.blockCols()[c].begin(); it != source.blockCols()[c].end(); ++it, ++k) {
+      BlockMap(_values.data() + _colValuePtr[c] + _blockRowOffsets[k], rowsOfBlock(_blockRows[k]), colsOfBlock(c), OuterStride<>(_panelRows[c])) = *it->second;
+    }
+  }
+}
+
+template<class MatrixType>
+int SparseBlockMatrixCCS<MatrixType>::findBlock(int r, int c) const {
+  SM_ASSERT_GE_LT_DBG(IndexException, c, 0, bCols(), "Block column out of range");
+  const std::vector<int>::const_iterator begin = _blockRows.begin() + _colBlockPtr[c];
+  const std::vector<int>::const_iterator end = _blockRows.begin() + _colBlockPtr[c + 1];
+  const std::vector<int>::const_iterator it = std::lower_bound(begin, end, r);
+  return it != end && *it == r ? static_cast<int>(it - _blockRows.begin()) : -1;
+}
+
+template<class MatrixType>
+typename SparseBlockMatrixCCS<MatrixType>::BlockMap SparseBlockMatrixCCS<MatrixType>::block(int r, int c) {
+  const int k = findBlock(r, c);
+  SM_ASSERT_GE(IndexException, k, 0, "There is no block at (" << r << ", " << c << ")");
+  return BlockMap(_values.data() + _colValuePtr[c] + _blockRowOffsets[k], rowsOfBlock(r), colsOfBlock(c), OuterStride<>(_panelRows[c]));
+}
+
+template<class MatrixType>
+typename SparseBlockMatrixCCS<MatrixType>::ConstBlockMap SparseBlockMatrixCCS<MatrixType>::block(int r, int c) const {
+  const int k = findBlock(r, c);
+  SM_ASSERT_GE(IndexException, k, 0, "There is no block at (" << r << ", " << c << ")");
+  return ConstBlockMap(_values.data() + _colValuePtr[c] + _blockRowOffsets[k], rowsOfBlock(r), colsOfBlock(c), OuterStride<>(_panelRows[c]));
+}
+
+template<class MatrixType>
+void SparseBlockMatrixCCS<MatrixType>::setZero() {
+  std::fill(_values.begin(), _values.end(), 0.0);
+}
+
+template<class MatrixType>
+Eigen::MatrixXd SparseBlockMatrixCCS<MatrixType>::toDense() const {
+  Eigen::MatrixXd M = Eigen::MatrixXd::Zero(rows(), cols());
+  for (int c = 0; c < bCols(); ++c) {
+    for (int k = _colBlockPtr[c]; k < _colBlockPtr[c + 1]; ++k) {
+      M.block(rowBaseOfBlock(_blockRows[k]), colBaseOfBlock(c), rowsOfBlock(_blockRows[k]), colsOfBlock(c)) = block(_blockRows[k], c);
+    }
+  }
+  return M;
+}
+
+template<class MatrixType>
+void SparseBlockMatrixCCS<MatrixType>::multiply(double*& dest, const double* src) const {
+  if (!dest) {
+    dest = new double[rows()];
+    memset(dest, 0, rows() * sizeof(double));
+  }
+
+  // map the memory by Eigen
+  Map<VectorXd> destVec(dest, rows());
+  Map<const VectorXd> srcVec(src, cols());
+
+  for (int c = 0; c < bCols(); ++c) {
+    const int csize = colsOfBlock(c);
+    const Map<const MatrixXd, Unaligned, OuterStride<> > panel(_values.data() + _colValuePtr[c], _panelRows[c], csize, OuterStride<>(_panelRows[c]));
+    const Map<const VectorXd> x(src + colBaseOfBlock(c), csize);
+    for (int k = _colBlockPtr[c]; k < _colBlockPtr[c + 1]; ++k) {
+      const int r = _blockRows[k];
+      destVec.segment(rowBaseOfBlock(r), rowsOfBlock(r)).noalias() += panel.middleRows(_blockRowOffsets[k], rowsOfBlock(r)) * x;
+    }
+  }
+}
+
+template<class MatrixType>
+void SparseBlockMatrixCCS<MatrixType>::multiply(VectorXd * dest, const VectorXd & src) const {
+  // Dimension CHECK:
+  assert(cols() == src.rows());
+  assert(rows() == dest->rows());
+  dest->setZero();
+  double* d = dest->data();
+  multiply(d, src.data());
+}
+
+template<class MatrixType>
+void SparseBlockMatrixCCS<MatrixType>::rightMultiply(double*& dest, const double* src) const {
+  if (!dest) {
+    dest = new double[cols()];
+    memset(dest, 0, cols() * sizeof(double));
+  }
+
+  // map the memory by Eigen
+  Map<VectorXd> destVec(dest, cols());
+  Map<const VectorXd> srcVec(src, rows());
+
+  for (int c = 0; c < bCols(); ++c) {
+    const int csize = colsOfBlock(c);
+    const Map<const MatrixXd, Unaligned, OuterStride<> > panel(_values.data() + _colValuePtr[c], _panelRows[c], csize, OuterStride<>(_panelRows[c]));
+    Map<VectorXd> y(dest + colBaseOfBlock(c), csize);
+    for (int k = _colBlockPtr[c]; k < _colBlockPtr[c + 1]; ++k) {
+      const int r = _blockRows[k];
+      y.noalias() += panel.middleRows(_blockRowOffsets[k], rowsOfBlock(r)).transpose() * srcVec.segment(rowBaseOfBlock(r), rowsOfBlock(r));
+    }
+  }
+}
+
+template<class MatrixType>
+void SparseBlockMatrixCCS<MatrixType>::rightMultiply(VectorXd * dest, const VectorXd & src) const {
+  // Dimension CHECK:
+  assert(rows() == src.rows());
+  assert(cols() == dest->rows());
+  dest->setZero();
+  double* d = dest->data();
+  rightMultiply(d, src.data());
+}
+
+template<class MatrixType>
+template<typename IntType>
+IntType SparseBlockMatrixCCS<MatrixType>::fillCCS(double* Cx, bool upperTriangle) const {
+  if (!upperTriangle) {
+    // the values are stored in compressed column order already
+    memcpy(Cx, _values.data(), _values.size() * sizeof(double));
+    return _values.size();
+  }
+  double* CxStart = Cx;
+  for (int i = 0; i < bCols(); ++i) {
+    const int cstart = colBaseOfBlock(i);
+    const int csize = colsOfBlock(i);
+    const int panelRows = _panelRows[i];
+    // the rows of the diagonal block below the diagonal are skipped
+    int diagonalOffset = -1, diagonalRows = 0;
+    for (int k = _colBlockPtr[i]; k < _colBlockPtr[i + 1]; ++k) {
+      if (rowBaseOfBlock(_blockRows[k]) == cstart) {
+        diagonalOffset = _blockRowOffsets[k];
+        diagonalRows = rowsOfBlock(_blockRows[k]);
+      }
+    }
+    const double* panelColumn = _values.data() + _colValuePtr[i];
+    for (int c = 0; c < csize; ++c, panelColumn += panelRows) {
+      if (diagonalOffset < 0) {
+        memcpy(Cx, panelColumn, panelRows * sizeof(double));
+        Cx += panelRows;
+      } else {
+        const int head = diagonalOffset + c + 1;
+        const int tail = diagonalOffset + diagonalRows;
+        memcpy(Cx, panelColumn, head * sizeof(double));
+        Cx += head;
+        memcpy(Cx, panelColumn + tail, (panelRows - tail) * sizeof(double));
+        Cx += panelRows - tail;
+      }
+    }
+  }
+  return Cx - CxStart;
+}
+
+template<class MatrixType>
+template<typename IntType>
+IntType SparseBlockMatrixCCS<MatrixType>::fillCCS(IntType* Cp, IntType* Ci, double* Cx, bool upperTriangle) const {
+  IntType nz = 0;
+  for (int i = 0; i < bCols(); ++i) {
+    const IntType cstart = colBaseOfBlock(i);
+    const IntType csize = colsOfBlock(i);
+    for (IntType c = 0; c < csize; ++c) {
+      *Cp++ = nz;
+      for (int k = _colBlockPtr[i]; k < _colBlockPtr[i + 1]; ++k) {
+        IntType rstart = rowBaseOfBlock(_blockRows[k]);
+        int elemsToCopy = rowsOfBlock(_blockRows[k]);
+        if (upperTriangle && rstart == cstart)
+          elemsToCopy = c + 1;
+        for (int r = 0; r < elemsToCopy; ++r) {
+          *Ci++ = rstart++;
+          ++nz;
+        }
+      }
+    }
+  }
+  *Cp = nz;
+  fillCCS<IntType>(Cx, upperTriangle);
+  return nz;
+}
+
+template<class MatrixType>
+void SparseBlockMatrixCCS<MatrixType>::fillBlockStructure(MatrixStructure& ms) const {
+  const int n = bCols();
+  ms.alloc(n, static_cast<int>(nonZeroBlocks()));
+  ms.m = bRows();
+
+  int nz = 0;
+  int* Cp = ms.Ap;
+  int* Ci = ms.Aii;
+  for (int c = 0; c < n; ++c) {
+    *Cp++ = nz;
+    for (int k = _colBlockPtr[c]; k < _colBlockPtr[c + 1]; ++k) {
+      if (_blockRows[k] <= c) {
+        *Ci++ = _blockRows[k];
+        ++nz;
+      }
+    }
+  }
+  *Cp = nz;
+}
+
+} //end namespace
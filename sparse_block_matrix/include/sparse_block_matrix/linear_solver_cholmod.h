@@ -18,6 +18,7 @@
 #define SBM_LINEAR_SOLVER_CHOLMOD
 
 #include <sparse_block_matrix/linear_solver.h>
+#include <sparse_block_matrix/sparse_block_matrix_ccs.h>
 #include <sparse_block_matrix/marginal_covariance_cholesky.h>
 #include <sparse_block_matrix/sparse_helper.h>
 #include <cholmod.h>
@@ -69,46 +70,13 @@ class LinearSolverCholmod : public LinearSolver<MatrixType>
 
     bool solve(const SparseBlockMatrix<MatrixType>& A, double* x, double* b) override
     {
-             
-      //cerr << __PRETTY_FUNCTION__ << " using cholmod" << endl;
-      fillCholmodExt(A, _cholmodFactor); // _cholmodFactor used as bool, if not existing will copy the whole structure, otherwise only the values
-
-      if (! _cholmodFactor) {
-        computeSymbolicDecomposition(A);
-        assert(_cholmodFactor && "Symbolic cholesky failed");
-      }
-      //double t=get_time();
-
-      // setting up b for calling cholmod
-      cholmod_dense bcholmod;
-      bcholmod.nrow  = bcholmod.d = _cholmodSparse->nrow;
-      bcholmod.ncol  = 1;
-      bcholmod.x     = b;
-      bcholmod.xtype = CHOLMOD_REAL;
-      bcholmod.dtype = CHOLMOD_DOUBLE;  
-            
-      cholmod_factorize(_cholmodSparse, _cholmodFactor, &_cholmodCommon);
-      if (_cholmodCommon.status == CHOLMOD_NOT_POSDEF) {
-        if (_cholmodFactor) {
-          cholmod_free_factor(&_cholmodFactor, &_cholmodCommon);
-          _cholmodFactor = 0;
-        }
-
-        //std::cerr << "Cholesky failure\n";//, writing debug.txt (Hessian loadable by Octave)" << std::endl;
-        //writeCCSMatrix("debug.txt", _cholmodSparse->nrow, _cholmodSparse->ncol, (int*)_cholmodSparse->p, (int*)_cholmodSparse->i, (double*)_cholmodSparse->x, true);
-        return false;
-      }
-
-      cholmod_dense* xcholmod = cholmod_solve(CHOLMOD_A, _cholmodFactor, &bcholmod, &_cholmodCommon);
-      memcpy(x, xcholmod->x, sizeof(double) * bcholmod.nrow); // copy back to our array
-      cholmod_free_dense(&xcholmod, &_cholmodCommon);
-
-      //if (globalStats){
-      //  globalStats->timeNumericDecomposition = get_time() - t;
-      //  globalStats->choleskyNNZ = _cholmodCommon.method[0].lnz;
-      //}
+      return solveImpl(A, x, b);
+    }
 
-      return true;
+    //! solve with a matrix in compressed block column storage, its values are copied with memcpy
+    bool solve(const SparseBlockMatrixCCS<MatrixType>& A, double* x, double* b)
+    {
+      return solveImpl(A, x, b);
     }
 
     bool solveBlocks(double**& blocks, const SparseBlockMatrix<MatrixType>& A) override
@@ -214,7 +182,52 @@ class LinearSolverCholmod : public LinearSolver<MatrixType>
     MatrixStructure _matrixStructure;
     VectorXi _scalarPermutation, _blockPermutation;
 
-    void computeSymbolicDecomposition(const SparseBlockMatrix<MatrixType>& A)
+    template <typename SPARSE_MATRIX>
+    bool solveImpl(const SPARSE_MATRIX& A, double* x, double* b)
+    {
+      //cerr << __PRETTY_FUNCTION__ << " using cholmod" << endl;
+      fillCholmodExt(A, _cholmodFactor); // _cholmodFactor used as bool, if not existing will copy the whole structure, otherwise only the values
+
+      if (! _cholmodFactor) {
+        computeSymbolicDecomposition(A);
+        assert(_cholmodFactor && "Symbolic cholesky failed");
+      }
+      //double t=get_time();
+
+      // setting up b for calling cholmod
+      cholmod_dense bcholmod;
+      bcholmod.nrow  = bcholmod.d = _cholmodSparse->nrow;
+      bcholmod.ncol  = 1;
+      bcholmod.x     = b;
+      bcholmod.xtype = CHOLMOD_REAL;
+      bcholmod.dtype = CHOLMOD_DOUBLE;  
+            
+      cholmod_factorize(_cholmodSparse, _cholmodFactor, &_cholmodCommon);
+      if (_cholmodCommon.status == CHOLMOD_NOT_POSDEF) {
+        if (_cholmodFactor) {
+          cholmod_free_factor(&_cholmodFactor, &_cholmodCommon);
+          _cholmodFactor = 0;
+        }
+
+        //std::cerr << "Cholesky failure\n";//, writing debug.txt (Hessian loadable by Octave)" << std::endl;
+        //writeCCSMatrix("debug.txt", _cholmodSparse->nrow, _cholmodSparse->ncol, (int*)_cholmodSparse->p, (int*)_cholmodSparse->i, (double*)_cholmodSparse->x, true);
+        return false;
+      }
+
+      cholmod_dense* xcholmod = cholmod_solve(CHOLMOD_A, _cholmodFactor, &bcholmod, &_cholmodCommon);
+      memcpy(x, xcholmod->x, sizeof(double) * bcholmod.nrow); // copy back to our array
+      cholmod_free_dense(&xcholmod, &_cholmodCommon);
+
+      //if (globalStats){
+      //  globalStats->timeNumericDecomposition = get_time() - t;
+      //  globalStats->choleskyNNZ = _cholmodCommon.method[0].lnz;
+      //}
+
+      return true;
+    }
+
+    template <typename SPARSE_MATRIX>
+    void computeSymbolicDecomposition(const SPARSE_MATRIX& A)
     {
       // double t = get_time();
       if (! _blockOrdering) {
@@ -282,7 +295,8 @@ class LinearSolverCholmod : public LinearSolver<MatrixType>
 
     }
 
-    void fillCholmodExt(const SparseBlockMatrix<MatrixType>& A, bool onlyValues)
+    template <typename SPARSE_MATRIX>
+    void fillCholmodExt(const SPARSE_MATRIX& A, bool onlyValues)
     {
       size_t m = A.rows();
       size_t n = A.cols();
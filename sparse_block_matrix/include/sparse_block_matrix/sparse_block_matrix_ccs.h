@@ -0,0 +1,140 @@
+#ifndef __SPARSE_BLOCK_MATRIX_CCS__
+#define __SPARSE_BLOCK_MATRIX_CCS__
+
+#include <vector>
+#include <Eigen/Core>
+
+#include "sparse_block_matrix.h"
+
+namespace sparse_block_matrix {
+  using namespace Eigen;
+/**
+ * \brief Sparse block matrix in compressed block column storage
+ *
+ * The structure is frozen when the matrix is built from a SparseBlockMatrix:
+ * per block column, the row indices of the non-zero blocks are sorted in one vector
+ * and all values live in one contiguous array. The blocks of a block column are
+ * stacked vertically and stored column major, i.e. the values of a block column are
+ * exactly its scalar compressed column storage. Block lookups are a binary search
+ * and copying the values into a CCS matrix is a memcpy.
+ *
+ * Use setValues() to update the values of a matrix with the same structure.
+ */
+template <class MatrixType = MatrixXd >
+class SparseBlockMatrixCCS {
+ public:
+  //! this is the scalar type of the matrix entries.
+  typedef typename MatrixType::Scalar Scalar;
+  //! a view on a block inside the value array
+  typedef Map<MatrixType, Unaligned, OuterStride<> > BlockMap;
+  //! a constant view on a block inside the value array
+  typedef Map<const MatrixType, Unaligned, OuterStride<> > ConstBlockMap;
+
+  SM_DEFINE_EXCEPTION(Exception, std::runtime_error);
+  SM_DEFINE_EXCEPTION(IndexException, Exception);
+
+  SparseBlockMatrixCCS();
+
+  //! builds the structure and copies the values from \p source
+  explicit SparseBlockMatrixCCS(const SparseBlockMatrix<MatrixType>& source);
+
+  //! freezes the block structure of \p source and copies its values
+  void setStructure(const SparseBlockMatrix<MatrixType>& source);
+
+  //! copies the values of \p source, which must have the structure this matrix was built from
+  void setValues(const SparseBlockMatrix<MatrixType>& source);
+
+  //! does \p source have the structure of this matrix?
+  bool hasStructure(const SparseBlockMatrix<MatrixType>& source) const;
+
+  //! columns of the matrix
+  inline int cols() const {return _colBlockIndices.size() ? _colBlockIndices.back() : 0;}
+  //! rows of the matrix
+  inline int rows() const {return _rowBlockIndices.size() ? _rowBlockIndices.back() : 0;}
+
+  //! block columns of the matrix
+  inline int bCols() const {return _colBlockIndices.size();}
+  //! block rows of the matrix
+  inline int bRows() const {return _rowBlockIndices.size();}
+
+  //! how many rows does the block at block-row r have?
+  inline int rowsOfBlock(int r) const { return r ? _rowBlockIndices[r] - _rowBlockIndices[r-1] : _rowBlockIndices[0] ; }
+  //! how many cols does the block at block-col c have?
+  inline int colsOfBlock(int c) const { return c ? _colBlockIndices[c] - _colBlockIndices[c-1] : _colBlockIndices[0]; }
+  //! where does the row at block-row r starts?
+  inline int rowBaseOfBlock(int r) const { return r ? _rowBlockIndices[r-1] : 0 ; }
+  //! where does the col at block-col r starts?
+  inline int colBaseOfBlock(int c) const { return c ? _colBlockIndices[c-1] : 0 ; }
+
+  //! is there a block at location r,c?
+  bool isBlockSet(int r, int c) const { return findBlock(r, c) >= 0; }
+
+  //! returns the block at location r,c. The block has to exist.
+  BlockMap block(int r, int c);
+  //! returns the block at location r,c. The block has to exist.
+  ConstBlockMap block(int r, int c) const;
+
+  //! number of non-zero elements
+  size_t nonZeros() const { return _values.size(); }
+  //! number of non-zero blocks
+  size_t nonZeroBlocks() const { return _blockRows.size(); }
+
+  //! this zeroes all the blocks, the structure is kept
+  void setZero();
+
+  Eigen::MatrixXd toDense() const;
+
+  //! dest = (*this) * src
+  void multiply(double*& dest, const double* src) const;
+  //! dest = (*this) * src
+  void multiply(VectorXd * dest, const VectorXd & src) const;
+  //! dest = (*this)^T * src
+  void rightMultiply(double*& dest, const double* src) const;
+  //! dest = (*this)^T * src
+  void rightMultiply(VectorXd * dest, const VectorXd & src) const;
+
+  /**
+   * fill the CCS arrays of a matrix, arrays have to be allocated beforehand
+   */
+  template<typename IntType>
+  IntType fillCCS(IntType* Cp, IntType* Ci, double* Cx, bool upperTriangle = false) const;
+
+  /**
+   * fill the CCS values of a matrix, arrays have to be allocated beforehand. This function only writes
+   * the values and assumes that column and row structures have already been written.
+   */
+  template<typename IntType>
+  IntType fillCCS(double* Cx, bool upperTriangle = false) const;
+
+  //! exports the non zero blocks in the structure matrix ms
+  void fillBlockStructure(MatrixStructure& ms) const;
+
+  //! indices of the row blocks
+  const std::vector<int>& rowBlockIndices() const { return _rowBlockIndices;}
+  //! indices of the column blocks
+  const std::vector<int>& colBlockIndices() const { return _colBlockIndices;}
+
+  //! the values of all blocks, block column by block column
+  const std::vector<double>& values() const { return _values; }
+
+ protected:
+  //! index of the block r,c in _blockRows or -1
+  int findBlock(int r, int c) const;
+
+  std::vector<int> _rowBlockIndices; ///< vector of the indices of the blocks along the rows.
+  std::vector<int> _colBlockIndices; ///< vector of the indices of the blocks along the cols
+  std::vector<int> _colBlockPtr; ///< the blocks of block column c are [_colBlockPtr[c], _colBlockPtr[c + 1])
+  std::vector<int> _blockRows; ///< the block row of each block, sorted within a block column
+  std::vector<int> _blockRowOffsets; ///< the first row of each block within the stacked blocks of its block column
+  std::vector<int> _panelRows; ///< the number of rows of the stacked blocks of each block column
+  std::vector<size_t> _colValuePtr; ///< the values of block column c are [_colValuePtr[c], _colValuePtr[c + 1])
+  std::vector<double> _values; ///< the values of all blocks
+};
+
+  typedef SparseBlockMatrixCCS<MatrixXd> SparseBlockMatrixCCSXd;
+
+} //end namespace
+
+#include "implementation/sparse_block_matrix_ccs.hpp"
+
+#endif
@@ -126,3 +126,28 @@ TEST(g2oTestSuite, testCholmod)
 
 
 }
+
+TEST(g2oTestSuite, testCholmodCompressedBlockColumns)
+{
+  typedef sparse_block_matrix::LinearSolverCholmod<Eigen::MatrixXd> solver_t;
+  int rows[] = {3,6,11};
+  sparse_block_matrix::SparseBlockMatrix<Eigen::MatrixXd> A(rows,rows,3,3);
+  Eigen::MatrixXd Adense = Eigen::MatrixXd::Zero(11,11);
+  randomSparseBlockMatrix<solver_t>(&A, Adense);
+  sparse_block_matrix::SparseBlockMatrixCCS<Eigen::MatrixXd> Accs(A);
+
+  solver_t solver;
+  ASSERT_TRUE(solver.init());
+  Eigen::VectorXd bb = Eigen::VectorXd::Random(A.rows());
+  Eigen::VectorXd xx = Eigen::VectorXd::Zero(A.rows());
+  ASSERT_TRUE(solver.solve(Accs,&xx[0],&bb[0]));
+  Eigen::VectorXd dx = Adense.selfadjointView<Eigen::Upper>().ldlt().solve(bb);
+  sm::eigen::assertNear(dx,xx,1e-10,SM_SOURCE_FILE_POS, "A: dense solution, B: solution from cholmod with compressed block columns");
+
+  // new values with the same structure reuse the symbolic factorization
+  randomSparseBlockMatrix<solver_t>(&A, Adense);
+  Accs.setValues(A);
+  ASSERT_TRUE(solver.solve(Accs,&xx[0],&bb[0]));
+  dx = Adense.selfadjointView<Eigen::Upper>().ldlt().solve(bb);
+  sm::eigen::assertNear(dx,xx,1e-10,SM_SOURCE_FILE_POS, "A: dense solution, B: solution from cholmod with compressed block columns");
+}
@@ -5,6 +5,7 @@
 // Helpful functions from schweizer_messer
 #include <sm/eigen/gtest.hpp>
 #include <sparse_block_matrix/sparse_block_matrix.h>
+#include <sparse_block_matrix/sparse_block_matrix_ccs.h>
 #include <boost/random/linear_congruential.hpp>
 #include <boost/random/uniform_int.hpp>
 #include <boost/random/uniform_real.hpp>
@@ -396,6 +397,81 @@ TEST(sparse_block_matrixTestSuite, testMatrixMatrixMultiplication) {
     FAIL() << e.what();
   }
 }
+TEST(sparse_block_matrixTestSuite, testCompressedBlockColumnStorage) {
+
+  using namespace Eigen;
+  using namespace sparse_block_matrix;
+  VectorXi rows(3);
+  rows << 3, 6, 11;
+  VectorXi cols(4);
+  cols << 4, 9, 12, 18;
+
+  SparseBlockMatrix<MatrixXd> M1 = buildRandomMatrix<MatrixXd>(rows, cols, 0.5);
+  SparseBlockMatrixCCS<MatrixXd> C1(M1);
+
+  ASSERT_EQ(M1.rows(), C1.rows());
+  ASSERT_EQ(M1.cols(), C1.cols());
+  ASSERT_EQ(M1.nonZeroBlocks(), C1.nonZeroBlocks());
+  ASSERT_EQ(M1.nonZeros(), C1.nonZeros());
+  ASSERT_TRUE(C1.hasStructure(M1));
+  sm::eigen::assertEqual(M1.toDense(), C1.toDense(), SM_SOURCE_FILE_POS);
+
+  for (int c = 0; c < M1.bCols(); ++c) {
+    for (int r = 0; r < M1.bRows(); ++r) {
+      const MatrixXd* B = M1.block(r, c);
+      ASSERT_EQ(B != NULL, C1.isBlockSet(r, c));
+      if (B)
+        sm::eigen::assertEqual(*B, MatrixXd(C1.block(r, c)), SM_SOURCE_FILE_POS);
+      else
+        EXPECT_THROW(C1.block(r, c), SparseBlockMatrixCCS<MatrixXd>::IndexException);
+    }
+  }
+
+  // products
+  VectorXd x = VectorXd::Random(M1.cols());
+  VectorXd y(M1.rows()), yc(M1.rows());
+  M1.multiply(&y, x);
+  C1.multiply(&yc, x);
+  sm::eigen::assertNear(y, yc, 1e-12, SM_SOURCE_FILE_POS);
+  VectorXd z = VectorXd::Random(M1.rows());
+  VectorXd w(M1.cols()), wc(M1.cols());
+  M1.rightMultiply(&w, z);
+  C1.rightMultiply(&wc, z);
+  sm::eigen::assertNear(w, wc, 1e-12, SM_SOURCE_FILE_POS);
+
+  // new values with the same structure
+  for (int c = 0; c < M1.bCols(); ++c)
+    for (int r = 0; r < M1.bRows(); ++r)
+      if (M1.block(r, c))
+        M1.block(r, c)->setRandom();
+  C1.setValues(M1);
+  sm::eigen::assertEqual(M1.toDense(), C1.toDense(), SM_SOURCE_FILE_POS);
+
+  // a symmetric matrix with the upper triangle stored, compressed columns with and without the upper triangle only
+  VectorXi sym(4);
+  sym << 2, 5, 9, 10;
+  SparseBlockMatrix<MatrixXd> S = buildRandomMatrix<MatrixXd>(sym, sym, 0.5);
+  for (int i = 0; i < S.bCols(); ++i)
+    S.block(i, i, true)->setRandom();
+  SparseBlockMatrixCCS<MatrixXd> CS(S);
+  for (bool upperTriangle : { false, true }) {
+    SCOPED_TRACE(testing::Message() << "upperTriangle: " << upperTriangle);
+    std::vector<int> Cp(S.cols() + 1), Ci(S.nonZeros()), CpC(S.cols() + 1), CiC(S.nonZeros());
+    std::vector<double> Cx(S.nonZeros()), CxC(S.nonZeros());
+    const int nz = S.fillCCS(&Cp[0], &Ci[0], &Cx[0], upperTriangle);
+    ASSERT_EQ(nz, CS.fillCCS(&CpC[0], &CiC[0], &CxC[0], upperTriangle));
+    EXPECT_TRUE(Cp == CpC);
+    for (int i = 0; i < nz; ++i) {
+      EXPECT_EQ(Ci[i], CiC[i]);
+      EXPECT_EQ(Cx[i], CxC[i]);
+    }
+    std::fill(CxC.begin(), CxC.end(), 0.0);
+    ASSERT_EQ(nz, CS.fillCCS<int>(&CxC[0], upperTriangle));
+    for (int i = 0; i < nz; ++i)
+      EXPECT_EQ(Cx[i], CxC[i]);
+  }
+}
+
 // //! adds the current matrix to the destination
 // bool add(SparseBlockMatrix<MatrixType>*& dest) const ;
 